@@ -26,6 +26,7 @@
 #include "deltaQ.h"
 #include "generic.h"
 #include "active_tag.h"
+#include "link_table.h"
 
 // use this parameter to modify the range of the active tag
 // 1.0 => no scaling; <1.0 => range is increased; >1.0 => range is decreased 
@@ -101,6 +102,57 @@ struct interface_class *interface;
 // DeltaQ parameter computation functions
 ///////////////////////////////////////////
 
+// adjust the FER 'fer' computed for 4 byte packets to packets
+// of size 'packet_size' (see 'active_tag_fer()')
+static double
+active_tag_packet_fer(fer, packet_size)
+double fer;
+int packet_size;
+{
+    return 1 - pow ((1 - fer), (6.0 + packet_size) / (6.0 + 4.0));
+}
+
+// function tabulated by the link tables of the packet size
+// adjustment, for which 'context' is the packet size;
+// return SUCCESS on succes, ERROR on error
+static int
+active_tag_packet_fer_table_function(fer, context, values)
+double fer;
+void *context;
+double *values;
+{
+    values[0] = active_tag_packet_fer(fer, *((int *)context));
+
+    return SUCCESS;
+}
+
+// adjust the FER like 'active_tag_packet_fer()'; if link tables
+// are enabled, the FER is interpolated from the table of the
+// packet size
+static double
+active_tag_packet_fer_lookup(fer, packet_size)
+double fer;
+int packet_size;
+{
+    if(link_table_enabled == TRUE) {
+        double key[LINK_TABLE_KEY_SIZE] = { packet_size };
+        struct link_table_class *table;
+        double packet_fer;
+
+        table = link_table_find(LINK_TABLE_ACTIVE_TAG_FER, key);
+        if(table == NULL) {
+            table = link_table_build(LINK_TABLE_ACTIVE_TAG_FER, key, 0, 1, 1,
+                    active_tag_packet_fer_table_function, &packet_size);
+        }
+
+        if(table != NULL && link_table_lookup(table, fer, &packet_fer) == TRUE) {
+            return packet_fer;
+        }
+    }
+
+    return active_tag_packet_fer(fer, packet_size);
+}
+
 // compute FER corresponding to the current conditions
 // for a given operating rate
 // return SUCCESS on succes, ERROR on error
@@ -192,7 +244,7 @@ double *fer;
     // which increases faster with distance than the measured data;
     // measured data showed a slower increase since 2-bit errors were
     // reported as no error
-    (*fer) = 1 - pow ((1 - (*fer)), (6.0 + connection->packet_size) / (6.0 + 4.0));
+    (*fer) = active_tag_packet_fer_lookup((*fer), connection->packet_size);
     DEBUG("Adjusted connection FER = %f", (*fer));
 
     return SUCCESS;
@@ -337,7 +389,7 @@ struct scenario_class *scenario;
 
             connection->Pr = node_tx->interfaces[connection->from_interface_index].Pr0 -
                 10 * environment->alpha[0] * log10(distance) -
-                environment->W[0] + randn (0, environment->sigma[0]) +
+                environment->W[0] + connection_shadowing (connection, scenario, environment->sigma[0]) +
                 node_rx->interfaces[connection->to_interface_index].antenna_gain;
         }
         else {
@@ -389,7 +441,7 @@ struct scenario_class *scenario;
             connection->Pr -= W_sum;
 
             // take into account shadowing
-            connection->Pr += randn(0, sqrt(sigma_square_sum));
+            connection->Pr += connection_shadowing(connection, scenario, sqrt(sigma_square_sum));
 
             DEBUG ("Pr=%f W_s=%f s_s_s=%f\n", connection->Pr, W_sum, sigma_square_sum);
         }
@@ -433,7 +485,7 @@ struct scenario_class *scenario;
     struct connection_class virtual_connection;
 
     // do not consider again this node if it was processed before
-    if(scenario->nodes[connection_i->from_node_index].interfaces[connection_i->from_interface_index].interference_accounted == TRUE) {
+    if(scenario_interference_accounted(scenario, connection_i->from_node_index, connection_i->from_interface_index) == TRUE) {
         return TRUE;
     }
 
@@ -446,7 +498,7 @@ struct scenario_class *scenario;
     INFO("Building a virtual connection from '%s' to '%s'", connection_i->from_node, connection->to_node);
 
     // mark the interference_accounted flag
-    scenario->nodes[connection_i->from_node_index].interfaces[connection_i->from_interface_index].interference_accounted = TRUE;
+    scenario_set_interference_accounted(scenario, connection_i->from_node_index, connection_i->from_interface_index);
 
     connection_copy(&virtual_connection, connection_i);
     virtual_connection.to_node_index = connection->to_node_index;
@@ -500,7 +552,8 @@ struct scenario_class *scenario;
     for(connection_i = 0; connection_i < scenario->connection_number; connection_i++) {
         // look only at connections that are not the same with
         // the current one
-        if(connection != &(scenario->connections[connection_i])) {
+        if(connection != &(scenario->connections[connection_i]) &&
+                connection != scenario_interfering_connection(scenario, connection_i)) {
             //printf("Found a different connection...\n");
             /*
                this will be used perhaps later for optimization purposes
@@ -526,7 +579,7 @@ struct scenario_class *scenario;
                 DEBUG("--------------------------------------------");
                 DEBUG("Interference between active tags '%s' and '%s' detected \
                         => determine effects", connection->from_node, scenario->connections[connection_i].from_node);
-                active_tag_compute_interference(connection, &(scenario->connections[connection_i]), scenario);
+                active_tag_compute_interference(connection, scenario_interfering_connection(scenario, connection_i), scenario);
             }
         }
     }
@@ -27,6 +27,7 @@
 #include "deltaQ.h"
 
 #include "connection.h"
+#include "generic.h"
 
 #include "wlan.h"
 #include "ethernet.h"
@@ -81,6 +82,7 @@ connection_init (struct connection_class *connection, char *from_node,
 
   // initialize dynamic parameters
   connection->Pr = 0;
+  connection->shadowing_sigma = 0;
   connection->SNR = 0;
   connection->distance = -1;
   connection->concurrent_stations = 0;
@@ -477,6 +479,7 @@ connection_copy (struct connection_class *connection_dst,
 
   // initialize dynamic parameters
   connection_dst->Pr = connection_src->Pr;
+  connection_dst->shadowing_sigma = connection_src->shadowing_sigma;
   connection_dst->SNR = connection_src->SNR;
   connection_dst->distance = connection_src->distance;
 
@@ -904,15 +907,73 @@ connection_do_compute (struct connection_class *connection,
   return SUCCESS;
 }
 
-// update the state and calculate all deltaQ parameters 
-// for the current connection;
-// deltaQ parameters are returned in the corresponding fields of
-// the connection objects and the last argument is set to TRUE if 
-// any parameter values were changed, or to FALSE otherwise;
+// return the shadowing term of the received power of a connection,
+// drawn from a normal distribution with standard deviation 'sigma';
+// while the scenario defers shadowing, no value is drawn and 0 is
+// returned; 'sigma' is saved in the connection in both cases
+double
+connection_shadowing (struct connection_class *connection,
+		      struct scenario_class *scenario, double sigma)
+{
+  connection->shadowing_sigma = sigma;
+
+  if (scenario->shadowing_deferred == TRUE)
+    return 0;
+
+  return randn (0, sigma);
+}
+
+// apply the fixed_deltaQ record of a connection that corresponds
+// to 'current_time', if any
+void
+connection_apply_fixed_deltaQ (struct connection_class *connection,
+			       double current_time)
+{
+  struct fixed_deltaQ_class *fixed_deltaQ;
+
+  if (connection->fixed_deltaQ_number == 0)
+    return;
+
+  fixed_deltaQ = &(connection->fixed_deltaQs[connection->fixed_deltaQ_crt]);
+
+  // advance to next record if needed
+  if (fixed_deltaQ->end_time <= current_time)
+    if (connection->fixed_deltaQ_crt < (connection->fixed_deltaQ_number - 1))
+      {
+	connection->fixed_deltaQ_crt++;
+	fixed_deltaQ = &(connection->fixed_deltaQs
+			 [connection->fixed_deltaQ_crt]);
+      }
+
+  DEBUG ("fixed_deltaQ: fixed_deltaQ_number=%d fixed_deltaQ_crt=%d \
+current_time=%.2f", connection->fixed_deltaQ_number, connection->fixed_deltaQ_crt, current_time);
+
+  if (fixed_deltaQ->start_time <= current_time)
+    {
+      connection->bandwidth_defined = TRUE;
+      connection->bandwidth = fixed_deltaQ->bandwidth;
+      connection->loss_rate_defined = TRUE;
+      connection->loss_rate = fixed_deltaQ->loss_rate;
+      connection->delay_defined = TRUE;
+      connection->delay = fixed_deltaQ->delay;
+      connection->jitter_defined = TRUE;
+      connection->jitter = fixed_deltaQ->jitter;
+    }
+  else
+    {
+      connection->bandwidth_defined = FALSE;
+      connection->loss_rate_defined = FALSE;
+      connection->delay_defined = FALSE;
+      connection->jitter_defined = FALSE;
+    }
+}
+
+// update the state of a connection (e.g., relative distance, Pr)
+// after the state of the system changed;
 // return SUCCESS on succes, ERROR on error
 int
-connection_deltaQ (struct connection_class *connection,
-		   struct scenario_class *scenario, int *deltaQ_changed)
+connection_update (struct connection_class *connection,
+		   struct scenario_class *scenario)
 {
   // check if "from_node" could not be found
   if (connection->from_node_index == INVALID_INDEX)
@@ -1011,6 +1072,22 @@ doesn't exist in scenario.\n", connection->through_environment);
       return ERROR;
     }
 
+  return SUCCESS;
+}
+
+// update the state and calculate all deltaQ parameters 
+// for the current connection;
+// deltaQ parameters are returned in the corresponding fields of
+// the connection objects and the last argument is set to TRUE if 
+// any parameter values were changed, or to FALSE otherwise;
+// return SUCCESS on succes, ERROR on error
+int
+connection_deltaQ (struct connection_class *connection,
+		   struct scenario_class *scenario, int *deltaQ_changed)
+{
+  if (connection_update (connection, scenario) == ERROR)
+    return ERROR;
+
   // compute deltaQ for connection
   if (connection_do_compute (connection, scenario, deltaQ_changed) == ERROR)
     {
@@ -32,8 +32,18 @@
 #include <limits.h>
 #include <string.h>
 #include <time.h>
+#include <float.h>
+#include <pthread.h>
 
 #include "deltaQ.h"		// include file of deltaQ library
+#include "io_writer.h"
+#include "io_columnar.h"
+#include "io_slice.h"
+#include "io_summary.h"
+#include "io_checkpoint.h"
+#include "ensemble.h"
+#include "sweep.h"
+#include "link_table.h"
 #include "message.h"
 
 //#define DISABLE_EMPTY_TIME_RECORDS
@@ -48,6 +58,64 @@
 #define MOTION_OUTPUT_NS2         1
 
 
+///////////////////////////////////////////////////////////
+// Run structures
+///////////////////////////////////////////////////////////
+
+// options of a deltaQ run; the same options are used
+// for all the variants of a sweep
+struct run_options_class {
+    // output control
+    int text_output_enabled;
+    int binary_output_enabled;
+    int text_only_enabled;
+    int binary_only_enabled;
+    int motion_output_enabled;
+    int motion_output_type;
+    int columnar_output_enabled;
+    int summary_output_enabled;
+    int per_host_group_size;
+    int object_output_enabled;
+
+    // computation control
+    int deltaQ_disabled;
+    int thread_number;
+    int window_enabled;
+    double window_start, window_end;
+    int checkpoint_interval;
+    int replica_number;
+    int resume_enabled;
+    char *output_file_mode;
+
+    // revision information
+    long int svn_revision;
+    char *qomet_name;
+};
+
+// state shared by the threads that compute the variants of a sweep;
+// variants are handed to threads in order as they become idle
+struct sweep_run_class {
+    struct run_options_class *options;
+    struct sweep_class *sweep;
+
+    // scenario initialized once for all variants
+    struct xml_scenario_class *xml_scenario;
+
+    char *output_filename_base;
+
+    pthread_mutex_t mutex;
+    int next_variant_i;
+    int failed_number;
+};
+
+// thread that computes variants of a sweep
+struct sweep_thread_class {
+    struct sweep_run_class *run;
+    int thread_i;
+    pthread_t thread;
+};
+
+
 ///////////////////////////////////////////////////////////
 // Constants used to add artificial noise;
 // currently only used for specific experimental purposes;
@@ -98,16 +166,27 @@ static struct option long_options[] = {
     {"motion-nam", 0, 0, 'm'},
     {"motion-ns", 0, 0, 's'},
     {"object", 0, 0, 'j'},
+    {"columnar", 0, 0, 'c'},
+    {"summary", 0, 0, 'u'},
+    {"per-host", 1, 0, 'p'},
     {"output", 1, 0, 'o'},
 
     {"disable-deltaQ", 0, 0, 'd'},
+    {"threads", 1, 0, 'T'},
+    {"window", 1, 0, 'w'},
+    {"checkpoint", 1, 0, 'k'},
+    {"resume", 0, 0, 'r'},
+    {"ensemble", 1, 0, 'E'},
+    {"sweep", 1, 0, 'S'},
+    {"parallel", 1, 0, 'P'},
+    {"link-tables", 0, 0, 'L'},
 
     {0, 0, 0, 0}
 };
 
 // structure holding name of short options; 
 // should match the 'long_options' structure above 
-static char *short_options = "hvltbnmsjo:d";
+static char *short_options = "hvltbnmsjcup:o:dT:w:k:rE:S:P:L";
 
 
 // print license info
@@ -160,10 +239,35 @@ FILE *f;
     fprintf(f, " -m, --motion-nam       - enable output of motion data in NAM format\n");
     fprintf(f, " -s, --motion-ns        - enable output of motion data in NS-2 format\n");
     fprintf(f, " -j, --object           - enable output of object data\n");
+    fprintf(f, " -c, --columnar         - enable link-major columnar deltaQ output (.col)\n");
+    fprintf(f, " -u, --summary          - enable output of per-link summary statistics (.summary)\n");
+    fprintf(f, " -p, --per-host <size>  - also split binary output per groups of <size> node ids\n");
+    fprintf(f, "                          (files <base>.<group>.bin; use 1 for one file per node)\n");
     fprintf(f, " -o, --output <base>    - use <base> as base for generating output files,\n");
     fprintf(f, "                          instead of the input file name\n");
     fprintf(f, "Computation control:\n");
     fprintf(f, " -d, --disable-deltaQ   - disable deltaQ computation (output still generated)\n");
+    fprintf(f, " -T, --threads <n>      - use <n> threads to precompute the initial connection\n");
+    fprintf(f, "                          state (default 1)\n");
+    fprintf(f, " -w, --window <t1>:<t2> - compute only the steps with time in [t1, t2);\n");
+    fprintf(f, "                          the outputs of consecutive windows can be\n");
+    fprintf(f, "                          concatenated; random-walk and behavioral\n");
+    fprintf(f, "                          motions then use random states of their own,\n");
+    fprintf(f, "                          so their trajectories differ from a full run\n");
+    fprintf(f, " -k, --checkpoint <n>   - save a checkpoint every <n> steps (.ckp)\n");
+    fprintf(f, " -r, --resume           - resume from the checkpoint of a previous run\n");
+    fprintf(f, "                          with the same options\n");
+    fprintf(f, " -E, --ensemble <n>     - compute <n> replicas with independent shadowing, and\n");
+    fprintf(f, "                          output their mean and confidence interval (.ens);\n");
+    fprintf(f, "                          the other outputs describe the first replica\n");
+    fprintf(f, " -S, --sweep <file>     - compute the variants of the scenario listed in <file>,\n");
+    fprintf(f, "                          one per line as '<name> <path>=<value> ...'; the\n");
+    fprintf(f, "                          outputs of each variant use <base>.<name> as base\n");
+    fprintf(f, " -P, --parallel <n>     - compute up to <n> sweep variants in parallel (default 1)\n");
+    fprintf(f, " -L, --link-tables      - compute frame error rate, retransmissions, delay and\n");
+    fprintf(f, "                          jitter by interpolation in precomputed tables (relative\n");
+    fprintf(f, "                          error at most %g with respect to the analytic models)\n",
+            LINK_TABLE_MAX_ERROR);
     fprintf(f, "\n");
     fprintf(f, "See the documentation for more usage details.\n");
     fprintf(f, "Please send any comments or bug reports to 'info@starbed.org'.\n\n");
@@ -245,19 +349,23 @@ char *svn_revision_str;
 
 
 ///////////////////////////////////////////////////
-// main function
+// scenario computation
 ///////////////////////////////////////////////////
 
-int
-main(argc, argv)
-int argc;
-char *argv[];
+// compute the scenario 'xml_scenario' with the given options, and
+// write the outputs to files named after 'output_filename_base'; if
+// 'scenario_initialized' is TRUE, scenario_init_state was already
+// called without computing the connection state;
+// return SUCCESS on succes, ERROR on error
+static int
+compute_scenario(options, xml_scenario, output_filename_base, scenario_initialized)
+struct run_options_class *options;
+struct xml_scenario_class *xml_scenario;
+char *output_filename_base;
+int scenario_initialized;
 {
     int error_status = SUCCESS;
 
-    // xml scenario object
-    struct xml_scenario_class *xml_scenario = NULL;
-
     // helper scenario object used temporarily
     struct scenario_class *scenario;
 
@@ -265,387 +373,259 @@ char *argv[];
     double current_time;
     long int time_rec_num = 0;
 
+    // time grid of the scenario, and current and first step index
+    struct motion_grid_class motion_grid;
+    long int step_i, first_step_i;
+
     // various indexes for scenario elements
 #ifdef MESSAGE_DEBUG
-    int node_i, environment_i, object_i;
+    int node_i, environment_i, object_i, motion_i;
 #endif
-    int motion_i, connection_i;
-
-    // keep track whether any valid motion was found
-    int motion_found;
+    int connection_i;
 
     // file pointers
-    FILE *scenario_file = NULL;	// scenario file pointer
     FILE *text_output_file = NULL;	// text output file pointer
     FILE *binary_output_file = NULL;	// binary output file pointer
+    FILE *columnar_output_file = NULL;	// columnar output file pointer
+    FILE *summary_output_file = NULL;	// summary output file pointer
+    FILE *ensemble_output_file = NULL;	// ensemble output file pointer
     FILE *motion_file = NULL;	// motion file pointer
     FILE *object_output_file = NULL;	// object output file pointer
 
     FILE *settings_file = NULL;	// settings file pointer
 
+    // asynchronous writer for text output
+    struct io_writer_class text_writer;
+    int text_writer_started = FALSE;
+
+    // writer for columnar output
+    struct io_columnar_writer_cls columnar_writer;
+    int columnar_writer_started = FALSE;
+
+    // per-link summary statistics
+    struct io_summary_class summary;
+    int summary_started = FALSE;
+
+    // replicas of ensemble computation
+    struct ensemble_class ensemble;
+    int ensemble_started = FALSE;
+
+    // writer for per-host binary output
+    struct io_slice_writer_cls slice_writer;
+    int slice_writer_started = FALSE;
+
     // file name related strings
-    char scenario_filename[MAX_STRING];
     char text_output_filename[MAX_STRING];
     char binary_output_filename[MAX_STRING];
+    char columnar_output_filename[MAX_STRING];
+    char summary_output_filename[MAX_STRING];
+    char ensemble_output_filename[MAX_STRING];
     char motion_filename[MAX_STRING];
     char settings_filename[MAX_STRING];
     char object_output_filename[MAX_STRING];
-
-    // revision related variables
-    long int svn_revision;
-    char svn_revision_str[MAX_STRING];
-    char qomet_name[MAX_STRING];
-    char c;
-
-    // output control variables
-    int motion_output_enabled;
-    int motion_output_type;
-    int text_output_enabled;
-    int binary_output_enabled;
-    int text_only_enabled;
-    int binary_only_enabled;
-    int no_deltaQ_enabled;
-    int object_output_enabled;
-
-    char output_filename_base[MAX_STRING];
-    int output_filename_provided;
-
-    // computation control variables
-    int deltaQ_disabled;
+    char checkpoint_filename[MAX_STRING];
 
     struct io_connection_state_class io_connection_state;
 
-    int divider_i;
-    double motion_step, motion_current_time;
-
+    // state of the run saved in checkpoints
+    struct io_checkpoint_class checkpoint;
 
-    ////////////////////////////////////////////////////////////
-    // initialization
 
-#ifndef SVN_REVISION
-    DEBUG("SVN_REVISION not defined.");
-    svn_revision = ERROR;
-#else
-    if((strcmp(SVN_REVISION, "exported") == 0) || (strlen(SVN_REVISION) == 0)) {
-        DEBUG("SVN_REVISION defined but equal to 'exported' or ''.");
-        svn_revision = ERROR;
-    }
-    else {
-        DEBUG("SVN_REVISION defined.");
-        svn_revision = parse_svn_revision(SVN_REVISION);
+    // prepare the time grid of the scenario
+    if(motion_grid_init(&motion_grid, xml_scenario->start_time, xml_scenario->duration,
+            xml_scenario->step, xml_scenario->motion_step_divider) == ERROR) {
+        return ERROR;
     }
-#endif
 
-    if(svn_revision == ERROR) {
-        WARNING("Could not identify revision number.");
-        sprintf(svn_revision_str, "N/A");
+    // steps are counted from the start of the scenario, so that
+    // a time window starts at the same step as in a complete run
+    if(options->window_enabled == TRUE) {
+        first_step_i = motion_grid_step_index(&motion_grid, options->window_start);
     }
     else {
-        sprintf(svn_revision_str, "%ld", svn_revision);
+        first_step_i = 0;
     }
 
-    snprintf(qomet_name, MAX_STRING, "QOMET v%d.%d.%d %s- deltaQ (revision %s)", MAJOR_VERSION,
-            MINOR_VERSION, SUBMINOR_VERSION, (IS_BETA == TRUE) ? "beta " : "", svn_revision_str);
+    // save a pointer to the scenario data structure
+    scenario = &(xml_scenario->scenario);
 
+    // the motions of a window are replayed from the scenario start,
+    // which requires random states of their own; all windows use
+    // them, so that their outputs can still be concatenated
+    if(options->window_enabled == TRUE) {
+        scenario_use_motion_rand_states(scenario);
+    }
 
-    ////////////////////////////////////////////////////////////
-    // option parsing
 
-    // uncomment the following line to disable 
-    // option parsing error printing
-    //opterr = 0;
+    ////////////////////////////////////////////////////////////
+    // computation phase
 
-    // default values for output
-    text_output_enabled = TRUE;
-    binary_output_enabled = TRUE;
-    motion_output_enabled = FALSE;
-    motion_output_type = MOTION_OUTPUT_NAM;
-    output_filename_provided = FALSE;
+    // Latest version of expat (expat-2.0.1-11.el6_2.i686) fixed a bug
+    // related to hash functions by initializing internally the random
+    // number generator seed to values obtained from the clock. This causes
+    // random values computed by us to change at each run. To fix this
+    // we initialize the random number generator seed to its default
+    // value (1).
+    // References:
+    // [1] http://cmeerw.org/blog/759.html
+    // [2] https://bugzilla.redhat.com/show_bug.cgi?id=786617
+    // [3] https://rhn.redhat.com/errata/RHSA-2012-0731.html
+    DEBUG("Initialize random seed because it was changed by expat during parsing.\n");
+    generic_rand_seed(1);
 
-    // option values initialization
-    text_only_enabled = FALSE;
-    binary_only_enabled = FALSE;
-    no_deltaQ_enabled = FALSE;
-    deltaQ_disabled = FALSE;
-    object_output_enabled = FALSE;
+    INFO("\n-- QOMET Emulator: Scenario Computation --");
 
-    // parse options
-    while((c = getopt_long(argc, argv, short_options, long_options, NULL)) != -1) {
-        switch (c) {
-            // generic options
-            case 'h':
-                printf("\n%s: A versatile wireless network emulator.\n", qomet_name);
-                usage(stdout);
-                exit(0);
-            case 'v':
-                printf("\n%s.  Copyright (c) 2006-2013 The StarBED Project.\n\n", qomet_name);
-                exit(0);
-            case 'l':
-                printf("\n%s.\n", qomet_name);
-                license(stdout);
-                exit(0);
+    // prepare checkpoint filename
+    if(options->checkpoint_interval > 0 || options->resume_enabled == TRUE) {
+        if(snprintf(checkpoint_filename, MAX_STRING, "%s.ckp", output_filename_base) >= MAX_STRING) {
+            WARNING("Cannot create checkpoint file name because input filename '%s' is too long!",
+                    output_filename_base);
+            goto ERROR_HANDLE;
+        }
+    }
 
-                // output control
-            case 't':
-                text_only_enabled = TRUE;
-                break;
-            case 'b':
-                binary_only_enabled = TRUE;
-                break;
-            case 'n':
-                no_deltaQ_enabled = TRUE;
-                break;
-            case 'm':
-                // check whether motion output has already been enabled
-                if(motion_output_enabled == TRUE) {
-                    WARNING("Multiple arguments related to motion output detected.");
-                    WARNING("Note that arguments '-m' and '-s' are mutually \ exclusive.");
-                    usage(stdout);
-                    exit(1);
-                }
-                else {
-                    motion_output_enabled = TRUE;
-                    motion_output_type = MOTION_OUTPUT_NAM;
-                }
-                break;
-            case 's':
-                // check whether motion output has already been enabled
-                if(motion_output_enabled == TRUE) {
-                    WARNING("Multiple arguments related to motion output detected.");
-                    WARNING("Note that arguments '-m' and '-s' are mutually exclusive.");
-                    usage(stdout);
-                    exit(1);
-                }
-                else {
-                    motion_output_enabled = TRUE;
-                    motion_output_type = MOTION_OUTPUT_NS2;
-                }
-                break;
-            case 'j':
-                object_output_enabled = TRUE;
-                break;
-            case 'o':
-                output_filename_provided = TRUE;
-                strncpy(output_filename_base, optarg, MAX_STRING - 1);
-                break;
+    // check if settings output is enabled
+    if(!(options->text_only_enabled || options->binary_only_enabled)) {
+        // prepare settings filename
+        strncpy(settings_filename, output_filename_base, MAX_STRING - 1);
 
-                // computation control
-            case 'd':
-                deltaQ_disabled = TRUE;
-                break;
+        if(strlen(settings_filename) > MAX_STRING - 10) {
+            WARNING("Cannot create settings file name because input filename '%s' exceeds %d characters!", 
+                    settings_filename, MAX_STRING - 10);
+            goto ERROR_HANDLE;
+        }
 
-                // unknown options
-            case '?':
-                printf("Try --help for more info\n");
-                exit(1);
-            default:
-                WARNING("Unimplemented option -- %c", c);
-                WARNING("Try --help for more info");
-                exit(1);
+        // append extension ".settings"
+        strncat(settings_filename, ".settings", MAX_STRING - strlen(settings_filename) - 10);
+        settings_file = fopen (settings_filename, "w");
+        if(settings_file == NULL) {
+            WARNING("Cannot open settings file '%s' for writing!", settings_filename);
+            goto ERROR_HANDLE;
         }
     }
 
-    if((text_only_enabled == TRUE && binary_only_enabled == TRUE) ||
-            (text_only_enabled == TRUE && no_deltaQ_enabled == TRUE) ||
-            (binary_only_enabled == TRUE && no_deltaQ_enabled == TRUE)) {
-        WARNING("The output control options 'text-only', 'binary-only', and \
-                'no-deltaQ' are mutually exclusive and cannot be used together!");
-        usage(stdout);
-        exit(1);
-    }
+    // check if binary output is enabled
+    if(options->binary_output_enabled == TRUE) {
+        // prepare binary output filename
+        strncpy(binary_output_filename, output_filename_base, MAX_STRING - 1);
 
-    // check if text-only output is enabled
-    if(text_only_enabled == TRUE) {
-        text_output_enabled = TRUE;
-        binary_output_enabled = FALSE;
-    }
-    // check if binary-only output is enabled
-    else if(binary_only_enabled == TRUE) {
-        text_output_enabled = FALSE;
-        binary_output_enabled = TRUE;
-    }
-    // check if no-deltaQ output is enabled
-    else if(no_deltaQ_enabled == TRUE) {
-        text_output_enabled = FALSE;
-        binary_output_enabled = FALSE;
-    }
+        if(strlen(binary_output_filename) > MAX_STRING - 5) {
+            WARNING("Cannot create binary output file name because input \
+                    filename '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 5);
+            goto ERROR_HANDLE;
+        }
 
-    // optind represents the index where option parsing stopped
-    // and where non-option arguments parsing can start;
-    // check whether non-option arguments are present
-    if(argc == optind) {
-        WARNING("No scenario configuration file was provided.");
-        printf("\n%s: A versatile wireless network emulator.\n", qomet_name);
-        usage(stdout);
-        exit(1);
-    }
+        // append extension ".bin"
+        strncat(binary_output_filename, ".bin", MAX_STRING - strlen(binary_output_filename) - 5);
+        binary_output_file = fopen(binary_output_filename, options->output_file_mode);
+        if(binary_output_file == NULL) {
+            WARNING("Cannot open binary output file '%s' for writing!", binary_output_filename);
+            goto ERROR_HANDLE;
+        }
 
+        // start writing binary output
+        if(options->resume_enabled == FALSE) {
+            io_binary_write_header_to_file(scenario->if_num, 0, MAJOR_VERSION, MINOR_VERSION,
+                    SUBMINOR_VERSION, options->svn_revision, binary_output_file);
+        }
+    }
 
-    ////////////////////////////////////////////////////////////
-    // more initialization
+    // check if text output is enabled
+    if(options->text_output_enabled == TRUE) {
+        // prepare text output filename
+        strncpy(text_output_filename, output_filename_base, MAX_STRING - 1);
 
-    INFO("\n-- Wireless network emulator %s --", qomet_name);
-    INFO("Starting...");
+        if(strlen(text_output_filename) > MAX_STRING - 5) {
+            WARNING("Cannot create output file name because input filename \
+                    '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 5);
+            goto ERROR_HANDLE;
+        }
 
-#ifdef ADD_NOISE
-    fprintf(stderr, "Noise will be added to your experiment!\n");
-    fprintf(stderr, "Press <Return> to continue...\n");
-    getchar();
-#endif
+        // append extension ".out"
+        strncat(text_output_filename, ".out", MAX_STRING - strlen(text_output_filename) - 5);
 
+        // open file
+        text_output_file = fopen(text_output_filename, options->output_file_mode);
+        if(text_output_file == NULL) {
+            WARNING("Cannot open text output file '%s'! for writing", text_output_filename);
+            goto ERROR_HANDLE;
+        }
 
-    // try to allocate the xml_scenario object
-    xml_scenario = (struct xml_scenario_class *)malloc(sizeof(struct xml_scenario_class));
+        // write global file header for matlab
+        if(options->resume_enabled == FALSE) {
+            io_write_header_to_file(text_output_file, options->qomet_name);
+        }
 
-    if(xml_scenario == NULL) {
-        WARNING("Cannot allocate memory (tried %zd bytes); you may need to reduce \
-                maximum scenario size by editing the maximum data sizes constants in the \
-                file 'deltaQ/scenario.h' (MAX_NODES, MAX_OBJECTS, MAX_ENVIRONMENTS, \
-                MAX_MOTIONS and MAX_CONNECTIONS)", sizeof (struct xml_scenario_class));
-        goto ERROR_HANDLE;
+        // records are formatted here and written by a separate thread
+        if(io_writer_init(&text_writer, text_output_file) == ERROR) {
+            WARNING("Cannot initialize text output writer");
+            goto ERROR_HANDLE;
+        }
+        text_writer_started = TRUE;
     }
-    else {
-        DEBUG("Allocated %.2f MB (%zd bytes) for internal scenario storage.",
-                sizeof (struct xml_scenario_class) / 1048576.0, sizeof (struct xml_scenario_class));
-    }
-
-    // initialize the scenario object
-    scenario_init(&(xml_scenario->scenario));
-
-    ////////////////////////////////////////////////////////////
-    // scenario parsing phase
-    INFO("\n-- QOMET Emulator: Scenario Parsing --\n");
-
-    if(strlen(argv[optind]) > MAX_STRING) {
-        WARNING("Input file name '%s' longer than %d characters!", argv[optind], MAX_STRING);
-        goto ERROR_HANDLE;
-    }
-    else {
-        strncpy(scenario_filename, argv[optind], MAX_STRING - 1);
-    }
-
-    // set the output filename base to the scenario filename
-    // if no output filename base was provided
-    if(output_filename_provided == FALSE) {
-        strncpy(output_filename_base, scenario_filename, MAX_STRING - 1);
-    }
-
-    // open scenario file
-    scenario_file = fopen(scenario_filename, "r");
-    if(scenario_file == NULL) {
-        WARNING("Cannot open scenario file '%s'!", scenario_filename);
-        goto ERROR_HANDLE;
-    }
-
-    // parse scenario file
-    if(xml_scenario_parse(scenario_file, xml_scenario) == ERROR) {
-        WARNING("Cannot parse scenario file '%s'!", scenario_filename);
-        goto ERROR_HANDLE;
-    }
-
-    // print parse summary
-    INFO("Scenario file '%s' parsed.", scenario_filename);
-#ifdef MESSAGE_DEBUG
-    DEBUG("Loaded scenario file summary:");
-    xml_scenario_print (xml_scenario);
-#endif
-
-    // even more initialization
-    motion_step = xml_scenario->step / xml_scenario->motion_step_divider;
-
-    // save a pointer to the scenario data structure
-    scenario = &(xml_scenario->scenario);
-
-
-    ////////////////////////////////////////////////////////////
-    // computation phase
-
-    // Latest version of expat (expat-2.0.1-11.el6_2.i686) fixed a bug
-    // related to hash functions by initializing internally the random
-    // number generator seed to values obtained from the clock. This causes
-    // random values computed by us to change at each run. To fix this
-    // we initialize the random number generator seed to its default
-    // value (1).
-    // References:
-    // [1] http://cmeerw.org/blog/759.html
-    // [2] https://bugzilla.redhat.com/show_bug.cgi?id=786617
-    // [3] https://rhn.redhat.com/errata/RHSA-2012-0731.html
-    DEBUG("Initialize random seed because it was changed by expat during parsing.\n");
-    srand(1);
-
-    INFO("\n-- QOMET Emulator: Scenario Computation --");
 
-    // check if settings output is enabled
-    if(!(text_only_enabled || binary_only_enabled)) {
-        // prepare settings filename
-        strncpy(settings_filename, output_filename_base, MAX_STRING - 1);
+    // check if columnar output is enabled
+    if(options->columnar_output_enabled == TRUE) {
+        // prepare columnar output filename
+        strncpy(columnar_output_filename, output_filename_base, MAX_STRING - 1);
 
-        if(strlen(settings_filename) > MAX_STRING - 10) {
-            WARNING("Cannot create settings file name because input filename '%s' exceeds %d characters!", 
-                    settings_filename, MAX_STRING - 10);
+        if(strlen(columnar_output_filename) > MAX_STRING - 5) {
+            WARNING("Cannot create columnar output file name because input \
+                    filename '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 5);
             goto ERROR_HANDLE;
         }
 
-        // append extension ".settings"
-        strncat(settings_filename, ".settings", MAX_STRING - strlen(settings_filename) - 10);
-        settings_file = fopen (settings_filename, "w");
-        if(settings_file == NULL) {
-            WARNING("Cannot open settings file '%s' for writing!", settings_filename);
+        // append extension ".col"
+        strncat(columnar_output_filename, ".col", MAX_STRING - strlen(columnar_output_filename) - 5);
+        columnar_output_file = fopen(columnar_output_filename, "w");
+        if(columnar_output_file == NULL) {
+            WARNING("Cannot open columnar output file '%s' for writing!", columnar_output_filename);
             goto ERROR_HANDLE;
         }
     }
 
-    // check if binary output is enabled
-    if(binary_output_enabled == TRUE) {
-        // prepare binary output filename
-        strncpy(binary_output_filename, output_filename_base, MAX_STRING - 1);
+    // check if summary output is enabled
+    if(options->summary_output_enabled == TRUE) {
+        // prepare summary output filename
+        strncpy(summary_output_filename, output_filename_base, MAX_STRING - 1);
 
-        if(strlen(binary_output_filename) > MAX_STRING - 5) {
-            WARNING("Cannot create binary output file name because input \
-                    filename '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 5);
+        if(strlen(summary_output_filename) > MAX_STRING - 10) {
+            WARNING("Cannot create summary output file name because input \
+                    filename '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 10);
             goto ERROR_HANDLE;
         }
 
-        // append extension ".bin"
-        strncat(binary_output_filename, ".bin", MAX_STRING - strlen(binary_output_filename) - 5);
-        binary_output_file = fopen(binary_output_filename, "w");
-        if(binary_output_file == NULL) {
-            WARNING("Cannot open binary output file '%s' for writing!", binary_output_filename);
+        // append extension ".summary"
+        strncat(summary_output_filename, ".summary", MAX_STRING - strlen(summary_output_filename) - 10);
+        summary_output_file = fopen(summary_output_filename, "w");
+        if(summary_output_file == NULL) {
+            WARNING("Cannot open summary output file '%s' for writing!", summary_output_filename);
             goto ERROR_HANDLE;
         }
-
-        // start writing binary output
-        io_binary_write_header_to_file(scenario->if_num, 0, MAJOR_VERSION, MINOR_VERSION,
-                SUBMINOR_VERSION, svn_revision, binary_output_file);
     }
 
-    // check if text output is enabled
-    if(text_output_enabled == TRUE) {
-        // prepare text output filename
-        strncpy(text_output_filename, output_filename_base, MAX_STRING - 1);
+    // check if ensemble computation is enabled
+    if(options->replica_number > 0) {
+        // prepare ensemble output filename
+        strncpy(ensemble_output_filename, output_filename_base, MAX_STRING - 1);
 
-        if(strlen(text_output_filename) > MAX_STRING - 5) {
-            WARNING("Cannot create output file name because input filename \
-                    '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 5);
+        if(strlen(ensemble_output_filename) > MAX_STRING - 5) {
+            WARNING("Cannot create ensemble output file name because input \
+                    filename '%s' exceeds %d characters!", output_filename_base, MAX_STRING - 5);
             goto ERROR_HANDLE;
         }
 
-        // append extension ".out"
-        strncat(text_output_filename, ".out", MAX_STRING - strlen(text_output_filename) - 5);
-
-        // open file
-        text_output_file = fopen(text_output_filename, "w");
-        if(text_output_file == NULL) {
-            WARNING("Cannot open text output file '%s'! for writing", text_output_filename);
+        // append extension ".ens"
+        strncat(ensemble_output_filename, ".ens", MAX_STRING - strlen(ensemble_output_filename) - 5);
+        ensemble_output_file = fopen(ensemble_output_filename, "w");
+        if(ensemble_output_file == NULL) {
+            WARNING("Cannot open ensemble output file '%s' for writing!", ensemble_output_filename);
             goto ERROR_HANDLE;
         }
-
-        // write global file header for matlab
-        io_write_header_to_file(text_output_file, qomet_name);
     }
 
     // check if motion output is enabled
-    if(motion_output_enabled == TRUE) {
+    if(options->motion_output_enabled == TRUE) {
         // prepare motion filename
         strncpy(motion_filename, output_filename_base, MAX_STRING - 1);
 
@@ -655,20 +635,20 @@ char *argv[];
             goto ERROR_HANDLE;
         }
 
-        if(motion_output_type == MOTION_OUTPUT_NAM) {
+        if(options->motion_output_type == MOTION_OUTPUT_NAM) {
             // append extension ".nam"
             strncat(motion_filename, ".nam", MAX_STRING - strlen(motion_filename) - 5);
         }
-        else if(motion_output_type == MOTION_OUTPUT_NS2) {
+        else if(options->motion_output_type == MOTION_OUTPUT_NS2) {
             // append extension ".ns2"
             strncat(motion_filename, ".ns2", MAX_STRING - strlen (motion_filename) - 5);
         }
         else {
-            WARNING("Unknown motion output type (%d)!", motion_output_type);
+            WARNING("Unknown motion output type (%d)!", options->motion_output_type);
             goto ERROR_HANDLE;
         }
 
-        motion_file = fopen(motion_filename, "w");
+        motion_file = fopen(motion_filename, options->output_file_mode);
         if(motion_file == NULL) {
             WARNING("Cannot open motion file '%s' for writing!", motion_filename);
             goto ERROR_HANDLE;
@@ -702,15 +682,119 @@ char *argv[];
     INFO("\n-- Scenario initialization:");
     fprintf(stderr, "\n-- Scenario initialization:\n");
 
-    if(scenario_init_state(scenario, xml_scenario->jpgis_filename_provided, xml_scenario->jpgis_filename,
-                xml_scenario->cartesian_coord_syst, deltaQ_disabled) == ERROR) {
-        fflush(stdout);
-        WARNING("Error during scenario initialization. Aborting...");
-        goto ERROR_HANDLE;
+    // for a time window, the connection state is precomputed
+    // after nodes are moved to the start of the window
+    scenario->thread_number = options->thread_number;
+    if(scenario_initialized == FALSE) {
+        if(scenario_init_state(scenario, xml_scenario->jpgis_filename_provided, xml_scenario->jpgis_filename,
+                    xml_scenario->cartesian_coord_syst,
+                    options->deltaQ_disabled || first_step_i > 0 || options->resume_enabled == TRUE) == ERROR) {
+            fflush(stdout);
+            WARNING("Error during scenario initialization. Aborting...");
+            goto ERROR_HANDLE;
+        }
+    }
+    // the scenario of a sweep variant only needs its connection state
+    else if(!(options->deltaQ_disabled || first_step_i > 0 || options->resume_enabled == TRUE)) {
+        if(scenario_precompute_state(scenario) == ERROR) {
+            WARNING("Error during scenario initialization. Aborting...");
+            goto ERROR_HANDLE;
+        }
+    }
+
+    if(options->resume_enabled == TRUE) {
+        // the state at the checkpoint replaces the initial state
+        fprintf(stderr, "* Resuming from checkpoint '%s'\n", checkpoint_filename);
+        if(io_checkpoint_read(checkpoint_filename, &checkpoint, scenario, &io_connection_state) == ERROR) {
+            WARNING("Cannot resume from checkpoint '%s'. Aborting...", checkpoint_filename);
+            goto ERROR_HANDLE;
+        }
+
+        if(checkpoint.first_step_i != first_step_i) {
+            WARNING("Checkpoint '%s' was saved for another time window. Aborting...", checkpoint_filename);
+            goto ERROR_HANDLE;
+        }
+
+        // random values continue from where they were at the checkpoint
+        if(generic_rand_restore(&(checkpoint.rand_state)) == ERROR) {
+            WARNING("Invalid random state in checkpoint '%s'. Aborting...", checkpoint_filename);
+            goto ERROR_HANDLE;
+        }
+
+        // outputs written after the checkpoint are discarded
+        if((text_output_file != NULL &&
+                    io_checkpoint_truncate_file(text_output_file, checkpoint.text_offset) == ERROR) ||
+                (binary_output_file != NULL &&
+                 io_checkpoint_truncate_file(binary_output_file, checkpoint.binary_offset) == ERROR) ||
+                (motion_file != NULL &&
+                 io_checkpoint_truncate_file(motion_file, checkpoint.motion_offset) == ERROR)) {
+            WARNING("Output files don't match checkpoint '%s'. Aborting...", checkpoint_filename);
+            goto ERROR_HANDLE;
+        }
+        time_rec_num = checkpoint.time_rec_num;
+    }
+    else if(first_step_i > 0) {
+        fprintf(stderr, "* Moving nodes to the window start time %.3f s\n",
+                motion_grid_step_time(&motion_grid, first_step_i));
+        if(scenario_motion_seek(scenario, &motion_grid,
+                motion_grid_step_time(&motion_grid, first_step_i)) == ERROR) {
+            WARNING("Error while moving nodes to the window start time. Aborting...");
+            goto ERROR_HANDLE;
+        }
+
+        if(options->deltaQ_disabled == FALSE) {
+            if(scenario_precompute_state(scenario) == ERROR) {
+                WARNING("Error during scenario initialization. Aborting...");
+                goto ERROR_HANDLE;
+            }
+        }
+    }
+
+    // connections are only identified after initialization,
+    // so the columnar, summary and per-host outputs can be started now
+    if(options->columnar_output_enabled == TRUE) {
+        // links are buffered separately and written in chunks
+        if(io_columnar_init(&columnar_writer, columnar_output_file, scenario,
+                motion_grid_step_time(&motion_grid, first_step_i), xml_scenario->step, MAJOR_VERSION,
+                MINOR_VERSION, SUBMINOR_VERSION, options->svn_revision) == ERROR) {
+            WARNING("Cannot initialize columnar output writer");
+            goto ERROR_HANDLE;
+        }
+        columnar_writer_started = TRUE;
+    }
+
+    if(options->summary_output_enabled == TRUE) {
+        // statistics are accumulated at each step and written at the end
+        if(io_summary_init(&summary, scenario, xml_scenario->step) == ERROR) {
+            WARNING("Cannot initialize summary statistics");
+            goto ERROR_HANDLE;
+        }
+        summary_started = TRUE;
+    }
+
+    if(options->replica_number > 0) {
+        // all replicas start from the precomputed state
+        if(ensemble_init(&ensemble, scenario, options->replica_number) == ERROR) {
+            WARNING("Cannot initialize ensemble replicas");
+            goto ERROR_HANDLE;
+        }
+        ensemble_started = TRUE;
+        ensemble_write_header(&ensemble, ensemble_output_file, options->qomet_name);
+    }
+
+    if(options->per_host_group_size > 0) {
+        // records are added to the slices of their source and destination
+        if(io_slice_init(&slice_writer, output_filename_base, scenario->if_num,
+                options->per_host_group_size, MAJOR_VERSION, MINOR_VERSION,
+                SUBMINOR_VERSION, options->svn_revision) == ERROR) {
+            WARNING("Cannot initialize per-host output");
+            goto ERROR_HANDLE;
+        }
+        slice_writer_started = TRUE;
     }
 
     // it is now late enough to output objects if enabled
-    if(object_output_enabled == TRUE) {
+    if(options->object_output_enabled == TRUE) {
         // prepare object output filename
         strncpy(object_output_filename, output_filename_base, MAX_STRING - 1);
 
@@ -743,9 +827,18 @@ char *argv[];
     INFO("\n-- Scenario processing:");
     fprintf(stderr, "\n-- Scenario processing:\n");
 
-    for(current_time = xml_scenario->start_time; 
-            current_time <= (xml_scenario->duration + xml_scenario->start_time + EPSILON); 
-            current_time += xml_scenario->step) {
+    // the time of each step is taken from the grid, so that it
+    // doesn't depend on where the computation started
+    step_i = (options->resume_enabled == TRUE) ? checkpoint.step_i : first_step_i;
+    for(;
+            (current_time = motion_grid_step_time(&motion_grid, step_i)) <=
+            (xml_scenario->duration + xml_scenario->start_time + EPSILON);
+            step_i++) {
+        // stop at the end of the time window
+        if(options->window_enabled == TRUE && current_time >= options->window_end - EPSILON) {
+            break;
+        }
+
         // print the current state
         INFO("* Current time=%.3f", current_time);
         fprintf(stderr, "* Time=%.3f s: DONE                                 \r", current_time);
@@ -754,10 +847,10 @@ char *argv[];
         scenario->current_time = current_time;
 
         // check if motion output is enabled
-        if(motion_output_enabled == TRUE) {
+        if(options->motion_output_enabled == TRUE) {
             if(current_time == xml_scenario->start_time) {
                 // write motion file header
-                if(motion_output_type == MOTION_OUTPUT_NAM) {
+                if(options->motion_output_type == MOTION_OUTPUT_NAM) {
                     io_write_nam_motion_header_to_file(scenario, motion_file);
                 }
                 else {
@@ -766,7 +859,7 @@ char *argv[];
             }
             else {
                 // write motion info 
-                if(motion_output_type == MOTION_OUTPUT_NAM) {
+                if(options->motion_output_type == MOTION_OUTPUT_NAM) {
                     io_write_nam_motion_info_to_file(scenario, motion_file, current_time);
                 }
                 else {
@@ -797,17 +890,24 @@ char *argv[];
         }
 #endif
 
-        if(deltaQ_disabled == FALSE) {
+        if(options->deltaQ_disabled == FALSE) {
             // compute deltaQ parameters
             INFO("  DELTA_Q CALCULATION");
-            if(scenario_deltaQ (scenario, current_time) == ERROR) {
+            if(ensemble_started == TRUE) {
+                if(ensemble_deltaQ(&ensemble, scenario, current_time) == ERROR ||
+                        ensemble_write_step(&ensemble, scenario, current_time, ensemble_output_file) == ERROR) {
+                    WARNING("Error while calculating deltaQ. Aborting...");
+                    goto ERROR_HANDLE;
+                }
+            }
+            else if(scenario_deltaQ (scenario, current_time) == ERROR) {
                 WARNING("Error while calculating deltaQ. Aborting...");
                 goto ERROR_HANDLE;
             }
         }
 
         // check if binary output is enabled
-        if(binary_output_enabled == TRUE) {
+        if(options->binary_output_enabled == TRUE) {
             io_connection_state.binary_time_record.time = current_time;
             io_connection_state.binary_time_record.record_number = 0;
         }
@@ -824,15 +924,17 @@ char *argv[];
             }
 
             // check if text output is enabled
-            if(text_output_enabled == TRUE) {
-                io_write_to_file (&(scenario->connections[connection_i]), scenario, current_time,
-                        xml_scenario->cartesian_coord_syst, text_output_file);
+            if(options->text_output_enabled == TRUE) {
+                if(io_writer_write_connection(&text_writer, &(scenario->connections[connection_i]),
+                        scenario, current_time, xml_scenario->cartesian_coord_syst) == ERROR) {
+                    goto ERROR_HANDLE;
+                }
             }
 
             // check if binary output is enabled
-            if(binary_output_enabled == TRUE) {
+            if(options->binary_output_enabled == TRUE) {
                 // check if we are processing first time
-                if(current_time == xml_scenario->start_time) {
+                if(step_i == first_step_i) {
                     //save state without any checking
                     io_binary_build_record(&(io_connection_state.binary_records[connection_i]),
                          &(scenario->connections[connection_i]), scenario);
@@ -857,8 +959,27 @@ char *argv[];
             }
         }
 
+        // hand the text output of this step to the writer thread
+        if(options->text_output_enabled == TRUE) {
+            if(io_writer_end_step(&text_writer) == ERROR) {
+                goto ERROR_HANDLE;
+            }
+        }
+
+        // check if columnar output is enabled
+        if(options->columnar_output_enabled == TRUE) {
+            if(io_columnar_write_step(&columnar_writer, scenario) == ERROR) {
+                goto ERROR_HANDLE;
+            }
+        }
+
+        // check if summary output is enabled
+        if(options->summary_output_enabled == TRUE) {
+            io_summary_update(&summary, scenario);
+        }
+
         // check if binary output is enabled
-        if(binary_output_enabled == TRUE) {
+        if(options->binary_output_enabled == TRUE) {
             int record_i, connection_i;
 
 #ifdef DISABLE_EMPTY_TIME_RECORDS
@@ -881,6 +1002,9 @@ char *argv[];
                     if(io_connection_state.state_changed[connection_i] == TRUE) {
                         io_binary_write_record_to_file2(&(io_connection_state.binary_records[connection_i]),
                              binary_output_file);
+                        if(slice_writer_started == TRUE) {
+                            io_slice_add_record(&slice_writer, &(io_connection_state.binary_records[connection_i]));
+                        }
 #ifdef MESSAGE_DEBUG
                         io_binary_print_record(&(io_connection_state.binary_records[connection_i]));
 #endif
@@ -904,56 +1028,64 @@ char *argv[];
                 else {
                     INFO("At time %f wrote %d binary records", current_time, record_i);
                 }
+
+                // per-host output keeps the same time records
+                if(slice_writer_started == TRUE) {
+                    if(io_slice_end_step(&slice_writer, current_time) == ERROR) {
+                        goto ERROR_HANDLE;
+                    }
+                }
 #ifdef DISABLE_EMPTY_TIME_RECORDS
             }
 #endif
         }
 
-        for(divider_i = 0; divider_i < xml_scenario->motion_step_divider; divider_i++) {
-            motion_current_time = current_time + divider_i * motion_step;
+        // move nodes for the next step of evaluation
+        if(scenario_apply_motions(scenario, &motion_grid, step_i, DBL_MAX) == ERROR) {
+            goto ERROR_HANDLE;
+        }
 
-            if(motion_current_time > (xml_scenario->duration + xml_scenario->start_time + EPSILON)) {
-                break;
+        // save the state needed to continue with the next step,
+        // after all the output of this step was written
+        if(options->checkpoint_interval > 0 && (step_i + 1 - first_step_i) % options->checkpoint_interval == 0) {
+            if(options->text_output_enabled == TRUE && io_writer_flush(&text_writer) == ERROR) {
+                goto ERROR_HANDLE;
             }
+            checkpoint.text_offset = (text_output_file != NULL) ? ftell(text_output_file) : -1;
 
-            // move nodes according to the 'motions' object in 'scenario'
-            // for the next step of evaluation
-            INFO("  NODE MOVEMENT (sub-step %d)", divider_i);
-            motion_found = FALSE;
-            for(motion_i = 0; motion_i < scenario->motion_number; motion_i++) {
-                if((scenario->motions[motion_i].start_time <= motion_current_time) &&
-                        (scenario->motions[motion_i].stop_time > motion_current_time)) {
-                    fprintf(stderr, "\t\t\tcalculation => motion %d             \r", motion_i);
-                    // TEMPORARY!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+            if(binary_output_file != NULL) {
+                fflush(binary_output_file);
+            }
+            checkpoint.binary_offset = (binary_output_file != NULL) ? ftell(binary_output_file) : -1;
 
-                    //if(motion_i!=45) continue;     // 0 corresponds to id 1
+            if(motion_file != NULL) {
+                fflush(motion_file);
+            }
+            checkpoint.motion_offset = (motion_file != NULL) ? ftell(motion_file) : -1;
 
-                    if(motion_apply(&(scenario->motions[motion_i]), scenario, motion_current_time, motion_step) == ERROR) {
-                        goto ERROR_HANDLE;
-                    }
+            checkpoint.first_step_i = first_step_i;
+            checkpoint.step_i = step_i + 1;
+            checkpoint.time_rec_num = time_rec_num;
+            generic_rand_save(&(checkpoint.rand_state));
 
-                    motion_found = TRUE;
-                }
-            }
-#ifdef MESSAGE_INFO
-            if(motion_found == FALSE) {
-                INFO("  No valid motion found");
+            if(io_checkpoint_write(checkpoint_filename, &checkpoint, scenario, &io_connection_state) == ERROR) {
+                WARNING("Cannot save checkpoint '%s'. Aborting...", checkpoint_filename);
+                goto ERROR_HANDLE;
             }
-#endif
         }
     }
 
     // check if binary output is enabled
-    if(binary_output_enabled == TRUE) {
+    if(options->binary_output_enabled == TRUE) {
         // rewrite binary header now that all information is available
         rewind(binary_output_file);
         io_binary_write_header_to_file(scenario->if_num, time_rec_num,
              MAJOR_VERSION, MINOR_VERSION, SUBMINOR_VERSION,
-             svn_revision, binary_output_file);
+             options->svn_revision, binary_output_file);
     }
 
     // write settings file
-    if(!(text_only_enabled || binary_only_enabled)) {
+    if(!(options->text_only_enabled || options->binary_only_enabled)) {
         io_write_settings_file (scenario, settings_file);
     }
 
@@ -969,6 +1101,43 @@ ERROR_HANDLE:
 
 FINAL_HANDLE:
 
+    // write pending text output
+    if(text_writer_started == TRUE) {
+        if(io_writer_finalize(&text_writer) == ERROR) {
+            WARNING("Error writing text output file '%s'", text_output_filename);
+            error_status = ERROR;
+        }
+    }
+
+    // write pending columnar output and its tables
+    if(columnar_writer_started == TRUE) {
+        if(io_columnar_finalize(&columnar_writer) == ERROR) {
+            WARNING("Error writing columnar output file '%s'", columnar_output_filename);
+            error_status = ERROR;
+        }
+    }
+
+    // complete per-host output
+    if(slice_writer_started == TRUE) {
+        if(io_slice_finalize(&slice_writer) == ERROR) {
+            WARNING("Error writing per-host output files");
+            error_status = ERROR;
+        }
+    }
+
+    // write summary statistics
+    if(summary_started == TRUE) {
+        if(io_summary_write(&summary, summary_output_file, options->qomet_name) == ERROR) {
+            WARNING("Error writing summary output file '%s'", summary_output_filename);
+            error_status = ERROR;
+        }
+        io_summary_free(&summary);
+    }
+
+    if(ensemble_started == TRUE) {
+        ensemble_free(&ensemble);
+    }
+
     if(error_status == SUCCESS) {
         // print this in case of successful processing
         INFO("\n-- Scenario processing completed successfully\n\n");
@@ -981,9 +1150,6 @@ FINAL_HANDLE:
     }
 
     // close output files
-    if(scenario_file != NULL) {
-        fclose(scenario_file);
-    }
 
     if(settings_file != NULL) {
         fclose(settings_file);
@@ -999,14 +1165,653 @@ FINAL_HANDLE:
         fclose(binary_output_file);
     }
 
+    // check if columnar output is enabled
+    if(columnar_output_file != NULL) {
+        fclose(columnar_output_file);
+    }
+
+    // check if summary output is enabled
+    if(summary_output_file != NULL) {
+        fclose(summary_output_file);
+    }
+
+    // check if ensemble computation is enabled
+    if(ensemble_output_file != NULL) {
+        fclose(ensemble_output_file);
+    }
+
     // check if motion output is enabled
     if(motion_file != NULL) {
         fclose(motion_file);
     }
 
-    if(xml_scenario != NULL) {
+    motion_grid_free(&motion_grid);
+
+    return error_status;
+}
+
+///////////////////////////////////////////////////
+// parameter sweep
+///////////////////////////////////////////////////
+
+// compute variant 'variant_i' of a sweep in 'xml_scenario', whose
+// objects must be those of the base scenario;
+// return SUCCESS on succes, ERROR on error
+static int
+compute_variant(run, variant_i, xml_scenario)
+struct sweep_run_class *run;
+int variant_i;
+struct xml_scenario_class *xml_scenario;
+{
+    struct sweep_variant_class *variant = &(run->sweep->variants[variant_i]);
+    char variant_filename_base[MAX_STRING];
+
+    if(snprintf(variant_filename_base, MAX_STRING, "%s.%s", run->output_filename_base,
+            variant->name) >= MAX_STRING) {
+        WARNING("Cannot create output file names of variant '%s' because they are too long!",
+                variant->name);
+        return ERROR;
+    }
+
+    fprintf(stderr, "\n-- Sweep variant '%s' (%d out of %d):\n", variant->name,
+            variant_i + 1, run->sweep->variant_number);
+
+    if(sweep_prepare_variant(run->sweep, variant_i, &(xml_scenario->scenario)) == ERROR) {
+        return ERROR;
+    }
+
+    return compute_scenario(run->options, xml_scenario, variant_filename_base, TRUE);
+}
+
+// compute variants of a sweep until none is left; the first thread
+// uses the base scenario, and the others a copy of it
+static void *
+sweep_thread(arg)
+void *arg;
+{
+    struct sweep_thread_class *thread = (struct sweep_thread_class *)arg;
+    struct sweep_run_class *run = thread->run;
+    struct xml_scenario_class *xml_scenario;
+    struct generic_rand_stream_class rand_stream;
+    int variant_i;
+
+    if(thread->thread_i == 0) {
+        xml_scenario = run->xml_scenario;
+    }
+    else {
+        xml_scenario = (struct xml_scenario_class *)malloc(sizeof(struct xml_scenario_class));
+        if(xml_scenario == NULL) {
+            WARNING("Cannot allocate memory for the scenario of sweep thread %d", thread->thread_i);
+            return NULL;
+        }
+
+        scenario_init(&(xml_scenario->scenario));
+        xml_scenario->start_time = run->xml_scenario->start_time;
+        xml_scenario->duration = run->xml_scenario->duration;
+        xml_scenario->step = run->xml_scenario->step;
+        xml_scenario->motion_step_divider = run->xml_scenario->motion_step_divider;
+        xml_scenario->cartesian_coord_syst = run->xml_scenario->cartesian_coord_syst;
+        xml_scenario->jpgis_filename_provided = run->xml_scenario->jpgis_filename_provided;
+        strncpy(xml_scenario->jpgis_filename, run->xml_scenario->jpgis_filename, MAX_STRING);
+        sweep_copy_objects(run->sweep, &(xml_scenario->scenario));
+    }
+
+    // each variant generates the same random values as a separate run
+    generic_rand_stream_init(&rand_stream, 1);
+    generic_set_rand_stream(&rand_stream);
+
+    while(TRUE) {
+        pthread_mutex_lock(&(run->mutex));
+        variant_i = run->next_variant_i++;
+        pthread_mutex_unlock(&(run->mutex));
+
+        if(variant_i >= run->sweep->variant_number) {
+            break;
+        }
+
+        if(compute_variant(run, variant_i, xml_scenario) == ERROR) {
+            WARNING("Error while computing sweep variant '%s'", run->sweep->variants[variant_i].name);
+            pthread_mutex_lock(&(run->mutex));
+            run->failed_number++;
+            pthread_mutex_unlock(&(run->mutex));
+        }
+    }
+
+    generic_set_rand_stream(NULL);
+
+    if(thread->thread_i != 0) {
+        scenario_free_motion_checkpoints(&(xml_scenario->scenario));
         free(xml_scenario);
     }
 
+    return NULL;
+}
+
+// compute all the variants listed in sweep file 'sweep_filename' for
+// the parsed scenario 'xml_scenario', which is initialized only once;
+// up to 'parallel_number' variants are computed in parallel;
+// return SUCCESS if all variants were computed, ERROR otherwise
+static int
+compute_sweep(options, xml_scenario, sweep_filename, output_filename_base, parallel_number)
+struct run_options_class *options;
+struct xml_scenario_class *xml_scenario;
+char *sweep_filename;
+char *output_filename_base;
+int parallel_number;
+{
+    struct sweep_class sweep;
+    struct sweep_run_class run;
+    struct sweep_thread_class *threads;
+    struct scenario_class *scenario = &(xml_scenario->scenario);
+    int thread_i, started_number;
+    int error_status = SUCCESS;
+
+    if(sweep_read(&sweep, sweep_filename) == ERROR) {
+        WARNING("Cannot read sweep file '%s'!", sweep_filename);
+        return ERROR;
+    }
+
+    INFO("\n-- QOMET Emulator: Scenario Sweep --");
+    fprintf(stderr, "\n-- Scenario sweep of %d variants:\n", sweep.variant_number);
+
+    // objects, motions and connections are only indexed once;
+    // the connection state depends on variant parameters
+    scenario->thread_number = options->thread_number;
+    if(scenario_init_state(scenario, xml_scenario->jpgis_filename_provided, xml_scenario->jpgis_filename,
+                xml_scenario->cartesian_coord_syst, TRUE) == ERROR) {
+        fflush(stdout);
+        WARNING("Error during scenario initialization. Aborting...");
+        sweep_free(&sweep);
+        return ERROR;
+    }
+
+    if(sweep_set_base(&sweep, scenario) == ERROR) {
+        sweep_free(&sweep);
+        return ERROR;
+    }
+
+    if(parallel_number > sweep.variant_number) {
+        parallel_number = sweep.variant_number;
+    }
+
+    threads = (struct sweep_thread_class *)calloc(parallel_number, sizeof(struct sweep_thread_class));
+    if(threads == NULL) {
+        WARNING("Cannot allocate memory for sweep threads");
+        sweep_free(&sweep);
+        return ERROR;
+    }
+
+    run.options = options;
+    run.sweep = &sweep;
+    run.xml_scenario = xml_scenario;
+    run.output_filename_base = output_filename_base;
+    run.next_variant_i = 0;
+    run.failed_number = 0;
+    pthread_mutex_init(&(run.mutex), NULL);
+
+    // the current thread computes variants as well
+    for(thread_i = 0; thread_i < parallel_number; thread_i++) {
+        threads[thread_i].run = &run;
+        threads[thread_i].thread_i = thread_i;
+    }
+    for(started_number = 1; started_number < parallel_number; started_number++) {
+        if(pthread_create(&(threads[started_number].thread), NULL, sweep_thread,
+                &(threads[started_number])) != 0) {
+            WARNING("Cannot start sweep thread %d; continuing with %d threads",
+                    started_number, started_number);
+            break;
+        }
+    }
+    sweep_thread(&(threads[0]));
+    for(thread_i = 1; thread_i < started_number; thread_i++) {
+        pthread_join(threads[thread_i].thread, NULL);
+    }
+
+    pthread_mutex_destroy(&(run.mutex));
+    free(threads);
+
+    if(run.failed_number > 0) {
+        WARNING("%d out of %d sweep variants could not be computed", run.failed_number,
+                sweep.variant_number);
+        error_status = ERROR;
+    }
+    fprintf(stderr, "\n-- Scenario sweep completed: %d variants computed, %d failed\n\n",
+            sweep.variant_number - run.failed_number, run.failed_number);
+
+    sweep_free(&sweep);
+
+    return error_status;
+}
+
+///////////////////////////////////////////////////
+// main function
+///////////////////////////////////////////////////
+
+int
+main(argc, argv)
+int argc;
+char *argv[];
+{
+    int error_status = SUCCESS;
+
+    // xml scenario object
+    struct xml_scenario_class *xml_scenario = NULL;
+
+    // scenario file pointer
+    FILE *scenario_file = NULL;
+
+    // file name related strings
+    char scenario_filename[MAX_STRING];
+    char sweep_filename[MAX_STRING];
+
+    // revision related variables
+    char svn_revision_str[MAX_STRING];
+    char qomet_name[MAX_STRING];
+    char c;
+
+    // options of the run
+    struct run_options_class options;
+    int no_deltaQ_enabled;
+
+    char output_filename_base[MAX_STRING];
+    int output_filename_provided;
+
+    // sweep control variables
+    int sweep_enabled;
+    int parallel_number;
+
+
+    ////////////////////////////////////////////////////////////
+    // initialization
+
+#ifndef SVN_REVISION
+    DEBUG("SVN_REVISION not defined.");
+    options.svn_revision = ERROR;
+#else
+    if((strcmp(SVN_REVISION, "exported") == 0) || (strlen(SVN_REVISION) == 0)) {
+        DEBUG("SVN_REVISION defined but equal to 'exported' or ''.");
+        options.svn_revision = ERROR;
+    }
+    else {
+        DEBUG("SVN_REVISION defined.");
+        options.svn_revision = parse_svn_revision(SVN_REVISION);
+    }
+#endif
+
+    if(options.svn_revision == ERROR) {
+        WARNING("Could not identify revision number.");
+        sprintf(svn_revision_str, "N/A");
+    }
+    else {
+        sprintf(svn_revision_str, "%ld", options.svn_revision);
+    }
+
+    snprintf(qomet_name, MAX_STRING, "QOMET v%d.%d.%d %s- deltaQ (revision %s)", MAJOR_VERSION,
+            MINOR_VERSION, SUBMINOR_VERSION, (IS_BETA == TRUE) ? "beta " : "", svn_revision_str);
+
+
+    ////////////////////////////////////////////////////////////
+    // option parsing
+
+    // uncomment the following line to disable 
+    // option parsing error printing
+    //opterr = 0;
+
+    // default values for output
+    options.text_output_enabled = TRUE;
+    options.binary_output_enabled = TRUE;
+    options.motion_output_enabled = FALSE;
+    options.columnar_output_enabled = FALSE;
+    options.summary_output_enabled = FALSE;
+    options.per_host_group_size = 0;
+    options.motion_output_type = MOTION_OUTPUT_NAM;
+    output_filename_provided = FALSE;
+
+    // option values initialization
+    options.text_only_enabled = FALSE;
+    options.binary_only_enabled = FALSE;
+    no_deltaQ_enabled = FALSE;
+    options.deltaQ_disabled = FALSE;
+    options.thread_number = 1;
+    options.window_enabled = FALSE;
+    options.checkpoint_interval = 0;
+    options.replica_number = 0;
+    options.resume_enabled = FALSE;
+    options.object_output_enabled = FALSE;
+    options.qomet_name = qomet_name;
+    sweep_enabled = FALSE;
+    parallel_number = 1;
+
+    // parse options
+    while((c = getopt_long(argc, argv, short_options, long_options, NULL)) != -1) {
+        switch (c) {
+            // generic options
+            case 'h':
+                printf("\n%s: A versatile wireless network emulator.\n", qomet_name);
+                usage(stdout);
+                exit(0);
+            case 'v':
+                printf("\n%s.  Copyright (c) 2006-2013 The StarBED Project.\n\n", qomet_name);
+                exit(0);
+            case 'l':
+                printf("\n%s.\n", qomet_name);
+                license(stdout);
+                exit(0);
+
+                // output control
+            case 't':
+                options.text_only_enabled = TRUE;
+                break;
+            case 'b':
+                options.binary_only_enabled = TRUE;
+                break;
+            case 'n':
+                no_deltaQ_enabled = TRUE;
+                break;
+            case 'm':
+                // check whether motion output has already been enabled
+                if(options.motion_output_enabled == TRUE) {
+                    WARNING("Multiple arguments related to motion output detected.");
+                    WARNING("Note that arguments '-m' and '-s' are mutually \ exclusive.");
+                    usage(stdout);
+                    exit(1);
+                }
+                else {
+                    options.motion_output_enabled = TRUE;
+                    options.motion_output_type = MOTION_OUTPUT_NAM;
+                }
+                break;
+            case 's':
+                // check whether motion output has already been enabled
+                if(options.motion_output_enabled == TRUE) {
+                    WARNING("Multiple arguments related to motion output detected.");
+                    WARNING("Note that arguments '-m' and '-s' are mutually exclusive.");
+                    usage(stdout);
+                    exit(1);
+                }
+                else {
+                    options.motion_output_enabled = TRUE;
+                    options.motion_output_type = MOTION_OUTPUT_NS2;
+                }
+                break;
+            case 'j':
+                options.object_output_enabled = TRUE;
+                break;
+            case 'c':
+                options.columnar_output_enabled = TRUE;
+                break;
+            case 'u':
+                options.summary_output_enabled = TRUE;
+                break;
+            case 'p':
+                options.per_host_group_size = atoi(optarg);
+                if(options.per_host_group_size <= 0) {
+                    WARNING("Invalid host group size '%s'", optarg);
+                    exit(1);
+                }
+                break;
+            case 'o':
+                output_filename_provided = TRUE;
+                strncpy(output_filename_base, optarg, MAX_STRING - 1);
+                break;
+
+                // computation control
+            case 'd':
+                options.deltaQ_disabled = TRUE;
+                break;
+            case 'w':
+                if(sscanf(optarg, "%lf:%lf", &options.window_start, &options.window_end) != 2 ||
+                        options.window_end <= options.window_start) {
+                    WARNING("Invalid time window '%s' (must be <t1>:<t2>, with t1 < t2)", optarg);
+                    exit(1);
+                }
+                options.window_enabled = TRUE;
+                break;
+            case 'k':
+                options.checkpoint_interval = atoi(optarg);
+                if(options.checkpoint_interval <= 0) {
+                    WARNING("Invalid checkpoint interval '%s'", optarg);
+                    exit(1);
+                }
+                break;
+            case 'r':
+                options.resume_enabled = TRUE;
+                break;
+            case 'E':
+                options.replica_number = atoi(optarg);
+                if(options.replica_number < 2 || options.replica_number > MAX_ENSEMBLE_REPLICAS) {
+                    WARNING("Invalid number of replicas '%s' (must be between 2 and %d)",
+                            optarg, MAX_ENSEMBLE_REPLICAS);
+                    exit(1);
+                }
+                break;
+            case 'S':
+                sweep_enabled = TRUE;
+                strncpy(sweep_filename, optarg, MAX_STRING - 1);
+                sweep_filename[MAX_STRING - 1] = '\0';
+                break;
+            case 'P':
+                parallel_number = atoi(optarg);
+                if(parallel_number <= 0 || parallel_number > MAX_SCENARIO_THREADS) {
+                    WARNING("Invalid number of parallel variants '%s' (must be between 1 and %d)",
+                            optarg, MAX_SCENARIO_THREADS);
+                    exit(1);
+                }
+                break;
+            case 'L':
+                link_table_enabled = TRUE;
+                break;
+            case 'T':
+                options.thread_number = atoi(optarg);
+                if(options.thread_number <= 0 || options.thread_number > MAX_SCENARIO_THREADS) {
+                    WARNING("Invalid number of threads '%s' (must be between 1 and %d)",
+                            optarg, MAX_SCENARIO_THREADS);
+                    exit(1);
+                }
+                break;
+
+                // unknown options
+            case '?':
+                printf("Try --help for more info\n");
+                exit(1);
+            default:
+                WARNING("Unimplemented option -- %c", c);
+                WARNING("Try --help for more info");
+                exit(1);
+        }
+    }
+
+    if((options.text_only_enabled == TRUE && options.binary_only_enabled == TRUE) ||
+            (options.text_only_enabled == TRUE && no_deltaQ_enabled == TRUE) ||
+            (options.binary_only_enabled == TRUE && no_deltaQ_enabled == TRUE)) {
+        WARNING("The output control options 'text-only', 'binary-only', and \
+                'no-deltaQ' are mutually exclusive and cannot be used together!");
+        usage(stdout);
+        exit(1);
+    }
+
+    // check if text-only output is enabled
+    if(options.text_only_enabled == TRUE) {
+        options.text_output_enabled = TRUE;
+        options.binary_output_enabled = FALSE;
+    }
+    // check if binary-only output is enabled
+    else if(options.binary_only_enabled == TRUE) {
+        options.text_output_enabled = FALSE;
+        options.binary_output_enabled = TRUE;
+    }
+    // check if no-deltaQ output is enabled
+    else if(no_deltaQ_enabled == TRUE) {
+        options.text_output_enabled = FALSE;
+        options.binary_output_enabled = FALSE;
+    }
+
+    // per-host output is derived from binary output
+    if(options.per_host_group_size > 0 && options.binary_output_enabled == FALSE) {
+        WARNING("Per-host output requires binary output to be enabled!");
+        usage(stdout);
+        exit(1);
+    }
+
+    // outputs which accumulate data in memory until the end of
+    // the run, or are split in many files, cannot be checkpointed
+    if((options.checkpoint_interval > 0 || options.resume_enabled == TRUE) &&
+            (options.columnar_output_enabled == TRUE || options.summary_output_enabled == TRUE ||
+             options.per_host_group_size > 0)) {
+        WARNING("Checkpoints cannot be used with columnar, summary or per-host output!");
+        usage(stdout);
+        exit(1);
+    }
+
+    // the state of replicas is not saved in checkpoints
+    if((options.checkpoint_interval > 0 || options.resume_enabled == TRUE) && options.replica_number > 0) {
+        WARNING("Checkpoints cannot be used with ensemble computation!");
+        usage(stdout);
+        exit(1);
+    }
+
+    if(options.deltaQ_disabled == TRUE && options.replica_number > 0) {
+        WARNING("Ensemble computation requires deltaQ computation to be enabled!");
+        usage(stdout);
+        exit(1);
+    }
+
+    // each variant of a sweep would need its own checkpoint
+    if((options.checkpoint_interval > 0 || options.resume_enabled == TRUE) && sweep_enabled == TRUE) {
+        WARNING("Checkpoints cannot be used with sweeps!");
+        usage(stdout);
+        exit(1);
+    }
+
+    if(parallel_number > 1 && sweep_enabled == FALSE) {
+        WARNING("Parallel computation of variants requires a sweep!");
+        usage(stdout);
+        exit(1);
+    }
+
+    // output files are continued when resuming
+    options.output_file_mode = (options.resume_enabled == TRUE) ? "r+" : "w";
+
+    // optind represents the index where option parsing stopped
+    // and where non-option arguments parsing can start;
+    // check whether non-option arguments are present
+    if(argc == optind) {
+        WARNING("No scenario configuration file was provided.");
+        printf("\n%s: A versatile wireless network emulator.\n", qomet_name);
+        usage(stdout);
+        exit(1);
+    }
+
+
+
+    ////////////////////////////////////////////////////////////
+    // more initialization
+
+    INFO("\n-- Wireless network emulator %s --", qomet_name);
+    INFO("Starting...");
+
+#ifdef ADD_NOISE
+    fprintf(stderr, "Noise will be added to your experiment!\n");
+    fprintf(stderr, "Press <Return> to continue...\n");
+    getchar();
+#endif
+
+
+    // try to allocate the xml_scenario object
+    xml_scenario = (struct xml_scenario_class *)malloc(sizeof(struct xml_scenario_class));
+
+    if(xml_scenario == NULL) {
+        WARNING("Cannot allocate memory (tried %zd bytes); you may need to reduce \
+                maximum scenario size by editing the maximum data sizes constants in the \
+                file 'deltaQ/scenario.h' (MAX_NODES, MAX_OBJECTS, MAX_ENVIRONMENTS, \
+                MAX_MOTIONS and MAX_CONNECTIONS)", sizeof (struct xml_scenario_class));
+        goto ERROR_HANDLE;
+    }
+    else {
+        DEBUG("Allocated %.2f MB (%zd bytes) for internal scenario storage.",
+                sizeof (struct xml_scenario_class) / 1048576.0, sizeof (struct xml_scenario_class));
+    }
+
+    // initialize the scenario object
+    scenario_init(&(xml_scenario->scenario));
+
+    ////////////////////////////////////////////////////////////
+    // scenario parsing phase
+    INFO("\n-- QOMET Emulator: Scenario Parsing --\n");
+
+    if(strlen(argv[optind]) > MAX_STRING) {
+        WARNING("Input file name '%s' longer than %d characters!", argv[optind], MAX_STRING);
+        goto ERROR_HANDLE;
+    }
+    else {
+        strncpy(scenario_filename, argv[optind], MAX_STRING - 1);
+    }
+
+    // set the output filename base to the scenario filename
+    // if no output filename base was provided
+    if(output_filename_provided == FALSE) {
+        strncpy(output_filename_base, scenario_filename, MAX_STRING - 1);
+    }
+
+    // open scenario file
+    scenario_file = fopen(scenario_filename, "r");
+    if(scenario_file == NULL) {
+        WARNING("Cannot open scenario file '%s'!", scenario_filename);
+        goto ERROR_HANDLE;
+    }
+
+    // parse scenario file
+    if(xml_scenario_parse(scenario_file, xml_scenario) == ERROR) {
+        WARNING("Cannot parse scenario file '%s'!", scenario_filename);
+        goto ERROR_HANDLE;
+    }
+
+    // print parse summary
+    INFO("Scenario file '%s' parsed.", scenario_filename);
+#ifdef MESSAGE_DEBUG
+    DEBUG("Loaded scenario file summary:");
+    xml_scenario_print (xml_scenario);
+#endif
+
+
+    ////////////////////////////////////////////////////////////
+    // computation phase
+
+    if(sweep_enabled == TRUE) {
+        error_status = compute_sweep(&options, xml_scenario, sweep_filename, output_filename_base,
+                parallel_number);
+    }
+    else {
+        error_status = compute_scenario(&options, xml_scenario, output_filename_base, FALSE);
+    }
+
+    // if no errors occurred, skip next instruction
+    goto FINAL_HANDLE;
+
+ERROR_HANDLE:
+    error_status = ERROR;
+
+    // print this in case of unsuccessful processing
+    INFO("\n-- Scenario processing completed with errors (see the WARNING messages above)\n\n");
+    fprintf(stderr, "\n\n-- Scenario processing completed with errors (see the WARNING messages above)\n\n");
+
+
+    ////////////////////////////////////////////////////////////
+    // finalizing phase
+
+FINAL_HANDLE:
+
+    // close scenario file
+    if(scenario_file != NULL) {
+        fclose(scenario_file);
+    }
+
+    if(xml_scenario != NULL) {
+        scenario_free_motion_checkpoints(&(xml_scenario->scenario));
+        free(xml_scenario);
+    }
+
+    link_table_free_all();
+
     return error_status;
 }
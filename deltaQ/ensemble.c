@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: ensemble.c
+ * Function: Monte Carlo ensembles of deltaQ computations
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ensemble.h"
+#include "generic.h"
+#include "message.h"
+
+
+// deltaQ parameters summarized in ensemble output
+#define ENSEMBLE_METRICS                4
+
+static const char *metric_names[ENSEMBLE_METRICS] =
+  { "loss_rate", "delay", "jitter", "bandwidth" };
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// return the value of deltaQ parameter 'metric_i' of a connection
+static double
+metric_value (struct connection_class *connection, int metric_i)
+{
+  switch (metric_i)
+    {
+    case 0:
+      return connection->loss_rate;
+    case 1:
+      return connection->delay;
+    case 2:
+      return connection->jitter;
+    default:
+      return connection->bandwidth;
+    }
+}
+
+// compute the deltaQ parameters of the connections of a replica,
+// starting from the shared deterministic state in 'scenario';
+// return SUCCESS on succes, ERROR on error
+static int
+replica_deltaQ (struct connection_class *connections,
+		struct scenario_class *scenario, double current_time)
+{
+  struct connection_class *connection, *shared_connection;
+  int connection_i, deltaQ_changed;
+
+  // interference is computed from the connections of this replica
+  scenario->interfering_connections = connections;
+
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      connection = &(connections[connection_i]);
+      shared_connection = &(scenario->connections[connection_i]);
+
+      connection_apply_fixed_deltaQ (connection, current_time);
+
+      connection->distance = shared_connection->distance;
+      connection->shadowing_sigma = shared_connection->shadowing_sigma;
+      connection->Pr = shared_connection->Pr +
+	randn (0, shared_connection->shadowing_sigma);
+
+      if (connection_do_compute (connection, scenario, &deltaQ_changed)
+	  == ERROR)
+	{
+	  WARNING ("Error while computing connection parameters");
+	  scenario->interfering_connections = NULL;
+	  return ERROR;
+	}
+    }
+
+  scenario->interfering_connections = NULL;
+
+  return SUCCESS;
+}
+
+
+////////////////////////////////////////////////
+// Ensemble functions
+////////////////////////////////////////////////
+
+// init an ensemble of 'replica_number' replicas that start from
+// the current connection state of 'scenario';
+// return SUCCESS on succes, ERROR on error
+int
+ensemble_init (struct ensemble_class *ensemble,
+	       struct scenario_class *scenario, int replica_number)
+{
+  int replica_i;
+
+  memset (ensemble, 0, sizeof (struct ensemble_class));
+
+  if (replica_number < 2 || replica_number > MAX_ENSEMBLE_REPLICAS)
+    {
+      WARNING ("Invalid number of replicas (%d)", replica_number);
+      return ERROR;
+    }
+
+  ensemble->connections = (struct connection_class **)
+    calloc (replica_number, sizeof (struct connection_class *));
+  ensemble->rand_states = (unsigned int *)
+    calloc (replica_number, sizeof (unsigned int));
+  if (ensemble->connections == NULL || ensemble->rand_states == NULL)
+    {
+      WARNING ("Cannot allocate memory for ensemble replicas");
+      ensemble_free (ensemble);
+      return ERROR;
+    }
+  ensemble->replica_number = replica_number;
+
+  for (replica_i = 0; replica_i < replica_number; replica_i++)
+    {
+      ensemble->connections[replica_i] = (struct connection_class *)
+	malloc ((scenario->connection_number + 1) *
+		sizeof (struct connection_class));
+      if (ensemble->connections[replica_i] == NULL)
+	{
+	  WARNING ("Cannot allocate memory for ensemble replicas");
+	  ensemble_free (ensemble);
+	  return ERROR;
+	}
+
+      memcpy (ensemble->connections[replica_i], scenario->connections,
+	      scenario->connection_number * sizeof (struct connection_class));
+      ensemble->rand_states[replica_i] = 1 + replica_i * 2654435761u;
+    }
+
+  return SUCCESS;
+}
+
+// compute deltaQ parameters for all replicas at 'current_time';
+// the connections of 'scenario' are set to those of replica 0;
+// return SUCCESS on succes, ERROR on error
+int
+ensemble_deltaQ (struct ensemble_class *ensemble,
+		 struct scenario_class *scenario, double current_time)
+{
+  unsigned int *previous_rand_state;
+  int connection_i, replica_i;
+  int result = SUCCESS;
+
+  // distance and path loss are computed once for all replicas
+  scenario->shadowing_deferred = TRUE;
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    if (connection_update (&(scenario->connections[connection_i]),
+			   scenario) == ERROR)
+      {
+	scenario->shadowing_deferred = FALSE;
+	return ERROR;
+      }
+  scenario->shadowing_deferred = FALSE;
+
+  for (replica_i = 0; replica_i < ensemble->replica_number
+       && result == SUCCESS; replica_i++)
+    {
+      previous_rand_state = generic_set_rand_state
+	((replica_i == 0) ? NULL : &(ensemble->rand_states[replica_i]));
+      result = replica_deltaQ (ensemble->connections[replica_i], scenario,
+			       current_time);
+      generic_set_rand_state (previous_rand_state);
+    }
+
+  if (result == ERROR)
+    return ERROR;
+
+  memcpy (scenario->connections, ensemble->connections[0],
+	  scenario->connection_number * sizeof (struct connection_class));
+
+  return SUCCESS;
+}
+
+// write the header of ensemble output to 'file'
+void
+ensemble_write_header (struct ensemble_class *ensemble, FILE * file,
+		       char *qomet_name)
+{
+  int metric_i;
+
+  fprintf (file, "%% Ensemble output generated by %s\n", qomet_name);
+  fprintf (file, "%% %d replicas; mean and 95%% confidence interval of "
+	   "each parameter; delay and jitter in ms, bandwidth in bit/s\n",
+	   ensemble->replica_number);
+  fprintf (file, "%% time from_id to_id");
+  for (metric_i = 0; metric_i < ENSEMBLE_METRICS; metric_i++)
+    fprintf (file, " %s_mean %s_low %s_high", metric_names[metric_i],
+	     metric_names[metric_i], metric_names[metric_i]);
+  fprintf (file, "\n");
+}
+
+// write to 'file' the mean and confidence interval of the deltaQ
+// parameters of all replicas for each connection (except those
+// starting from noise sources); return SUCCESS on succes,
+// ERROR on error
+int
+ensemble_write_step (struct ensemble_class *ensemble,
+		     struct scenario_class *scenario, double time,
+		     FILE * file)
+{
+  struct connection_class *connection;
+  double value, mean, m2, delta, half_width;
+  int connection_i, replica_i, metric_i;
+
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      connection = &(scenario->connections[connection_i]);
+      if (scenario->nodes[connection->from_node_index].
+	  interfaces[connection->from_interface_index].noise_source == TRUE)
+	continue;
+
+      fprintf (file, "%.2f %d %d", time, connection->from_id,
+	       connection->to_id);
+
+      for (metric_i = 0; metric_i < ENSEMBLE_METRICS; metric_i++)
+	{
+	  // mean and variance (Welford's method)
+	  mean = 0.0;
+	  m2 = 0.0;
+	  for (replica_i = 0; replica_i < ensemble->replica_number;
+	       replica_i++)
+	    {
+	      value = metric_value (&(ensemble->connections[replica_i]
+				      [connection_i]), metric_i);
+	      delta = value - mean;
+	      mean += delta / (replica_i + 1);
+	      m2 += delta * (value - mean);
+	    }
+
+	  half_width = ENSEMBLE_CONFIDENCE_Z *
+	    sqrt (m2 / (ensemble->replica_number - 1) /
+		  ensemble->replica_number);
+	  fprintf (file, " %.6g %.6g %.6g", mean, mean - half_width,
+		   mean + half_width);
+	}
+
+      fprintf (file, "\n");
+    }
+
+  if (ferror (file))
+    {
+      WARNING ("Error writing ensemble output");
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// release the resources of an ensemble
+void
+ensemble_free (struct ensemble_class *ensemble)
+{
+  int replica_i;
+
+  if (ensemble->connections != NULL)
+    for (replica_i = 0; replica_i < ensemble->replica_number; replica_i++)
+      free (ensemble->connections[replica_i]);
+
+  free (ensemble->connections);
+  free (ensemble->rand_states);
+  ensemble->connections = NULL;
+  ensemble->rand_states = NULL;
+  ensemble->replica_number = 0;
+}
@@ -25,12 +25,29 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <limits.h>
+#include <string.h>
 
 #include "message.h"
 #include "deltaQ.h"
 #include "generic.h"
 
 
+// random state used by the current thread instead of the
+// random stream, if one was set
+static __thread unsigned int *thread_rand_state = NULL;
+
+// random stream used by the current thread instead of the
+// shared one, if one was set
+static __thread struct generic_rand_stream_class *thread_rand_stream = NULL;
+
+// random stream shared by threads that do not have one of their own;
+// it replaces the state of rand(), so that it can be saved and
+// restored; it is initialized at its first use with the default seed
+// of rand() (1)
+static struct generic_rand_stream_class shared_rand_stream;
+static int shared_rand_stream_initialized = FALSE;
+
+
 /////////////////////////////////////////////
 // Generic functions
 /////////////////////////////////////////////
@@ -104,11 +121,125 @@ long_int_value (const char *string)
   return value;
 }
 
+// make the random functions below use 'rand_state' in the current
+// thread, so that threads do not share the random stream;
+// use NULL to return to the random stream; return the previous
+// random state
+unsigned int *
+generic_set_rand_state (unsigned int *rand_state)
+{
+  unsigned int *previous_rand_state = thread_rand_state;
+
+  thread_rand_state = rand_state;
+
+  return previous_rand_state;
+}
+
+// init a random stream seeded with 'seed'
+void
+generic_rand_stream_init (struct generic_rand_stream_class *stream,
+			  unsigned int seed)
+{
+  memset (stream, 0, sizeof (struct generic_rand_stream_class));
+  initstate_r (seed, stream->state, GENERIC_RAND_STREAM_STATE_SIZE,
+	       &(stream->data));
+}
+
+// make the current thread use 'stream' instead of the shared random
+// stream (use NULL to return to the shared stream); random states set
+// by generic_set_rand_state still take precedence;
+// return the previous random stream
+struct generic_rand_stream_class *
+generic_set_rand_stream (struct generic_rand_stream_class *stream)
+{
+  struct generic_rand_stream_class *previous_rand_stream =
+    thread_rand_stream;
+
+  thread_rand_stream = stream;
+
+  return previous_rand_stream;
+}
+
+// return the random stream of the current thread
+// (by default the shared one)
+static struct generic_rand_stream_class *
+current_rand_stream ()
+{
+  if (thread_rand_stream != NULL)
+    return thread_rand_stream;
+
+  if (shared_rand_stream_initialized == FALSE)
+    {
+      generic_rand_stream_init (&shared_rand_stream, 1);
+      shared_rand_stream_initialized = TRUE;
+    }
+
+  return &shared_rand_stream;
+}
+
+// seed the random stream of the current thread
+// (by default the shared one)
+void
+generic_rand_seed (unsigned int seed)
+{
+  srandom_r (seed, &(current_rand_stream ()->data));
+}
+
+// save to 'saved' the state of the random stream of the current
+// thread (by default the shared one)
+void
+generic_rand_save (struct generic_rand_saved_class *saved)
+{
+  struct generic_rand_stream_class *stream = current_rand_stream ();
+
+  memcpy (saved->state, stream->state, GENERIC_RAND_STREAM_STATE_SIZE);
+  saved->front_i = stream->data.fptr - stream->data.state;
+  saved->rear_i = stream->data.rptr - stream->data.state;
+}
+
+// restore the state of the random stream of the current thread
+// (by default the shared one) from 'saved';
+// return SUCCESS on succes, ERROR if 'saved' is not valid
+int
+generic_rand_restore (struct generic_rand_saved_class *saved)
+{
+  struct generic_rand_stream_class *stream = current_rand_stream ();
+
+  // the type of generator is given by the size of the state, which
+  // is the same for all streams
+  if (saved->front_i < 0 || saved->front_i >= stream->data.rand_deg
+      || saved->rear_i < 0 || saved->rear_i >= stream->data.rand_deg)
+    {
+      WARNING ("Invalid random stream state (front=%d rear=%d)",
+	       saved->front_i, saved->rear_i);
+      return ERROR;
+    }
+
+  memcpy (stream->state, saved->state, GENERIC_RAND_STREAM_STATE_SIZE);
+  stream->data.fptr = stream->data.state + saved->front_i;
+  stream->data.rptr = stream->data.state + saved->rear_i;
+
+  return SUCCESS;
+}
+
+// generate a random integer in the interval [0,RAND_MAX]
+int
+generic_rand ()
+{
+  int32_t value;
+
+  if (thread_rand_state != NULL)
+    return rand_r (thread_rand_state);
+
+  random_r (&(current_rand_stream ()->data), &value);
+  return value;
+}
+
 // generate a random number in the interval [0,1)
 double
 rand_0_1 ()
 {
-  return rand () / ((double) RAND_MAX + 1.0);
+  return generic_rand () / ((double) RAND_MAX + 1.0);
 }
 
 // generate a random double in the interval [min,max);
@@ -116,7 +247,7 @@ rand_0_1 ()
 double
 rand_min_max (double min, double max)
 {
-  return (min + (rand () / ((double) RAND_MAX + 1.0)) * (max - min));
+  return (min + (generic_rand () / ((double) RAND_MAX + 1.0)) * (max - min));
 }
 
 // generate a random double in the interval [min,max] (max inclusive);
@@ -124,7 +255,7 @@ rand_min_max (double min, double max)
 double
 rand_min_max_inclusive (double min, double max)
 {
-  return (min + (rand () / (double) RAND_MAX) * (max - min));
+  return (min + (generic_rand () / (double) RAND_MAX) * (max - min));
 }
 
 // generate a random number from a normal distribution 
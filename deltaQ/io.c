@@ -20,8 +20,15 @@
  ***********************************************************************/
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "io.h"
 #include "global.h"
@@ -32,6 +39,241 @@
 #define GRID_SIZE_Y            300.0
 #define NODE_RADIUS            5.0
 
+// largest precision handled by 'io_format_fixed' without printf
+#define MAX_FAST_PRECISION     9
+
+// values scaled by the precision must stay below 2^52 so that
+// integers and half-integers are represented exactly
+#define MAX_FAST_SCALED        4503599627370496.0
+
+static const double powers_of_10[MAX_FAST_PRECISION + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+static const uint64_t int_powers_of_10[MAX_FAST_PRECISION + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL
+};
+
+// size of the chunks used when a file cannot be mapped
+#define READ_CHUNK_SIZE        65536
+
+
+////////////////////////////////////////////////
+// File mapping functions
+////////////////////////////////////////////////
+
+// read the whole content of a file that cannot be mapped
+// (e.g., a pipe); return SUCCESS on succes, ERROR on error
+    static int
+read_whole_file (int fd, const char *filename, char **data, size_t * size)
+{
+    size_t allocated = 0;
+    ssize_t read_size;
+    char *new_data;
+
+    *data = NULL;
+    *size = 0;
+
+    do
+    {
+        if (*size + READ_CHUNK_SIZE > allocated)
+        {
+            allocated = (allocated == 0) ? READ_CHUNK_SIZE : allocated * 2;
+            new_data = (char *) realloc (*data, allocated);
+            if (new_data == NULL)
+            {
+                WARNING ("Cannot allocate memory for file '%s'", filename);
+                free (*data);
+                *data = NULL;
+                return ERROR;
+            }
+            *data = new_data;
+        }
+
+        read_size = read (fd, *data + *size, READ_CHUNK_SIZE);
+        if (read_size < 0)
+        {
+            WARNING ("Cannot read file '%s'", filename);
+            free (*data);
+            *data = NULL;
+            return ERROR;
+        }
+        *size += read_size;
+    }
+    while (read_size > 0);
+
+    return SUCCESS;
+}
+
+// make the whole content of a file available in memory, by mapping
+// it if possible and by reading it otherwise; 'mapped' is set to
+// TRUE in the first case; return SUCCESS on succes, ERROR on error
+    int
+io_map_file (const char *filename, char **data, size_t * size, int *mapped)
+{
+    int fd;
+    struct stat file_stat;
+    void *mapping;
+
+    *data = NULL;
+    *size = 0;
+    *mapped = FALSE;
+
+    if ((fd = open (filename, O_RDONLY)) < 0)
+    {
+        WARNING ("Cannot open file '%s'", filename);
+        return ERROR;
+    }
+
+    if (fstat (fd, &file_stat) == 0 && S_ISREG (file_stat.st_mode)
+            && file_stat.st_size > 0)
+    {
+        mapping = mmap (NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE,
+                fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            *data = (char *) mapping;
+            *size = file_stat.st_size;
+            *mapped = TRUE;
+            close (fd);
+            return SUCCESS;
+        }
+    }
+
+    if (read_whole_file (fd, filename, data, size) == ERROR)
+    {
+        close (fd);
+        return ERROR;
+    }
+
+    close (fd);
+    return SUCCESS;
+}
+
+// release the memory obtained with 'io_map_file'
+    void
+io_unmap_file (char *data, size_t size, int mapped)
+{
+    if (data == NULL)
+        return;
+
+    if (mapped == TRUE)
+        munmap (data, size);
+    else
+        free (data);
+}
+
+
+////////////////////////////////////////////////
+// Number formatting functions
+////////////////////////////////////////////////
+
+// write an unsigned integer in decimal form, padded with zeros
+// to at least 'min_digits' digits; return the number of characters
+    static int
+format_unsigned (char *buffer, uint64_t value, int min_digits)
+{
+    char digits[24];
+    int digit_count = 0;
+    int i;
+
+    do
+    {
+        digits[digit_count++] = '0' + (value % 10);
+        value /= 10;
+    }
+    while (value != 0);
+
+    while (digit_count < min_digits)
+        digits[digit_count++] = '0';
+
+    for (i = 0; i < digit_count; i++)
+        buffer[i] = digits[digit_count - 1 - i];
+
+    return digit_count;
+}
+
+// write 'value' to 'buffer' exactly as printf ("%.*f", precision, value)
+// would, i.e., the binary value rounded half-to-even at the given
+// precision; common cases are handled without printf, using an fma to
+// get the exact rounding error of the scaling; 'size' must be at least
+// IO_FORMAT_SIZE; return the number of characters written
+    int
+io_format_fixed (char *buffer, size_t size, double value, int precision)
+{
+    double magnitude, scaled, error, rounded, remainder, difference;
+    uint64_t integer;
+    int length = 0;
+
+    if (precision < 0 || precision > MAX_FAST_PRECISION
+            || isfinite (value) == 0 || size < IO_FORMAT_SIZE)
+        return snprintf (buffer, size, "%.*f", precision, value);
+
+    magnitude = fabs (value);
+    scaled = magnitude * powers_of_10[precision];
+    if (scaled >= MAX_FAST_SCALED)
+        return snprintf (buffer, size, "%.*f", precision, value);
+
+    // magnitude * 10^precision == scaled + error exactly
+    error = fma (magnitude, powers_of_10[precision], -scaled);
+    rounded = nearbyint (scaled);
+    remainder = scaled - rounded;
+
+    // the rounding of 'scaled' may hide which side of a half-way
+    // point the exact value is on; decide that using 'error'
+    if (remainder >= 0.25)
+    {
+        difference = (remainder - 0.5) + error;
+        if (difference > 0 || (difference == 0 && fmod (rounded, 2.0) != 0))
+            rounded += 1.0;
+    }
+    else if (remainder <= -0.25)
+    {
+        difference = (remainder + 0.5) + error;
+        if (difference < 0 || (difference == 0 && fmod (rounded, 2.0) != 0))
+            rounded -= 1.0;
+    }
+
+    integer = (uint64_t) rounded;
+
+    // printf keeps the sign of negative values rounded to zero
+    if (signbit (value))
+        buffer[length++] = '-';
+
+    length += format_unsigned (buffer + length,
+            integer / int_powers_of_10[precision], 1);
+    if (precision > 0)
+    {
+        buffer[length++] = '.';
+        length += format_unsigned (buffer + length,
+                integer % int_powers_of_10[precision], precision);
+    }
+    buffer[length] = '\0';
+
+    return length;
+}
+
+// write an integer in decimal form; return the number of characters
+    int
+io_format_int (char *buffer, int value)
+{
+    int length = 0;
+    uint64_t magnitude;
+
+    if (value < 0)
+    {
+        buffer[length++] = '-';
+        magnitude = -(int64_t) value;
+    }
+    else
+        magnitude = value;
+
+    length += format_unsigned (buffer + length, magnitude, 1);
+    buffer[length] = '\0';
+
+    return length;
+}
+
 
 ////////////////////////////////////////////////
 // Text I/O functions
@@ -47,13 +289,17 @@ io_write_header_to_file (FILE * file_global, char *qomet_name)
             num_retr op_rate bandwidth loss_rate delay jitter\n");
 }
 
-// write connection description to file
-    void
-io_write_to_file (struct connection_class *connection,
+// format connection description as one line of text output into
+// 'line', which must be at least IO_LINE_SIZE bytes long;
+// return the length of the line
+    int
+io_format_connection (struct connection_class *connection,
         struct scenario_class *scenario, double time,
-        int cartesian_coord_syst, FILE * file_global)
+        int cartesian_coord_syst, char *line)
 {
     struct node_class *from_node, *to_node;
+    char *p = line;
+    char *end = line + IO_LINE_SIZE;
 
     struct coordinate_class saved_from, saved_to;
     struct coordinate_class point_blh;
@@ -139,16 +385,45 @@ io_write_to_file (struct connection_class *connection,
     else
         to_c2 = to_node->position.c[2];
 
-    // write current connection description to file using 
-    // from_id and to_id from connection
-    fprintf(file_global, "%.2f %d %.6f %.6f %.6f %d %.6f %.6f %.6f"
-            "%.4f %.4f %.4f %.4f %.4f %.2f %.2f %.4f %.4f %.4f\n",
-            time, connection->from_id, from_c0, from_c1, from_c2, 
-            connection->to_id, to_c0, to_c1, to_c2, 
-            connection->distance, connection->Pr, connection->SNR, 
-            connection->frame_error_rate, connection->num_retransmissions, 
-            connection_get_operating_rate(connection), 
-            connection->bandwidth, connection->loss_rate, connection->delay, connection->jitter);
+    // write current connection description using from_id and to_id
+    // from connection; the fields are the same as for the format
+    // "%.2f %d %.6f %.6f %.6f %d %.6f %.6f %.6f "
+    // "%.4f %.4f %.4f %.4f %.4f %.2f %.2f %.4f %.4f %.4f\n"
+#define FORMAT_FIXED(value, precision) do {                         \
+        p += io_format_fixed (p, end - p, (value), (precision));    \
+        *p++ = ' ';                                                 \
+    } while (0)
+#define FORMAT_INT(value) do {                                      \
+        p += io_format_int (p, (value));                            \
+        *p++ = ' ';                                                 \
+    } while (0)
+
+    FORMAT_FIXED (time, 2);
+    FORMAT_INT (connection->from_id);
+    FORMAT_FIXED (from_c0, 6);
+    FORMAT_FIXED (from_c1, 6);
+    FORMAT_FIXED (from_c2, 6);
+    FORMAT_INT (connection->to_id);
+    FORMAT_FIXED (to_c0, 6);
+    FORMAT_FIXED (to_c1, 6);
+    FORMAT_FIXED (to_c2, 6);
+    FORMAT_FIXED (connection->distance, 4);
+    FORMAT_FIXED (connection->Pr, 4);
+    FORMAT_FIXED (connection->SNR, 4);
+    FORMAT_FIXED (connection->frame_error_rate, 4);
+    FORMAT_FIXED (connection->num_retransmissions, 4);
+    FORMAT_FIXED (connection_get_operating_rate (connection), 2);
+    FORMAT_FIXED (connection->bandwidth, 2);
+    FORMAT_FIXED (connection->loss_rate, 4);
+    FORMAT_FIXED (connection->delay, 4);
+    FORMAT_FIXED (connection->jitter, 4);
+
+#undef FORMAT_FIXED
+#undef FORMAT_INT
+
+    // replace the last separator with the end of line
+    p[-1] = '\n';
+    *p = '\0';
 
     // restore coordinates
     if (cartesian_coord_syst == FALSE)
@@ -156,6 +431,22 @@ io_write_to_file (struct connection_class *connection,
         coordinate_copy (&(from_node->position), &saved_from);
         coordinate_copy (&(to_node->position), &saved_to);
     }
+
+    return p - line;
+}
+
+// write connection description to file
+    void
+io_write_to_file (struct connection_class *connection,
+        struct scenario_class *scenario, double time,
+        int cartesian_coord_syst, FILE * file_global)
+{
+    char line[IO_LINE_SIZE];
+    int length;
+
+    length = io_format_connection (connection, scenario, time,
+            cartesian_coord_syst, line);
+    fwrite (line, 1, length, file_global);
 }
 
 // write header of motion file in NAM format;
@@ -556,7 +847,7 @@ int array_size;
 
 // print binary header
     void
-io_binary_print_header (struct bin_hdr_cls *bin_hdr)
+io_binary_print_header (const struct bin_hdr_cls *bin_hdr)
 {
     // print signature (only first 3 characters)
     printf ("Header signature: %c%c%c\n",
@@ -574,14 +865,14 @@ io_binary_print_header (struct bin_hdr_cls *bin_hdr)
 // print binary time record
 void
 io_binary_print_time_record(binary_time_record)
-struct bin_time_rec_cls *binary_time_record;
+const struct bin_time_rec_cls *binary_time_record;
 {
     INFO("- Time: %.2f s (%d records)\n", binary_time_record->time, binary_time_record->record_number);
 }
 
 // print binary record
     void
-io_binary_print_record (struct bin_rec_cls *binary_record)
+io_binary_print_record (const struct bin_rec_cls *binary_record)
 {
     /*
        printf ("-- Record: from_node=%d to_node=%d FER=%.4f num_retr=%.4f \
@@ -597,7 +888,7 @@ io_binary_print_record (struct bin_rec_cls *binary_record)
 // print binary record for gnuplot
 void
 io_bin_rec2gnuplot(bin_rec, time)
-struct bin_rec_cls *bin_rec;
+const struct bin_rec_cls *bin_rec;
 double time;
 {
     printf("%.4f %d %d %.6f %.6f %.6f\n", 
@@ -608,7 +899,7 @@ double time;
     void
 io_bin_cp_rec(bin_rec_dst, bin_rec_src)
     struct bin_rec_cls *bin_rec_dst;
-    struct bin_rec_cls *bin_rec_src;
+    const struct bin_rec_cls *bin_rec_src;
 {
     bin_rec_dst->from_id             = bin_rec_src->from_id;
     bin_rec_dst->to_id               = bin_rec_src->to_id;
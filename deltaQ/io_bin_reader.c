@@ -0,0 +1,381 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_bin_reader.c
+ * Function: Random-access reader for the binary output of QOMET
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_bin_reader.h"
+#include "message.h"
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// get a time record by index
+static const struct bin_time_rec_cls *
+time_record_at (struct io_bin_reader_cls *reader, long int time_rec_i)
+{
+  return (const struct bin_time_rec_cls *)
+    (reader->data + reader->time_rec_offsets[time_rec_i]);
+}
+
+// get the records that follow a time record
+static const struct bin_rec_cls *
+records_at (struct io_bin_reader_cls *reader, long int time_rec_i)
+{
+  return (const struct bin_rec_cls *)
+    (reader->data + reader->time_rec_offsets[time_rec_i] +
+     sizeof (struct bin_time_rec_cls));
+}
+
+// build the index of time records; a truncated file is accepted,
+// but only its complete time records are used;
+// return SUCCESS on succes, ERROR on error
+static int
+build_time_index (struct io_bin_reader_cls *reader)
+{
+  const struct bin_time_rec_cls *time_record;
+  size_t offset = sizeof (struct bin_hdr_cls);
+  size_t end;
+  long int time_rec_i;
+  long int max_time_rec_num;
+
+  // a corrupted header must not cause a huge allocation
+  max_time_rec_num = (reader->size - sizeof (struct bin_hdr_cls)) /
+    sizeof (struct bin_time_rec_cls);
+  if (max_time_rec_num > reader->header->time_rec_num)
+    max_time_rec_num = reader->header->time_rec_num;
+
+  reader->time_rec_offsets =
+    (size_t *) malloc ((max_time_rec_num + 1) * sizeof (size_t));
+  if (reader->time_rec_offsets == NULL)
+    {
+      WARNING ("Cannot allocate memory for time record index");
+      return ERROR;
+    }
+
+  for (time_rec_i = 0; time_rec_i < max_time_rec_num; time_rec_i++)
+    {
+      if (offset + sizeof (struct bin_time_rec_cls) > reader->size)
+	break;
+
+      time_record = (const struct bin_time_rec_cls *) (reader->data + offset);
+      if (time_record->record_number < 0)
+	break;
+
+      end = offset + sizeof (struct bin_time_rec_cls) +
+	time_record->record_number * sizeof (struct bin_rec_cls);
+      if (end > reader->size)
+	break;
+
+      reader->time_rec_offsets[time_rec_i] = offset;
+      offset = end;
+    }
+
+  reader->time_rec_num = time_rec_i;
+  if (reader->time_rec_num < reader->header->time_rec_num)
+    WARNING ("File '%s' is truncated: only %ld of %d time records are valid",
+	     reader->filename, reader->time_rec_num,
+	     reader->header->time_rec_num);
+
+  return SUCCESS;
+}
+
+// build the per-link index of records;
+// return SUCCESS on succes, ERROR on error
+static int
+build_link_index (struct io_bin_reader_cls *reader)
+{
+  const struct bin_rec_cls *records;
+  long int if_num = reader->header->if_num;
+  long int link_number = if_num * if_num;
+  long int *link_fill;
+  long int time_rec_i, link_i;
+  int rec_i, record_number;
+
+  reader->link_starts = (long int *) calloc (link_number + 1,
+					     sizeof (long int));
+  link_fill = (long int *) calloc (link_number, sizeof (long int));
+  if (reader->link_starts == NULL || link_fill == NULL)
+    {
+      WARNING ("Cannot allocate memory for link index");
+      free (reader->link_starts);
+      free (link_fill);
+      reader->link_starts = NULL;
+      return ERROR;
+    }
+
+  // count records of each link; records with invalid ids are ignored
+  for (time_rec_i = 0; time_rec_i < reader->time_rec_num; time_rec_i++)
+    {
+      records = records_at (reader, time_rec_i);
+      record_number = time_record_at (reader, time_rec_i)->record_number;
+      for (rec_i = 0; rec_i < record_number; rec_i++)
+	if (records[rec_i].from_id >= 0 && records[rec_i].from_id < if_num
+	    && records[rec_i].to_id >= 0 && records[rec_i].to_id < if_num)
+	  reader->link_starts[records[rec_i].from_id * if_num +
+			      records[rec_i].to_id + 1]++;
+    }
+
+  for (link_i = 0; link_i < link_number; link_i++)
+    {
+      reader->link_starts[link_i + 1] += reader->link_starts[link_i];
+      link_fill[link_i] = reader->link_starts[link_i];
+    }
+
+  reader->link_entries = (struct io_bin_link_entry_cls *)
+    malloc ((reader->link_starts[link_number] + 1) *
+	    sizeof (struct io_bin_link_entry_cls));
+  if (reader->link_entries == NULL)
+    {
+      WARNING ("Cannot allocate memory for link index");
+      free (reader->link_starts);
+      free (link_fill);
+      reader->link_starts = NULL;
+      return ERROR;
+    }
+
+  // records are stored in time order for each link
+  for (time_rec_i = 0; time_rec_i < reader->time_rec_num; time_rec_i++)
+    {
+      records = records_at (reader, time_rec_i);
+      record_number = time_record_at (reader, time_rec_i)->record_number;
+      for (rec_i = 0; rec_i < record_number; rec_i++)
+	if (records[rec_i].from_id >= 0 && records[rec_i].from_id < if_num
+	    && records[rec_i].to_id >= 0 && records[rec_i].to_id < if_num)
+	  {
+	    link_i = records[rec_i].from_id * if_num + records[rec_i].to_id;
+	    reader->link_entries[link_fill[link_i]].time_rec_i = time_rec_i;
+	    reader->link_entries[link_fill[link_i]].offset =
+	      (const char *) &(records[rec_i]) - reader->data;
+	    link_fill[link_i]++;
+	  }
+    }
+
+  free (link_fill);
+
+  return SUCCESS;
+}
+
+// get the index of the link 'from_id' -> 'to_id', building the
+// per-link index if needed; return the index, or ERROR on error
+static long int
+link_index (struct io_bin_reader_cls *reader, int from_id, int to_id)
+{
+  if (from_id < 0 || from_id >= reader->header->if_num
+      || to_id < 0 || to_id >= reader->header->if_num)
+    {
+      WARNING ("Link %d -> %d is out of the valid range [0, %d]",
+	       from_id, to_id, reader->header->if_num - 1);
+      return ERROR;
+    }
+
+  if (reader->link_starts == NULL && build_link_index (reader) == ERROR)
+    return ERROR;
+
+  return (long int) from_id * reader->header->if_num + to_id;
+}
+
+
+////////////////////////////////////////////////
+// Binary reader functions
+////////////////////////////////////////////////
+
+// open a QOMET binary output file and index its time records;
+// return SUCCESS on succes, ERROR on error
+int
+io_bin_reader_open (struct io_bin_reader_cls *reader, const char *filename)
+{
+  memset (reader, 0, sizeof (struct io_bin_reader_cls));
+  strncpy (reader->filename, filename, MAX_STRING - 1);
+
+  if (io_map_file (filename, &(reader->data), &(reader->size),
+		   &(reader->mapped)) == ERROR)
+    return ERROR;
+
+  if (reader->size < sizeof (struct bin_hdr_cls))
+    {
+      WARNING ("File '%s' is too short for a binary header", filename);
+      io_bin_reader_close (reader);
+      return ERROR;
+    }
+
+  reader->header = (const struct bin_hdr_cls *) reader->data;
+  if (!(reader->header->signature[0] == 'Q'
+	&& reader->header->signature[1] == 'M'
+	&& reader->header->signature[2] == 'T'
+	&& reader->header->signature[3] == '\0'))
+    {
+      WARNING ("Incorrect signature in binary file '%s'", filename);
+      io_bin_reader_close (reader);
+      return ERROR;
+    }
+
+  if (reader->header->if_num < 0 || reader->header->time_rec_num < 0)
+    {
+      WARNING ("Invalid header in binary file '%s'", filename);
+      io_bin_reader_close (reader);
+      return ERROR;
+    }
+
+  if (build_time_index (reader) == ERROR)
+    {
+      io_bin_reader_close (reader);
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// release the resources used by a reader
+void
+io_bin_reader_close (struct io_bin_reader_cls *reader)
+{
+  io_unmap_file (reader->data, reader->size, reader->mapped);
+  free (reader->time_rec_offsets);
+  free (reader->link_starts);
+  free (reader->link_entries);
+
+  reader->data = NULL;
+  reader->size = 0;
+  reader->header = NULL;
+  reader->time_rec_num = 0;
+  reader->time_rec_offsets = NULL;
+  reader->link_starts = NULL;
+  reader->link_entries = NULL;
+}
+
+// restart reading from the first time record
+void
+io_bin_reader_rewind (struct io_bin_reader_cls *reader)
+{
+  reader->position = 0;
+}
+
+// position the reader on the first time record whose time is not
+// earlier than 'time'; return the index of that time record (equal
+// to 'time_rec_num' if all records are earlier)
+long int
+io_bin_reader_seek (struct io_bin_reader_cls *reader, double time)
+{
+  long int low = 0;
+  long int high = reader->time_rec_num;
+  long int middle;
+
+  while (low < high)
+    {
+      middle = low + (high - low) / 2;
+      if (time_record_at (reader, middle)->time < time)
+	low = middle + 1;
+      else
+	high = middle;
+    }
+
+  reader->position = low;
+
+  return low;
+}
+
+// get the next time record and its records without copying them;
+// return TRUE if a time record was available, FALSE at end of file
+int
+io_bin_reader_next_batch (struct io_bin_reader_cls *reader,
+			  const struct bin_time_rec_cls **time_record,
+			  const struct bin_rec_cls **records)
+{
+  if (reader->position >= reader->time_rec_num)
+    return FALSE;
+
+  *time_record = time_record_at (reader, reader->position);
+  *records = records_at (reader, reader->position);
+  reader->position++;
+
+  return TRUE;
+}
+
+// init an iterator over the records of the link 'from_id' -> 'to_id';
+// return SUCCESS on succes, ERROR on error
+int
+io_bin_reader_link_iter (struct io_bin_reader_cls *reader,
+			 int from_id, int to_id,
+			 struct io_bin_link_iter_cls *iter)
+{
+  long int link_i;
+
+  if ((link_i = link_index (reader, from_id, to_id)) == ERROR)
+    return ERROR;
+
+  iter->reader = reader;
+  iter->current = reader->link_starts[link_i];
+  iter->end = reader->link_starts[link_i + 1];
+
+  return SUCCESS;
+}
+
+// get the next record of a link and the time at which it applies;
+// return TRUE if a record was available, FALSE otherwise
+int
+io_bin_link_iter_next (struct io_bin_link_iter_cls *iter, float *time,
+		       const struct bin_rec_cls **record)
+{
+  struct io_bin_link_entry_cls *entry;
+
+  if (iter->current >= iter->end)
+    return FALSE;
+
+  entry = &(iter->reader->link_entries[iter->current]);
+  *time = time_record_at (iter->reader, entry->time_rec_i)->time;
+  *record = (const struct bin_rec_cls *) (iter->reader->data + entry->offset);
+  iter->current++;
+
+  return TRUE;
+}
+
+// get the record in effect for the link 'from_id' -> 'to_id' at 'time',
+// that is, the last record of the link whose time is not later than
+// 'time'; return NULL if there is no such record
+const struct bin_rec_cls *
+io_bin_reader_link_state (struct io_bin_reader_cls *reader,
+			  int from_id, int to_id, double time)
+{
+  struct io_bin_link_entry_cls *entries;
+  long int link_i, low, high, middle;
+
+  if ((link_i = link_index (reader, from_id, to_id)) == ERROR)
+    return NULL;
+
+  // find the first entry later than 'time'
+  entries = reader->link_entries;
+  low = reader->link_starts[link_i];
+  high = reader->link_starts[link_i + 1];
+  while (low < high)
+    {
+      middle = low + (high - low) / 2;
+      if (time_record_at (reader, entries[middle].time_rec_i)->time <= time)
+	low = middle + 1;
+      else
+	high = middle;
+    }
+
+  if (low == reader->link_starts[link_i])
+    return NULL;
+
+  return (const struct bin_rec_cls *) (reader->data + entries[low - 1].offset);
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_checkpoint.c
+ * Function: Checkpoints of deltaQ runs, used to resume them
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "io_checkpoint.h"
+#include "message.h"
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// fill in the parts of a checkpoint header that only
+// depend on the scenario
+static void
+header_init (struct io_checkpoint_header_class *header,
+	     struct scenario_class *scenario)
+{
+  memset (header, 0, sizeof (struct io_checkpoint_header_class));
+
+  strncpy (header->signature, IO_CHECKPOINT_SIGNATURE, 4);
+  header->version = IO_CHECKPOINT_VERSION;
+
+  header->node_size = sizeof (struct node_class);
+  header->environment_size = sizeof (struct environment_class);
+  header->motion_state_size = sizeof (struct motion_state_class);
+  header->connection_size = sizeof (struct connection_class);
+  header->binary_record_size = sizeof (struct bin_rec_cls);
+
+  header->node_number = scenario->node_number;
+  header->environment_number = scenario->environment_number;
+  header->motion_number = scenario->motion_number;
+  header->connection_number = scenario->connection_number;
+  header->if_num = scenario->if_num;
+}
+
+// write 'number' elements of size 'size' to file;
+// return SUCCESS on succes, ERROR on error
+static int
+write_array (void *elements, size_t size, int number, FILE * file)
+{
+  if (number == 0)
+    return SUCCESS;
+
+  return (fwrite (elements, size, number, file) == (size_t) number) ?
+    SUCCESS : ERROR;
+}
+
+// read 'number' elements of size 'size' from file;
+// return SUCCESS on succes, ERROR on error
+static int
+read_array (void *elements, size_t size, int number, FILE * file)
+{
+  if (number == 0)
+    return SUCCESS;
+
+  return (fread (elements, size, number, file) == (size_t) number) ?
+    SUCCESS : ERROR;
+}
+
+
+////////////////////////////////////////////////
+// Checkpoint functions
+////////////////////////////////////////////////
+
+// write to file 'filename' a checkpoint with the state of 'scenario',
+// the binary output state 'io_connection_state' and the run state
+// 'checkpoint'; the previous checkpoint is only replaced once the
+// new one was completely written; return SUCCESS on succes,
+// ERROR on error
+int
+io_checkpoint_write (char *filename, struct io_checkpoint_class *checkpoint,
+		     struct scenario_class *scenario,
+		     struct io_connection_state_class *io_connection_state)
+{
+  struct io_checkpoint_header_class header;
+  struct motion_state_class motion_state;
+  char temporary_filename[MAX_STRING];
+  FILE *file;
+  int motion_i;
+  int result = SUCCESS;
+
+  if (snprintf (temporary_filename, MAX_STRING, "%s.tmp", filename)
+      >= MAX_STRING)
+    {
+      WARNING ("Cannot create checkpoint file name because file name \
+'%s' is too long!", filename);
+      return ERROR;
+    }
+
+  file = fopen (temporary_filename, "w");
+  if (file == NULL)
+    {
+      WARNING ("Cannot open checkpoint file '%s' for writing!",
+	       temporary_filename);
+      return ERROR;
+    }
+
+  header_init (&header, scenario);
+  header.first_step_i = checkpoint->first_step_i;
+  header.step_i = checkpoint->step_i;
+  header.time_rec_num = checkpoint->time_rec_num;
+  header.rand_state = checkpoint->rand_state;
+  header.text_offset = checkpoint->text_offset;
+  header.binary_offset = checkpoint->binary_offset;
+  header.motion_offset = checkpoint->motion_offset;
+
+  if (write_array (&header, sizeof (header), 1, file) == ERROR
+      || write_array (scenario->nodes, sizeof (struct node_class),
+		      scenario->node_number, file) == ERROR
+      || write_array (scenario->environments,
+		      sizeof (struct environment_class),
+		      scenario->environment_number, file) == ERROR
+      || write_array (scenario->connections,
+		      sizeof (struct connection_class),
+		      scenario->connection_number, file) == ERROR
+      || write_array (io_connection_state->binary_records,
+		      sizeof (struct bin_rec_cls),
+		      scenario->connection_number, file) == ERROR)
+    result = ERROR;
+
+  // trace records and motion parameters don't change,
+  // so only the state of motions is saved
+  for (motion_i = 0; motion_i < scenario->motion_number && result == SUCCESS;
+       motion_i++)
+    {
+      motion_save_state (&(scenario->motions[motion_i]), &motion_state);
+      result = write_array (&motion_state, sizeof (motion_state), 1, file);
+    }
+
+  if (fclose (file) != 0)
+    result = ERROR;
+
+  if (result == ERROR)
+    {
+      WARNING ("Error writing checkpoint file '%s'", temporary_filename);
+      remove (temporary_filename);
+      return ERROR;
+    }
+
+  if (rename (temporary_filename, filename) != 0)
+    {
+      WARNING ("Cannot rename checkpoint file '%s' to '%s'",
+	       temporary_filename, filename);
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// read from file 'filename' a checkpoint written for the same
+// initialized scenario, and restore the state of 'scenario' and
+// 'io_connection_state'; the run state is stored in 'checkpoint';
+// return SUCCESS on succes, ERROR on error
+int
+io_checkpoint_read (char *filename, struct io_checkpoint_class *checkpoint,
+		    struct scenario_class *scenario,
+		    struct io_connection_state_class *io_connection_state)
+{
+  struct io_checkpoint_header_class header, expected_header;
+  struct motion_state_class motion_state;
+  FILE *file;
+  int motion_i;
+
+  file = fopen (filename, "r");
+  if (file == NULL)
+    {
+      WARNING ("Cannot open checkpoint file '%s'!", filename);
+      return ERROR;
+    }
+
+  if (read_array (&header, sizeof (header), 1, file) == ERROR)
+    {
+      WARNING ("Error reading checkpoint file '%s'", filename);
+      fclose (file);
+      return ERROR;
+    }
+
+  // all the fields before 'first_step_i' must match
+  header_init (&expected_header, scenario);
+  if (memcmp (&header, &expected_header,
+	      offsetof (struct io_checkpoint_header_class, first_step_i)) != 0)
+    {
+      WARNING ("Checkpoint file '%s' was not written for this scenario \
+or by this version of deltaQ", filename);
+      fclose (file);
+      return ERROR;
+    }
+
+  if (read_array (scenario->nodes, sizeof (struct node_class),
+		  scenario->node_number, file) == ERROR
+      || read_array (scenario->environments,
+		     sizeof (struct environment_class),
+		     scenario->environment_number, file) == ERROR
+      || read_array (scenario->connections, sizeof (struct connection_class),
+		     scenario->connection_number, file) == ERROR
+      || read_array (io_connection_state->binary_records,
+		     sizeof (struct bin_rec_cls),
+		     scenario->connection_number, file) == ERROR)
+    {
+      WARNING ("Error reading checkpoint file '%s'", filename);
+      fclose (file);
+      return ERROR;
+    }
+
+  for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+    {
+      if (read_array (&motion_state, sizeof (motion_state), 1, file)
+	  == ERROR)
+	{
+	  WARNING ("Error reading checkpoint file '%s'", filename);
+	  fclose (file);
+	  return ERROR;
+	}
+      motion_restore_state (&(scenario->motions[motion_i]), &motion_state);
+    }
+
+  fclose (file);
+
+  checkpoint->first_step_i = header.first_step_i;
+  checkpoint->step_i = header.step_i;
+  checkpoint->time_rec_num = header.time_rec_num;
+  checkpoint->rand_state = header.rand_state;
+  checkpoint->text_offset = header.text_offset;
+  checkpoint->binary_offset = header.binary_offset;
+  checkpoint->motion_offset = header.motion_offset;
+
+  return SUCCESS;
+}
+
+// discard the content of output file 'file' after 'offset', and
+// continue writing from there; return SUCCESS on succes,
+// ERROR on error
+int
+io_checkpoint_truncate_file (FILE * file, long int offset)
+{
+  if (fflush (file) != 0 || ftruncate (fileno (file), offset) != 0
+      || fseek (file, offset, SEEK_SET) != 0)
+    {
+      WARNING ("Cannot truncate output file to %ld bytes", offset);
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
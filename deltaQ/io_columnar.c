@@ -0,0 +1,564 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_columnar.c
+ * Function: Link-major columnar output of deltaQ
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_columnar.h"
+#include "message.h"
+
+
+// maximum size of an encoded value
+#define MAX_VALUE_SIZE          5
+
+// initial size of the chunk table
+#define INITIAL_CHUNK_NUM       1024
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// get the bits of a float value
+static uint32_t
+float_bits (float value)
+{
+  uint32_t bits;
+
+  memcpy (&bits, &value, sizeof (bits));
+  return bits;
+}
+
+// get the float value of some bits
+static float
+bits_float (uint32_t bits)
+{
+  float value;
+
+  memcpy (&value, &bits, sizeof (value));
+  return value;
+}
+
+// append a value to a column of a link buffer
+static void
+append_value (struct io_columnar_link_buffer_cls *link, int column_i,
+	      uint32_t bits)
+{
+  unsigned char *p = link->columns[column_i] + link->used[column_i];
+  uint32_t delta = bits ^ link->previous[column_i];
+
+  while (delta >= 0x80)
+    {
+      *p++ = (unsigned char) (delta | 0x80);
+      delta >>= 7;
+    }
+  *p++ = (unsigned char) delta;
+
+  link->used[column_i] = p - link->columns[column_i];
+  link->previous[column_i] = bits;
+}
+
+// write data to the output file; return SUCCESS on succes, ERROR on error
+static int
+write_data (struct io_columnar_writer_cls *writer, const void *data,
+	    size_t size)
+{
+  if (size > 0 && fwrite (data, 1, size, writer->file) != size)
+    {
+      writer->write_error = TRUE;
+      return ERROR;
+    }
+
+  writer->offset += size;
+  return SUCCESS;
+}
+
+// write the current chunk of a link and add it to the chunk table;
+// return SUCCESS on succes, ERROR on error
+static int
+flush_link (struct io_columnar_writer_cls *writer, int link_i)
+{
+  struct io_columnar_link_buffer_cls *link = &(writer->links[link_i]);
+  struct io_columnar_chunk_hdr_cls chunk_hdr;
+  struct io_columnar_chunk_entry_cls *entry;
+  int column_i;
+
+  if (link->step_num == 0)
+    return SUCCESS;
+
+  if (writer->header.chunk_num == writer->chunk_max_num)
+    {
+      struct io_columnar_chunk_entry_cls *chunks;
+
+      chunks = (struct io_columnar_chunk_entry_cls *)
+	realloc (writer->chunks, 2 * writer->chunk_max_num *
+		 sizeof (struct io_columnar_chunk_entry_cls));
+      if (chunks == NULL)
+	{
+	  WARNING ("Cannot allocate memory for columnar chunk table");
+	  return ERROR;
+	}
+      writer->chunks = chunks;
+      writer->chunk_max_num *= 2;
+    }
+
+  entry = &(writer->chunks[writer->header.chunk_num]);
+  entry->link_i = link_i;
+  entry->chunk.offset = writer->offset;
+  entry->chunk.first_step = link->first_step;
+  entry->chunk.step_num = link->step_num;
+
+  memset (&chunk_hdr, 0, sizeof (chunk_hdr));
+  chunk_hdr.link_i = link_i;
+  chunk_hdr.first_step = link->first_step;
+  chunk_hdr.step_num = link->step_num;
+  for (column_i = 0; column_i < IO_COLUMNS; column_i++)
+    chunk_hdr.column_sizes[column_i] = link->used[column_i];
+
+  if (write_data (writer, &chunk_hdr, sizeof (chunk_hdr)) == ERROR)
+    {
+      WARNING ("Error writing columnar output");
+      return ERROR;
+    }
+  for (column_i = 0; column_i < IO_COLUMNS; column_i++)
+    if (write_data (writer, link->columns[column_i],
+		    link->used[column_i]) == ERROR)
+      {
+	WARNING ("Error writing columnar output");
+	return ERROR;
+      }
+
+  writer->header.chunk_num++;
+
+  // the next chunk is decoded independently of this one
+  link->first_step += link->step_num;
+  link->step_num = 0;
+  for (column_i = 0; column_i < IO_COLUMNS; column_i++)
+    {
+      link->used[column_i] = 0;
+      link->previous[column_i] = 0;
+    }
+
+  return SUCCESS;
+}
+
+
+////////////////////////////////////////////////
+// Writer functions
+////////////////////////////////////////////////
+
+// init a writer of columnar output for the connections of 'scenario'
+// (except those starting from noise sources), and write a provisional
+// header to 'file'; return SUCCESS on succes, ERROR on error
+int
+io_columnar_init (struct io_columnar_writer_cls *writer, FILE * file,
+		  struct scenario_class *scenario, double start_time,
+		  double step, int major_version, int minor_version,
+		  int subminor_version, int svn_revision)
+{
+  struct connection_class *connection;
+  int connection_i, link_i, column_i;
+  int link_num = 0;
+
+  memset (writer, 0, sizeof (struct io_columnar_writer_cls));
+  writer->file = file;
+
+  writer->links = (struct io_columnar_link_buffer_cls *)
+    calloc (scenario->connection_number + 1,
+	    sizeof (struct io_columnar_link_buffer_cls));
+  writer->chunks = (struct io_columnar_chunk_entry_cls *)
+    malloc (INITIAL_CHUNK_NUM * sizeof (struct io_columnar_chunk_entry_cls));
+  if (writer->links == NULL || writer->chunks == NULL)
+    {
+      WARNING ("Cannot allocate memory for columnar output");
+      free (writer->links);
+      free (writer->chunks);
+      return ERROR;
+    }
+  writer->chunk_max_num = INITIAL_CHUNK_NUM;
+
+  // same connections as in the binary output
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      connection = &(scenario->connections[connection_i]);
+      if (scenario->nodes[connection->from_node_index].
+	  interfaces[connection->from_interface_index].noise_source == TRUE)
+	continue;
+
+      writer->links[link_num].connection_i = connection_i;
+      writer->links[link_num].from_id = connection->from_id;
+      writer->links[link_num].to_id = connection->to_id;
+      link_num++;
+    }
+
+  // share the memory budget between all columns
+  if (link_num > 0)
+    writer->column_size = IO_COLUMNAR_MEMORY / (link_num * IO_COLUMNS);
+  if (writer->column_size < IO_COLUMNAR_MIN_COLUMN_SIZE)
+    writer->column_size = IO_COLUMNAR_MIN_COLUMN_SIZE;
+  if (writer->column_size > IO_COLUMNAR_MAX_COLUMN_SIZE)
+    writer->column_size = IO_COLUMNAR_MAX_COLUMN_SIZE;
+
+  writer->column_memory = (unsigned char *)
+    malloc ((link_num + 1) * IO_COLUMNS * writer->column_size);
+  if (writer->column_memory == NULL)
+    {
+      WARNING ("Cannot allocate memory for columnar output buffers");
+      free (writer->links);
+      free (writer->chunks);
+      return ERROR;
+    }
+
+  for (link_i = 0; link_i < link_num; link_i++)
+    for (column_i = 0; column_i < IO_COLUMNS; column_i++)
+      writer->links[link_i].columns[column_i] = writer->column_memory +
+	(link_i * IO_COLUMNS + column_i) * writer->column_size;
+
+  writer->header.signature[0] = 'Q';
+  writer->header.signature[1] = 'M';
+  writer->header.signature[2] = 'C';
+  writer->header.signature[3] = '\0';
+  writer->header.major_version = major_version;
+  writer->header.minor_version = minor_version;
+  writer->header.subminor_version = subminor_version;
+  writer->header.svn_revision = svn_revision;
+  writer->header.if_num = scenario->if_num;
+  writer->header.link_num = link_num;
+  writer->header.column_num = IO_COLUMNS;
+  writer->header.start_time = start_time;
+  writer->header.step = step;
+
+  // the header is written again when the tables are known
+  if (write_data (writer, &(writer->header), sizeof (writer->header))
+      == ERROR)
+    {
+      WARNING ("Error writing columnar output header");
+      free (writer->links);
+      free (writer->chunks);
+      free (writer->column_memory);
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// append the current state of all links as a new step;
+// return SUCCESS on succes, ERROR on error
+int
+io_columnar_write_step (struct io_columnar_writer_cls *writer,
+			struct scenario_class *scenario)
+{
+  struct io_columnar_link_buffer_cls *link;
+  struct bin_rec_cls record;
+  int link_i, column_i;
+
+  for (link_i = 0; link_i < writer->header.link_num; link_i++)
+    {
+      link = &(writer->links[link_i]);
+
+      // make sure one more value fits in each column
+      if (link->step_num == IO_COLUMNAR_CHUNK_STEPS)
+	{
+	  if (flush_link (writer, link_i) == ERROR)
+	    return ERROR;
+	}
+      else
+	for (column_i = 0; column_i < IO_COLUMNS; column_i++)
+	  if (link->used[column_i] + MAX_VALUE_SIZE > writer->column_size)
+	    {
+	      if (flush_link (writer, link_i) == ERROR)
+		return ERROR;
+	      break;
+	    }
+
+      // values are the same as in the binary output
+      io_binary_build_record (&record,
+			      &(scenario->connections[link->connection_i]),
+			      scenario);
+
+      append_value (link, IO_COLUMN_FRAME_ERROR_RATE,
+		    float_bits (record.frame_error_rate));
+      append_value (link, IO_COLUMN_NUM_RETRANSMISSIONS,
+		    float_bits (record.num_retransmissions));
+      append_value (link, IO_COLUMN_STANDARD, (uint32_t) record.standard);
+      append_value (link, IO_COLUMN_OPERATING_RATE,
+		    float_bits (record.operating_rate));
+      append_value (link, IO_COLUMN_BANDWIDTH, float_bits (record.bandwidth));
+      append_value (link, IO_COLUMN_LOSS_RATE, float_bits (record.loss_rate));
+      append_value (link, IO_COLUMN_DELAY, float_bits (record.delay));
+      link->step_num++;
+    }
+
+  writer->header.step_num++;
+
+  return SUCCESS;
+}
+
+// write the pending chunks, the link and chunk tables, and the final
+// header, and release the resources of the writer (the file itself is
+// not closed); return SUCCESS on succes, ERROR if any write failed
+int
+io_columnar_finalize (struct io_columnar_writer_cls *writer)
+{
+  struct io_columnar_link_cls *links = NULL;
+  struct io_columnar_chunk_cls *chunks = NULL;
+  int32_t *fill = NULL;
+  long int chunk_i;
+  int link_i;
+
+  for (link_i = 0; link_i < writer->header.link_num; link_i++)
+    if (flush_link (writer, link_i) == ERROR)
+      goto FINALIZE_ERROR;
+
+  links = (struct io_columnar_link_cls *)
+    calloc (writer->header.link_num + 1, sizeof (struct io_columnar_link_cls));
+  chunks = (struct io_columnar_chunk_cls *)
+    malloc ((writer->header.chunk_num + 1) *
+	    sizeof (struct io_columnar_chunk_cls));
+  fill = (int32_t *) calloc (writer->header.link_num + 1, sizeof (int32_t));
+  if (links == NULL || chunks == NULL || fill == NULL)
+    {
+      WARNING ("Cannot allocate memory for columnar tables");
+      goto FINALIZE_ERROR;
+    }
+
+  // group the chunks by link; chunks of a link are already in step order
+  for (chunk_i = 0; chunk_i < writer->header.chunk_num; chunk_i++)
+    links[writer->chunks[chunk_i].link_i].chunk_num++;
+  for (link_i = 0; link_i < writer->header.link_num; link_i++)
+    {
+      links[link_i].from_id = writer->links[link_i].from_id;
+      links[link_i].to_id = writer->links[link_i].to_id;
+      if (link_i > 0)
+	links[link_i].first_chunk = links[link_i - 1].first_chunk +
+	  links[link_i - 1].chunk_num;
+      fill[link_i] = links[link_i].first_chunk;
+    }
+  for (chunk_i = 0; chunk_i < writer->header.chunk_num; chunk_i++)
+    chunks[fill[writer->chunks[chunk_i].link_i]++] =
+      writer->chunks[chunk_i].chunk;
+
+  writer->header.index_offset = writer->offset;
+  if (write_data (writer, links, writer->header.link_num *
+		  sizeof (struct io_columnar_link_cls)) == ERROR
+      || write_data (writer, chunks, writer->header.chunk_num *
+		     sizeof (struct io_columnar_chunk_cls)) == ERROR)
+    {
+      WARNING ("Error writing columnar output tables");
+      goto FINALIZE_ERROR;
+    }
+
+  rewind (writer->file);
+  if (fwrite (&(writer->header), sizeof (writer->header), 1, writer->file)
+      != 1)
+    {
+      WARNING ("Error writing columnar output header");
+      writer->write_error = TRUE;
+    }
+
+FINALIZE_ERROR:
+  if (links == NULL || chunks == NULL || fill == NULL)
+    writer->write_error = TRUE;
+
+  free (links);
+  free (chunks);
+  free (fill);
+  free (writer->links);
+  free (writer->chunks);
+  free (writer->column_memory);
+  writer->links = NULL;
+  writer->chunks = NULL;
+  writer->column_memory = NULL;
+
+  return (writer->write_error == TRUE) ? ERROR : SUCCESS;
+}
+
+
+////////////////////////////////////////////////
+// Reader functions
+////////////////////////////////////////////////
+
+// open a columnar output file and check its tables;
+// return SUCCESS on succes, ERROR on error
+int
+io_columnar_open (struct io_columnar_reader_cls *reader, const char *filename)
+{
+  const struct io_columnar_hdr_cls *header;
+  uint64_t tables_size;
+  long int chunk_i;
+
+  memset (reader, 0, sizeof (struct io_columnar_reader_cls));
+  strncpy (reader->filename, filename, MAX_STRING - 1);
+
+  if (io_map_file (filename, &(reader->data), &(reader->size),
+		   &(reader->mapped)) == ERROR)
+    return ERROR;
+
+  header = (const struct io_columnar_hdr_cls *) reader->data;
+  if (reader->size < sizeof (struct io_columnar_hdr_cls)
+      || memcmp (header->signature, "QMC", 4) != 0)
+    {
+      WARNING ("File '%s' is not a columnar QOMET output file", filename);
+      io_columnar_close (reader);
+      return ERROR;
+    }
+
+  tables_size =
+    (uint64_t) header->link_num * sizeof (struct io_columnar_link_cls) +
+    (uint64_t) header->chunk_num * sizeof (struct io_columnar_chunk_cls);
+  if (header->link_num < 0 || header->chunk_num < 0 || header->step_num < 0
+      || header->column_num != IO_COLUMNS
+      || header->index_offset < sizeof (struct io_columnar_hdr_cls)
+      || header->index_offset > reader->size
+      || tables_size > reader->size - header->index_offset)
+    {
+      WARNING ("Invalid or incomplete columnar file '%s'", filename);
+      io_columnar_close (reader);
+      return ERROR;
+    }
+
+  reader->header = header;
+  reader->links = (const struct io_columnar_link_cls *)
+    (reader->data + header->index_offset);
+  reader->chunks = (const struct io_columnar_chunk_cls *)
+    (reader->links + header->link_num);
+
+  // check that all chunks are inside the file
+  for (chunk_i = 0; chunk_i < header->chunk_num; chunk_i++)
+    if (reader->chunks[chunk_i].offset + sizeof (struct io_columnar_chunk_hdr_cls)
+	> header->index_offset)
+      {
+	WARNING ("Invalid chunk table in columnar file '%s'", filename);
+	io_columnar_close (reader);
+	return ERROR;
+      }
+
+  return SUCCESS;
+}
+
+// release the resources used by a reader
+void
+io_columnar_close (struct io_columnar_reader_cls *reader)
+{
+  io_unmap_file (reader->data, reader->size, reader->mapped);
+
+  reader->data = NULL;
+  reader->size = 0;
+  reader->header = NULL;
+  reader->links = NULL;
+  reader->chunks = NULL;
+}
+
+// find the link 'from_id' -> 'to_id';
+// return its index, or ERROR if it is not in the file
+int
+io_columnar_find_link (struct io_columnar_reader_cls *reader,
+		       int from_id, int to_id)
+{
+  int link_i;
+
+  for (link_i = 0; link_i < reader->header->link_num; link_i++)
+    if (reader->links[link_i].from_id == from_id
+	&& reader->links[link_i].to_id == to_id)
+      return link_i;
+
+  return ERROR;
+}
+
+// decode one column of a link into 'values', which must hold
+// 'step_num' values; steps not covered by any chunk are set to 0;
+// return SUCCESS on succes, ERROR on error
+int
+io_columnar_read_column (struct io_columnar_reader_cls *reader,
+			 int link_i, int column_i, float *values)
+{
+  const struct io_columnar_link_cls *link;
+  const struct io_columnar_chunk_cls *chunk;
+  const struct io_columnar_chunk_hdr_cls *chunk_hdr;
+  const unsigned char *p, *end;
+  uint32_t bits, delta;
+  int32_t chunk_i, step_i;
+  int shift, i;
+
+  if (link_i < 0 || link_i >= reader->header->link_num
+      || column_i < 0 || column_i >= IO_COLUMNS)
+    {
+      WARNING ("Invalid link (%d) or column (%d)", link_i, column_i);
+      return ERROR;
+    }
+
+  memset (values, 0, reader->header->step_num * sizeof (float));
+
+  link = &(reader->links[link_i]);
+  for (chunk_i = link->first_chunk;
+       chunk_i < link->first_chunk + link->chunk_num; chunk_i++)
+    {
+      if (chunk_i < 0 || chunk_i >= reader->header->chunk_num)
+	{
+	  WARNING ("Invalid chunk index %d for link %d", chunk_i, link_i);
+	  return ERROR;
+	}
+      chunk = &(reader->chunks[chunk_i]);
+      chunk_hdr = (const struct io_columnar_chunk_hdr_cls *)
+	(reader->data + chunk->offset);
+
+      // skip the columns stored before the requested one
+      p = (const unsigned char *) (chunk_hdr + 1);
+      for (i = 0; i < column_i; i++)
+	p += chunk_hdr->column_sizes[i];
+      end = p + chunk_hdr->column_sizes[column_i];
+
+      if (chunk_hdr->first_step < 0 || chunk_hdr->step_num < 0
+	  || chunk_hdr->first_step + chunk_hdr->step_num >
+	  reader->header->step_num
+	  || end > (const unsigned char *) reader->data +
+	  reader->header->index_offset)
+	{
+	  WARNING ("Invalid chunk %d of link %d", chunk_i, link_i);
+	  return ERROR;
+	}
+
+      bits = 0;
+      for (step_i = 0; step_i < chunk_hdr->step_num; step_i++)
+	{
+	  delta = 0;
+	  shift = 0;
+	  do
+	    {
+	      if (p >= end || shift > 28)
+		{
+		  WARNING ("Corrupted column %d in chunk %d of link %d",
+			   column_i, chunk_i, link_i);
+		  return ERROR;
+		}
+	      delta |= (uint32_t) (*p & 0x7f) << shift;
+	      shift += 7;
+	    }
+	  while (*p++ & 0x80);
+
+	  bits ^= delta;
+	  values[chunk_hdr->first_step + step_i] =
+	    (column_i == IO_COLUMN_STANDARD) ?
+	    (float) (int32_t) bits : bits_float (bits);
+	}
+    }
+
+  return SUCCESS;
+}
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_slice.c
+ * Function: Per-host binary output of deltaQ
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io_slice.h"
+#include "message.h"
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// add a record to the buffer of a slice;
+// return SUCCESS on succes, ERROR on error
+static int
+slice_append (struct io_slice_cls *slice, struct bin_rec_cls *record)
+{
+  struct bin_rec_cls *records;
+
+  if (slice->record_number == slice->record_max_number)
+    {
+      records = (struct bin_rec_cls *)
+	realloc (slice->records, 2 * slice->record_max_number *
+		 sizeof (struct bin_rec_cls));
+      if (records == NULL)
+	return ERROR;
+      slice->records = records;
+      slice->record_max_number *= 2;
+    }
+
+  slice->records[slice->record_number++] = *record;
+  return SUCCESS;
+}
+
+// close the file of a slice and release its buffers
+static void
+slice_free (struct io_slice_cls *slice)
+{
+  if (slice->file != NULL)
+    fclose (slice->file);
+  free (slice->file_buffer);
+  free (slice->records);
+
+  slice->file = NULL;
+  slice->file_buffer = NULL;
+  slice->records = NULL;
+}
+
+
+////////////////////////////////////////////////
+// Slice functions
+////////////////////////////////////////////////
+
+// create the slice files '<filename_base>.<slice>.bin' for 'if_num'
+// ids grouped by 'group_size', and write their provisional headers;
+// return SUCCESS on succes, ERROR on error
+int
+io_slice_init (struct io_slice_writer_cls *writer, char *filename_base,
+	       int if_num, int group_size, int major_version,
+	       int minor_version, int subminor_version, int svn_revision)
+{
+  struct io_slice_cls *slice;
+  int slice_i;
+
+  memset (writer, 0, sizeof (struct io_slice_writer_cls));
+
+  if (group_size <= 0)
+    {
+      WARNING ("Invalid host group size (%d)", group_size);
+      return ERROR;
+    }
+
+  writer->if_num = if_num;
+  writer->group_size = group_size;
+  writer->slice_num = (if_num + group_size - 1) / group_size;
+  writer->major_version = major_version;
+  writer->minor_version = minor_version;
+  writer->subminor_version = subminor_version;
+  writer->svn_revision = svn_revision;
+
+  writer->slices = (struct io_slice_cls *)
+    calloc (writer->slice_num + 1, sizeof (struct io_slice_cls));
+  if (writer->slices == NULL)
+    {
+      WARNING ("Cannot allocate memory for per-host output");
+      return ERROR;
+    }
+
+  for (slice_i = 0; slice_i < writer->slice_num; slice_i++)
+    {
+      slice = &(writer->slices[slice_i]);
+
+      if (snprintf (slice->filename, MAX_STRING, "%s.%d.bin",
+		    filename_base, slice_i) >= MAX_STRING)
+	{
+	  WARNING ("Cannot create per-host output file name because \
+input filename '%s' is too long!", filename_base);
+	  goto INIT_ERROR;
+	}
+
+      slice->file = fopen (slice->filename, "w");
+      if (slice->file == NULL)
+	{
+	  WARNING ("Cannot open per-host output file '%s' for writing \
+(use a larger host group if too many files are open)", slice->filename);
+	  goto INIT_ERROR;
+	}
+
+      slice->file_buffer = (char *) malloc (IO_SLICE_FILE_BUFFER_SIZE);
+      slice->records = (struct bin_rec_cls *)
+	malloc (IO_SLICE_INITIAL_RECORDS * sizeof (struct bin_rec_cls));
+      if (slice->file_buffer == NULL || slice->records == NULL)
+	{
+	  WARNING ("Cannot allocate memory for per-host output");
+	  goto INIT_ERROR;
+	}
+      setvbuf (slice->file, slice->file_buffer, _IOFBF,
+	       IO_SLICE_FILE_BUFFER_SIZE);
+      slice->record_max_number = IO_SLICE_INITIAL_RECORDS;
+
+      // the header is written again when the number of
+      // time records is known
+      if (io_binary_write_header_to_file (if_num, 0, major_version,
+					  minor_version, subminor_version,
+					  svn_revision, slice->file) == ERROR)
+	goto INIT_ERROR;
+    }
+
+  return SUCCESS;
+
+INIT_ERROR:
+  for (slice_i = 0; slice_i < writer->slice_num; slice_i++)
+    slice_free (&(writer->slices[slice_i]));
+  free (writer->slices);
+  writer->slices = NULL;
+
+  return ERROR;
+}
+
+// add a record of the current step to the slices of its source
+// and destination
+void
+io_slice_add_record (struct io_slice_writer_cls *writer,
+		     struct bin_rec_cls *record)
+{
+  int from_slice, to_slice;
+
+  if (record->from_id < 0 || record->from_id >= writer->if_num
+      || record->to_id < 0 || record->to_id >= writer->if_num)
+    {
+      writer->ignored_record_number++;
+      return;
+    }
+
+  from_slice = record->from_id / writer->group_size;
+  to_slice = record->to_id / writer->group_size;
+
+  if (slice_append (&(writer->slices[from_slice]), record) == ERROR)
+    writer->ignored_record_number++;
+  if (to_slice != from_slice
+      && slice_append (&(writer->slices[to_slice]), record) == ERROR)
+    writer->ignored_record_number++;
+}
+
+// write a time record with the records added since the previous
+// step to every slice; return SUCCESS on succes, ERROR on error
+int
+io_slice_end_step (struct io_slice_writer_cls *writer, float time)
+{
+  struct bin_time_rec_cls time_record;
+  struct io_slice_cls *slice;
+  int slice_i;
+
+  for (slice_i = 0; slice_i < writer->slice_num; slice_i++)
+    {
+      slice = &(writer->slices[slice_i]);
+
+      time_record.time = time;
+      time_record.record_number = slice->record_number;
+      if (io_binary_write_time_record_to_file2 (&time_record, slice->file)
+	  == ERROR
+	  || fwrite (slice->records, sizeof (struct bin_rec_cls),
+		     slice->record_number, slice->file)
+	  != (size_t) slice->record_number)
+	{
+	  WARNING ("Error writing per-host output file '%s'",
+		   slice->filename);
+	  return ERROR;
+	}
+
+      slice->record_number = 0;
+    }
+
+  writer->time_rec_num++;
+
+  return SUCCESS;
+}
+
+// rewrite the headers of all slices, close them and release the
+// resources of the writer; return SUCCESS on succes, ERROR on error
+int
+io_slice_finalize (struct io_slice_writer_cls *writer)
+{
+  struct io_slice_cls *slice;
+  int slice_i;
+  int result = SUCCESS;
+
+  if (writer->ignored_record_number > 0)
+    {
+      WARNING ("%ld records could not be added to per-host output",
+	       writer->ignored_record_number);
+      result = ERROR;
+    }
+
+  for (slice_i = 0; slice_i < writer->slice_num; slice_i++)
+    {
+      slice = &(writer->slices[slice_i]);
+
+      rewind (slice->file);
+      if (io_binary_write_header_to_file (writer->if_num,
+					  writer->time_rec_num,
+					  writer->major_version,
+					  writer->minor_version,
+					  writer->subminor_version,
+					  writer->svn_revision,
+					  slice->file) == ERROR)
+	result = ERROR;
+
+      if (fclose (slice->file) != 0)
+	{
+	  WARNING ("Error writing per-host output file '%s'",
+		   slice->filename);
+	  result = ERROR;
+	}
+      slice->file = NULL;
+      slice_free (slice);
+    }
+
+  free (writer->slices);
+  writer->slices = NULL;
+
+  return result;
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_summary.c
+ * Function: Streaming per-link summary statistics of deltaQ output
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "io_summary.h"
+#include "message.h"
+
+
+// histogram range of each metric, as powers of 2; values outside
+// the range are counted in the first or last bin
+struct metric_range_cls
+{
+  const char *name;
+  int min_exponent;
+  int max_exponent;
+};
+
+static const struct metric_range_cls metric_ranges[IO_SUMMARY_METRICS] = {
+  {"loss", -20, 1},		// loss rate (1e-6 to 1)
+  {"delay", -10, 20},		// delay [ms] (1 us to 1000 s)
+  {"bandwidth", 10, 37}		// bandwidth [bit/s] (1 kbit/s to 100 Gbit/s)
+};
+
+// quantiles written for each metric
+static const double quantiles[] = { 0.5, 0.9, 0.95, 0.99 };
+#define QUANTILE_NUM            4
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// number of histogram bins of a metric
+static int
+bin_number (int metric_i)
+{
+  return (metric_ranges[metric_i].max_exponent -
+	  metric_ranges[metric_i].min_exponent) *
+    IO_SUMMARY_BINS_PER_OCTAVE + 2;
+}
+
+// histogram bin of a value
+static int
+bin_index (int metric_i, double value)
+{
+  int exponent, octave, sub_bin;
+  double mantissa;
+
+  if (!(value >= ldexp (1.0, metric_ranges[metric_i].min_exponent)))
+    return 0;
+  if (value >= ldexp (1.0, metric_ranges[metric_i].max_exponent))
+    return bin_number (metric_i) - 1;
+
+  // value = mantissa * 2^exponent, with mantissa in [0.5, 1)
+  mantissa = frexp (value, &exponent);
+  octave = exponent - 1 - metric_ranges[metric_i].min_exponent;
+  sub_bin = (int) ((2 * mantissa - 1) * IO_SUMMARY_BINS_PER_OCTAVE);
+
+  return 1 + octave * IO_SUMMARY_BINS_PER_OCTAVE + sub_bin;
+}
+
+// lower limit of a histogram bin (not used for the first and last bin)
+static double
+bin_lower_limit (int metric_i, int bin_i)
+{
+  int octave = (bin_i - 1) / IO_SUMMARY_BINS_PER_OCTAVE;
+  int sub_bin = (bin_i - 1) % IO_SUMMARY_BINS_PER_OCTAVE;
+
+  return ldexp (1.0 + (double) sub_bin / IO_SUMMARY_BINS_PER_OCTAVE,
+		metric_ranges[metric_i].min_exponent + octave);
+}
+
+// add a value to the statistics of a metric
+static void
+update_metric (struct io_summary_metric_cls *metric, int metric_i,
+	       int64_t count, double value)
+{
+  double delta;
+
+  if (count == 1)
+    {
+      metric->min = value;
+      metric->max = value;
+    }
+  else
+    {
+      if (value < metric->min)
+	metric->min = value;
+      if (value > metric->max)
+	metric->max = value;
+    }
+
+  delta = value - metric->mean;
+  metric->mean += delta / count;
+  metric->m2 += delta * (value - metric->mean);
+
+  metric->bins[bin_index (metric_i, value)]++;
+}
+
+// estimate a quantile of a metric from its histogram, by linear
+// interpolation inside the bin that contains it
+static double
+metric_quantile (struct io_summary_metric_cls *metric, int metric_i,
+		 int64_t count, double quantile)
+{
+  double target = quantile * count;
+  double cumulative = 0.0;
+  double lower, upper, value;
+  int bin_i, last_bin_i = bin_number (metric_i) - 1;
+
+  for (bin_i = 0; bin_i <= last_bin_i; bin_i++)
+    {
+      if (metric->bins[bin_i] == 0
+	  || cumulative + metric->bins[bin_i] < target)
+	{
+	  cumulative += metric->bins[bin_i];
+	  continue;
+	}
+
+      if (bin_i == 0)
+	return metric->min;
+      if (bin_i == last_bin_i)
+	return metric->max;
+
+      lower = bin_lower_limit (metric_i, bin_i);
+      upper = bin_lower_limit (metric_i, bin_i + 1);
+      value = lower + (upper - lower) * (target - cumulative) /
+	metric->bins[bin_i];
+
+      // the histogram cannot be more precise than the extremes
+      if (value < metric->min)
+	value = metric->min;
+      if (value > metric->max)
+	value = metric->max;
+      return value;
+    }
+
+  return metric->max;
+}
+
+
+////////////////////////////////////////////////
+// Summary functions
+////////////////////////////////////////////////
+
+// init per-link statistics for the connections of 'scenario' (except
+// those starting from noise sources); 'step' is the duration of a
+// step; return SUCCESS on succes, ERROR on error
+int
+io_summary_init (struct io_summary_class *summary,
+		 struct scenario_class *scenario, double step)
+{
+  struct connection_class *connection;
+  uint32_t *bins;
+  size_t link_bin_number = 0;
+  int connection_i, link_i, metric_i;
+
+  memset (summary, 0, sizeof (struct io_summary_class));
+  summary->step = step;
+
+  for (metric_i = 0; metric_i < IO_SUMMARY_METRICS; metric_i++)
+    link_bin_number += bin_number (metric_i);
+
+  summary->links = (struct io_summary_link_cls *)
+    calloc (scenario->connection_number + 1,
+	    sizeof (struct io_summary_link_cls));
+  summary->bin_memory = (uint32_t *)
+    calloc ((scenario->connection_number + 1) * link_bin_number,
+	    sizeof (uint32_t));
+  if (summary->links == NULL || summary->bin_memory == NULL)
+    {
+      WARNING ("Cannot allocate memory for summary statistics");
+      io_summary_free (summary);
+      return ERROR;
+    }
+
+  // same connections as in the binary output
+  bins = summary->bin_memory;
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      connection = &(scenario->connections[connection_i]);
+      if (scenario->nodes[connection->from_node_index].
+	  interfaces[connection->from_interface_index].noise_source == TRUE)
+	continue;
+
+      link_i = summary->link_num++;
+      summary->links[link_i].connection_i = connection_i;
+      summary->links[link_i].from_id = connection->from_id;
+      summary->links[link_i].to_id = connection->to_id;
+      for (metric_i = 0; metric_i < IO_SUMMARY_METRICS; metric_i++)
+	{
+	  summary->links[link_i].metrics[metric_i].bins = bins;
+	  bins += bin_number (metric_i);
+	}
+    }
+
+  return SUCCESS;
+}
+
+// add the current state of all links to the statistics
+void
+io_summary_update (struct io_summary_class *summary,
+		   struct scenario_class *scenario)
+{
+  struct io_summary_link_cls *link;
+  struct connection_class *connection;
+  int link_i;
+
+  for (link_i = 0; link_i < summary->link_num; link_i++)
+    {
+      link = &(summary->links[link_i]);
+      connection = &(scenario->connections[link->connection_i]);
+
+      link->step_num++;
+      update_metric (&(link->metrics[IO_SUMMARY_LOSS_RATE]),
+		     IO_SUMMARY_LOSS_RATE, link->step_num,
+		     connection->loss_rate);
+      update_metric (&(link->metrics[IO_SUMMARY_DELAY]),
+		     IO_SUMMARY_DELAY, link->step_num, connection->delay);
+      update_metric (&(link->metrics[IO_SUMMARY_BANDWIDTH]),
+		     IO_SUMMARY_BANDWIDTH, link->step_num,
+		     connection->bandwidth);
+
+      // outages are counted as runs of consecutive steps
+      if (connection->loss_rate >= IO_SUMMARY_OUTAGE_LOSS_RATE)
+	{
+	  if (link->current_outage_steps == 0)
+	    link->outage_num++;
+	  link->current_outage_steps++;
+	  link->outage_steps++;
+	  if (link->current_outage_steps > link->longest_outage_steps)
+	    link->longest_outage_steps = link->current_outage_steps;
+	}
+      else
+	link->current_outage_steps = 0;
+    }
+}
+
+// write the statistics of all links to 'file' as text, one line
+// per link; return SUCCESS on succes, ERROR on error
+int
+io_summary_write (struct io_summary_class *summary, FILE * file,
+		  char *qomet_name)
+{
+  struct io_summary_link_cls *link;
+  struct io_summary_metric_cls *metric;
+  int link_i, metric_i, quantile_i;
+
+  fprintf (file, "%% Summary generated by %s\n", qomet_name);
+  fprintf (file, "%% outage: loss_rate >= %.2f; times in s, delay in ms, "
+	   "bandwidth in bit/s\n", IO_SUMMARY_OUTAGE_LOSS_RATE);
+  fprintf (file, "%% from_id to_id steps");
+  for (metric_i = 0; metric_i < IO_SUMMARY_METRICS; metric_i++)
+    fprintf (file, " %s_mean %s_stddev %s_min %s_max %s_p50 %s_p90 %s_p95"
+	     " %s_p99", metric_ranges[metric_i].name,
+	     metric_ranges[metric_i].name, metric_ranges[metric_i].name,
+	     metric_ranges[metric_i].name, metric_ranges[metric_i].name,
+	     metric_ranges[metric_i].name, metric_ranges[metric_i].name,
+	     metric_ranges[metric_i].name);
+  fprintf (file, " outages outage_time longest_outage coverage\n");
+
+  for (link_i = 0; link_i < summary->link_num; link_i++)
+    {
+      link = &(summary->links[link_i]);
+      fprintf (file, "%d %d %lld", link->from_id, link->to_id,
+	       (long long int) link->step_num);
+
+      for (metric_i = 0; metric_i < IO_SUMMARY_METRICS; metric_i++)
+	{
+	  metric = &(link->metrics[metric_i]);
+	  fprintf (file, " %.6g %.6g %.6g %.6g", metric->mean,
+		   (link->step_num > 1) ?
+		   sqrt (metric->m2 / (link->step_num - 1)) : 0.0,
+		   metric->min, metric->max);
+	  for (quantile_i = 0; quantile_i < QUANTILE_NUM; quantile_i++)
+	    fprintf (file, " %.6g",
+		     (link->step_num > 0) ?
+		     metric_quantile (metric, metric_i, link->step_num,
+				      quantiles[quantile_i]) : 0.0);
+	}
+
+      fprintf (file, " %lld %.6g %.6g %.6f\n",
+	       (long long int) link->outage_num,
+	       link->outage_steps * summary->step,
+	       link->longest_outage_steps * summary->step,
+	       (link->step_num > 0) ?
+	       1.0 - (double) link->outage_steps / link->step_num : 0.0);
+    }
+
+  if (ferror (file))
+    {
+      WARNING ("Error writing summary statistics");
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// release the resources of the statistics
+void
+io_summary_free (struct io_summary_class *summary)
+{
+  free (summary->links);
+  free (summary->bin_memory);
+  summary->links = NULL;
+  summary->bin_memory = NULL;
+  summary->link_num = 0;
+}
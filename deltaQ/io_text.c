@@ -0,0 +1,417 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_text.c
+ * Function: Parser for the text output of QOMET (.out files)
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/mman.h>
+
+#include "io.h"
+#include "io_text.h"
+#include "message.h"
+
+
+// index of the fields that are node ids
+#define FIELD_FROM_ID           1
+#define FIELD_TO_ID             5
+
+// index of the 'to_node_z' field; older versions of deltaQ printed
+// it without a separator before 'distance' (e.g., "0.00000012.5000"),
+// so this field is limited to the 6 decimals it is printed with
+#define FIELD_TO_Z              8
+#define TO_Z_DECIMALS           6
+
+// maximum number of significant digits accumulated in the mantissa
+#define MAX_MANTISSA_DIGITS     19
+
+// error description for each field of a record
+static const char *field_errors[IO_TEXT_FIELDS] = {
+  "invalid or missing time", "invalid or missing from_id",
+  "invalid or missing from_node_x", "invalid or missing from_node_y",
+  "invalid or missing from_node_z", "invalid or missing to_id",
+  "invalid or missing to_node_x", "invalid or missing to_node_y",
+  "invalid or missing to_node_z", "invalid or missing distance",
+  "invalid or missing Pr", "invalid or missing SNR",
+  "invalid or missing FER", "invalid or missing num_retr",
+  "invalid or missing op_rate", "invalid or missing bandwidth",
+  "invalid or missing loss_rate", "invalid or missing delay",
+  "invalid or missing jitter"
+};
+
+// exact powers of 10 that can be represented as double
+static const double powers_of_10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+#define MAX_EXACT_POWER         22
+
+
+////////////////////////////////////////////////
+// Number parsing functions
+////////////////////////////////////////////////
+
+#define IS_DIGIT(c)             ((c) >= '0' && (c) <= '9')
+#define IS_BLANK(c)             ((c) == ' ' || (c) == '\t' || (c) == '\r')
+
+// parse a floating-point number starting at 'p' without going past
+// 'end'; the result is independent of the current locale and is
+// exact for values with up to 15 significant digits; if
+// 'max_decimals' is not negative, at most that many decimals are
+// consumed; return the position after the number, or NULL on error
+static const char *
+parse_double (const char *p, const char *end, int max_decimals,
+	      double *value)
+{
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int decimals = 0;
+  int exponent = 0;
+  int negative = FALSE;
+  int has_digits = FALSE;
+  double result;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    {
+      negative = (*p == '-');
+      p++;
+    }
+
+  // special values, as printed by printf
+  if (p < end && (*p == 'i' || *p == 'I'))
+    {
+      if (end - p < 3 || strncasecmp (p, "inf", 3) != 0)
+	return NULL;
+      p += 3;
+      if (end - p >= 5 && strncasecmp (p, "inity", 5) == 0)
+	p += 5;
+      *value = negative ? -INFINITY : INFINITY;
+      return p;
+    }
+  if (p < end && (*p == 'n' || *p == 'N'))
+    {
+      if (end - p < 3 || strncasecmp (p, "nan", 3) != 0)
+	return NULL;
+      *value = NAN;
+      return p + 3;
+    }
+
+  // integer part
+  while (p < end && IS_DIGIT (*p))
+    {
+      has_digits = TRUE;
+      if (digits < MAX_MANTISSA_DIGITS)
+	{
+	  mantissa = mantissa * 10 + (*p - '0');
+	  if (mantissa != 0)
+	    digits++;
+	}
+      else
+	exponent++;
+      p++;
+    }
+
+  // fractional part
+  if (p < end && *p == '.')
+    {
+      p++;
+      while (p < end && IS_DIGIT (*p)
+	     && (max_decimals < 0 || decimals < max_decimals))
+	{
+	  has_digits = TRUE;
+	  if (digits < MAX_MANTISSA_DIGITS)
+	    {
+	      mantissa = mantissa * 10 + (*p - '0');
+	      if (mantissa != 0)
+		digits++;
+	      exponent--;
+	    }
+	  decimals++;
+	  p++;
+	}
+    }
+
+  if (has_digits == FALSE)
+    return NULL;
+
+  // exponent
+  if (p < end && (*p == 'e' || *p == 'E'))
+    {
+      int exponent_negative = FALSE;
+      int exponent_value = 0;
+
+      p++;
+      if (p < end && (*p == '-' || *p == '+'))
+	{
+	  exponent_negative = (*p == '-');
+	  p++;
+	}
+      if (p >= end || !IS_DIGIT (*p))
+	return NULL;
+      while (p < end && IS_DIGIT (*p))
+	{
+	  if (exponent_value < 100000)
+	    exponent_value = exponent_value * 10 + (*p - '0');
+	  p++;
+	}
+      exponent += exponent_negative ? -exponent_value : exponent_value;
+    }
+
+  result = (double) mantissa;
+  if (mantissa != 0 && exponent != 0)
+    {
+      if (exponent > 0)
+	result *= (exponent <= MAX_EXACT_POWER) ?
+	  powers_of_10[exponent] : pow (10.0, exponent);
+      else
+	result /= (-exponent <= MAX_EXACT_POWER) ?
+	  powers_of_10[-exponent] : pow (10.0, -exponent);
+    }
+
+  *value = negative ? -result : result;
+  return p;
+}
+
+// parse a decimal integer starting at 'p' without going past 'end';
+// return the position after the number, or NULL on error
+static const char *
+parse_int (const char *p, const char *end, int *value)
+{
+  long int result = 0;
+  int negative = FALSE;
+  const char *start;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    {
+      negative = (*p == '-');
+      p++;
+    }
+
+  start = p;
+  while (p < end && IS_DIGIT (*p))
+    {
+      result = result * 10 + (*p - '0');
+      if (result > INT_MAX)
+	return NULL;
+      p++;
+    }
+
+  if (p == start)
+    return NULL;
+
+  *value = negative ? -result : result;
+  return p;
+}
+
+
+////////////////////////////////////////////////
+// Text input functions
+////////////////////////////////////////////////
+
+// parse one line of QOMET text output of given length;
+// return TRUE if a record was parsed, FALSE if the line is empty
+// or a comment, and ERROR on error (in which case 'error_column'
+// and 'error' are set, if not NULL)
+int
+io_text_parse_line (const char *line, size_t length,
+		    struct io_text_rec_cls *text_record,
+		    int *error_column, const char **error)
+{
+  const char *p = line;
+  const char *end = line + length;
+  const char *next;
+  double values[IO_TEXT_FIELDS];
+  int ids[IO_TEXT_FIELDS];
+  int field_i;
+
+  while (p < end && IS_BLANK (*p))
+    p++;
+
+  // empty lines and comments
+  if (p == end || *p == '%' || *p == '#')
+    return FALSE;
+
+  for (field_i = 0; field_i < IO_TEXT_FIELDS; field_i++)
+    {
+      while (p < end && IS_BLANK (*p))
+	p++;
+
+      if (field_i == FIELD_FROM_ID || field_i == FIELD_TO_ID)
+	next = parse_int (p, end, &ids[field_i]);
+      else
+	next = parse_double (p, end, (field_i == FIELD_TO_Z) ?
+			     TO_Z_DECIMALS : -1, &values[field_i]);
+
+      // each field must be followed by a separator, except for the
+      // one that may be merged with the next field
+      if (next == NULL
+	  || (next < end && !IS_BLANK (*next) && field_i != FIELD_TO_Z))
+	{
+	  if (error_column != NULL)
+	    *error_column = (int) (p - line) + 1;
+	  if (error != NULL)
+	    *error = field_errors[field_i];
+	  return ERROR;
+	}
+
+      p = next;
+    }
+
+  while (p < end && IS_BLANK (*p))
+    p++;
+
+  if (p != end)
+    {
+      if (error_column != NULL)
+	*error_column = (int) (p - line) + 1;
+      if (error != NULL)
+	*error = "unexpected data after the last field";
+      return ERROR;
+    }
+
+  text_record->time = values[0];
+  text_record->from_id = ids[FIELD_FROM_ID];
+  text_record->from_x = values[2];
+  text_record->from_y = values[3];
+  text_record->from_z = values[4];
+  text_record->to_id = ids[FIELD_TO_ID];
+  text_record->to_x = values[6];
+  text_record->to_y = values[7];
+  text_record->to_z = values[FIELD_TO_Z];
+  text_record->distance = values[9];
+  text_record->Pr = values[10];
+  text_record->SNR = values[11];
+  text_record->frame_error_rate = values[12];
+  text_record->num_retransmissions = values[13];
+  text_record->operating_rate = values[14];
+  text_record->bandwidth = values[15];
+  text_record->loss_rate = values[16];
+  text_record->delay = values[17];
+  text_record->jitter = values[18];
+
+  return TRUE;
+}
+
+// open a QOMET text output file for reading;
+// return SUCCESS on succes, ERROR on error
+int
+io_text_open (struct io_text_reader_cls *reader, const char *filename)
+{
+  memset (reader, 0, sizeof (struct io_text_reader_cls));
+  strncpy (reader->filename, filename, MAX_STRING - 1);
+
+  if (io_map_file (filename, &(reader->data), &(reader->size),
+		   &(reader->mapped)) == ERROR)
+    return ERROR;
+
+#ifdef MADV_SEQUENTIAL
+  if (reader->mapped == TRUE)
+    madvise (reader->data, reader->size, MADV_SEQUENTIAL);
+#endif
+
+  return SUCCESS;
+}
+
+// release the resources used by a reader
+void
+io_text_close (struct io_text_reader_cls *reader)
+{
+  io_unmap_file (reader->data, reader->size, reader->mapped);
+
+  reader->data = NULL;
+  reader->size = 0;
+  reader->position = 0;
+}
+
+// restart reading from the beginning of the file
+void
+io_text_rewind (struct io_text_reader_cls *reader)
+{
+  reader->position = 0;
+  reader->line_nr = 0;
+  reader->error_column = 0;
+  reader->error = NULL;
+}
+
+// read the next record, skipping empty lines and comments;
+// return TRUE if a record was read, FALSE at end of file, and
+// ERROR if the line is invalid ('line_nr', 'error_column' and 'error'
+// describe the problem, and the next call continues with the next line)
+int
+io_text_read_record (struct io_text_reader_cls *reader,
+		     struct io_text_rec_cls *text_record)
+{
+  const char *line;
+  const char *line_end;
+  size_t length;
+  int result;
+
+  while (reader->position < reader->size)
+    {
+      line = reader->data + reader->position;
+      line_end = memchr (line, '\n', reader->size - reader->position);
+
+      if (line_end != NULL)
+	{
+	  length = line_end - line;
+	  reader->position += length + 1;
+	}
+      else
+	{
+	  length = reader->size - reader->position;
+	  reader->position = reader->size;
+	}
+      reader->line_nr++;
+
+      result = io_text_parse_line (line, length, text_record,
+				   &(reader->error_column),
+				   &(reader->error));
+      if (result != FALSE)
+	return result;
+    }
+
+  return FALSE;
+}
+
+// fill a binary record with the fields of a text record
+void
+io_text_to_binary_record (struct io_text_rec_cls *text_record,
+			  struct bin_rec_cls *binary_record)
+{
+  binary_record->from_id = text_record->from_id;
+  binary_record->to_id = text_record->to_id;
+  binary_record->frame_error_rate = text_record->frame_error_rate;
+  binary_record->num_retransmissions = text_record->num_retransmissions;
+  binary_record->standard = 0;
+  binary_record->operating_rate = text_record->operating_rate;
+  binary_record->bandwidth = text_record->bandwidth;
+  binary_record->loss_rate = text_record->loss_rate;
+  binary_record->delay = text_record->delay;
+}
+
+// print a parse error of a reader in the usual form
+// "file:line:column: description"
+void
+io_text_print_error (struct io_text_reader_cls *reader)
+{
+  fprintf (stderr, "%s:%ld:%d: %s\n", reader->filename, reader->line_nr,
+	   reader->error_column,
+	   (reader->error != NULL) ? reader->error : "parse error");
+}
@@ -0,0 +1,254 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_writer.c
+ * Function: Asynchronous writer for the text output of deltaQ
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "io_writer.h"
+#include "message.h"
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// write the buffers queued by the main thread until the
+// writer is finalized and the queue is empty
+static void *
+writer_thread (void *arg)
+{
+  struct io_writer_class *writer = (struct io_writer_class *) arg;
+  struct io_writer_buffer_class *buffer;
+  int write_error;
+
+  pthread_mutex_lock (&(writer->mutex));
+  while (TRUE)
+    {
+      while (writer->count == 0 && writer->finished == FALSE)
+	pthread_cond_wait (&(writer->queue_changed), &(writer->mutex));
+
+      if (writer->count == 0)
+	break;
+
+      buffer = &(writer->buffers[writer->head]);
+      pthread_mutex_unlock (&(writer->mutex));
+
+      write_error = (fwrite (buffer->data, 1, buffer->used, writer->file)
+		     != buffer->used);
+
+      pthread_mutex_lock (&(writer->mutex));
+      if (write_error == TRUE)
+	writer->write_error = TRUE;
+      buffer->used = 0;
+      writer->head = (writer->head + 1) % IO_WRITER_BUFFERS;
+      writer->count--;
+      pthread_cond_broadcast (&(writer->queue_changed));
+    }
+  pthread_mutex_unlock (&(writer->mutex));
+
+  return NULL;
+}
+
+// hand the current buffer to the writer thread, and wait until
+// another buffer is free; without a writer thread, the buffer is
+// written directly; return SUCCESS on succes, ERROR on error
+static int
+submit_buffer (struct io_writer_class *writer)
+{
+  struct io_writer_buffer_class *buffer;
+  int write_error;
+
+  buffer = &(writer->buffers[writer->current]);
+  if (buffer->used == 0)
+    return SUCCESS;
+
+  if (writer->threaded == FALSE)
+    {
+      if (fwrite (buffer->data, 1, buffer->used, writer->file)
+	  != buffer->used)
+	{
+	  WARNING ("Error writing text output");
+	  writer->write_error = TRUE;
+	  return ERROR;
+	}
+      buffer->used = 0;
+      return SUCCESS;
+    }
+
+  pthread_mutex_lock (&(writer->mutex));
+  writer->count++;
+  pthread_cond_broadcast (&(writer->queue_changed));
+  while (writer->count == IO_WRITER_BUFFERS)
+    pthread_cond_wait (&(writer->queue_changed), &(writer->mutex));
+  writer->current = (writer->head + writer->count) % IO_WRITER_BUFFERS;
+  write_error = writer->write_error;
+  pthread_mutex_unlock (&(writer->mutex));
+
+  if (write_error == TRUE)
+    {
+      WARNING ("Error writing text output");
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+
+////////////////////////////////////////////////
+// Writer functions
+////////////////////////////////////////////////
+
+// init a writer for 'file' and start its thread;
+// return SUCCESS on succes, ERROR on error
+int
+io_writer_init (struct io_writer_class *writer, FILE * file)
+{
+  int buffer_i;
+
+  memset (writer, 0, sizeof (struct io_writer_class));
+  writer->file = file;
+
+  for (buffer_i = 0; buffer_i < IO_WRITER_BUFFERS; buffer_i++)
+    {
+      writer->buffers[buffer_i].data = (char *) malloc (IO_WRITER_BUFFER_SIZE);
+      if (writer->buffers[buffer_i].data == NULL)
+	{
+	  WARNING ("Cannot allocate memory for text output buffers");
+	  while (--buffer_i >= 0)
+	    free (writer->buffers[buffer_i].data);
+	  return ERROR;
+	}
+    }
+
+  pthread_mutex_init (&(writer->mutex), NULL);
+  pthread_cond_init (&(writer->queue_changed), NULL);
+
+  if (pthread_create (&(writer->thread), NULL, writer_thread, writer) == 0)
+    writer->threaded = TRUE;
+  else
+    {
+      WARNING ("Cannot start text output thread; writing synchronously");
+      writer->threaded = FALSE;
+    }
+
+  return SUCCESS;
+}
+
+// format connection description as text output and add it to
+// the current buffer; return SUCCESS on succes, ERROR on error
+int
+io_writer_write_connection (struct io_writer_class *writer,
+			    struct connection_class *connection,
+			    struct scenario_class *scenario,
+			    double time, int cartesian_coord_syst)
+{
+  struct io_writer_buffer_class *buffer;
+
+  buffer = &(writer->buffers[writer->current]);
+  if (IO_WRITER_BUFFER_SIZE - buffer->used < IO_LINE_SIZE)
+    {
+      if (submit_buffer (writer) == ERROR)
+	return ERROR;
+      buffer = &(writer->buffers[writer->current]);
+    }
+
+  buffer->used += io_format_connection (connection, scenario, time,
+					cartesian_coord_syst,
+					buffer->data + buffer->used);
+
+  return SUCCESS;
+}
+
+// mark the end of a time step; the current buffer is handed to the
+// writer thread if it holds enough data;
+// return SUCCESS on succes, ERROR on error
+int
+io_writer_end_step (struct io_writer_class *writer)
+{
+  if (writer->buffers[writer->current].used >= IO_WRITER_STEP_SIZE)
+    return submit_buffer (writer);
+
+  return SUCCESS;
+}
+
+// write all pending data to file, so that the file holds all the
+// steps ended so far; return SUCCESS on succes, ERROR on error
+int
+io_writer_flush (struct io_writer_class *writer)
+{
+  int write_error;
+
+  if (submit_buffer (writer) == ERROR)
+    return ERROR;
+
+  if (writer->threaded == TRUE)
+    {
+      pthread_mutex_lock (&(writer->mutex));
+      while (writer->count > 0)
+	pthread_cond_wait (&(writer->queue_changed), &(writer->mutex));
+      write_error = writer->write_error;
+      pthread_mutex_unlock (&(writer->mutex));
+
+      if (write_error == TRUE)
+	return ERROR;
+    }
+
+  if (fflush (writer->file) != 0)
+    {
+      WARNING ("Error writing text output");
+      writer->write_error = TRUE;
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// write all pending data, stop the writer thread and release
+// its resources (the file itself is not closed);
+// return SUCCESS on succes, ERROR if any write failed
+int
+io_writer_finalize (struct io_writer_class *writer)
+{
+  int buffer_i;
+
+  submit_buffer (writer);
+
+  if (writer->threaded == TRUE)
+    {
+      pthread_mutex_lock (&(writer->mutex));
+      writer->finished = TRUE;
+      pthread_cond_broadcast (&(writer->queue_changed));
+      pthread_mutex_unlock (&(writer->mutex));
+
+      pthread_join (writer->thread, NULL);
+      writer->threaded = FALSE;
+    }
+
+  pthread_mutex_destroy (&(writer->mutex));
+  pthread_cond_destroy (&(writer->queue_changed));
+
+  for (buffer_i = 0; buffer_i < IO_WRITER_BUFFERS; buffer_i++)
+    {
+      free (writer->buffers[buffer_i].data);
+      writer->buffers[buffer_i].data = NULL;
+    }
+
+  return (writer->write_error == TRUE) ? ERROR : SUCCESS;
+}
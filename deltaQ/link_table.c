@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: link_table.c
+ * Function: Precomputed tables of link quality models, used instead
+ *           of the analytic functions in the computation of deltaQ
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "link_table.h"
+#include "message.h"
+
+
+//////////////////////////////////
+// Link table variables
+//////////////////////////////////
+
+// TRUE if deltaQ parameters are computed using link tables
+int link_table_enabled = FALSE;
+
+// tables built so far; tables are only added (under 'table_mutex'),
+// and never change once added
+static struct link_table_class tables[LINK_TABLE_MAX_TABLES];
+static int table_number = 0;
+static pthread_mutex_t table_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// tables recently used by this thread, so that lookups in the
+// computation loop don't need to take 'table_mutex'
+static __thread struct link_table_class *table_cache[LINK_TABLE_CACHE_SIZE];
+static __thread int table_cache_next = 0;
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// return TRUE if 'table' has kind 'kind' and key 'key',
+// FALSE otherwise
+static int
+table_matches (struct link_table_class *table, int kind, double *key)
+{
+  return (table->kind == kind
+	  && memcmp (table->key, key, sizeof (table->key)) == 0);
+}
+
+// add 'table' to the tables cached by this thread
+static void
+table_cache_add (struct link_table_class *table)
+{
+  table_cache[table_cache_next] = table;
+  table_cache_next = (table_cache_next + 1) % LINK_TABLE_CACHE_SIZE;
+}
+
+// find a table that was already built; must be called with
+// 'table_mutex' locked
+static struct link_table_class *
+table_search (int kind, double *key)
+{
+  int table_i;
+
+  for (table_i = 0; table_i < table_number; table_i++)
+    if (table_matches (&(tables[table_i]), kind, key) == TRUE)
+      return &(tables[table_i]);
+
+  return NULL;
+}
+
+// interpolate the values of 'table' for 'x', which must be
+// inside the grid of the table
+static void
+table_interpolate (struct link_table_class *table, double x, double *values)
+{
+  double position, weight;
+  double *low, *high;
+  int point_i, value_i;
+
+  position = (x - table->x_min) * table->inverse_step;
+  point_i = (int) position;
+  if (point_i > table->point_number - 2)
+    point_i = table->point_number - 2;
+  weight = position - point_i;
+
+  low = &(table->values[point_i * table->value_number]);
+  high = low + table->value_number;
+  for (value_i = 0; value_i < table->value_number; value_i++)
+    values[value_i] = low[value_i] + weight * (high[value_i] - low[value_i]);
+}
+
+// compute the values of 'table' at 'point_number' grid points;
+// return SUCCESS on succes, ERROR on error
+static int
+table_fill (struct link_table_class *table, int point_number,
+	    link_table_function function, void *context)
+{
+  double step, x;
+  int point_i;
+
+  free (table->values);
+  table->values = (double *) malloc (point_number * table->value_number
+				     * sizeof (double));
+  if (table->values == NULL)
+    {
+      WARNING ("Cannot allocate memory for link table");
+      return ERROR;
+    }
+
+  step = (table->x_max - table->x_min) / (point_number - 1);
+  table->point_number = point_number;
+  table->inverse_step = 1.0 / step;
+
+  for (point_i = 0; point_i < point_number; point_i++)
+    {
+      // use the exact end of the grid for the last point
+      x = (point_i == point_number - 1) ?
+	table->x_max : table->x_min + point_i * step;
+      if (function (x, context,
+		    &(table->values[point_i * table->value_number])) == ERROR)
+	return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// compute the maximum error of 'table' at the middle of each grid
+// interval; return SUCCESS on succes, ERROR on error
+static int
+table_measure_error (struct link_table_class *table,
+		     link_table_function function, void *context,
+		     double *error)
+{
+  double exact[LINK_TABLE_MAX_VALUES], interpolated[LINK_TABLE_MAX_VALUES];
+  double step, x, value_error;
+  int point_i, value_i;
+
+  step = (table->x_max - table->x_min) / (table->point_number - 1);
+
+  (*error) = 0;
+  for (point_i = 0; point_i < table->point_number - 1; point_i++)
+    {
+      x = table->x_min + (point_i + 0.5) * step;
+      if (function (x, context, exact) == ERROR)
+	return ERROR;
+      table_interpolate (table, x, interpolated);
+
+      for (value_i = 0; value_i < table->value_number; value_i++)
+	{
+	  value_error = fabs (interpolated[value_i] - exact[value_i]) /
+	    fmax (fabs (exact[value_i]), LINK_TABLE_ERROR_FLOOR);
+
+	  // also catches values that are not numbers
+	  if (!(value_error <= (*error)))
+	    (*error) = value_error;
+	}
+    }
+
+  return SUCCESS;
+}
+
+
+////////////////////////////////////////////////
+// Link table functions
+////////////////////////////////////////////////
+
+// find the table of kind 'kind' with key 'key' (LINK_TABLE_KEY_SIZE
+// elements, unused ones being 0); return the table (which may be
+// invalid) on success, NULL if it was not built yet
+struct link_table_class *
+link_table_find (int kind, double *key)
+{
+  struct link_table_class *table;
+  int cache_i;
+
+  for (cache_i = 0; cache_i < LINK_TABLE_CACHE_SIZE; cache_i++)
+    if (table_cache[cache_i] != NULL
+	&& table_matches (table_cache[cache_i], kind, key) == TRUE)
+      return table_cache[cache_i];
+
+  pthread_mutex_lock (&table_mutex);
+  table = table_search (kind, key);
+  pthread_mutex_unlock (&table_mutex);
+
+  if (table != NULL)
+    table_cache_add (table);
+
+  return table;
+}
+
+// build the table of kind 'kind' with key 'key' by tabulating
+// 'value_number' values of 'function' between 'x_min' and 'x_max';
+// the grid is refined until the error, measured at the middle of each
+// grid interval, meets the error bound; the grid and function must
+// only depend on 'kind' and 'key'; return the table (which may be
+// invalid) on success, NULL on error
+struct link_table_class *
+link_table_build (int kind, double *key, double x_min, double x_max,
+		  int value_number, link_table_function function,
+		  void *context)
+{
+  struct link_table_class *table;
+  int point_number;
+  double error;
+
+  if (value_number < 1 || value_number > LINK_TABLE_MAX_VALUES)
+    {
+      WARNING ("Invalid number of link table values (%d)", value_number);
+      return NULL;
+    }
+
+  pthread_mutex_lock (&table_mutex);
+
+  // the table may have been built by another thread meanwhile
+  table = table_search (kind, key);
+  if (table != NULL)
+    {
+      pthread_mutex_unlock (&table_mutex);
+      table_cache_add (table);
+      return table;
+    }
+
+  if (table_number == LINK_TABLE_MAX_TABLES)
+    {
+      pthread_mutex_unlock (&table_mutex);
+      WARNING ("Maximum number of link tables exceeded (%d)",
+	       LINK_TABLE_MAX_TABLES);
+      return NULL;
+    }
+
+  table = &(tables[table_number]);
+  memset (table, 0, sizeof (struct link_table_class));
+  table->kind = kind;
+  memcpy (table->key, key, sizeof (table->key));
+  table->x_min = x_min;
+  table->x_max = x_max;
+  table->value_number = value_number;
+  table->valid = FALSE;
+
+  // empty grids are kept as invalid tables
+  if (x_min < x_max && isfinite (x_min) && isfinite (x_max))
+    for (point_number = LINK_TABLE_INITIAL_POINTS;
+	 point_number <= LINK_TABLE_MAX_POINTS; point_number *= 2)
+      {
+	if (table_fill (table, point_number, function, context) == ERROR
+	    || table_measure_error (table, function, context,
+				    &error) == ERROR)
+	  break;
+
+	table->error = error;
+	if (error <= LINK_TABLE_MAX_ERROR)
+	  {
+	    table->valid = TRUE;
+	    break;
+	  }
+      }
+
+  if (table->valid == TRUE)
+    INFO ("Built link table (kind=%d) with %d points in [%g, %g]; \
+maximum error %g", kind, table->point_number, x_min, x_max, table->error);
+  else
+    {
+      INFO ("Link table (kind=%d) in [%g, %g] does not meet the error \
+bound; analytic functions will be used instead", kind, x_min, x_max);
+      free (table->values);
+      table->values = NULL;
+      table->point_number = 0;
+    }
+
+  table_number++;
+  pthread_mutex_unlock (&table_mutex);
+
+  table_cache_add (table);
+
+  return table;
+}
+
+// interpolate the values of a table for 'x'; return TRUE if the
+// table is valid and 'x' is inside its grid, FALSE otherwise
+int
+link_table_lookup (struct link_table_class *table, double x, double *values)
+{
+  // the comparisons also fail for values that are not numbers
+  if (table->valid == FALSE || !(x >= table->x_min && x <= table->x_max))
+    return FALSE;
+
+  table_interpolate (table, x, values);
+
+  return TRUE;
+}
+
+// release all the tables; no other thread may use tables meanwhile
+void
+link_table_free_all (void)
+{
+  int table_i;
+
+  pthread_mutex_lock (&table_mutex);
+  for (table_i = 0; table_i < table_number; table_i++)
+    {
+      free (tables[table_i].values);
+      tables[table_i].values = NULL;
+    }
+  table_number = 0;
+  pthread_mutex_unlock (&table_mutex);
+
+  memset (table_cache, 0, sizeof (table_cache));
+}
@@ -92,6 +92,9 @@ motion_init (struct motion_class *motion, int id, char *node_name, int type,
   motion->mobility_filename_provided = FALSE;
   motion->trace_record_number = 0;
   motion->trace_record_crt = 0;
+
+  motion->own_rand_state = FALSE;
+  motion->rand_state = MOTION_RANDOM_SEED + (unsigned int) id * 2654435761u;
 }
 
 int
@@ -336,6 +339,9 @@ motion_copy (struct motion_class *motion_dst, struct motion_class *motion_src)
 		       &(motion_src->trace_records[i]));
   motion_dst->trace_record_number = motion_src->trace_record_number;
   motion_dst->trace_record_crt = motion_src->trace_record_crt;
+
+  motion_dst->own_rand_state = motion_src->own_rand_state;
+  motion_dst->rand_state = motion_src->rand_state;
 }
 
 
@@ -1452,10 +1458,27 @@ motion_apply (struct motion_class *motion, struct scenario_class *scenario,
 	motion_circular (motion, node, time_step);
       else if (motion->type == ROTATION_MOTION)
 	motion_rotation (motion, node, time_step);
-      else if (motion->type == RANDOM_WALK_MOTION)
-	motion_random_walk (motion, node, time_step);
-      else if (motion->type == BEHAVIORAL_MOTION)
-	motion_behavioral (motion, scenario, node, time_step);
+      else if (motion->type == RANDOM_WALK_MOTION
+	       || motion->type == BEHAVIORAL_MOTION)
+	{
+	  // stateful motions may draw from their own random state, so
+	  // that their trajectory can be replayed independently of the
+	  // other users of random numbers (e.g., fading in deltaQ
+	  // computation)
+	  unsigned int *previous_rand_state = NULL;
+
+	  if (motion->own_rand_state == TRUE)
+	    previous_rand_state =
+	      generic_set_rand_state (&(motion->rand_state));
+
+	  if (motion->type == RANDOM_WALK_MOTION)
+	    motion_random_walk (motion, node, time_step);
+	  else
+	    motion_behavioral (motion, scenario, node, time_step);
+
+	  if (motion->own_rand_state == TRUE)
+	    generic_set_rand_state (previous_rand_state);
+	}
       else if (motion->type == QUALNET_MOTION)
 	motion_trace (motion, scenario, node, motion_current_time, time_step);
       else
@@ -1569,3 +1592,418 @@ velocity calculation", motion_types[motion2->type]);
 
   return relative_velocity;
 }
+
+// save in 'state' the fields of a motion that change while it is applied
+void
+motion_save_state (struct motion_class *motion,
+		   struct motion_state_class *state)
+{
+  coordinate_copy (&(state->speed), &(motion->speed));
+  state->velocity = motion->velocity;
+  state->current_walk_time = motion->current_walk_time;
+  state->angle = motion->angle;
+  state->time_since_destination_reached =
+    motion->time_since_destination_reached;
+  state->speed_from_destination = motion->speed_from_destination;
+  state->motion_sense = motion->motion_sense;
+  state->trace_record_crt = motion->trace_record_crt;
+  state->rand_state = motion->rand_state;
+}
+
+// restore the fields of a motion saved by motion_save_state
+void
+motion_restore_state (struct motion_class *motion,
+		      struct motion_state_class *state)
+{
+  coordinate_copy (&(motion->speed), &(state->speed));
+  motion->velocity = state->velocity;
+  motion->current_walk_time = state->current_walk_time;
+  motion->angle = state->angle;
+  motion->time_since_destination_reached =
+    state->time_since_destination_reached;
+  motion->speed_from_destination = state->speed_from_destination;
+  motion->motion_sense = state->motion_sense;
+  motion->trace_record_crt = state->trace_record_crt;
+  motion->rand_state = state->rand_state;
+}
+
+
+/////////////////////////////////////////
+// Motion time grid functions
+/////////////////////////////////////////
+
+// return the time of sub-step 'divider_i' of step 'step_i'; the
+// expression is the same as in the main loop of deltaQ, so that
+// comparisons give the same results
+static double
+grid_time (struct motion_grid_class *grid, long step_i, int divider_i)
+{
+  return motion_grid_step_time (grid, step_i)
+    + divider_i * grid->motion_step;
+}
+
+// return the first step for which sub-step 'divider_i' takes place
+// at 'time' or later (if 'strict' is FALSE), or after 'time' (if
+// 'strict' is TRUE)
+static long
+grid_first_step (struct motion_grid_class *grid, int divider_i, double time,
+		 int strict)
+{
+  long step_i;
+
+#define GRID_AFTER(step_i) \
+  ((strict == TRUE) ? (grid_time (grid, (step_i), divider_i) > time) : \
+   (grid_time (grid, (step_i), divider_i) >= time))
+
+  // estimate the step directly, then correct rounding errors
+  step_i = (long) ceil ((time - grid->start_time
+			 - divider_i * grid->motion_step) / grid->step);
+  if (step_i < 0)
+    step_i = 0;
+  while (step_i > 0 && GRID_AFTER (step_i - 1))
+    step_i--;
+  while (!GRID_AFTER (step_i))
+    step_i++;
+
+#undef GRID_AFTER
+
+  return step_i;
+}
+
+// return the number of motion sub-steps earlier than 'time'
+static long
+grid_count_before (struct motion_grid_class *grid, double time)
+{
+  long count = 0, step_number, before_number;
+  int divider_i;
+
+  for (divider_i = 0; divider_i < grid->divider_number; divider_i++)
+    {
+      // sub-steps later than the end of the scenario are not applied
+      step_number = grid_first_step (grid, divider_i,
+				     grid->stop_time + EPSILON, TRUE);
+      before_number = grid_first_step (grid, divider_i, time, FALSE);
+      count += (before_number < step_number) ? before_number : step_number;
+    }
+
+  return count;
+}
+
+// init the time grid of a scenario that starts at 'start_time',
+// lasts 'duration' and is computed with 'step' split into
+// 'motion_step_divider' motion sub-steps;
+// return SUCCESS on succes, ERROR on error
+int
+motion_grid_init (struct motion_grid_class *grid, double start_time,
+		  double duration, double step, double motion_step_divider)
+{
+  double current_time;
+  long step_i;
+
+  grid->start_time = start_time;
+  grid->stop_time = duration + start_time;
+  grid->step = step;
+  grid->motion_step = step / motion_step_divider;
+  grid->divider_number = (int) ceil (motion_step_divider);
+
+  // the steps of the scenario, and the first one after its end
+  grid->step_number = (long) ceil (duration / step) + 2;
+  grid->step_times = (double *) malloc (grid->step_number * sizeof (double));
+  if (grid->step_times == NULL)
+    {
+      WARNING ("Cannot allocate memory for motion time grid");
+      return ERROR;
+    }
+
+  // add the step repeatedly, as the main loop of deltaQ used to
+  current_time = start_time;
+  for (step_i = 0; step_i < grid->step_number; step_i++)
+    {
+      grid->step_times[step_i] = current_time;
+      current_time += step;
+    }
+
+  return SUCCESS;
+}
+
+// free the memory used by a time grid
+void
+motion_grid_free (struct motion_grid_class *grid)
+{
+  free (grid->step_times);
+  grid->step_times = NULL;
+  grid->step_number = 0;
+}
+
+// return the time of step 'step_i'
+double
+motion_grid_step_time (struct motion_grid_class *grid, long step_i)
+{
+  if (step_i < grid->step_number)
+    return grid->step_times[step_i];
+
+  // steps after the end of the scenario are never applied
+  return grid->step_times[grid->step_number - 1]
+    + (step_i - grid->step_number + 1) * grid->step;
+}
+
+// return the index of the first step whose time is not earlier
+// than 'time'
+long
+motion_grid_step_index (struct motion_grid_class *grid, double time)
+{
+  return grid_first_step (grid, 0, time - EPSILON, FALSE);
+}
+
+// return the number of motion sub-steps whose time is in the
+// interval [time1, time2)
+long
+motion_grid_count (struct motion_grid_class *grid, double time1,
+		   double time2)
+{
+  if (time2 <= time1)
+    return 0;
+
+  return grid_count_before (grid, time2) - grid_count_before (grid, time1);
+}
+
+// return the time of the first sub-step at 'time' or later
+static double
+grid_first_time (struct motion_grid_class *grid, double time)
+{
+  double first_time = DBL_MAX, substep_time;
+  int divider_i;
+
+  for (divider_i = 0; divider_i < grid->divider_number; divider_i++)
+    {
+      substep_time = grid_time (grid, grid_first_step (grid, divider_i,
+						       time, FALSE),
+				divider_i);
+      if (substep_time < first_time)
+	first_time = substep_time;
+    }
+
+  return first_time;
+}
+
+// return the time of the last sub-step earlier than 'time'
+static double
+grid_last_time (struct motion_grid_class *grid, double time)
+{
+  double last_time = -DBL_MAX, substep_time;
+  long step_i;
+  int divider_i;
+
+  for (divider_i = 0; divider_i < grid->divider_number; divider_i++)
+    {
+      step_i = grid_first_step (grid, divider_i, time, FALSE) - 1;
+      if (step_i < 0)
+	continue;
+      substep_time = grid_time (grid, step_i, divider_i);
+      if (substep_time > last_time)
+	last_time = substep_time;
+    }
+
+  return last_time;
+}
+
+
+/////////////////////////////////////////
+// Closed-form motion functions
+/////////////////////////////////////////
+
+// return TRUE if the motion can be evaluated in closed form (that is,
+// without applying all its previous steps), FALSE otherwise
+int
+motion_has_closed_form (struct motion_class *motion)
+{
+  return (motion->type == LINEAR_MOTION || motion->type == CIRCULAR_MOTION
+	  || motion->type == ROTATION_MOTION
+	  || motion->type == QUALNET_MOTION);
+}
+
+// return TRUE if the motion changes the node position, FALSE otherwise
+int
+motion_changes_position (struct motion_class *motion)
+{
+  return (motion->type != ROTATION_MOTION);
+}
+
+// return the index of the first trace record later than 'time'
+// (binary search)
+static int
+trace_first_record_after (struct motion_class *motion, double time)
+{
+  int low = 0, high = motion->trace_record_number, middle;
+
+  while (low < high)
+    {
+      middle = (low + high) / 2;
+      if (motion->trace_records[middle].time > time)
+	high = middle;
+      else
+	low = middle + 1;
+    }
+
+  return low;
+}
+
+// move the node of a trace motion to the position it has at 'time'
+// when it left 'start_position' at 'start_time'; the incremental
+// motion heads at each step towards the next trace record, which
+// is equivalent to linear interpolation between records
+static void
+motion_trace_closed_form (struct motion_class *motion,
+			  struct node_class *node, double start_time,
+			  double time)
+{
+  struct coordinate_class start_position;
+  struct coordinate_class *from, *to;
+  double from_time, to_time;
+  int record_i, first_record_i, i;
+
+  coordinate_copy (&start_position, &(node->position));
+
+  first_record_i = trace_first_record_after (motion, start_time);
+  record_i = trace_first_record_after (motion, time);
+
+  if (record_i >= motion->trace_record_number)
+    {
+      // all records were passed => stay at the last one
+      if (first_record_i < motion->trace_record_number)
+	coordinate_copy (&(node->position),
+			 &(motion->trace_records
+			   [motion->trace_record_number - 1].coord));
+      return;
+    }
+
+  // interpolate between the previous point and the next record
+  if (record_i > first_record_i)
+    {
+      from = &(motion->trace_records[record_i - 1].coord);
+      from_time = motion->trace_records[record_i - 1].time;
+    }
+  else
+    {
+      from = &start_position;
+      from_time = start_time;
+    }
+  to = &(motion->trace_records[record_i].coord);
+  to_time = motion->trace_records[record_i].time;
+
+  for (i = 0; i < MAX_COORDINATES; i++)
+    node->position.c[i] = from->c[i] + (to->c[i] - from->c[i])
+      * (time - from_time) / (to_time - from_time);
+}
+
+// apply in one go all the sub-steps of 'grid' earlier than 'time'
+// during which the motion is active, starting from the node state
+// before its first sub-step; only for motions that have a closed form;
+// return SUCCESS on succes, ERROR on error
+int
+motion_apply_closed_form (struct motion_class *motion,
+			  struct scenario_class *scenario,
+			  struct motion_grid_class *grid, double time)
+{
+  struct node_class *node;
+  double end_time, last_time;
+  double radius, delta_alpha, alpha, orientation;
+  long substep_number;
+  int i, interf_j;
+
+  if (motion->node_index == INVALID_INDEX)	// node could not be found
+    {
+      WARNING ("Motion specifies an unexisting node ('%s')",
+	       motion->node_name);
+      return ERROR;
+    }
+  node = &(scenario->nodes[motion->node_index]);
+
+  // sub-steps at which the motion is applied
+  end_time = (motion->stop_time < time) ? motion->stop_time : time;
+  substep_number = motion_grid_count (grid, motion->start_time, end_time);
+  if (substep_number == 0)
+    return SUCCESS;
+
+  if (motion->type == LINEAR_MOTION)
+    {
+      // same as the first application in motion_apply
+      if (motion->speed_from_destination)
+	{
+	  coordinate_vector_difference (&(motion->speed),
+					&(motion->destination),
+					&(node->position));
+	  coordinate_multiply_scalar (&(motion->speed), &(motion->speed),
+				      1 / (motion->stop_time -
+					   motion->start_time));
+	  motion->speed_from_destination = FALSE;
+	}
+
+      for (i = 0; i < MAX_COORDINATES; i++)
+	node->position.c[i] +=
+	  motion->speed.c[i] * grid->motion_step * substep_number;
+    }
+  else if (motion->type == CIRCULAR_MOTION)
+    {
+      // the radius does not change, and the angle increases
+      // by the same amount at each sub-step
+      radius = sqrt (pow (node->position.c[0] - motion->center.c[0], 2) +
+		     pow (node->position.c[1] - motion->center.c[1], 2));
+      delta_alpha = motion->velocity * grid->motion_step / radius;
+
+      alpha = asin ((node->position.c[1] - motion->center.c[1]) / radius);
+      if ((node->position.c[0] - motion->center.c[0]) < 0 &&
+	  (node->position.c[1] - motion->center.c[1]) > 0)
+	alpha = M_PI - alpha;
+      else if ((node->position.c[0] - motion->center.c[0]) < 0
+	       && (node->position.c[1] - motion->center.c[1]) < 0)
+	alpha = -M_PI - alpha;
+
+      alpha += substep_number * delta_alpha;
+      node->position.c[0] = radius * cos (alpha) + motion->center.c[0];
+      node->position.c[1] = radius * sin (alpha) + motion->center.c[1];
+    }
+  else if (motion->type == ROTATION_MOTION)
+    {
+      // orientations are brought in the interval [0,360) only if
+      // they were increased, as in motion_rotation
+      for (interf_j = 0; interf_j < node->if_num; interf_j++)
+	{
+	  orientation = node->interfaces[interf_j].azimuth_orientation
+	    + substep_number * motion->rotation_angle_horizontal;
+	  if (orientation >= 360)
+	    orientation = fmod (orientation, 360);
+	  node->interfaces[interf_j].azimuth_orientation = orientation;
+
+	  orientation = node->interfaces[interf_j].elevation_orientation
+	    + substep_number * motion->rotation_angle_vertical;
+	  if (orientation >= 360)
+	    orientation = fmod (orientation, 360);
+	  node->interfaces[interf_j].elevation_orientation = orientation;
+	}
+    }
+  else if (motion->type == QUALNET_MOTION)
+    {
+      if (motion->trace_record_number == 0)
+	return SUCCESS;
+
+      // the position reached after the last sub-step is the one
+      // at the end of that sub-step
+      last_time = grid_last_time (grid, end_time);
+      motion_trace_closed_form (motion, node,
+				grid_first_time (grid, motion->start_time),
+				last_time + grid->motion_step);
+
+      motion->trace_record_crt = trace_first_record_after (motion, last_time);
+      if (motion->trace_record_crt > motion->trace_record_number - 1)
+	motion->trace_record_crt = motion->trace_record_number - 1;
+    }
+  else
+    {
+      WARNING ("Motion type '%s' cannot be evaluated in closed form",
+	       motion_types[motion->type]);
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
@@ -20,18 +20,50 @@
  ***********************************************************************/
 
 
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "message.h"
 #include "deltaQ.h"
 
 #include "scenario.h"
+#include "generic.h"
 
 #include "wlan.h"
 #include "xml_jpgis.h"
 
 
+// private state of the current thread while connections are
+// computed in parallel; NULL otherwise
+static __thread struct scenario_worker_class *crt_worker = NULL;
+
+// work shared by the threads of a parallel precomputation;
+// connections are handed out in groups with the same transmitting
+// node, since some models update the state of the transmitting
+// interface (e.g., WiMAX capacity), which must thus not be written
+// by two threads at the same time
+struct precompute_work_class
+{
+  struct scenario_class *scenario;
+
+  // connection indexes ordered by transmitting node, and the start
+  // of each group of connections from the same node in this order
+  int *connection_order;
+  int *group_starts;
+  int group_number;
+
+  // next group to be computed, and whether an error occurred
+  int next_group;
+  int error;
+  pthread_mutex_t mutex;
+
+  // number of iterations needed by each connection
+  int *iterations;
+};
+
+
 /////////////////////////////////////////
 // Scenario structure functions
 /////////////////////////////////////////
@@ -49,6 +81,13 @@ scenario_init (struct scenario_class *scenario)
   scenario->if_num = 0;
 
   scenario->current_time = 0.0;
+
+  scenario->thread_number = 1;
+  scenario->interfering_connections = NULL;
+  scenario->shadowing_deferred = FALSE;
+
+  scenario->motion_checkpoints = NULL;
+  scenario->motion_checkpoint_number = 0;
 }
 
 // print the fields of a scenario
@@ -547,6 +586,208 @@ scenario_auto_connect_nodes_at (struct scenario_class *scenario)
   return SUCCESS;
 }
 
+// compute the deltaQ of a connection repeatedly until its
+// parameters do not change anymore, but at most MAXIMUM_PRECOMPUTE
+// times; the number of iterations is returned in 'num_iterations';
+// return SUCCESS on succes, ERROR on error
+static int
+scenario_precompute_connection (struct scenario_class *scenario,
+				int connection_i, int *num_iterations)
+{
+  int deltaQ_changed;		// show whether deltaQ was changed or not
+
+  // reset number of iterations
+  *num_iterations = 0;
+  INFO ("--- Initializing connection %d ---", connection_i);
+
+  do
+    {
+      // compute deltaQ
+      if (connection_deltaQ (&(scenario->connections[connection_i]),
+			     scenario, &deltaQ_changed) == ERROR)
+	{
+	  WARNING ("Error while computing connection deltaQ");
+	  return ERROR;
+	}
+
+#ifdef MESSAGE_DEBUG
+      DEBUG ("Current connection state:");
+      connection_print (&(scenario->connections[connection_i]));
+#endif
+
+      // if deltaQ didn't change with respect to the previous 
+      // iteration then break, else continue
+      if (deltaQ_changed == FALSE)
+	break;
+      else
+	(*num_iterations)++;
+
+      // if maximum number of iterations was reached it means 
+      // a steady state cannot be achieved => warning
+      if (*num_iterations >= MAXIMUM_PRECOMPUTE)
+	{
+	  WARNING ("Maximum number of iterations (%d) was \
+reached during precomputation phase without reaching steady state", MAXIMUM_PRECOMPUTE);
+	  break;
+	}
+    }
+  while (1);
+
+  // print "nice" separator between connections
+  INFO ("--- Connection %d initialization finished (%d iterations) ---",
+	connection_i, *num_iterations);
+
+  return SUCCESS;
+}
+
+// precompute groups of connections until none is left
+static void *
+precompute_thread (void *arg)
+{
+  struct precompute_work_class *work = (struct precompute_work_class *) arg;
+  struct scenario_worker_class worker;
+  int group_i, order_i, connection_i;
+
+  if (scenario_worker_init (&worker) == ERROR)
+    {
+      pthread_mutex_lock (&(work->mutex));
+      work->error = TRUE;
+      pthread_mutex_unlock (&(work->mutex));
+      return NULL;
+    }
+  scenario_worker_attach (&worker);
+
+  while (1)
+    {
+      pthread_mutex_lock (&(work->mutex));
+      if (work->error == TRUE || work->next_group >= work->group_number)
+	{
+	  pthread_mutex_unlock (&(work->mutex));
+	  break;
+	}
+      group_i = work->next_group++;
+      pthread_mutex_unlock (&(work->mutex));
+
+      for (order_i = work->group_starts[group_i];
+	   order_i < work->group_starts[group_i + 1]; order_i++)
+	{
+	  connection_i = work->connection_order[order_i];
+	  scenario_worker_seed (&worker, connection_i);
+	  if (scenario_precompute_connection (work->scenario, connection_i,
+					      &(work->iterations
+						[connection_i])) == ERROR)
+	    {
+	      pthread_mutex_lock (&(work->mutex));
+	      work->error = TRUE;
+	      pthread_mutex_unlock (&(work->mutex));
+	      break;
+	    }
+	}
+    }
+
+  scenario_worker_attach (NULL);
+  scenario_worker_free (&worker);
+
+  return NULL;
+}
+
+// precompute all connections using 'scenario->thread_number' threads;
+// interference is computed from the state the connections had before
+// precomputation, so that the result does not depend on the order in
+// which threads process connections; the number of iterations needed
+// by each connection is returned in 'iterations';
+// return SUCCESS on succes, ERROR on error
+static int
+scenario_precompute_parallel (struct scenario_class *scenario,
+			      int *iterations)
+{
+  struct precompute_work_class work;
+  pthread_t threads[MAX_SCENARIO_THREADS];
+  int *node_counts;
+  int thread_number, thread_i, started_threads = 0;
+  int node_i, connection_i, order_i;
+  int result = SUCCESS;
+
+  memset (&work, 0, sizeof (struct precompute_work_class));
+  work.scenario = scenario;
+  work.iterations = iterations;
+
+  work.connection_order =
+    (int *) malloc (scenario->connection_number * sizeof (int));
+  work.group_starts =
+    (int *) malloc ((scenario->node_number + 1) * sizeof (int));
+  node_counts = (int *) calloc (scenario->node_number + 1, sizeof (int));
+  scenario->interfering_connections = (struct connection_class *)
+    malloc (scenario->connection_number * sizeof (struct connection_class));
+  if (work.connection_order == NULL || work.group_starts == NULL
+      || node_counts == NULL || scenario->interfering_connections == NULL)
+    {
+      WARNING ("Cannot allocate memory for parallel precomputation");
+      result = ERROR;
+      goto PRECOMPUTE_END;
+    }
+
+  // state seen by interference computations
+  memcpy (scenario->interfering_connections, scenario->connections,
+	  scenario->connection_number * sizeof (struct connection_class));
+
+  // order connections by transmitting node (counting sort)
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    node_counts[scenario->connections[connection_i].from_node_index + 1]++;
+  for (node_i = 0; node_i < scenario->node_number; node_i++)
+    {
+      if (node_counts[node_i + 1] > 0)
+	work.group_starts[work.group_number++] = node_counts[node_i];
+      node_counts[node_i + 1] += node_counts[node_i];
+    }
+  work.group_starts[work.group_number] = scenario->connection_number;
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      order_i =
+	node_counts[scenario->connections[connection_i].from_node_index]++;
+      work.connection_order[order_i] = connection_i;
+    }
+
+  thread_number = scenario->thread_number;
+  if (thread_number > work.group_number)
+    thread_number = work.group_number;
+
+  pthread_mutex_init (&(work.mutex), NULL);
+  for (thread_i = 0; thread_i < thread_number; thread_i++)
+    {
+      if (pthread_create (&(threads[thread_i]), NULL, precompute_thread,
+			  &work) != 0)
+	{
+	  WARNING ("Cannot start precomputation thread; using %d threads",
+		   started_threads);
+	  break;
+	}
+      started_threads++;
+    }
+
+  // if no thread could be started, do the work in this one
+  if (started_threads == 0)
+    precompute_thread (&work);
+
+  for (thread_i = 0; thread_i < started_threads; thread_i++)
+    pthread_join (threads[thread_i], NULL);
+  pthread_mutex_destroy (&(work.mutex));
+
+  if (work.error == TRUE)
+    result = ERROR;
+
+PRECOMPUTE_END:
+  free (work.connection_order);
+  free (work.group_starts);
+  free (node_counts);
+  free (scenario->interfering_connections);
+  scenario->interfering_connections = NULL;
+
+  return result;
+}
+
 // perform the necessary initialization before the scenario_deltaQ
 // function can be called (mainly connection-related initialization);
 // if 'load_from_jpgis_file' flag is set, some object coordinates 
@@ -562,8 +803,6 @@ scenario_init_state (struct scenario_class *scenario,
   int object_i;			// object index
   int connection_i;		// connection index
   int motion_i;			// motion index
-  int num_iterations;		// iteration counter
-  int deltaQ_changed;		// show whether deltaQ was changed or not
 
   // initialize interface indexes for each node
   for (node_i = 0; node_i < scenario->node_number; node_i++)
@@ -743,9 +982,61 @@ no merging necessary", crt_object->name);
     }
 
   if (deltaQ_disabled == FALSE)
+    if (scenario_precompute_state (scenario) == ERROR)
+      return ERROR;
+
+  return SUCCESS;
+}
+
+
+// compute the state of all connections until their deltaQ parameters
+// do not change anymore (done by scenario_init_state, unless deltaQ
+// computation is disabled); return SUCCESS on succes, ERROR on error
+int
+scenario_precompute_state (struct scenario_class *scenario)
+{
+  int connection_i;		// connection index
+  int environment_i;		// environment index
+  int parallel_precompute;	// precompute connections in parallel or not
+  int *iterations;
+  int min_iterations, max_iterations, unsteady_number = 0;
+  double sum_iterations = 0;
+
+  iterations = (int *) calloc (scenario->connection_number + 1,
+			       sizeof (int));
+  if (iterations == NULL)
+    {
+      WARNING ("Cannot allocate memory for precomputation");
+      return ERROR;
+    }
+
+  // dynamic environments are updated by each connection that
+  // goes through them, so they cannot be shared between threads
+  parallel_precompute = (scenario->thread_number > 1
+			 && scenario->connection_number > 1);
+  for (environment_i = 0; environment_i < scenario->environment_number;
+       environment_i++)
+    if (scenario->environments[environment_i].is_dynamic == TRUE)
+      {
+	if (parallel_precompute == TRUE)
+	  INFO ("Dynamic environments are used => precomputing \
+connections serially");
+	parallel_precompute = FALSE;
+	break;
+      }
+
+  if (parallel_precompute == TRUE)
+    {
+      if (scenario_precompute_parallel (scenario, iterations) == ERROR)
+	{
+	  free (iterations);
+	  return ERROR;
+	}
+    }
+  else
     {
-      // precompute status for each connection; since this may take a while
-      // for large scenarios, a counter is displayed
+      // precompute status for each connection; since this may take
+      // a while for large scenarios, a counter is displayed
       for (connection_i = 0; connection_i < scenario->connection_number;
 	   connection_i++)
 	{
@@ -755,56 +1046,45 @@ no merging necessary", crt_object->name);
 	     connection_i, scenario->connection_number);
 	   */
 
-	  // reset number of iterations
-	  num_iterations = 0;
-	  INFO ("--- Initializing connection %d ---", connection_i);
-
-	  do
+	  if (scenario_precompute_connection (scenario, connection_i,
+					      &(iterations[connection_i]))
+	      == ERROR)
 	    {
-	      // compute deltaQ
-	      if (connection_deltaQ (&(scenario->connections[connection_i]),
-				     scenario, &deltaQ_changed) == ERROR)
-		{
-		  WARNING ("Error while computing connection deltaQ");
-		  return ERROR;
-		}
-
-#ifdef MESSAGE_DEBUG
-	      DEBUG ("Current connection state:");
-	      connection_print (&(scenario->connections[connection_i]));
-#endif
-
-	      // if deltaQ didn't change with respect to the previous 
-	      // iteration then break, else continue
-	      if (deltaQ_changed == FALSE)
-		break;
-	      else
-		num_iterations++;
-
-	      // if maximum number of iterations was reached it means 
-	      // a steady state cannot be achieved => warning
-	      if (num_iterations >= MAXIMUM_PRECOMPUTE)
-		{
-		  WARNING ("Maximum number of iterations (%d) was \
-reached during precomputation phase without reaching steady state", MAXIMUM_PRECOMPUTE);
-		  break;
-		}
+	      free (iterations);
+	      return ERROR;
 	    }
-	  while (1);
-
-	  // print "nice" separator between connections
-	  INFO ("--- Connection %d initialization finished ---",
-		connection_i);
 	}
+    }
 
-      fprintf (stderr, "* Connection validation and initialization done (%d \
-connections)      \n", scenario->connection_number);
+  // report how fast connections reached steady state
+  min_iterations = iterations[0];
+  max_iterations = iterations[0];
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      if (iterations[connection_i] < min_iterations)
+	min_iterations = iterations[connection_i];
+      if (iterations[connection_i] > max_iterations)
+	max_iterations = iterations[connection_i];
+      if (iterations[connection_i] >= MAXIMUM_PRECOMPUTE)
+	unsteady_number++;
+      sum_iterations += iterations[connection_i];
     }
+  free (iterations);
+
+  if (scenario->connection_number > 0)
+    fprintf (stderr, "* Connection precomputation done with %d thread(s): \
+iterations min=%d avg=%.2f max=%d; %d connections without steady state\n",
+	     (parallel_precompute == TRUE) ? scenario->thread_number : 1,
+	     min_iterations, sum_iterations / scenario->connection_number,
+	     max_iterations, unsteady_number);
+
+  fprintf (stderr, "* Connection validation and initialization done (%d \
+connections)      \n", scenario->connection_number);
 
   return SUCCESS;
 }
 
-
 // compute the deltaQ for all connections of the given scenario;
 // deltaQ parameters are returned in the corresponding fields of
 // the connection objects;
@@ -814,7 +1094,6 @@ scenario_deltaQ (struct scenario_class *scenario, double current_time)
 {
   int connection_i, deltaQ_changed;
   struct connection_class *connection;
-  struct fixed_deltaQ_class *fixed_deltaQ;
 
   // calculate the state for active nodes according to 
   // 'connections' object in 'scenario'
@@ -829,53 +1108,346 @@ scenario_deltaQ (struct scenario_class *scenario, double current_time)
       connection = &(scenario->connections[connection_i]);
 
       // check whether a fixed_deltaQ structure can be applied
-      if (connection->fixed_deltaQ_number > 0)
-	{
-	  fixed_deltaQ = &(connection->fixed_deltaQs
-			   [connection->fixed_deltaQ_crt]);
+      connection_apply_fixed_deltaQ (connection, current_time);
 
-	  // advance to next record if needed
-	  if (fixed_deltaQ->end_time <= current_time)
-	    if (connection->fixed_deltaQ_crt
-		< (connection->fixed_deltaQ_number - 1))
-	      {
-		connection->fixed_deltaQ_crt++;
-		fixed_deltaQ = &(connection->fixed_deltaQs
-				 [connection->fixed_deltaQ_crt]);
-	      }
+      if (connection_deltaQ
+	  (&(scenario->connections[connection_i]), scenario,
+	   &deltaQ_changed) == ERROR)
+	return ERROR;
+    }
 
-	  DEBUG ("fixed_deltaQ: fixed_deltaQ_number=%d fixed_deltaQ_crt=%d \
-current_time=%.2f", connection->fixed_deltaQ_number, connection->fixed_deltaQ_crt, current_time);
+  return SUCCESS;
+}
 
-	  if (fixed_deltaQ->start_time <= current_time)
-	    {
-	      connection->bandwidth_defined = TRUE;
-	      connection->bandwidth = fixed_deltaQ->bandwidth;
-	      connection->loss_rate_defined = TRUE;
-	      connection->loss_rate = fixed_deltaQ->loss_rate;
-	      connection->delay_defined = TRUE;
-	      connection->delay = fixed_deltaQ->delay;
-	      connection->jitter_defined = TRUE;
-	      connection->jitter = fixed_deltaQ->jitter;
-	    }
-	  else
+// apply all the motions that are active during the sub-steps of
+// step 'step_i' of 'grid' that are earlier than 'time_limit';
+// return SUCCESS on succes, ERROR on error
+int
+scenario_apply_motions (struct scenario_class *scenario,
+			struct motion_grid_class *grid, long step_i,
+			double time_limit)
+{
+  double current_time = motion_grid_step_time (grid, step_i);
+  double motion_current_time;
+  int divider_i, motion_i;
+  int motion_found;
+
+  for (divider_i = 0; divider_i < grid->divider_number; divider_i++)
+    {
+      motion_current_time = current_time + divider_i * grid->motion_step;
+
+      if (motion_current_time > (grid->stop_time + EPSILON)
+	  || motion_current_time >= time_limit)
+	break;
+
+      // move nodes according to the 'motions' object in 'scenario'
+      // for the next step of evaluation
+      INFO ("  NODE MOVEMENT (sub-step %d)", divider_i);
+      motion_found = FALSE;
+      for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+	{
+	  if ((scenario->motions[motion_i].start_time <= motion_current_time)
+	      && (scenario->motions[motion_i].stop_time >
+		  motion_current_time))
 	    {
-	      connection->bandwidth_defined = FALSE;
-	      connection->loss_rate_defined = FALSE;
-	      connection->delay_defined = FALSE;
-	      connection->jitter_defined = FALSE;
+	      fprintf (stderr, "\t\t\tcalculation => motion %d             \r",
+		       motion_i);
+
+	      if (motion_apply (&(scenario->motions[motion_i]), scenario,
+				motion_current_time,
+				grid->motion_step) == ERROR)
+		return ERROR;
+
+	      motion_found = TRUE;
 	    }
 	}
+#ifdef MESSAGE_INFO
+      if (motion_found == FALSE)
+	INFO ("  No valid motion found");
+#endif
+    }
 
-      if (connection_deltaQ
-	  (&(scenario->connections[connection_i]), scenario,
-	   &deltaQ_changed) == ERROR)
+  return SUCCESS;
+}
+
+// save the state of all nodes and motions before step 'step_i'
+// to 'checkpoint'; return SUCCESS on succes, ERROR on error
+static int
+checkpoint_save (struct scenario_class *scenario,
+		 struct scenario_checkpoint_class *checkpoint, long step_i)
+{
+  struct node_class *node;
+  int node_i, interf_j, motion_i, orientation_i = 0;
+  int interface_number = 0;
+
+  for (node_i = 0; node_i < scenario->node_number; node_i++)
+    interface_number += scenario->nodes[node_i].if_num;
+
+  checkpoint->step_i = step_i;
+  checkpoint->positions = (struct coordinate_class *)
+    malloc ((scenario->node_number + 1) * sizeof (struct coordinate_class));
+  checkpoint->orientations =
+    (double *) malloc ((2 * interface_number + 1) * sizeof (double));
+  checkpoint->motion_states = (struct motion_state_class *)
+    malloc ((scenario->motion_number + 1) *
+	    sizeof (struct motion_state_class));
+  if (checkpoint->positions == NULL || checkpoint->orientations == NULL
+      || checkpoint->motion_states == NULL)
+    {
+      WARNING ("Cannot allocate memory for motion checkpoint");
+      free (checkpoint->positions);
+      free (checkpoint->orientations);
+      free (checkpoint->motion_states);
+      return ERROR;
+    }
+
+  for (node_i = 0; node_i < scenario->node_number; node_i++)
+    {
+      node = &(scenario->nodes[node_i]);
+      coordinate_copy (&(checkpoint->positions[node_i]), &(node->position));
+      for (interf_j = 0; interf_j < node->if_num; interf_j++)
+	{
+	  checkpoint->orientations[orientation_i++] =
+	    node->interfaces[interf_j].azimuth_orientation;
+	  checkpoint->orientations[orientation_i++] =
+	    node->interfaces[interf_j].elevation_orientation;
+	}
+    }
+
+  for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+    motion_save_state (&(scenario->motions[motion_i]),
+		       &(checkpoint->motion_states[motion_i]));
+
+  return SUCCESS;
+}
+
+// restore the state of all nodes and motions saved in 'checkpoint'
+static void
+checkpoint_restore (struct scenario_class *scenario,
+		    struct scenario_checkpoint_class *checkpoint)
+{
+  struct node_class *node;
+  int node_i, interf_j, motion_i, orientation_i = 0;
+
+  for (node_i = 0; node_i < scenario->node_number; node_i++)
+    {
+      node = &(scenario->nodes[node_i]);
+      coordinate_copy (&(node->position), &(checkpoint->positions[node_i]));
+      for (interf_j = 0; interf_j < node->if_num; interf_j++)
+	{
+	  node->interfaces[interf_j].azimuth_orientation =
+	    checkpoint->orientations[orientation_i++];
+	  node->interfaces[interf_j].elevation_orientation =
+	    checkpoint->orientations[orientation_i++];
+	}
+    }
+
+  for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+    motion_restore_state (&(scenario->motions[motion_i]),
+			  &(checkpoint->motion_states[motion_i]));
+}
+
+// add a checkpoint of the current state before step 'step_i';
+// return SUCCESS on succes, ERROR on error
+static int
+scenario_add_motion_checkpoint (struct scenario_class *scenario, long step_i)
+{
+  if (scenario->motion_checkpoints == NULL)
+    {
+      scenario->motion_checkpoints = (struct scenario_checkpoint_class *)
+	calloc (MAX_MOTION_CHECKPOINTS,
+		sizeof (struct scenario_checkpoint_class));
+      if (scenario->motion_checkpoints == NULL)
+	{
+	  WARNING ("Cannot allocate memory for motion checkpoints");
+	  return ERROR;
+	}
+    }
+
+  if (scenario->motion_checkpoint_number >= MAX_MOTION_CHECKPOINTS)
+    return SUCCESS;
+
+  if (checkpoint_save (scenario, &(scenario->motion_checkpoints
+				   [scenario->motion_checkpoint_number]),
+		       step_i) == ERROR)
+    return ERROR;
+  scenario->motion_checkpoint_number++;
+
+  return SUCCESS;
+}
+
+// check whether the motions of the scenario can be evaluated in
+// closed form: all motions must have a closed form, and the motions
+// whose effect depends on the current node position (all but plain
+// linear motions and rotations) must not overlap in time with other
+// motions that change the position of the same node;
+// return TRUE if they can, FALSE otherwise
+static int
+scenario_motions_closed_form (struct scenario_class *scenario)
+{
+  struct motion_class *motion1, *motion2;
+  int motion_i, motion_j;
+
+  for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+    if (motion_has_closed_form (&(scenario->motions[motion_i])) == FALSE)
+      return FALSE;
+
+  for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+    {
+      motion1 = &(scenario->motions[motion_i]);
+      if (motion_changes_position (motion1) == FALSE
+	  || (motion1->type == LINEAR_MOTION
+	      && motion1->speed_from_destination == FALSE))
+	continue;
+
+      for (motion_j = 0; motion_j < scenario->motion_number; motion_j++)
+	{
+	  motion2 = &(scenario->motions[motion_j]);
+	  if (motion_j != motion_i
+	      && motion2->node_index == motion1->node_index
+	      && motion_changes_position (motion2) == TRUE
+	      && motion2->start_time < motion1->stop_time
+	      && motion1->start_time < motion2->stop_time)
+	    return FALSE;
+	}
+    }
+
+  return TRUE;
+}
+
+// order motions by start time (and by index for equal start times)
+static __thread struct motion_class *sort_motions;
+static int
+compare_motion_start (const void *index1, const void *index2)
+{
+  int motion_i = *((const int *) index1), motion_j = *((const int *) index2);
+
+  if (sort_motions[motion_i].start_time < sort_motions[motion_j].start_time)
+    return -1;
+  if (sort_motions[motion_i].start_time > sort_motions[motion_j].start_time)
+    return 1;
+  return motion_i - motion_j;
+}
+
+// move nodes to the state they have at 'time', as if all the motion
+// sub-steps of 'grid' earlier than 'time' were applied from the
+// initial state; motions with closed form are evaluated directly,
+// and the others are replayed from the latest saved checkpoint;
+// the first call must be made while nodes are in their initial state;
+// return SUCCESS on succes, ERROR on error
+int
+scenario_motion_seek (struct scenario_class *scenario,
+		      struct motion_grid_class *grid, double time)
+{
+  struct scenario_checkpoint_class *checkpoint;
+  int *motion_order;
+  int motion_i, checkpoint_i;
+  long step_i;
+
+  // the initial state is always the first checkpoint
+  if (scenario->motion_checkpoint_number == 0)
+    if (scenario_add_motion_checkpoint (scenario, 0) == ERROR)
+      return ERROR;
+
+  if (scenario_motions_closed_form (scenario) == TRUE)
+    {
+      INFO ("Evaluating motions in closed form at time %.3f", time);
+      checkpoint_restore (scenario, &(scenario->motion_checkpoints[0]));
+
+      // motions of the same node that change its position do not
+      // overlap, so applying them in start time order gives the
+      // same positions as applying them step by step
+      motion_order =
+	(int *) malloc ((scenario->motion_number + 1) * sizeof (int));
+      if (motion_order == NULL)
+	{
+	  WARNING ("Cannot allocate memory for motion order");
+	  return ERROR;
+	}
+      for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+	motion_order[motion_i] = motion_i;
+      sort_motions = scenario->motions;
+      qsort (motion_order, scenario->motion_number, sizeof (int),
+	     compare_motion_start);
+
+      for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+	if (motion_apply_closed_form (&(scenario->motions
+					[motion_order[motion_i]]),
+				      scenario, grid, time) == ERROR)
+	  {
+	    free (motion_order);
+	    return ERROR;
+	  }
+
+      free (motion_order);
+      return SUCCESS;
+    }
+
+  // replay motions from the latest checkpoint before 'time'
+  checkpoint = &(scenario->motion_checkpoints[0]);
+  for (checkpoint_i = 1; checkpoint_i < scenario->motion_checkpoint_number;
+       checkpoint_i++)
+    if (motion_grid_step_time (grid, scenario->motion_checkpoints
+			       [checkpoint_i].step_i) < time
+	&& scenario->motion_checkpoints[checkpoint_i].step_i >
+	checkpoint->step_i)
+      checkpoint = &(scenario->motion_checkpoints[checkpoint_i]);
+
+  INFO ("Replaying motions from time %.3f to time %.3f",
+	motion_grid_step_time (grid, checkpoint->step_i), time);
+  checkpoint_restore (scenario, checkpoint);
+
+  for (step_i = checkpoint->step_i;
+       motion_grid_step_time (grid, step_i) < time
+       && motion_grid_step_time (grid, step_i) <= grid->stop_time + EPSILON;
+       step_i++)
+    {
+      // save checkpoints periodically, so that later seeks
+      // do not need to start from the beginning
+      if (step_i > checkpoint->step_i
+	  && step_i % MOTION_CHECKPOINT_STEPS == 0
+	  && step_i > scenario->motion_checkpoints
+	  [scenario->motion_checkpoint_number - 1].step_i)
+	if (scenario_add_motion_checkpoint (scenario, step_i) == ERROR)
+	  return ERROR;
+
+      if (scenario_apply_motions (scenario, grid, step_i, time) == ERROR)
 	return ERROR;
     }
 
   return SUCCESS;
 }
 
+// release the motion checkpoints of a scenario
+void
+scenario_free_motion_checkpoints (struct scenario_class *scenario)
+{
+  int checkpoint_i;
+
+  for (checkpoint_i = 0; checkpoint_i < scenario->motion_checkpoint_number;
+       checkpoint_i++)
+    {
+      free (scenario->motion_checkpoints[checkpoint_i].positions);
+      free (scenario->motion_checkpoints[checkpoint_i].orientations);
+      free (scenario->motion_checkpoints[checkpoint_i].motion_states);
+    }
+  free (scenario->motion_checkpoints);
+
+  scenario->motion_checkpoints = NULL;
+  scenario->motion_checkpoint_number = 0;
+}
+
+// make random-walk and behavioral motions draw from random states
+// of their own instead of the shared random state
+void
+scenario_use_motion_rand_states (struct scenario_class *scenario)
+{
+  int motion_i;
+
+  for (motion_i = 0; motion_i < scenario->motion_number; motion_i++)
+    scenario->motions[motion_i].own_rand_state = TRUE;
+}
+
 // reset the interference_accounted flag for all nodes
 void
 scenario_reset_node_interference_flag (struct scenario_class *scenario)
@@ -883,6 +1455,14 @@ scenario_reset_node_interference_flag (struct scenario_class *scenario)
   int node_i, interf_j;
   struct node_class *node;
 
+  // threads computing in parallel only reset their own flags
+  if (crt_worker != NULL)
+    {
+      memset (crt_worker->interference_accounted, FALSE,
+	      scenario->node_number * MAX_INTERFACES);
+      return;
+    }
+
   // for all the nodes and all the interfaces, reset interference flag
   for (node_i = 0; node_i < scenario->node_number; node_i++)
     {
@@ -892,6 +1472,95 @@ scenario_reset_node_interference_flag (struct scenario_class *scenario)
     }
 }
 
+// check whether the interference of an interface was already accounted;
+// return TRUE if it was, FALSE otherwise
+int
+scenario_interference_accounted (struct scenario_class *scenario,
+				 int node_i, int interf_j)
+{
+  if (crt_worker != NULL)
+    return crt_worker->interference_accounted[node_i * MAX_INTERFACES +
+					      interf_j];
+  else
+    return scenario->nodes[node_i].interfaces[interf_j].
+      interference_accounted;
+}
+
+// mark the interference of an interface as accounted
+void
+scenario_set_interference_accounted (struct scenario_class *scenario,
+				     int node_i, int interf_j)
+{
+  if (crt_worker != NULL)
+    crt_worker->interference_accounted[node_i * MAX_INTERFACES + interf_j] =
+      TRUE;
+  else
+    scenario->nodes[node_i].interfaces[interf_j].interference_accounted =
+      TRUE;
+}
+
+// return the connection with index 'connection_i' as it should be
+// seen when computing the interference it causes to other connections
+struct connection_class *
+scenario_interfering_connection (struct scenario_class *scenario,
+				 int connection_i)
+{
+  if (scenario->interfering_connections != NULL)
+    return &(scenario->interfering_connections[connection_i]);
+  else
+    return &(scenario->connections[connection_i]);
+}
+
+
+/////////////////////////////////////////
+// Parallel computation workers
+/////////////////////////////////////////
+
+// init the private state of a thread;
+// return SUCCESS on succes, ERROR on error
+int
+scenario_worker_init (struct scenario_worker_class *worker)
+{
+  worker->interference_accounted =
+    (char *) calloc (MAX_NODES * MAX_INTERFACES, sizeof (char));
+  if (worker->interference_accounted == NULL)
+    {
+      WARNING ("Cannot allocate memory for worker interference flags");
+      return ERROR;
+    }
+  worker->rand_state = 1;
+
+  return SUCCESS;
+}
+
+// make the current thread use the private state of 'worker' (or the
+// shared state if 'worker' is NULL)
+void
+scenario_worker_attach (struct scenario_worker_class *worker)
+{
+  crt_worker = worker;
+  generic_set_rand_state ((worker != NULL) ? &(worker->rand_state) : NULL);
+}
+
+// prepare the private state of a thread for computing the connection
+// with index 'connection_i'
+void
+scenario_worker_seed (struct scenario_worker_class *worker,
+		      int connection_i)
+{
+  // spread consecutive indexes over the state space
+  // (multiplicative hashing with the golden ratio)
+  worker->rand_state = 1 + (unsigned int) connection_i * 2654435761u;
+}
+
+// release the private state of a thread
+void
+scenario_worker_free (struct scenario_worker_class *worker)
+{
+  free (worker->interference_accounted);
+  worker->interference_accounted = NULL;
+}
+
 // try to merge an object specified by index 'merge_object_i' to other
 // objects in scenario; 
 // return TRUE if a merge operation was performed, FALSE otherwise
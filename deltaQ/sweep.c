@@ -0,0 +1,622 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: sweep.c
+ * Function: Parameter sweeps over variants of a scenario
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <math.h>
+
+#include "sweep.h"
+#include "generic.h"
+#include "message.h"
+#include "wlan.h"
+#include "active_tag.h"
+#include "zigbee.h"
+
+
+// maximum number of components of an override path
+#define MAX_PATH_COMPONENTS             5
+
+// number of variants for which memory is initially allocated
+#define SWEEP_INITIAL_VARIANTS          16
+
+
+////////////////////////////////////////////////
+// Local functions
+////////////////////////////////////////////////
+
+// check whether a variant name can be used in file names;
+// return TRUE if valid, FALSE otherwise
+static int
+variant_name_valid (char *name)
+{
+  int i;
+
+  for (i = 0; name[i] != '\0'; i++)
+    if (!isalnum ((unsigned char) name[i]) && name[i] != '_'
+	&& name[i] != '-')
+      return FALSE;
+
+  return TRUE;
+}
+
+// check whether 'name' matches 'pattern' (a name or the wildcard);
+// return TRUE if it does, FALSE otherwise
+static int
+name_matches (char *pattern, char *name)
+{
+  return (strcmp (pattern, SWEEP_WILDCARD_STRING) == 0
+	  || strcmp (pattern, name) == 0);
+}
+
+// split 'path' into at most MAX_PATH_COMPONENTS components separated
+// by '.'; return the number of components, or ERROR on error
+static int
+split_path (char *path, char components[][MAX_STRING])
+{
+  char path_copy[MAX_STRING];
+  char *token, *save_pointer;
+  int component_number = 0;
+
+  strncpy (path_copy, path, MAX_STRING - 1);
+  path_copy[MAX_STRING - 1] = '\0';
+
+  for (token = strtok_r (path_copy, ".", &save_pointer); token != NULL;
+       token = strtok_r (NULL, ".", &save_pointer))
+    {
+      if (component_number == MAX_PATH_COMPONENTS)
+	return ERROR;
+      strncpy (components[component_number], token, MAX_STRING - 1);
+      components[component_number][MAX_STRING - 1] = '\0';
+      component_number++;
+    }
+
+  return component_number;
+}
+
+// convert a standard name used in scenario files to its code;
+// return the code on success, ERROR on error
+static int
+standard_value (char *string)
+{
+  if (strcmp (string, CONNECTION_STANDARD_802_11B_STRING) == 0)
+    return WLAN_802_11B;
+  else if (strcmp (string, CONNECTION_STANDARD_802_11G_STRING) == 0)
+    return WLAN_802_11G;
+  else if (strcmp (string, CONNECTION_STANDARD_802_11A_STRING) == 0)
+    return WLAN_802_11A;
+  else if (strcmp (string, CONNECTION_STANDARD_ETH_10_STRING) == 0)
+    return ETHERNET_10;
+  else if (strcmp (string, CONNECTION_STANDARD_ETH_100_STRING) == 0)
+    return ETHERNET_100;
+  else if (strcmp (string, CONNECTION_STANDARD_ETH_1000_STRING) == 0)
+    return ETHERNET_1000;
+  else if (strcmp (string, CONNECTION_STANDARD_ACTIVE_TAG_STRING) == 0)
+    return ACTIVE_TAG;
+  else if (strcmp (string, CONNECTION_STANDARD_ZIGBEE_STRING) == 0)
+    return ZIGBEE;
+  else if (strcmp (string, CONNECTION_STANDARD_802_16_STRING) == 0)
+    return WIMAX_802_16;
+
+  return ERROR;
+}
+
+// apply an override to the interfaces matching 'node_name' and
+// 'interface_name'; return the number of modified interfaces,
+// or ERROR on error
+static int
+override_interfaces (struct scenario_class *scenario, char *node_name,
+		     char *interface_name, char *parameter, char *value)
+{
+  struct interface_class *interface;
+  double double_result;
+  int node_i, interf_j;
+  int match_number = 0;
+
+  double_result = double_value (value);
+  if (double_result == -HUGE_VAL)
+    return ERROR;
+
+  for (node_i = 0; node_i < scenario->node_number; node_i++)
+    {
+      if (name_matches (node_name, scenario->nodes[node_i].name) == FALSE)
+	continue;
+
+      for (interf_j = 0; interf_j < scenario->nodes[node_i].if_num;
+	   interf_j++)
+	{
+	  interface = &(scenario->nodes[node_i].interfaces[interf_j]);
+	  if (name_matches (interface_name, interface->name) == FALSE)
+	    continue;
+
+	  if (strcmp (parameter, INTERFACE_PT_STRING) == 0)
+	    interface->Pt = double_result;
+	  else if (strcmp (parameter, INTERFACE_ANTENNA_GAIN_STRING) == 0)
+	    interface->antenna_gain = double_result;
+	  else if (strcmp (parameter,
+			   INTERFACE_AZIMUTH_ORIENTATION_STRING) == 0)
+	    interface->azimuth_orientation = double_result;
+	  else if (strcmp (parameter, INTERFACE_AZIMUTH_BEAMWIDTH_STRING) == 0)
+	    interface->azimuth_beamwidth = double_result;
+	  else if (strcmp (parameter,
+			   INTERFACE_ELEVATION_ORIENTATION_STRING) == 0)
+	    interface->elevation_orientation = double_result;
+	  else if (strcmp (parameter,
+			   INTERFACE_ELEVATION_BEAMWIDTH_STRING) == 0)
+	    interface->elevation_beamwidth = double_result;
+	  else
+	    {
+	      WARNING ("Interface parameter '%s' cannot be overridden",
+		       parameter);
+	      return ERROR;
+	    }
+
+	  // update the Pr0 field of the interface, as done
+	  // when the scenario is parsed
+	  wlan_interface_update_Pr0 (interface);
+	  active_tag_interface_update_Pr0 (interface);
+	  zigbee_interface_update_Pr0 (interface);
+
+	  match_number++;
+	}
+    }
+
+  return match_number;
+}
+
+// apply an override to the connections from nodes matching
+// 'from_node_name' to nodes matching 'to_node_name'; return the
+// number of modified connections, or ERROR on error
+static int
+override_connections (struct scenario_class *scenario, char *from_node_name,
+		      char *to_node_name, char *parameter, char *value)
+{
+  struct connection_class *connection;
+  long int long_int_result = 0;
+  int standard = ERROR;
+  int connection_i;
+  int match_number = 0;
+
+  if (strcmp (parameter, CONNECTION_STANDARD_STRING) == 0)
+    {
+      standard = standard_value (value);
+      if (standard == ERROR)
+	{
+	  WARNING ("Invalid connection standard '%s'", value);
+	  return ERROR;
+	}
+    }
+  else if (strcmp (parameter, CONNECTION_CHANNEL_STRING) == 0
+	   || strcmp (parameter, CONNECTION_PACKET_SIZE_STRING) == 0
+	   || strcmp (parameter, CONNECTION_RTS_CTS_THRESHOLD_STRING) == 0)
+    {
+      long_int_result = long_int_value (value);
+      if (long_int_result == LONG_MIN)
+	return ERROR;
+
+      if ((strcmp (parameter, CONNECTION_CHANNEL_STRING) == 0
+	   && (long_int_result < MIN_CHANNEL
+	       || long_int_result > MAX_CHANNEL))
+	  || (strcmp (parameter, CONNECTION_PACKET_SIZE_STRING) == 0
+	      && (long_int_result < 0 || long_int_result > INT_MAX))
+	  || (strcmp (parameter, CONNECTION_RTS_CTS_THRESHOLD_STRING) == 0
+	      && (long_int_result < 0
+		  || long_int_result > MAX_PSDU_SIZE_AG)))
+	{
+	  WARNING ("Invalid value '%s' for connection parameter '%s'",
+		   value, parameter);
+	  return ERROR;
+	}
+    }
+  else
+    {
+      WARNING ("Connection parameter '%s' cannot be overridden", parameter);
+      return ERROR;
+    }
+
+  for (connection_i = 0; connection_i < scenario->connection_number;
+       connection_i++)
+    {
+      connection = &(scenario->connections[connection_i]);
+      if (name_matches (from_node_name,
+			scenario->nodes[connection->from_node_index].name)
+	  == FALSE
+	  || name_matches (to_node_name,
+			   scenario->nodes[connection->to_node_index].name)
+	  == FALSE)
+	continue;
+
+      // the standard also resets the operating rate; the channel
+      // is kept, so it should be overridden as well if needed
+      if (standard != ERROR)
+	{
+	  if (connection_init_standard (connection, standard) == ERROR)
+	    return ERROR;
+	}
+      else if (strcmp (parameter, CONNECTION_CHANNEL_STRING) == 0)
+	connection->channel = (int) long_int_result;
+      else if (strcmp (parameter, CONNECTION_PACKET_SIZE_STRING) == 0)
+	connection->packet_size = (int) long_int_result;
+      else
+	connection->RTS_CTS_threshold = (int) long_int_result;
+
+      match_number++;
+    }
+
+  return match_number;
+}
+
+// apply an override to the environments matching 'environment_name';
+// return the number of modified environments, or ERROR on error
+static int
+override_environments (struct scenario_class *scenario,
+		       char *environment_name, char *parameter, char *value)
+{
+  struct environment_class *environment;
+  double *values;
+  double double_result;
+  int environment_i, segment_i;
+  int match_number = 0;
+
+  double_result = double_value (value);
+  if (double_result == -HUGE_VAL)
+    return ERROR;
+
+  for (environment_i = 0; environment_i < scenario->environment_number;
+       environment_i++)
+    {
+      environment = &(scenario->environments[environment_i]);
+      if (name_matches (environment_name, environment->name) == FALSE)
+	continue;
+
+      // the parameters of dynamic environments are
+      // computed from objects at each step
+      if (environment->is_dynamic == TRUE)
+	{
+	  WARNING ("Parameters of dynamic environment '%s' cannot be \
+overridden", environment->name);
+	  return ERROR;
+	}
+
+      if (strcmp (parameter, ENVIRONMENT_ALPHA_STRING) == 0)
+	values = environment->alpha;
+      else if (strcmp (parameter, ENVIRONMENT_SIGMA_STRING) == 0)
+	values = environment->sigma;
+      else if (strcmp (parameter, ENVIRONMENT_W_STRING) == 0)
+	values = environment->W;
+      else if (strcmp (parameter, ENVIRONMENT_NOISE_POWER_STRING) == 0)
+	values = environment->noise_power;
+      else
+	{
+	  WARNING ("Environment parameter '%s' cannot be overridden",
+		   parameter);
+	  return ERROR;
+	}
+
+      for (segment_i = 0; segment_i < environment->num_segments; segment_i++)
+	values[segment_i] = double_result;
+
+      match_number++;
+    }
+
+  return match_number;
+}
+
+// apply an override to a scenario;
+// return SUCCESS on succes, ERROR on error
+static int
+apply_override (struct sweep_override_class *override,
+		struct scenario_class *scenario)
+{
+  char components[MAX_PATH_COMPONENTS][MAX_STRING];
+  int component_number, match_number;
+
+  component_number = split_path (override->path, components);
+
+  if (component_number == 4 && strcmp (components[0], INTERFACE_STRING) == 0)
+    match_number = override_interfaces (scenario, components[1],
+					components[2], components[3],
+					override->value);
+  else if (component_number == 4
+	   && strcmp (components[0], CONNECTION_STRING) == 0)
+    match_number = override_connections (scenario, components[1],
+					 components[2], components[3],
+					 override->value);
+  else if (component_number == 3
+	   && strcmp (components[0], ENVIRONMENT_STRING) == 0)
+    match_number = override_environments (scenario, components[1],
+					  components[2], override->value);
+  else
+    {
+      WARNING ("Invalid override path '%s' (must be 'interface.<node>.\
+<interface>.<parameter>', 'connection.<from_node>.<to_node>.<parameter>' \
+or 'environment.<environment>.<parameter>')", override->path);
+      return ERROR;
+    }
+
+  if (match_number == ERROR)
+    {
+      WARNING ("Cannot apply override '%s=%s'", override->path,
+	       override->value);
+      return ERROR;
+    }
+
+  // a misspelled name would otherwise silently leave
+  // the variant equal to the base scenario
+  if (match_number == 0)
+    {
+      WARNING ("Override path '%s' matches no scenario element",
+	       override->path);
+      return ERROR;
+    }
+
+  return SUCCESS;
+}
+
+// add to a sweep the variant described by 'line';
+// return SUCCESS on succes, ERROR on error
+static int
+add_variant (struct sweep_class *sweep, char *line)
+{
+  struct sweep_variant_class *variant, *variants;
+  struct sweep_override_class *override;
+  char *token, *separator, *save_pointer;
+  int variant_i;
+
+  if (sweep->variant_number == MAX_SWEEP_VARIANTS)
+    {
+      WARNING ("Too many variants in sweep (maximum %d)", MAX_SWEEP_VARIANTS);
+      return ERROR;
+    }
+
+  // variants are allocated by doubling the current number
+  if (sweep->variant_number >= SWEEP_INITIAL_VARIANTS
+      && (sweep->variant_number & (sweep->variant_number - 1)) == 0)
+    {
+      variants = (struct sweep_variant_class *)
+	realloc (sweep->variants, 2 * sweep->variant_number *
+		 sizeof (struct sweep_variant_class));
+      if (variants == NULL)
+	{
+	  WARNING ("Cannot allocate memory for sweep variants");
+	  return ERROR;
+	}
+      sweep->variants = variants;
+    }
+
+  variant = &(sweep->variants[sweep->variant_number]);
+  memset (variant, 0, sizeof (struct sweep_variant_class));
+
+  token = strtok_r (line, " \t\r\n", &save_pointer);
+  if (strlen (token) >= MAX_STRING || variant_name_valid (token) == FALSE)
+    {
+      WARNING ("Invalid variant name '%s' (only letters, digits, '_' and \
+'-' can be used)", token);
+      return ERROR;
+    }
+  strcpy (variant->name, token);
+
+  for (variant_i = 0; variant_i < sweep->variant_number; variant_i++)
+    if (strcmp (sweep->variants[variant_i].name, variant->name) == 0)
+      {
+	WARNING ("Variant '%s' is defined more than once", variant->name);
+	return ERROR;
+      }
+
+  while ((token = strtok_r (NULL, " \t\r\n", &save_pointer)) != NULL)
+    {
+      separator = strchr (token, '=');
+      if (separator == NULL || separator == token || separator[1] == '\0'
+	  || separator - token >= MAX_STRING
+	  || strlen (separator + 1) >= MAX_STRING)
+	{
+	  WARNING ("Invalid override '%s' of variant '%s' (must be \
+<path>=<value>)", token, variant->name);
+	  return ERROR;
+	}
+
+      if (variant->override_number == MAX_SWEEP_OVERRIDES)
+	{
+	  WARNING ("Too many overrides for variant '%s' (maximum %d)",
+		   variant->name, MAX_SWEEP_OVERRIDES);
+	  return ERROR;
+	}
+
+      override = &(variant->overrides[variant->override_number++]);
+      strncpy (override->path, token, separator - token);
+      override->path[separator - token] = '\0';
+      strcpy (override->value, separator + 1);
+    }
+
+  sweep->variant_number++;
+
+  return SUCCESS;
+}
+
+
+////////////////////////////////////////////////
+// Sweep functions
+////////////////////////////////////////////////
+
+// read the variants of a sweep from file 'filename'; each line
+// contains a variant name followed by 'path=value' overrides
+// separated by blanks; empty lines and lines starting with '#'
+// are ignored; return SUCCESS on succes, ERROR on error
+int
+sweep_read (struct sweep_class *sweep, char *filename)
+{
+  FILE *file;
+  char *line = NULL;
+  size_t line_size = 0;
+  int line_i = 0;
+  int result = SUCCESS;
+
+  memset (sweep, 0, sizeof (struct sweep_class));
+
+  sweep->variants = (struct sweep_variant_class *)
+    malloc (SWEEP_INITIAL_VARIANTS * sizeof (struct sweep_variant_class));
+  if (sweep->variants == NULL)
+    {
+      WARNING ("Cannot allocate memory for sweep variants");
+      return ERROR;
+    }
+
+  file = fopen (filename, "r");
+  if (file == NULL)
+    {
+      WARNING ("Cannot open sweep file '%s'!", filename);
+      sweep_free (sweep);
+      return ERROR;
+    }
+
+  while (result == SUCCESS && getline (&line, &line_size, file) != -1)
+    {
+      line_i++;
+
+      if (line[strspn (line, " \t\r\n")] == '\0'
+	  || line[strspn (line, " \t")] == '#')
+	continue;
+
+      if (add_variant (sweep, line) == ERROR)
+	{
+	  WARNING ("Error in line %d of sweep file '%s'", line_i, filename);
+	  result = ERROR;
+	}
+    }
+
+  free (line);
+  fclose (file);
+
+  if (result == SUCCESS && sweep->variant_number == 0)
+    {
+      WARNING ("No variant defined in sweep file '%s'", filename);
+      result = ERROR;
+    }
+
+  if (result == ERROR)
+    sweep_free (sweep);
+
+  return result;
+}
+
+// save the state of the initialized scenario 'base', from which all
+// variants start; return SUCCESS on succes, ERROR on error
+int
+sweep_set_base (struct sweep_class *sweep, struct scenario_class *base)
+{
+  sweep->base = base;
+
+  sweep->nodes = (struct node_class *)
+    malloc ((base->node_number + 1) * sizeof (struct node_class));
+  sweep->environments = (struct environment_class *)
+    malloc ((base->environment_number + 1) *
+	    sizeof (struct environment_class));
+  sweep->motions = (struct motion_class *)
+    malloc ((base->motion_number + 1) * sizeof (struct motion_class));
+  sweep->connections = (struct connection_class *)
+    malloc ((base->connection_number + 1) * sizeof (struct connection_class));
+  if (sweep->nodes == NULL || sweep->environments == NULL
+      || sweep->motions == NULL || sweep->connections == NULL)
+    {
+      WARNING ("Cannot allocate memory for the base scenario of the sweep");
+      return ERROR;
+    }
+
+  memcpy (sweep->nodes, base->nodes,
+	  base->node_number * sizeof (struct node_class));
+  memcpy (sweep->environments, base->environments,
+	  base->environment_number * sizeof (struct environment_class));
+  memcpy (sweep->motions, base->motions,
+	  base->motion_number * sizeof (struct motion_class));
+  memcpy (sweep->connections, base->connections,
+	  base->connection_number * sizeof (struct connection_class));
+
+  return SUCCESS;
+}
+
+// copy the objects of the base scenario to 'scenario', so that
+// variants can also be computed in a scenario other than the base
+void
+sweep_copy_objects (struct sweep_class *sweep,
+		    struct scenario_class *scenario)
+{
+  memcpy (scenario->objects, sweep->base->objects,
+	  sweep->base->object_number * sizeof (struct object_class));
+  scenario->object_number = sweep->base->object_number;
+}
+
+// restore in 'scenario' the saved state of the base scenario, and
+// apply the overrides of variant 'variant_i'; the objects of
+// 'scenario' must be those of the base;
+// return SUCCESS on succes, ERROR on error
+int
+sweep_prepare_variant (struct sweep_class *sweep, int variant_i,
+		       struct scenario_class *scenario)
+{
+  struct scenario_class *base = sweep->base;
+  struct sweep_variant_class *variant = &(sweep->variants[variant_i]);
+  int override_i;
+
+  memcpy (scenario->nodes, sweep->nodes,
+	  base->node_number * sizeof (struct node_class));
+  memcpy (scenario->environments, sweep->environments,
+	  base->environment_number * sizeof (struct environment_class));
+  memcpy (scenario->motions, sweep->motions,
+	  base->motion_number * sizeof (struct motion_class));
+  memcpy (scenario->connections, sweep->connections,
+	  base->connection_number * sizeof (struct connection_class));
+
+  scenario->node_number = base->node_number;
+  scenario->environment_number = base->environment_number;
+  scenario->motion_number = base->motion_number;
+  scenario->connection_number = base->connection_number;
+  scenario->if_num = base->if_num;
+
+  scenario->current_time = base->current_time;
+  scenario->thread_number = base->thread_number;
+  scenario->interfering_connections = NULL;
+  scenario->shadowing_deferred = FALSE;
+
+  // motion checkpoints depend on the motions of previous variants
+  scenario_free_motion_checkpoints (scenario);
+
+  for (override_i = 0; override_i < variant->override_number; override_i++)
+    if (apply_override (&(variant->overrides[override_i]), scenario) ==
+	ERROR)
+      {
+	WARNING ("Cannot prepare variant '%s'", variant->name);
+	return ERROR;
+      }
+
+  return SUCCESS;
+}
+
+// release the resources of a sweep
+void
+sweep_free (struct sweep_class *sweep)
+{
+  free (sweep->variants);
+  free (sweep->nodes);
+  free (sweep->environments);
+  free (sweep->motions);
+  free (sweep->connections);
+
+  memset (sweep, 0, sizeof (struct sweep_class));
+}
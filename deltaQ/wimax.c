@@ -555,8 +555,8 @@ wimax_connection_update (struct connection_class *connection,
 	    ((node_tx->interfaces[connection->from_interface_index].
 	      antenna_gain - antenna_dir_attenuation_tx) -
 	     10 * environment->alpha[0] * log10 (distance) -
-	     environment->W[0] + randn (0,
-					environment->sigma[0]) +
+	     environment->W[0] + connection_shadowing (connection, scenario,
+						       environment->sigma[0]) +
 	     (node_rx->interfaces[connection->to_interface_index].
 	      antenna_gain - antenna_dir_attenuation_rx));
 	}
@@ -629,7 +629,8 @@ wimax_connection_update (struct connection_class *connection,
 	  connection->Pr -= W_sum;
 
 	  // take into account shadowing
-	  connection->Pr += randn (0, sqrt (sigma_square_sum));
+	  connection->Pr += connection_shadowing (connection, scenario,
+						  sqrt (sigma_square_sum));
 
 	  DEBUG ("Pr=%f W_s=%f s_s_s=%f\n", connection->Pr,
 		 W_sum, sigma_square_sum);
@@ -31,6 +31,7 @@
 #include "message.h"
 #include "generic.h"
 #include "wlan.h"
+#include "link_table.h"
 
 
 //////////////////////////////////////////////////
@@ -258,7 +259,7 @@ wlan_connection_update (struct connection_class *connection, struct scenario_cla
              connection->Pr += ((node_tx->interfaces[connection->from_interface_index].antenna_gain - 
                         antenna_dir_attenuation_tx) - 
                         10 * environment->alpha[0] * log10(distance) - 
-                        environment->W[0] + randn (0, environment->sigma[0]) +
+                        environment->W[0] + connection_shadowing (connection, scenario, environment->sigma[0]) +
                         (node_rx->interfaces[connection->to_interface_index].antenna_gain - 
                          antenna_dir_attenuation_rx));
             }
@@ -334,7 +335,7 @@ wlan_connection_update (struct connection_class *connection, struct scenario_cla
             connection->Pr -= W_sum;
 
             // take into account shadowing
-            connection->Pr += randn(0, sqrt(sigma_square_sum));
+            connection->Pr += connection_shadowing(connection, scenario, sqrt(sigma_square_sum));
 
             DEBUG("Pr=%f W_s=%f s_s_s=%f\n", connection->Pr, W_sum, sigma_square_sum);
         }
@@ -418,7 +419,7 @@ compute_channel_interference (struct connection_class *connection,
     }
 
     // do not consider again this node if it was processed before
-    if(scenario->nodes[connection_i->from_node_index].interfaces[connection_i->from_interface_index].interference_accounted == TRUE) {
+    if(scenario_interference_accounted(scenario, connection_i->from_node_index, connection_i->from_interface_index) == TRUE) {
         INFO("Interference with node '%s' already accounted for", connection_i->from_node);
         return TRUE;
     }
@@ -432,7 +433,7 @@ compute_channel_interference (struct connection_class *connection,
     INFO("Building a virtual connection from '%s' to '%s'", connection_i->from_node, connection->to_node);
 
     // mark the interference_accounted flag
-    scenario->nodes[connection_i->from_node_index].interfaces[connection_i->from_interface_index].interference_accounted = TRUE;
+    scenario_set_interference_accounted(scenario, connection_i->from_node_index, connection_i->from_interface_index);
 
     connection_copy(&virtual_connection, connection_i);
     virtual_connection.to_node_index = connection->to_node_index;
@@ -603,7 +604,8 @@ wlan_interference(struct connection_class *connection, struct scenario_class *sc
     for(connection_i = 0; connection_i < scenario->connection_number; connection_i++) {
         // look only at connections that are not the same with
         // the current one
-        if(connection != &(scenario->connections[connection_i])) {
+        if(connection != &(scenario->connections[connection_i]) &&
+                connection != scenario_interfering_connection(scenario, connection_i)) {
             //printf("Found a different connection...\n");
             /*
                this will be used perhaps later for optimization purposes
@@ -641,7 +643,7 @@ wlan_interference(struct connection_class *connection, struct scenario_class *sc
                     INFO("Interference 'a' <-> 'a' detected => determine effects");
                 }
 
-                compute_channel_interference(connection, &(scenario->connections[connection_i]),scenario);
+                compute_channel_interference(connection, scenario_interfering_connection(scenario, connection_i), scenario);
             }
         }
     }
@@ -649,6 +651,81 @@ wlan_interference(struct connection_class *connection, struct scenario_class *sc
     return SUCCESS;
 }
 
+// compute the FER of model 1 (Pr-threshold based) for frames of
+// 'psdu_number' standard PSDU sizes, given the FER at the threshold
+// 'threshold_fer', the constant of the exponential dependency 'alpha'
+// and the 'margin' (in dB) between the threshold and the signal
+static double
+wlan_model1_fer(threshold_fer, alpha, margin, psdu_number)
+double threshold_fer;
+double alpha;
+double margin;
+int psdu_number;
+{
+    double fer;
+
+    fer = threshold_fer * exp(alpha * margin);
+
+    // this FER corresponds to the standard PSDU size,
+    // therefore needs to be adjusted for different packet sizes
+    return 1 - pow(1 - fer, psdu_number);
+}
+
+// parameters of model 1 used when building its link tables
+struct wlan_model1_class {
+    double threshold_fer;
+    double alpha;
+    int psdu_number;
+};
+
+// function tabulated by the link tables of model 1;
+// return SUCCESS on succes, ERROR on error
+static int
+wlan_model1_table_function(margin, context, values)
+double margin;
+void *context;
+double *values;
+{
+    struct wlan_model1_class *model = (struct wlan_model1_class *)context;
+
+    values[0] = wlan_model1_fer(model->threshold_fer, model->alpha, margin, model->psdu_number);
+
+    return SUCCESS;
+}
+
+// compute the FER of model 1 like 'wlan_model1_fer()'; if link
+// tables are enabled, the FER is interpolated from the table of
+// the model, which covers the margins for which the FER at the
+// threshold is scaled between LINK_TABLE_MIN_ERROR_RATE and 1
+static double
+wlan_model1_fer_lookup(threshold_fer, alpha, margin, psdu_number)
+double threshold_fer;
+double alpha;
+double margin;
+int psdu_number;
+{
+    if(link_table_enabled == TRUE && threshold_fer > 0 && alpha > 0) {
+        double key[LINK_TABLE_KEY_SIZE] = { threshold_fer, alpha, psdu_number };
+        struct link_table_class *table;
+        double fer;
+
+        table = link_table_find(LINK_TABLE_WLAN_FER, key);
+        if(table == NULL) {
+            struct wlan_model1_class model = { threshold_fer, alpha, psdu_number };
+
+            table = link_table_build(LINK_TABLE_WLAN_FER, key,
+                    log(LINK_TABLE_MIN_ERROR_RATE / threshold_fer) / alpha, -log(threshold_fer) / alpha,
+                    1, wlan_model1_table_function, &model);
+        }
+
+        if(table != NULL && link_table_lookup(table, margin, &fer) == TRUE) {
+            return fer;
+        }
+    }
+
+    return wlan_model1_fer(threshold_fer, alpha, margin, psdu_number);
+}
+
 // compute FER corresponding to the current conditions
 // for a given operating rate;
 // return SUCCESS on succes, ERROR on error
@@ -694,18 +771,14 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
 
         // use model 1 (Pr-threshold based) if enabled
         if(adapter_802_11b->use_model1 == TRUE) {
-            fer1 = adapter_802_11b->Pr_threshold_fer *
-                exp(adapter_802_11b->model1_alpha * (adapter_802_11b->Pr_thresholds[operating_rate] - connection->Pr));
+            fer1 = wlan_model1_fer_lookup(adapter_802_11b->Pr_threshold_fer, adapter_802_11b->model1_alpha,
+                    adapter_802_11b->Pr_thresholds[operating_rate] - connection->Pr,
+                    (connection->packet_size + header) / PSDU_DSSS);
         }
         else {
             fer1 = 0;
         }
 
-        // this FER corresponds to the standard value PSDU_DSSS,
-        // therefore needs to be adjusted for different packet sizes
-        //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_DSSS; INCORRECT
-        fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_DSSS);
-
         // limit error rate for numerical reasons
         if(fer1 > MAXIMUM_ERROR_RATE) {
             fer1 = MAXIMUM_ERROR_RATE;
@@ -812,14 +885,9 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
 
         // check whether model parameters were initialized
         if(adapter_802_11b->use_model1 == TRUE) {
-            fer1 = adapter_802_11b->Pr_threshold_fer *
-                exp(adapter_802_11b->model1_alpha * (adapter_802_11b->Pr_thresholds[operating_rate] -
-                connection->SNR - STANDARD_NOISE));
-
-            // this FER corresponds to the standard value PSDU_DSSS,
-            // therefore needs to be adjusted for different packet sizes
-            //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_DSSS; INCORRECT
-            fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_DSSS);
+            fer1 = wlan_model1_fer_lookup(adapter_802_11b->Pr_threshold_fer, adapter_802_11b->model1_alpha,
+                    adapter_802_11b->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE,
+                    (connection->packet_size + header) / PSDU_DSSS);
         }
         else {
             fer1 = 0;
@@ -848,25 +916,17 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
             if(operating_rate == 0 || operating_rate == 1 || operating_rate == 2 || operating_rate == 5) {
                 header = MAC_Overhead / 8;
 
-                fer1 = adapter_802_11g->Pr_threshold_fer * exp(adapter_802_11g->model1_alpha *
-                        (adapter_802_11g->Pr_thresholds[operating_rate] - connection->Pr));
-
-                // this FER corresponds to the standard value PSDU_DSSS,
-                // therefore needs to be adjusted for different packet sizes
-                //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_DSSS; INCORRECT
-                fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_DSSS);
+                fer1 = wlan_model1_fer_lookup(adapter_802_11g->Pr_threshold_fer, adapter_802_11g->model1_alpha,
+                        adapter_802_11g->Pr_thresholds[operating_rate] - connection->Pr,
+                        (connection->packet_size + header) / PSDU_DSSS);
             }
             else {
                 // add 2 for rounding purposes
                 header = (MAC_Overhead + OFDM_Overhead + 2) / 8;
 
-                fer1 = adapter_802_11g->Pr_threshold_per * exp (adapter_802_11g->model1_alpha *
-                        (adapter_802_11g->Pr_thresholds[operating_rate] - connection->Pr));
-
-                // this FER corresponds to the standard value PSDU_OFDM,
-                // therefore needs to be adjusted for different packet sizes
-                //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_OFDM; INCORRECT
-                fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_OFDM);
+                fer1 = wlan_model1_fer_lookup(adapter_802_11g->Pr_threshold_per, adapter_802_11g->model1_alpha,
+                        adapter_802_11g->Pr_thresholds[operating_rate] - connection->Pr,
+                        (connection->packet_size + header) / PSDU_OFDM);
             }
         }
         else {
@@ -919,13 +979,9 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
             if(operating_rate == 0 || operating_rate == 1 || operating_rate == 2 || operating_rate == 5) {
                 header = MAC_Overhead / 8;
 
-                fer1 = adapter_802_11g->Pr_threshold_fer * exp(adapter_802_11g->model1_alpha *
-                        (adapter_802_11g->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE));
-
-                // this FER corresponds to the standard value PSDU_DSSS,
-                // therefore needs to be adjusted for different packet sizes
-                //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_DSSS; INCORRECT
-                fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_DSSS);
+                fer1 = wlan_model1_fer_lookup(adapter_802_11g->Pr_threshold_fer, adapter_802_11g->model1_alpha,
+                        adapter_802_11g->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE,
+                        (connection->packet_size + header) / PSDU_DSSS);
             }
             else {
                 // compute Doppler shift only for OFDM operating rates
@@ -949,13 +1005,9 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
                 // continue with old code...
                 header = (MAC_Overhead + OFDM_Overhead + 2) / 8;
 
-                fer1 = adapter_802_11g->Pr_threshold_per * exp(adapter_802_11g->model1_alpha *
-                        (adapter_802_11g->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE));
-
-                // this FER corresponds to the standard value PSDU_OFDM,
-                // therefore needs to be adjusted for different packet sizes
-                //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_OFDM; INCORRECT
-                fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_OFDM);
+                fer1 = wlan_model1_fer_lookup(adapter_802_11g->Pr_threshold_per, adapter_802_11g->model1_alpha,
+                        adapter_802_11g->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE,
+                        (connection->packet_size + header) / PSDU_OFDM);
             }
         }
         else {
@@ -982,13 +1034,9 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
         // for 802.11a only this model is available for the moment
 
         if(adapter_802_11a->use_model1 == TRUE) {
-            fer1 = adapter_802_11a->Pr_threshold_per * exp(adapter_802_11a->model1_alpha * 
-                    (adapter_802_11a->Pr_thresholds[operating_rate] - connection->Pr));
-
-            // this FER corresponds to the standard value PSDU_OFDM,
-            // therefore needs to be adjusted for different packet sizes
-            //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_OFDM; INCORRECT
-            fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_OFDM);
+            fer1 = wlan_model1_fer_lookup(adapter_802_11a->Pr_threshold_per, adapter_802_11a->model1_alpha,
+                    adapter_802_11a->Pr_thresholds[operating_rate] - connection->Pr,
+                    (connection->packet_size + header) / PSDU_OFDM);
         }
         else {
             fer1 = 0; 
@@ -1056,13 +1104,9 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
             connection->SNR -= doppler_snr_value;
 
             // continue with old code...
-            fer1 = adapter_802_11a->Pr_threshold_per * exp (adapter_802_11a->model1_alpha *
-                    (adapter_802_11a->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE));
-
-            // this FER corresponds to the standard value PSDU_OFDM,
-            // therefore needs to be adjusted for different packet sizes
-            //fer1 = (fer1 * (connection->packet_size + header)) / PSDU_OFDM; INCORRECT
-            fer1 = 1 - pow(1 - fer1, (connection->packet_size + header) / PSDU_OFDM);
+            fer1 = wlan_model1_fer_lookup(adapter_802_11a->Pr_threshold_per, adapter_802_11a->model1_alpha,
+                    adapter_802_11a->Pr_thresholds[operating_rate] - connection->SNR - STANDARD_NOISE,
+                    (connection->packet_size + header) / PSDU_OFDM);
         }
         else {
             fer1 = 0;
@@ -1099,13 +1143,19 @@ wlan_fer(struct connection_class *connection, struct scenario_class *scenario, i
     return SUCCESS;
 }
 
-// compute the average number of retransmissions corresponding
-// to the current conditions for ALL frames (including errored ones);
+// values of the link tables of the MAC layer model
+#define WLAN_MAC_RETRANSMISSIONS        0
+#define WLAN_MAC_LOSS_RATE              1
+#define WLAN_MAC_DELAY                  2
+#define WLAN_MAC_JITTER                 3
+#define WLAN_MAC_VALUES                 4
+
+// compute the average number of retransmissions for the frame
+// error rate of 'connection' (see 'wlan_retransmissions()');
 // return SUCCESS on succes, ERROR on error
-int
-wlan_retransmissions(connection, scenario, num_retransmissions)
+static int
+wlan_do_compute_retransmissions(connection, num_retransmissions)
 struct connection_class *connection;
-struct scenario_class *scenario;
 double *num_retransmissions;
 {
     double FER = connection->frame_error_rate;
@@ -1133,6 +1183,78 @@ double *num_retransmissions;
     return SUCCESS;
 }
 
+// function tabulated by the link tables of the MAC layer model,
+// for which 'context' is a copy of the connection;
+// return SUCCESS on succes, ERROR on error
+static int
+wlan_mac_table_function(fer, context, values)
+double fer;
+void *context;
+double *values;
+{
+    struct connection_class *connection = (struct connection_class *)context;
+
+    connection->frame_error_rate = fer;
+
+    if(wlan_do_compute_retransmissions(connection, &(values[WLAN_MAC_RETRANSMISSIONS])) == ERROR ||
+            wlan_do_compute_loss_rate(connection, &(values[WLAN_MAC_LOSS_RATE])) == ERROR ||
+            wlan_do_compute_delay_jitter(connection, &(values[WLAN_MAC_DELAY]),
+                &(values[WLAN_MAC_JITTER]), 0.0) == ERROR) {
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+// interpolate from the link table of the MAC layer model the values
+// corresponding to the frame error rate of 'connection' (with no
+// channel utilization by others); the table depends on all the
+// parameters that determine the frame duration;
+// return TRUE if the values were interpolated, FALSE otherwise
+static int
+wlan_mac_lookup(connection, values)
+struct connection_class *connection;
+double *values;
+{
+    double key[LINK_TABLE_KEY_SIZE] = { connection->standard, connection->compatibility_mode,
+        connection->operating_rate, connection->packet_size,
+        connection->packet_size > connection->RTS_CTS_threshold };
+    struct link_table_class *table;
+
+    if(link_table_enabled == FALSE) {
+        return FALSE;
+    }
+
+    table = link_table_find(LINK_TABLE_WLAN_MAC, key);
+    if(table == NULL) {
+        struct connection_class table_connection = *connection;
+
+        table = link_table_build(LINK_TABLE_WLAN_MAC, key, 0, MAXIMUM_ERROR_RATE,
+                WLAN_MAC_VALUES, wlan_mac_table_function, &table_connection);
+    }
+
+    return (table != NULL && link_table_lookup(table, connection->frame_error_rate, values) == TRUE);
+}
+
+// compute the average number of retransmissions corresponding
+// to the current conditions for ALL frames (including errored ones);
+// return SUCCESS on succes, ERROR on error
+int
+wlan_retransmissions(connection, scenario, num_retransmissions)
+struct connection_class *connection;
+struct scenario_class *scenario;
+double *num_retransmissions;
+{
+    double values[WLAN_MAC_VALUES];
+
+    if(wlan_mac_lookup(connection, values) == TRUE) {
+        (*num_retransmissions) = values[WLAN_MAC_RETRANSMISSIONS];
+        return SUCCESS;
+    }
+
+    return wlan_do_compute_retransmissions(connection, num_retransmissions);
+}
+
 // compute loss rate based on FER;
 // return SUCCESS on succes, ERROR on error
 int
@@ -1141,11 +1263,18 @@ struct connection_class *connection;
 struct scenario_class *scenario;
 double *loss_rate;
 {
+    double values[WLAN_MAC_VALUES];
+
     if(wlan_fer(connection, scenario, connection->operating_rate, &(connection->frame_error_rate)) == ERROR) {
         WARNING("Error while computing frame error rate");
         return ERROR;
     }
 
+    if(wlan_mac_lookup(connection, values) == TRUE) {
+        (*loss_rate) = values[WLAN_MAC_LOSS_RATE];
+        return SUCCESS;
+    }
+
     if(wlan_do_compute_loss_rate(connection, loss_rate) == ERROR) {
         WARNING("Error while computing loss rate");
         return ERROR;
@@ -1470,8 +1599,16 @@ double *jitter;
     // mean weighted delay and jitter (in us)
     double D_avg, J_avg;
 
+    double values[WLAN_MAC_VALUES];
+
     // we assume in here that total channel utilization by others is 0.0
-    wlan_do_compute_delay_jitter(connection, &D_avg, &J_avg, 0.0);
+    if(wlan_mac_lookup(connection, values) == TRUE) {
+        D_avg = values[WLAN_MAC_DELAY];
+        J_avg = values[WLAN_MAC_JITTER];
+    }
+    else {
+        wlan_do_compute_delay_jitter(connection, &D_avg, &J_avg, 0.0);
+    }
 
     // compute & store the final values of delay & jitter
     if(connection->delay_defined == FALSE) {
@@ -31,6 +31,7 @@
 #include "message.h"
 #include "generic.h"
 #include "zigbee.h"
+#include "link_table.h"
 
 
 // since MAC emulation is not needed in connection with ORE and JLE,
@@ -122,8 +123,8 @@ zigbee_connection_update (struct connection_class *connection,
 	  connection->Pr =
 	    node_tx->interfaces[connection->from_interface_index].Pr0 -
 	    10 * environment->alpha[0] * log10 (distance) -
-	    environment->W[0] + randn (0,
-				       environment->sigma[0]) +
+	    environment->W[0] + connection_shadowing (connection, scenario,
+						      environment->sigma[0]) +
 	    node_rx->interfaces[connection->to_interface_index].antenna_gain;
 	}
       else			// dynamic environment
@@ -181,7 +182,8 @@ zigbee_connection_update (struct connection_class *connection,
 	  connection->Pr -= W_sum;
 
 	  // take into account shadowing
-	  connection->Pr += randn (0, sqrt (sigma_square_sum));
+	  connection->Pr += connection_shadowing (connection, scenario,
+						  sqrt (sigma_square_sum));
 
 	  DEBUG ("Pr=%f W_s=%f s_s_s=%f\n", connection->Pr,
 		 W_sum, sigma_square_sum);
@@ -231,10 +233,10 @@ zigbee_compute_channel_interference (struct connection_class *connection,
   void *adapter;
 
   // do not consider again this node if it was processed before
-  if (scenario->nodes
-      [connection_i->from_node_index].interfaces[connection_i->
-						 from_interface_index].
-      interference_accounted == TRUE)
+  if (scenario_interference_accounted (scenario,
+				       connection_i->from_node_index,
+				       connection_i->from_interface_index)
+      == TRUE)
     {
       INFO ("Interference with node '%s' already accounted for",
 	    connection_i->from_node);
@@ -251,9 +253,9 @@ zigbee_compute_channel_interference (struct connection_class *connection,
 	connection_i->from_node, connection->to_node);
 
   // mark the interference_accounted flag
-  scenario->nodes[connection_i->from_node_index].interfaces[connection_i->
-							    from_interface_index].
-    interference_accounted = TRUE;
+  scenario_set_interference_accounted (scenario,
+				       connection_i->from_node_index,
+				       connection_i->from_interface_index);
 
   connection_copy (&virtual_connection, connection_i);
   virtual_connection.to_node_index = connection->to_node_index;
@@ -379,7 +381,9 @@ zigbee_interference (struct connection_class *connection,
     {
       // look only at connections that are not the same with
       // the current one
-      if (connection != &(scenario->connections[connection_i]))
+      if (connection != &(scenario->connections[connection_i])
+	  && connection != scenario_interfering_connection (scenario,
+							    connection_i))
 	{
 	  //printf("Found a different connection...\n");
 	  /*
@@ -409,7 +413,8 @@ zigbee_interference (struct connection_class *connection,
 	      INFO ("Interference ZigBee <-> ZigBee detected => \
 determine effects");
 	      zigbee_compute_channel_interference
-		(connection, &(scenario->connections[connection_i]),
+		(connection,
+		 scenario_interfering_connection (scenario, connection_i),
 		 scenario);
 	    }
 	}
@@ -418,6 +423,84 @@ determine effects");
   return SUCCESS;
 }
 
+// compute the FER of model 1 (Pr-threshold based) for frames of
+// 'psdu_number' standard PSDU sizes, given the FER at the threshold
+// 'threshold_fer', the constant of the exponential dependency 'alpha'
+// and the 'margin' (in dB) between the threshold and the signal
+static double
+zigbee_model1_fer (double threshold_fer, double alpha, double margin,
+		   int psdu_number)
+{
+  double fer;
+
+  fer = threshold_fer * exp (alpha * margin);
+
+  // limit error rate for numerical reasons
+  if (fer > MAXIMUM_ERROR_RATE)
+    fer = MAXIMUM_ERROR_RATE;
+
+  // this FER corresponds to the standard value ZIGBEE_PSDU,
+  // therefore needs to be adjusted for different packet sizes
+  return 1 - pow (1 - fer, psdu_number);
+}
+
+// parameters of model 1 used when building its link tables
+struct zigbee_model1_class
+{
+  double threshold_fer;
+  double alpha;
+  int psdu_number;
+};
+
+// function tabulated by the link tables of model 1;
+// return SUCCESS on succes, ERROR on error
+static int
+zigbee_model1_table_function (double margin, void *context, double *values)
+{
+  struct zigbee_model1_class *model = (struct zigbee_model1_class *) context;
+
+  values[0] = zigbee_model1_fer (model->threshold_fer, model->alpha, margin,
+				 model->psdu_number);
+
+  return SUCCESS;
+}
+
+// compute the FER of model 1 like 'zigbee_model1_fer()'; if link
+// tables are enabled, the FER is interpolated from the table of
+// the model, which covers the margins for which the FER at the
+// threshold is scaled between LINK_TABLE_MIN_ERROR_RATE and
+// MAXIMUM_ERROR_RATE
+static double
+zigbee_model1_fer_lookup (double threshold_fer, double alpha, double margin,
+			  int psdu_number)
+{
+  if (link_table_enabled == TRUE && threshold_fer > 0 && alpha > 0)
+    {
+      double key[LINK_TABLE_KEY_SIZE] =
+	{ threshold_fer, alpha, psdu_number };
+      struct link_table_class *table;
+      double fer;
+
+      table = link_table_find (LINK_TABLE_ZIGBEE_FER, key);
+      if (table == NULL)
+	{
+	  struct zigbee_model1_class model =
+	    { threshold_fer, alpha, psdu_number };
+
+	  table = link_table_build
+	    (LINK_TABLE_ZIGBEE_FER, key,
+	     log (LINK_TABLE_MIN_ERROR_RATE / threshold_fer) / alpha,
+	     log (MAXIMUM_ERROR_RATE / threshold_fer) / alpha, 1,
+	     zigbee_model1_table_function, &model);
+	}
+
+      if (table != NULL && link_table_lookup (table, margin, &fer) == TRUE)
+	return fer;
+    }
+
+  return zigbee_model1_fer (threshold_fer, alpha, margin, psdu_number);
+}
+
 // compute FER corresponding to the current conditions
 // for a given operating rate;
 // return SUCCESS on succes, ERROR on error
@@ -482,28 +565,17 @@ zigbee_fer (struct connection_class *connection,
   // check whether model parameters were initialized
   if (adapter->use_model1 == TRUE)
     {
-      fer1 = adapter->Pr_threshold_fer *
-	exp (adapter->model1_alpha *
-	     (adapter->Pr_thresholds[operating_rate] -
-	      connection->SNR - ZIGBEE_STANDARD_NOISE));
-
-      // limit error rate for numerical reasons
-      if (fer1 > MAXIMUM_ERROR_RATE)
-	fer1 = MAXIMUM_ERROR_RATE;
+      fer1 = zigbee_model1_fer_lookup
+	(adapter->Pr_threshold_fer, adapter->model1_alpha,
+	 adapter->Pr_thresholds[operating_rate] - connection->SNR -
+	 ZIGBEE_STANDARD_NOISE,
+	 (connection->packet_size + header) / ZIGBEE_PSDU);
 
       DEBUG
-	("fer1=%f Pr_threshold_fer=%f model1_alpha=%f Pr_thresholds[operating_rate]=%f SNR=%f ZIGBEE_STANDARD_NOISE=%f",
-	 fer1, adapter->Pr_threshold_fer, adapter->model1_alpha,
+	("Pr_threshold_fer=%f model1_alpha=%f Pr_thresholds[operating_rate]=%f SNR=%f ZIGBEE_STANDARD_NOISE=%f",
+	 adapter->Pr_threshold_fer, adapter->model1_alpha,
 	 adapter->Pr_thresholds[operating_rate], connection->SNR,
 	 ZIGBEE_STANDARD_NOISE);
-
-      // this FER corresponds to the standard value ZIGBEE_PSDU,
-      // therefore needs to be adjusted for different packet sizes
-
-      //fer1 = (fer1 * (connection->packet_size + header)) / ZIGBEE_PSDU; INCORRECT
-      fer1 = 1
-	- pow (1 - fer1, (connection->packet_size + header) / ZIGBEE_PSDU);
-
       DEBUG ("after packet adaptation fer1=%f", fer1);
     }
   else
@@ -525,13 +597,19 @@ zigbee_fer (struct connection_class *connection,
   return SUCCESS;
 }
 
-// compute the average number of retransmissions corresponding 
-// to the current conditions for ALL frames (including errored ones);
+// values of the link tables of the MAC layer model
+#define ZIGBEE_MAC_RETRANSMISSIONS      0
+#define ZIGBEE_MAC_LOSS_RATE            1
+#define ZIGBEE_MAC_DELAY                2
+#define ZIGBEE_MAC_JITTER               3
+#define ZIGBEE_MAC_VALUES               4
+
+// compute the average number of retransmissions for the frame
+// error rate of 'connection' (see 'zigbee_retransmissions()');
 // return SUCCESS on succes, ERROR on error
-int
-zigbee_retransmissions (struct connection_class *connection,
-			struct scenario_class *scenario,
-			double *num_retransmissions)
+static int
+zigbee_do_compute_retransmissions (struct connection_class *connection,
+				   double *num_retransmissions)
 {
   double FER = connection->frame_error_rate;
   int i, r;
@@ -554,12 +632,195 @@ zigbee_retransmissions (struct connection_class *connection,
   return SUCCESS;
 }
 
+// compute the mean weighted delay and jitter (in us) for the frame
+// error rate of 'connection' (see 'zigbee_delay_jitter()');
+// return SUCCESS on succes, ERROR on error
+static int
+zigbee_do_compute_delay_jitter (struct connection_class *connection,
+				double *avg_delay, double *avg_jitter)
+{
+  // symbol duration in us [pp. 28] (from symbol rate)
+  int symbol_duration = 16;
+  int aUnitBackoffPeriod = 20 * symbol_duration;	// [pp. 159]
+
+  int slot_time = aUnitBackoffPeriod;
+
+  // values for delay and jitter corresponding to 'i' retransmissions (in us)
+  // NOTE: the jitter values depend on the average delay, therefore they change
+  //       with FER
+  double D[ZIGBEE_MAX_TRANSMISSIONS], J[ZIGBEE_MAX_TRANSMISSIONS];
+
+  // used to store temporarily a constant time duration
+  // used when calculating D
+  double constant_time;
+
+  ////////////////////////////////
+  // local constants
+
+  // maximum congestion window (assume no interference)
+  // if environment is busy CSMA/CA can be repeated ZIGBEE_MAX_CSMA_BACKOFFS
+  // times and CW increaseas up to 5
+  //e.g. congestion=0 => CWmax=3; congestion closer to 1 => CWmax = (3+4+5+5+5)
+  // very high congestion => failure and retransmit => MODEL!!!!!!!!!!!!!
+
+  int CW[ZIGBEE_MAX_TRANSMISSIONS] = { 3, 3, 3, 3 };
+
+  // loop variable
+  int i;
+
+  // number of retransmissions
+  int r;
+
+  // local storage for "connection->frame_error_rate"
+  double FER;
+
+  // mean weighted delay and jitter (in us)
+  double D_avg, J_avg;
+
+  // preliminary initializations
+  FER = connection->frame_error_rate;
+
+  r = ZIGBEE_MAX_TRANSMISSIONS - 1;
+
+  if (zigbee_ppdu_duration (connection, &constant_time) == ERROR)
+    {
+      WARNING ("Error calculating PPDU duration");
+      return ERROR;
+    }
+
+  DEBUG ("FRAME DURATION:   %f us", constant_time);
+
+  // compute the average delays for the number of retransmissions "i"
+  D[0] = constant_time + CW[0] * slot_time / 2.0;
+  for (i = 1; i <= r; i++)
+    D[i] = D[i - 1] + constant_time + CW[i] * slot_time / 2.0;
+
+  DEBUG ("__D[0:%d]: %f %f %f %f\n", r, D[0], D[1], D[2], D[3]);
+
+  // compute the weighted mean delay
+  D_avg = D[0];
+
+  // only compute the weighted average if MAC emulation is enabled
+  if (enable_MAC_emulation == TRUE)
+    {
+      for (i = 1; i <= r; i++)
+	D_avg += D[i] * pow (FER, i);
+      D_avg = (1 - FER) / (1 - pow (FER, r + 1)) * D_avg;
+    }
+
+  DEBUG ("__D_avg=%f\n", D_avg);
+
+  // compute the average jitter for the number of retransmissions "i"
+  for (i = 0; i <= r; i++)
+    {
+      J[i] = fabs (D[i] - D_avg);
+    }
+
+  // adjust for the case of error in the computation
+  // after 0 retransmissions (maximum error is 160 us) ????????????
+  J[0] = J[0] + slot_time * (CW[0] + 1) / 4;
+
+  DEBUG ("__J[0:%d]: %f %f %f %f\n", r, J[0], J[1], J[2], J[3]);
+
+  // compute the weighted mean jitter
+  J_avg = J[0];
+
+  // only compute the weighted average if MAC emulation is enabled
+  if (enable_MAC_emulation == TRUE)
+    {
+      for (i = 1; i <= r; i++)
+	{
+	  J_avg += J[i] * pow (FER, i);
+	}
+      J_avg = (1 - FER) / (1 - pow (FER, r + 1)) * J_avg;
+    }
+
+  DEBUG ("J_avg=%f\n", J_avg);
+
+  (*avg_delay) = D_avg;
+  (*avg_jitter) = J_avg;
+
+  return SUCCESS;
+}
+
+// function tabulated by the link tables of the MAC layer model,
+// for which 'context' is a copy of the connection;
+// return SUCCESS on succes, ERROR on error
+static int
+zigbee_mac_table_function (double fer, void *context, double *values)
+{
+  struct connection_class *connection = (struct connection_class *) context;
+
+  connection->frame_error_rate = fer;
+
+  if (zigbee_do_compute_retransmissions
+      (connection, &(values[ZIGBEE_MAC_RETRANSMISSIONS])) == ERROR
+      || zigbee_do_compute_delay_jitter
+      (connection, &(values[ZIGBEE_MAC_DELAY]),
+       &(values[ZIGBEE_MAC_JITTER])) == ERROR)
+    return ERROR;
+
+  values[ZIGBEE_MAC_LOSS_RATE] = pow (fer, ZIGBEE_MAX_TRANSMISSIONS);
+
+  return SUCCESS;
+}
+
+// interpolate from the link table of the MAC layer model the values
+// corresponding to the frame error rate of 'connection'; the table
+// depends on all the parameters that determine the frame duration;
+// return TRUE if the values were interpolated, FALSE otherwise
+static int
+zigbee_mac_lookup (struct connection_class *connection, double *values)
+{
+  double key[LINK_TABLE_KEY_SIZE] =
+    { connection->packet_size, enable_MAC_emulation };
+  struct link_table_class *table;
+
+  if (link_table_enabled == FALSE)
+    return FALSE;
+
+  table = link_table_find (LINK_TABLE_ZIGBEE_MAC, key);
+  if (table == NULL)
+    {
+      struct connection_class table_connection = *connection;
+
+      table = link_table_build (LINK_TABLE_ZIGBEE_MAC, key, 0,
+				MAXIMUM_ERROR_RATE, ZIGBEE_MAC_VALUES,
+				zigbee_mac_table_function, &table_connection);
+    }
+
+  return (table != NULL
+	  && link_table_lookup (table, connection->frame_error_rate,
+				values) == TRUE);
+}
+
+// compute the average number of retransmissions corresponding 
+// to the current conditions for ALL frames (including errored ones);
+// return SUCCESS on succes, ERROR on error
+int
+zigbee_retransmissions (struct connection_class *connection,
+			struct scenario_class *scenario,
+			double *num_retransmissions)
+{
+  double values[ZIGBEE_MAC_VALUES];
+
+  if (zigbee_mac_lookup (connection, values) == TRUE)
+    {
+      (*num_retransmissions) = values[ZIGBEE_MAC_RETRANSMISSIONS];
+      return SUCCESS;
+    }
+
+  return zigbee_do_compute_retransmissions (connection, num_retransmissions);
+}
+
 // compute loss rate based on FER;
 // return SUCCESS on succes, ERROR on error
 int
 zigbee_loss_rate (struct connection_class *connection,
 		  struct scenario_class *scenario, double *loss_rate)
 {
+  double values[ZIGBEE_MAC_VALUES];
+
   if (zigbee_fer (connection, scenario, connection->operating_rate,
 		  &(connection->frame_error_rate)) == ERROR)
     {
@@ -582,6 +843,8 @@ zigbee_loss_rate (struct connection_class *connection,
     }
   // when emulating the MAC, loss rate must be computed based on FER
   // and the maximum number of retransmissions
+  else if (zigbee_mac_lookup (connection, values) == TRUE)
+    (*loss_rate) = values[ZIGBEE_MAC_LOSS_RATE];
   else
     (*loss_rate) = pow (connection->frame_error_rate,
 			ZIGBEE_MAX_TRANSMISSIONS);
@@ -668,107 +931,23 @@ zigbee_delay_jitter (struct connection_class *connection,
 		     struct scenario_class *scenario, double *variable_delay,
 		     double *delay, double *jitter)
 {
-  // symbol duration in us [pp. 28] (from symbol rate)
-  int symbol_duration = 16;
-  int aUnitBackoffPeriod = 20 * symbol_duration;	// [pp. 159]
-
-  int slot_time = aUnitBackoffPeriod;
-
   struct node_class *node_rx = &(scenario->nodes[connection->to_node_index]);
   struct node_class *node_tx =
     &(scenario->nodes[connection->from_node_index]);
 
-  // values for delay and jitter corresponding to 'i' retransmissions (in us)
-  // NOTE: the jitter values depend on the average delay, therefore they change
-  //       with FER
-  double D[ZIGBEE_MAX_TRANSMISSIONS], J[ZIGBEE_MAX_TRANSMISSIONS];
-
-  // used to store temporarily a constant time duration
-  // used when calculating D
-  double constant_time;
-
-  ////////////////////////////////
-  // local constants
-
-  // maximum congestion window (assume no interference)
-  // if environment is busy CSMA/CA can be repeated ZIGBEE_MAX_CSMA_BACKOFFS
-  // times and CW increaseas up to 5
-  //e.g. congestion=0 => CWmax=3; congestion closer to 1 => CWmax = (3+4+5+5+5)
-  // very high congestion => failure and retransmit => MODEL!!!!!!!!!!!!!
-
-  int CW[ZIGBEE_MAX_TRANSMISSIONS] = { 3, 3, 3, 3 };
-
-  // loop variable
-  int i;
-
-  // number of retransmissions
-  int r;
-
-  // local storage for "connection->frame_error_rate"
-  double FER;
-
   // mean weighted delay and jitter (in us)
   double D_avg, J_avg;
 
-  // preliminary initializations
-  FER = connection->frame_error_rate;
-
-  r = ZIGBEE_MAX_TRANSMISSIONS - 1;
-
-  if (zigbee_ppdu_duration (connection, &constant_time) == ERROR)
-    {
-      WARNING ("Error calculating PPDU duration");
-      return ERROR;
-    }
-
-  DEBUG ("FRAME DURATION:   %f us", constant_time);
-
-  // compute the average delays for the number of retransmissions "i"
-  D[0] = constant_time + CW[0] * slot_time / 2.0;
-  for (i = 1; i <= r; i++)
-    D[i] = D[i - 1] + constant_time + CW[i] * slot_time / 2.0;
-
-  DEBUG ("__D[0:%d]: %f %f %f %f\n", r, D[0], D[1], D[2], D[3]);
-
-  // compute the weighted mean delay
-  D_avg = D[0];
-
-  // only compute the weighted average if MAC emulation is enabled
-  if (enable_MAC_emulation == TRUE)
-    {
-      for (i = 1; i <= r; i++)
-	D_avg += D[i] * pow (FER, i);
-      D_avg = (1 - FER) / (1 - pow (FER, r + 1)) * D_avg;
-    }
-
-  DEBUG ("__D_avg=%f\n", D_avg);
+  double values[ZIGBEE_MAC_VALUES];
 
-  // compute the average jitter for the number of retransmissions "i"
-  for (i = 0; i <= r; i++)
+  if (zigbee_mac_lookup (connection, values) == TRUE)
     {
-      J[i] = fabs (D[i] - D_avg);
+      D_avg = values[ZIGBEE_MAC_DELAY];
+      J_avg = values[ZIGBEE_MAC_JITTER];
     }
-
-  // adjust for the case of error in the computation
-  // after 0 retransmissions (maximum error is 160 us) ????????????
-  J[0] = J[0] + slot_time * (CW[0] + 1) / 4;
-
-  DEBUG ("__J[0:%d]: %f %f %f %f\n", r, J[0], J[1], J[2], J[3]);
-
-  // compute the weighted mean jitter
-  J_avg = J[0];
-
-  // only compute the weighted average if MAC emulation is enabled
-  if (enable_MAC_emulation == TRUE)
-    {
-      for (i = 1; i <= r; i++)
-	{
-	  J_avg += J[i] * pow (FER, i);
-	}
-      J_avg = (1 - FER) / (1 - pow (FER, r + 1)) * J_avg;
-    }
-
-  DEBUG ("J_avg=%f\n", J_avg);
+  else if (zigbee_do_compute_delay_jitter (connection, &D_avg, &J_avg)
+	   == ERROR)
+    return ERROR;
 
   // compute & store the final values of delay & jitter
   if (connection->delay_defined == FALSE)
@@ -0,0 +1,735 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: link_probe.c
+ * Function: Measurement tool for the network namespace testbed
+ *           (see run_netns_test.sh); generates a step scenario in
+ *           binary QOMET format, sends and receives timestamped UDP
+ *           probes, and compares the measured delay, loss and rate
+ *           with the values requested by the scenario
+ *
+ ***********************************************************************/
+
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "deltaQ.h"
+
+
+///////////////////////////////////
+// Generic variables and functions
+///////////////////////////////////
+
+#define MESSAGE_WARNING
+//#define MESSAGE_DEBUG
+#define MESSAGE_INFO
+
+#ifdef MESSAGE_WARNING
+#define WARNING(message...) do {                                            \
+  fprintf(stderr, "link_probe WARNING: %s, line %d: ", __FILE__, __LINE__); \
+  fprintf(stderr, message); fprintf(stderr,"\n");                           \
+} while(0)
+#else
+#define WARNING(message...)	/* message */
+#endif
+
+#ifdef MESSAGE_DEBUG
+#define DEBUG(message...) do {                                            \
+  fprintf(stdout, "link_probe DEBUG: %s, line %d: ", __FILE__, __LINE__); \
+  fprintf(stdout, message); fprintf(stdout,"\n");                         \
+} while(0)
+#else
+#define DEBUG(message...)	/* message */
+#endif
+
+#ifdef MESSAGE_INFO
+#define INFO(message...) do {                                       \
+  fprintf(stdout, message); fprintf(stdout,"\n");                   \
+} while(0)
+#else
+#define INFO(message...)	/* message */
+#endif
+
+
+#define MODE_NONE               0
+#define MODE_GENERATE           1
+#define MODE_SEND               2
+#define MODE_RECEIVE            3
+#define MODE_ANALYZE            4
+
+#define PROBE_MAGIC             0x514f4d54   // "QOMT"
+#define DEFAULT_PORT            5001
+#define DEFAULT_RATE            200          // probes per second
+#define DEFAULT_SIZE            256          // UDP payload [bytes]
+#define DEFAULT_DURATION        10.0         // [s]
+#define DEFAULT_STEPS           6
+#define DEFAULT_INTERVAL        2.0          // [s]
+#define DEFAULT_SETTLE          0.1          // [s]
+#define IP_UDP_OVERHEAD         28           // [bytes]
+#define NSEC                    1000000000ULL
+
+// header of each probe packet
+struct probe_hdr {
+    uint32_t magic;
+    uint32_t seq;
+    uint64_t send_ns;
+    uint64_t start_ns;
+    uint64_t period_ns;
+};
+
+// probe as seen by the receiver
+struct probe_sample {
+    uint32_t seq;
+    uint64_t send_ns;
+    uint64_t recv_ns;
+};
+
+// link conditions used by the generated scenario, repeated cyclically;
+// consecutive steps use different delays so that the moment when
+// each update takes effect can be detected
+struct step_params {
+    float delay;        // [ms]
+    float loss_rate;    // [0, 1]
+    float bandwidth;    // [bit/s]
+};
+
+static struct step_params steps_table[] = {
+    {10.0, 0.00, 100e6},
+    {40.0, 0.00, 100e6},
+    {20.0, 0.05, 100e6},
+    { 5.0, 0.00,  10e6},
+    {80.0, 0.01,  50e6},
+    {30.0, 0.20, 100e6},
+    {15.0, 0.00, 256e3},
+};
+
+#define STEPS_TABLE_SIZE (sizeof(steps_table) / sizeof(struct step_params))
+
+// print usage info
+static void
+usage()
+{
+    fprintf(stderr, "\nlink_probe. Measure the link conditions applied by meteor.\n\n");
+    fprintf(stderr, "Usage: link_probe -g <file.bin> [-n steps] [-i interval]\n");
+    fprintf(stderr, "       link_probe -s <dst_addr> [-p port] [-r probes/s] [-S size] [-t duration]\n");
+    fprintf(stderr, "       link_probe -l <samples_file> [-p port] [-t duration]\n");
+    fprintf(stderr, "       link_probe -a <samples_file> -b <file.bin> -T <origin> [-w settle]\n");
+    fprintf(stderr, "  -g: generate a 2-node step scenario in binary QOMET format\n");
+    fprintf(stderr, "  -s: send timestamped UDP probes to <dst_addr>\n");
+    fprintf(stderr, "  -l: listen for probes and store them in <samples_file>\n");
+    fprintf(stderr, "  -a: compare the received probes with the scenario; <origin> is the\n");
+    fprintf(stderr, "      CLOCK_MONOTONIC time of the scenario origin, as printed by meteor\n");
+}
+
+// return the current CLOCK_MONOTONIC time in nanoseconds; the clock
+// is shared by all network namespaces of a host
+static uint64_t
+get_time_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC + ts.tv_nsec;
+}
+
+///////////////////////////////////
+// Scenario generation
+///////////////////////////////////
+
+// write a scenario with 'step_count' updates every 'interval' seconds
+// for the link between nodes 0 and 1 (both directions);
+// return SUCCESS on success, ERROR on error
+static int
+generate_scenario(char *filename, int step_count, float interval)
+{
+    FILE *bin_file;
+    int step_i;
+    struct bin_time_rec_cls bin_time_rec;
+    struct bin_rec_cls bin_recs[2];
+
+    if((bin_file = fopen(filename, "w")) == NULL) {
+        WARNING("Cannot open binary file '%s'", filename);
+        return ERROR;
+    }
+
+    // meteor uses the record at time 0 only as initial state,
+    // hence the updates start at time 'interval'
+    if(io_binary_write_header_to_file(2, step_count + 1, 0, 0, 0, -1, bin_file) == ERROR) {
+        fclose(bin_file);
+        return ERROR;
+    }
+
+    for(step_i = 0; step_i <= step_count; step_i++) {
+        struct step_params *sp = &steps_table[step_i % STEPS_TABLE_SIZE];
+        int rec_i;
+
+        bin_time_rec.time = step_i * interval;
+        bin_time_rec.record_number = 2;
+        if(io_binary_write_time_record_to_file2(&bin_time_rec, bin_file) == ERROR) {
+            fclose(bin_file);
+            return ERROR;
+        }
+
+        memset(bin_recs, 0, sizeof(bin_recs));
+        for(rec_i = 0; rec_i < 2; rec_i++) {
+            bin_recs[rec_i].from_id = rec_i;
+            bin_recs[rec_i].to_id = 1 - rec_i;
+            bin_recs[rec_i].operating_rate = sp->bandwidth;
+            bin_recs[rec_i].bandwidth = sp->bandwidth;
+            bin_recs[rec_i].loss_rate = sp->loss_rate;
+            bin_recs[rec_i].delay = sp->delay;
+            if(io_binary_write_record_to_file2(&bin_recs[rec_i], bin_file) == ERROR) {
+                fclose(bin_file);
+                return ERROR;
+            }
+        }
+    }
+
+    fclose(bin_file);
+
+    INFO("Generated %d updates every %.3f s in '%s'", step_count, interval, filename);
+
+    return SUCCESS;
+}
+
+///////////////////////////////////
+// Probe sender and receiver
+///////////////////////////////////
+
+// send probes at 'rate' probes/s during 'duration' seconds;
+// return SUCCESS on success, ERROR on error
+static int
+send_probes(char *dst_addr, int port, int rate, int size, float duration)
+{
+    int sock;
+    char *buf;
+    uint32_t seq;
+    uint32_t count;
+    uint64_t start_ns;
+    uint64_t period_ns;
+    struct sockaddr_in dst;
+    struct probe_hdr *hdr;
+
+    if(size < sizeof(struct probe_hdr)) {
+        size = sizeof(struct probe_hdr);
+    }
+
+    memset(&dst, 0, sizeof(dst));
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(port);
+    if(inet_pton(AF_INET, dst_addr, &dst.sin_addr) != 1) {
+        WARNING("Invalid destination address '%s'", dst_addr);
+        return ERROR;
+    }
+
+    if((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        WARNING("Cannot create socket");
+        perror("socket");
+        return ERROR;
+    }
+
+    if((buf = calloc(1, size)) == NULL) {
+        WARNING("Cannot allocate probe buffer");
+        close(sock);
+        return ERROR;
+    }
+    hdr = (struct probe_hdr *)buf;
+
+    period_ns = NSEC / rate;
+    count = duration * rate;
+    start_ns = get_time_ns();
+
+    hdr->magic = PROBE_MAGIC;
+    hdr->start_ns = start_ns;
+    hdr->period_ns = period_ns;
+
+    for(seq = 0; seq < count; seq++) {
+        uint64_t next_ns = start_ns + seq * period_ns;
+        struct timespec next_ts;
+
+        next_ts.tv_sec = next_ns / NSEC;
+        next_ts.tv_nsec = next_ns % NSEC;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_ts, NULL) == EINTR);
+
+        hdr->seq = seq;
+        hdr->send_ns = get_time_ns();
+        if(sendto(sock, buf, size, 0, (struct sockaddr *)&dst, sizeof(dst)) < 0) {
+            DEBUG("Cannot send probe %u", seq);
+        }
+    }
+
+    INFO("Sent %u probes of %d bytes to %s:%d", count, size, dst_addr, port);
+
+    free(buf);
+    close(sock);
+
+    return SUCCESS;
+}
+
+// receive probes during 'duration' seconds and store them
+// in 'filename'; return SUCCESS on success, ERROR on error
+static int
+receive_probes(char *filename, int port, float duration)
+{
+    int sock;
+    int len;
+    char buf[65536];
+    FILE *out_file;
+    uint64_t end_ns;
+    uint32_t sample_cnt = 0;
+    struct sockaddr_in addr;
+    struct timeval tv;
+    struct probe_hdr *hdr = (struct probe_hdr *)buf;
+
+    if((sock = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+        WARNING("Cannot create socket");
+        perror("socket");
+        return ERROR;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        WARNING("Cannot bind to port %d", port);
+        perror("bind");
+        close(sock);
+        return ERROR;
+    }
+
+    tv.tv_sec = 0;
+    tv.tv_usec = 100000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    if((out_file = fopen(filename, "w")) == NULL) {
+        WARNING("Cannot open samples file '%s'", filename);
+        close(sock);
+        return ERROR;
+    }
+
+    end_ns = get_time_ns() + duration * NSEC;
+    while(get_time_ns() < end_ns) {
+        uint64_t recv_ns;
+
+        if((len = recv(sock, buf, sizeof(buf), 0)) < 0) {
+            continue;
+        }
+        recv_ns = get_time_ns();
+        if(len < sizeof(struct probe_hdr) || hdr->magic != PROBE_MAGIC) {
+            continue;
+        }
+
+        // the first line gives the sender parameters
+        if(sample_cnt == 0) {
+            fprintf(out_file, "# %llu %llu %d\n", (unsigned long long)hdr->start_ns,
+                    (unsigned long long)hdr->period_ns, len);
+        }
+        fprintf(out_file, "%u %llu %llu\n", hdr->seq,
+                (unsigned long long)hdr->send_ns, (unsigned long long)recv_ns);
+        sample_cnt++;
+    }
+
+    INFO("Received %u probes on port %d", sample_cnt, port);
+
+    fclose(out_file);
+    close(sock);
+
+    return SUCCESS;
+}
+
+///////////////////////////////////
+// Analysis
+///////////////////////////////////
+
+static int
+compare_samples(const void *a, const void *b)
+{
+    const struct probe_sample *sa = a;
+    const struct probe_sample *sb = b;
+
+    return (sa->seq > sb->seq) - (sa->seq < sb->seq);
+}
+
+// read the link parameters of the scenario (first record of each
+// time record); return the number of time records, or ERROR on error
+static int
+read_scenario(char *filename, double **times, struct step_params **params)
+{
+    FILE *bin_file;
+    long int time_i;
+    struct bin_hdr_cls bin_hdr;
+    struct bin_time_rec_cls bin_time_rec;
+    struct bin_rec_cls *bin_recs;
+
+    if((bin_file = fopen(filename, "r")) == NULL) {
+        WARNING("Cannot open binary file '%s'", filename);
+        return ERROR;
+    }
+    if(io_binary_read_header_from_file(&bin_hdr, bin_file) == ERROR) {
+        fclose(bin_file);
+        return ERROR;
+    }
+
+    bin_recs = calloc(bin_hdr.if_num * bin_hdr.if_num, sizeof(struct bin_rec_cls));
+    *times = calloc(bin_hdr.time_rec_num, sizeof(double));
+    *params = calloc(bin_hdr.time_rec_num, sizeof(struct step_params));
+    if(bin_recs == NULL || *times == NULL || *params == NULL) {
+        WARNING("Cannot allocate memory for the scenario");
+        fclose(bin_file);
+        return ERROR;
+    }
+
+    for(time_i = 0; time_i < bin_hdr.time_rec_num; time_i++) {
+        if(io_binary_read_time_record_from_file(&bin_time_rec, bin_file) == ERROR ||
+           bin_time_rec.record_number > bin_hdr.if_num * bin_hdr.if_num ||
+           io_binary_read_records_from_file(bin_recs, bin_time_rec.record_number, bin_file) == ERROR) {
+            WARNING("Aborting on input error (time record %ld)", time_i);
+            fclose(bin_file);
+            return ERROR;
+        }
+
+        (*times)[time_i] = bin_time_rec.time;
+        if(bin_time_rec.record_number > 0) {
+            (*params)[time_i].delay = bin_recs[0].delay;
+            (*params)[time_i].loss_rate = bin_recs[0].loss_rate;
+            (*params)[time_i].bandwidth = bin_recs[0].bandwidth;
+        }
+        else if(time_i > 0) {
+            (*params)[time_i] = (*params)[time_i - 1];
+        }
+    }
+
+    free(bin_recs);
+    fclose(bin_file);
+
+    return bin_hdr.time_rec_num;
+}
+
+// compare the received probes in 'samples_filename' with the scenario
+// in 'bin_filename', whose origin is at 'origin' seconds (CLOCK_MONOTONIC)
+static int
+analyze(char *samples_filename, char *bin_filename, double origin, float settle)
+{
+    FILE *samples_file;
+    char buf[BUFSIZ];
+    int time_rec_cnt;
+    int step_i;
+    uint32_t sample_cnt = 0;
+    uint32_t sample_max = 4096;
+    uint32_t max_seq = 0;
+    uint64_t start_ns = 0;
+    uint64_t period_ns = 0;
+    uint64_t origin_ns = origin * NSEC;
+    int size = 0;
+    double offered_rate;
+    double *times;
+    struct step_params *params;
+    struct probe_sample *samples;
+
+    int apply_cnt = 0;
+    int measure_cnt = 0;
+    double apply_sum = 0.0, apply_max = 0.0;
+    double delay_err_sum = 0.0, loss_err_sum = 0.0;
+
+    if((time_rec_cnt = read_scenario(bin_filename, &times, &params)) == ERROR) {
+        return ERROR;
+    }
+
+    if((samples_file = fopen(samples_filename, "r")) == NULL) {
+        WARNING("Cannot open samples file '%s'", samples_filename);
+        return ERROR;
+    }
+    if((samples = malloc(sample_max * sizeof(struct probe_sample))) == NULL) {
+        WARNING("Cannot allocate memory for samples");
+        fclose(samples_file);
+        return ERROR;
+    }
+    while(fgets(buf, BUFSIZ, samples_file) != NULL) {
+        unsigned long long send_ns, recv_ns;
+        unsigned int seq;
+
+        if(buf[0] == '#') {
+            sscanf(buf, "# %llu %llu %d", &send_ns, &recv_ns, &size);
+            start_ns = send_ns;
+            period_ns = recv_ns;
+            continue;
+        }
+        if(sscanf(buf, "%u %llu %llu", &seq, &send_ns, &recv_ns) != 3) {
+            continue;
+        }
+        if(sample_cnt == sample_max) {
+            sample_max *= 2;
+            if((samples = realloc(samples, sample_max * sizeof(struct probe_sample))) == NULL) {
+                WARNING("Cannot allocate memory for samples");
+                fclose(samples_file);
+                return ERROR;
+            }
+        }
+        samples[sample_cnt].seq = seq;
+        samples[sample_cnt].send_ns = send_ns;
+        samples[sample_cnt].recv_ns = recv_ns;
+        if(seq > max_seq) {
+            max_seq = seq;
+        }
+        sample_cnt++;
+    }
+    fclose(samples_file);
+
+    if(sample_cnt == 0 || period_ns == 0) {
+        WARNING("No probes in samples file '%s'", samples_filename);
+        return ERROR;
+    }
+    qsort(samples, sample_cnt, sizeof(struct probe_sample), compare_samples);
+
+    offered_rate = (size + IP_UDP_OVERHEAD) * 8.0 * NSEC / period_ns;
+
+    INFO("Scenario: %d updates; probes: %u received (last seq %u), %.0f bit/s offered",
+         time_rec_cnt - 1, sample_cnt, max_seq, offered_rate);
+    INFO("%4s %8s %9s %17s %15s %21s", "upd", "time[s]", "apply[ms]",
+         "delay req/meas", "loss% req/meas", "rate[kbit/s] req/meas");
+
+    // the record at time 0 is not applied by meteor
+    for(step_i = 1; step_i < time_rec_cnt; step_i++) {
+        struct step_params *sp = &params[step_i];
+        struct step_params *prev = &params[step_i - 1];
+        uint64_t step_ns = origin_ns + times[step_i] * NSEC;
+        uint64_t end_ns;
+        uint64_t window_ns;
+        uint32_t seq_lo, seq_hi;
+        uint32_t sample_i;
+        uint32_t recv_cnt = 0;
+        double delay_sum = 0.0;
+        double apply = 0.0;
+        int applied = FALSE;
+        char apply_str[16];
+        double loss, rate, expected_rate;
+
+        if(step_i + 1 < time_rec_cnt) {
+            end_ns = origin_ns + times[step_i + 1] * NSEC;
+        }
+        else {
+            end_ns = start_ns + (max_seq + 1) * period_ns;
+        }
+
+        // detect the first probe sent after the update
+        // that experiences the new delay
+        if(fabs(sp->delay - prev->delay) > 0) {
+            double tolerance = fabs(sp->delay - prev->delay) / 2;
+
+            for(sample_i = 0; sample_i < sample_cnt; sample_i++) {
+                double owd = (samples[sample_i].recv_ns - samples[sample_i].send_ns) / 1e6;
+
+                if(samples[sample_i].send_ns < step_ns) {
+                    continue;
+                }
+                if(samples[sample_i].send_ns >= end_ns) {
+                    break;
+                }
+                if(fabs(owd - sp->delay) < tolerance) {
+                    apply = ((double)samples[sample_i].send_ns - (double)step_ns) / 1e6;
+                    applied = TRUE;
+                    break;
+                }
+            }
+        }
+
+        // measurement window: after the update took effect
+        window_ns = step_ns + settle * NSEC;
+        if(applied == TRUE && step_ns + apply * 1e6 > window_ns) {
+            window_ns = step_ns + apply * 1e6;
+        }
+        if(window_ns >= end_ns || window_ns < start_ns) {
+            INFO("%4d %8.3f %9s (no probes in measurement window)", step_i, times[step_i], "-");
+            continue;
+        }
+
+        seq_lo = (window_ns - start_ns + period_ns - 1) / period_ns;
+        seq_hi = (end_ns - start_ns + period_ns - 1) / period_ns;
+        if(seq_hi > max_seq + 1) {
+            seq_hi = max_seq + 1;
+        }
+        if(seq_hi <= seq_lo) {
+            INFO("%4d %8.3f %9s (no probes in measurement window)", step_i, times[step_i], "-");
+            continue;
+        }
+
+        for(sample_i = 0; sample_i < sample_cnt; sample_i++) {
+            if(samples[sample_i].seq < seq_lo) {
+                continue;
+            }
+            if(samples[sample_i].seq >= seq_hi) {
+                break;
+            }
+            delay_sum += (samples[sample_i].recv_ns - samples[sample_i].send_ns) / 1e6;
+            recv_cnt++;
+        }
+
+        loss = 1.0 - (double)recv_cnt / (seq_hi - seq_lo);
+        rate = recv_cnt * (size + IP_UDP_OVERHEAD) * 8.0 / ((seq_hi - seq_lo) * period_ns / 1e9);
+        expected_rate = (sp->bandwidth < offered_rate) ? sp->bandwidth : offered_rate;
+
+        if(applied == TRUE) {
+            snprintf(apply_str, sizeof(apply_str), "%9.3f", apply);
+            apply_sum += apply;
+            if(apply > apply_max) {
+                apply_max = apply;
+            }
+            apply_cnt++;
+        }
+        else {
+            snprintf(apply_str, sizeof(apply_str), "%9s", "-");
+        }
+
+        // queueing makes the delay meaningless when the
+        // requested rate is below the offered load
+        if(recv_cnt > 0 && sp->bandwidth >= offered_rate) {
+            INFO("%4d %8.3f %s %8.3f/%8.3f %7.2f/%7.2f %10.1f/%10.1f", step_i, times[step_i],
+                 apply_str, sp->delay, delay_sum / recv_cnt, sp->loss_rate * 100, loss * 100,
+                 expected_rate / 1e3, rate / 1e3);
+            delay_err_sum += fabs(delay_sum / recv_cnt - sp->delay);
+            loss_err_sum += fabs(loss - sp->loss_rate);
+            measure_cnt++;
+        }
+        else {
+            INFO("%4d %8.3f %s %8.3f/%8s %7.2f/%7.2f %10.1f/%10.1f", step_i, times[step_i],
+                 apply_str, sp->delay, "-", sp->loss_rate * 100, loss * 100,
+                 expected_rate / 1e3, rate / 1e3);
+        }
+    }
+
+    if(apply_cnt > 0) {
+        INFO("Apply latency: mean=%.3f ms max=%.3f ms (%d updates)",
+             apply_sum / apply_cnt, apply_max, apply_cnt);
+    }
+    if(measure_cnt > 0) {
+        INFO("Mean absolute error: delay=%.3f ms loss=%.2f%% (%d updates)",
+             delay_err_sum / measure_cnt, loss_err_sum * 100 / measure_cnt, measure_cnt);
+    }
+
+    free(samples);
+    free(times);
+    free(params);
+
+    return SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+    char c;
+    int mode = MODE_NONE;
+    char *target = NULL;
+    char *bin_filename = NULL;
+    int port = DEFAULT_PORT;
+    int rate = DEFAULT_RATE;
+    int size = DEFAULT_SIZE;
+    int step_count = DEFAULT_STEPS;
+    float interval = DEFAULT_INTERVAL;
+    float duration = DEFAULT_DURATION;
+    float settle = DEFAULT_SETTLE;
+    double origin = -1.0;
+    int ret = ERROR;
+
+    while((c = getopt(argc, argv, "a:b:g:hi:l:n:p:r:s:S:t:T:w:")) != -1) {
+        switch(c) {
+            case 'a':
+                mode = MODE_ANALYZE;
+                target = optarg;
+                break;
+            case 'b':
+                bin_filename = optarg;
+                break;
+            case 'g':
+                mode = MODE_GENERATE;
+                target = optarg;
+                break;
+            case 'h':
+                usage();
+                exit(0);
+            case 'i':
+                interval = atof(optarg);
+                break;
+            case 'l':
+                mode = MODE_RECEIVE;
+                target = optarg;
+                break;
+            case 'n':
+                step_count = atoi(optarg);
+                break;
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'r':
+                rate = atoi(optarg);
+                break;
+            case 's':
+                mode = MODE_SEND;
+                target = optarg;
+                break;
+            case 'S':
+                size = atoi(optarg);
+                break;
+            case 't':
+                duration = atof(optarg);
+                break;
+            case 'T':
+                origin = atof(optarg);
+                break;
+            case 'w':
+                settle = atof(optarg);
+                break;
+            default:
+                usage();
+                exit(1);
+        }
+    }
+
+    if(interval <= 0 || duration <= 0 || rate <= 0 || step_count < 1) {
+        WARNING("Invalid interval, duration, rate or number of steps");
+        exit(1);
+    }
+
+    switch(mode) {
+        case MODE_GENERATE:
+            ret = generate_scenario(target, step_count, interval);
+            break;
+        case MODE_SEND:
+            ret = send_probes(target, port, rate, size, duration);
+            break;
+        case MODE_RECEIVE:
+            ret = receive_probes(target, port, duration);
+            break;
+        case MODE_ANALYZE:
+            if(bin_filename == NULL || origin < 0) {
+                WARNING("Analysis requires a scenario file (-b) and its origin (-T)");
+                usage();
+                exit(1);
+            }
+            ret = analyze(target, bin_filename, origin, settle);
+            break;
+        default:
+            usage();
+            exit(1);
+    }
+
+    return (ret == SUCCESS) ? 0 : 1;
+}
@@ -8,7 +8,6 @@
 
 #define ERROR   -1
 #define SUCCESS  0
-#define PARAMS_TOTAL        19
 #define PROG_NAME           "scenario_converter"
 
 #define BINARY  0
@@ -109,12 +108,12 @@ FILE *ofile_fd;
 }
 
 int32_t
-txt2bin(ifile_fd, ofile_fd)
-FILE *ifile_fd;
+txt2bin(reader, ofile_fd)
+struct io_text_reader_cls *reader;
 FILE *ofile_fd;
 {
-    char buf[BUFSIZ];
     int i;
+    int result;
     int32_t src, dst;
     int32_t max_node_num;
     int32_t rec_i;
@@ -128,7 +127,7 @@ FILE *ofile_fd;
     float op_rate;
     float num_retx;
     float fer;
-    float dummy[PARAMS_TOTAL];
+    struct io_text_rec_cls text_rec;
 
     struct bin_time_rec_cls bin_time_rec;
     struct bin_rec_cls *recs = NULL;
@@ -139,16 +138,14 @@ FILE *ofile_fd;
     rec_num = 0;
     rec_i = -1;
 
-    while(fgets(buf, BUFSIZ, ifile_fd) != NULL) {
-        if(sscanf(buf, "%f %d %f %f %f %d %f %f %f %f %f %f %f %f %f %f %f %f %f",
-                &time, 
-                &src, &dummy[0], &dummy[1], &dummy[2], 
-                &dst, &dummy[3], &dummy[4], &dummy[5],  
-                &dummy[6], &dummy[7], &dummy[8],
-                &dummy[9], &dummy[10], &dummy[11], 
-                &bandwidth, &loss_rate, &delay, &dummy[12]) != PARAMS_TOTAL) {
+    while((result = io_text_read_record(reader, &text_rec)) != FALSE) {
+        if(result == ERROR) {
+            io_text_print_error(reader);
             continue;
         }
+        time = text_rec.time;
+        src = text_rec.from_id;
+        dst = text_rec.to_id;
         if(src > max_node_num) {
             max_node_num = src;
         }
@@ -164,7 +161,7 @@ FILE *ofile_fd;
     time_recs++;
     fprintf(stderr, "Read Time Records...  %u                 \n", time_recs);
     max_node_num++;
-    fseek(ifile_fd, 0L, SEEK_SET);
+    io_text_rewind(reader);
     priv_time = 0;
 
     printf("max node number : %d\n", max_node_num);
@@ -182,16 +179,20 @@ FILE *ofile_fd;
     }
 
     rec_num++;
-    while(fgets(buf, BUFSIZ, ifile_fd) != NULL) {
-        if(sscanf(buf, "%f %d %f %f %f %d %f %f %f %f %f %f " "%f %f %f %f %f %f %f", \
-                &time, 
-                &src, &dummy[0], &dummy[1], &dummy[2], 
-                &dst, &dummy[3], &dummy[4], &dummy[5],  
-                &dummy[6], &dummy[7], &dummy[8],
-                &fer, &num_retx, &op_rate,
-                &bandwidth, &loss_rate, &delay, &dummy[12]) != PARAMS_TOTAL) {
+    while((result = io_text_read_record(reader, &text_rec)) != FALSE) {
+        if(result == ERROR) {
+            // already reported during the first pass
             continue;
         }
+        time = text_rec.time;
+        src = text_rec.from_id;
+        dst = text_rec.to_id;
+        fer = text_rec.frame_error_rate;
+        num_retx = text_rec.num_retransmissions;
+        op_rate = text_rec.operating_rate;
+        bandwidth = text_rec.bandwidth;
+        loss_rate = text_rec.loss_rate;
+        delay = text_rec.delay;
 
         if(fabs(priv_time - time) < FLT_EPSILON) {
             if(fabs(priv_rec[(src * max_node_num) + dst].delay - delay) < FLT_EPSILON
@@ -280,8 +281,10 @@ main(argc, argv)
 int argc;
 char **argv;
 {
-    FILE *ifile_fd;
-    FILE *ofile_fd;
+    FILE *ifile_fd = NULL;
+    FILE *ofile_fd = NULL;
+    char *ifile_name = NULL;
+    struct io_text_reader_cls reader;
     char c;
     int32_t ifile_type = TEXT;
     int32_t ofile_type = BINARY;
@@ -297,7 +300,7 @@ char **argv;
             usage();
             exit(0);
         case 'i':
-            ifile_fd = fopen(optarg, "r");
+            ifile_name = optarg;
             break;
         case 'I':
             ifile_type = check_type(optarg);
@@ -326,19 +329,28 @@ char **argv;
         }
     }
 
-    if(ifile_fd == NULL || ofile_fd == NULL) {
+    if(ifile_name == NULL || ofile_fd == NULL) {
         usage();
         exit(1);
     }
     
     if(ifile_type == BINARY && ofile_type == TEXT) {
+        if((ifile_fd = fopen(ifile_name, "r")) == NULL) {
+            fprintf(stderr, "Cannot open file: %s\n", ifile_name);
+            exit(1);
+        }
         bin2txt(ifile_fd, ofile_fd);
+        fclose(ifile_fd);
     }
     else if(ifile_type == TEXT && ofile_type == BINARY) {
-        txt2bin(ifile_fd, ofile_fd);
+        if(io_text_open(&reader, ifile_name) == ERROR) {
+            fprintf(stderr, "Cannot open file: %s\n", ifile_name);
+            exit(1);
+        }
+        txt2bin(&reader, ofile_fd);
+        io_text_close(&reader);
     }
 
-    fclose(ifile_fd);
     fclose(ofile_fd);
 
     return 0;
@@ -25,9 +25,12 @@
 
 #include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "deltaQ.h"
+#include "io_columnar.h"
+#include "io_bin_reader.h"
 
 
 ///////////////////////////////////
@@ -74,6 +77,11 @@ usage()
 {
     fprintf(stderr, "\nshow_bin. Display binary QOMET output as text.\n\n");
     fprintf(stderr, "Usage: show_bin -b <scenario_file.xml.bin> [-t gnuplot] [-s src_id] [-d dst_id]\n");
+    fprintf(stderr, "       show_bin -q <scenario_file.xml.out> [-t gnuplot] [-s src_id] [-d dst_id]\n");
+    fprintf(stderr, "       show_bin -c <scenario_file.xml.col> [-t gnuplot] [-s src_id] [-d dst_id]\n");
+    fprintf(stderr, "** -q shows a text QOMET output file the same way, reporting\n");
+    fprintf(stderr, "   invalid lines as file:line:column.\n");
+    fprintf(stderr, "** -c shows a columnar QOMET output file link by link.\n");
     fprintf(stderr, "** gnuplot types output format is follow.\n");
     fprintf(stderr, "     time, from_id, to_id delay, lossrate, bandwidth\n");
 }
@@ -121,27 +129,155 @@ print_systeminfo()
 
 }
 
-int
-main(int argc, char *argv[])
+// display a text QOMET output file in the same form as a binary one;
+// return the number of invalid lines, or ERROR if the file cannot be read
+static int
+show_text(char *text_filename, int32_t type, int32_t src_id, int32_t dst_id)
 {
-    // binary file name and descriptor
-    char c;
-    char bin_filename[MAX_STRING];
-    FILE *bin_file;
+    struct io_text_reader_cls reader;
+    struct io_text_rec_cls text_rec;
+    struct bin_rec_cls bin_rec;
+    int result;
+    int error_cnt = 0;
+    uint64_t rec_cnt = 0;
+    double crt_time = -1.0;
+
+    if(io_text_open(&reader, text_filename) == ERROR) {
+        WARNING("Cannot open text file '%s'", text_filename);
+        return ERROR;
+    }
 
-    // binary file header data structure
-    struct bin_hdr_cls bin_hdr;
+    printf("* RECORD CONTENT:\n");
+    while((result = io_text_read_record(&reader, &text_rec)) != FALSE) {
+        if(result == ERROR) {
+            io_text_print_error(&reader);
+            error_cnt++;
+            continue;
+        }
+        rec_cnt++;
 
-    // binary file time record data structure
-    struct bin_time_rec_cls binary_time_record;
+        if(type == PRINT_SC && text_rec.time != crt_time) {
+            INFO("- Time: %.2f s\n", text_rec.time);
+            crt_time = text_rec.time;
+        }
 
-    // binary file record data structure and max count
-    struct bin_rec_cls *bin_recs = NULL;
-    uint32_t bin_rec_max_cnt;
+        if(src_id == -1 || src_id == text_rec.from_id) {
+            if(dst_id == -1 || dst_id == text_rec.to_id) {
+                io_text_to_binary_record(&text_rec, &bin_rec);
+                if(type == PRINT_SC) {
+                    io_binary_print_record(&bin_rec);
+                }
+                else if(type == PRINT_GNUPLOT) {
+                    io_bin_rec2gnuplot(&bin_rec, text_rec.time);
+                }
+            }
+        }
+    }
 
-    // counters for time and binary records
-    uint64_t time_i;
-    uint32_t rec_i;
+    INFO("\n%llu records, %d invalid lines", (unsigned long long)rec_cnt, error_cnt);
+    io_text_close(&reader);
+
+    return error_cnt;
+}
+
+// display a columnar QOMET output file link by link;
+// return SUCCESS on succes, ERROR on error
+static int
+show_columnar(char *columnar_filename, int32_t type, int32_t src_id, int32_t dst_id)
+{
+    struct io_columnar_reader_cls reader;
+    struct bin_rec_cls bin_rec;
+    float *columns[IO_COLUMNS];
+    int32_t link_i, column_i, step_i;
+    int32_t step_num;
+    int result = SUCCESS;
+
+    if(io_columnar_open(&reader, columnar_filename) == ERROR) {
+        WARNING("Cannot open columnar file '%s'", columnar_filename);
+        return ERROR;
+    }
+
+    step_num = reader.header->step_num;
+    for(column_i = 0; column_i < IO_COLUMNS; column_i++) {
+        columns[column_i] = (float *)calloc(step_num + 1, sizeof(float));
+        if(columns[column_i] == NULL) {
+            WARNING("Cannot allocate memory for columns");
+            while(--column_i >= 0) {
+                free(columns[column_i]);
+            }
+            io_columnar_close(&reader);
+            return ERROR;
+        }
+    }
+
+    printf("* HEADER INFORMATION:\n");
+    printf("Number of interfaces in file: %d\n", reader.header->if_num);
+    printf("Number of links in file: %d\n", reader.header->link_num);
+    printf("Number of steps in file: %d\n", reader.header->step_num);
+
+    printf("* RECORD CONTENT:\n");
+    for(link_i = 0; link_i < reader.header->link_num && result == SUCCESS; link_i++) {
+        bin_rec.from_id = reader.links[link_i].from_id;
+        bin_rec.to_id = reader.links[link_i].to_id;
+        if((src_id != -1 && src_id != bin_rec.from_id) ||
+                (dst_id != -1 && dst_id != bin_rec.to_id)) {
+            continue;
+        }
+
+        for(column_i = 0; column_i < IO_COLUMNS; column_i++) {
+            if(io_columnar_read_column(&reader, link_i, column_i, columns[column_i]) == ERROR) {
+                result = ERROR;
+                break;
+            }
+        }
+
+        for(step_i = 0; step_i < step_num && result == SUCCESS; step_i++) {
+            bin_rec.frame_error_rate = columns[IO_COLUMN_FRAME_ERROR_RATE][step_i];
+            bin_rec.num_retransmissions = columns[IO_COLUMN_NUM_RETRANSMISSIONS][step_i];
+            bin_rec.standard = columns[IO_COLUMN_STANDARD][step_i];
+            bin_rec.operating_rate = columns[IO_COLUMN_OPERATING_RATE][step_i];
+            bin_rec.bandwidth = columns[IO_COLUMN_BANDWIDTH][step_i];
+            bin_rec.loss_rate = columns[IO_COLUMN_LOSS_RATE][step_i];
+            bin_rec.delay = columns[IO_COLUMN_DELAY][step_i];
+            if(type == PRINT_SC) {
+                io_binary_print_record(&bin_rec);
+            }
+            else if(type == PRINT_GNUPLOT) {
+                io_bin_rec2gnuplot(&bin_rec, reader.header->start_time + step_i * reader.header->step);
+            }
+        }
+    }
+
+    for(column_i = 0; column_i < IO_COLUMNS; column_i++) {
+        free(columns[column_i]);
+    }
+    io_columnar_close(&reader);
+
+    return result;
+}
+
+int
+main(int argc, char *argv[])
+{
+    // binary file name and reader
+    char c;
+    char bin_filename[MAX_STRING];
+    struct io_bin_reader_cls bin_reader;
+    int bin_file_open = FALSE;
+    char *text_filename = NULL;
+    char *columnar_filename = NULL;
+
+    // binary file time record and records
+    const struct bin_time_rec_cls *binary_time_record;
+    const struct bin_rec_cls *bin_recs;
+
+    // iterator over the records of one link
+    struct io_bin_link_iter_cls link_iter;
+    const struct bin_rec_cls *link_rec;
+    float link_time;
+
+    // counter for binary records
+    int32_t rec_i;
     int32_t type = PRINT_SC;
     int32_t src_id, dst_id;
 
@@ -155,11 +291,14 @@ main(int argc, char *argv[])
         exit(1);
     }
 
-    while((c = getopt(argc, argv, "b:d:hs:t:")) != -1) {
+    while((c = getopt(argc, argv, "b:c:d:hq:s:t:")) != -1) {
         switch(c) {
             case 'b':
                 strncpy(bin_filename, optarg, MAX_STRING - 1);
-                bin_file = fopen(optarg, "r");
+                bin_file_open = (io_bin_reader_open(&bin_reader, optarg) == SUCCESS);
+                break;
+            case 'c':
+                columnar_filename = optarg;
                 break;
             case 'd':
                 dst_id = atoi(optarg);
@@ -168,6 +307,9 @@ main(int argc, char *argv[])
                 usage();
                 exit(0);
                 break;
+            case 'q':
+                text_filename = optarg;
+                break;
             case 's':
                 src_id = atoi(optarg);
                 break;
@@ -189,69 +331,65 @@ main(int argc, char *argv[])
 
     print_systeminfo();
 
-    INFO("\nShowing file '%s'...\n", bin_filename);
-
-    if(bin_file == NULL) {
-        WARNING("Cannot open binary file '%s'", bin_filename);
-        exit(1);
+    if(text_filename != NULL) {
+        INFO("\nShowing file '%s'...\n", text_filename);
+        exit((show_text(text_filename, type, src_id, dst_id) == 0) ? 0 : 1);
     }
 
-    if(io_binary_read_header_from_file(&bin_hdr, bin_file) == ERROR) {
-        WARNING("Aborting on input error (binary header)");
-        fclose(bin_file);
-        exit(1);
+    if(columnar_filename != NULL) {
+        INFO("\nShowing file '%s'...\n", columnar_filename);
+        exit((show_columnar(columnar_filename, type, src_id, dst_id) == SUCCESS) ? 0 : 1);
     }
 
-    printf("* HEADER INFORMATION:\n");
-    io_binary_print_header(&bin_hdr);
+    INFO("\nShowing file '%s'...\n", bin_filename);
 
-    bin_rec_max_cnt = bin_hdr.if_num * (bin_hdr.if_num - 1);
-    bin_recs = (struct bin_rec_cls *)calloc(bin_rec_max_cnt, sizeof(struct bin_rec_cls));
-    if(bin_recs == NULL) {
-        WARNING("Cannot allocate memory for records");
-        fclose(bin_file);
+    if(bin_file_open == FALSE) {
+        WARNING("Cannot open binary file '%s'", bin_filename);
         exit(1);
     }
 
+    printf("* HEADER INFORMATION:\n");
+    io_binary_print_header(bin_reader.header);
+
     printf("* RECORD CONTENT:\n");
-    printf("bin_hdr.time_rec_num: %d\n", bin_hdr.time_rec_num);
-    for(time_i = 0; time_i < bin_hdr.time_rec_num; time_i++) {
-        // read time record
-        if(io_binary_read_time_record_from_file(&binary_time_record, bin_file) == ERROR) {
-            WARNING("Aborting on input error (time record)");
-            fclose(bin_file);
+    printf("bin_hdr.time_rec_num: %d\n", bin_reader.header->time_rec_num);
+
+    // for a single link, only the records of that link are visited
+    if(src_id != -1 && dst_id != -1) {
+        if(io_bin_reader_link_iter(&bin_reader, src_id, dst_id, &link_iter) == ERROR) {
+            io_bin_reader_close(&bin_reader);
             exit(1);
         }
-        io_binary_print_time_record(&binary_time_record);
-        if(binary_time_record.record_number > bin_rec_max_cnt) {
-            WARNING("Time: %d Number of records exceeds maximum (%d > %d)", 
-                    time_i, binary_time_record.record_number, bin_rec_max_cnt);
-            fclose(bin_file);
-            exit(1);
+        while(io_bin_link_iter_next(&link_iter, &link_time, &link_rec) == TRUE) {
+            if(type == PRINT_SC) {
+                io_binary_print_record(link_rec);
+            }
+            else if(type == PRINT_GNUPLOT) {
+                io_bin_rec2gnuplot(link_rec, link_time);
+            }
         }
+        io_bin_reader_close(&bin_reader);
+        return 0;
+    }
 
-        if(io_binary_read_records_from_file(bin_recs, binary_time_record.record_number, bin_file) == ERROR) {
-            WARNING("Aborting on input error (records)");
-            fclose(bin_file);
-            exit(1);
-        }
+    while(io_bin_reader_next_batch(&bin_reader, &binary_time_record, &bin_recs) == TRUE) {
+        io_binary_print_time_record(binary_time_record);
 
-        for(rec_i = 0; rec_i < binary_time_record.record_number; rec_i++) {
+        for(rec_i = 0; rec_i < binary_time_record->record_number; rec_i++) {
             if(src_id == -1 || src_id == bin_recs[rec_i].from_id) {
                 if(dst_id == -1 || dst_id == bin_recs[rec_i].to_id) {
                     if(type == PRINT_SC) {
                         io_binary_print_record(&bin_recs[rec_i]);
                     }
                     else if(type == PRINT_GNUPLOT) {
-                        io_bin_rec2gnuplot(&bin_recs[rec_i], binary_time_record.time);
+                        io_bin_rec2gnuplot(&bin_recs[rec_i], binary_time_record->time);
                     }
                 }
             }
         }
     }
 
-    free(bin_recs);
-    fclose(bin_file);
+    io_bin_reader_close(&bin_reader);
 
     return 0;
 }
@@ -117,6 +117,9 @@ struct connection_class
   // received power by 'to_node' in dBm
   double Pr;
 
+  // standard deviation of the shadowing included in Pr
+  double shadowing_sigma;
+
   // SNR for signal received by 'to_node' in dB
   double SNR;
 
@@ -212,6 +215,24 @@ int connection_do_compute (struct connection_class *connection,
 			   struct scenario_class *scenario,
 			   int *deltaQ_changed);
 
+// return the shadowing term of the received power of a connection,
+// drawn from a normal distribution with standard deviation 'sigma';
+// while the scenario defers shadowing, no value is drawn and 0 is
+// returned; 'sigma' is saved in the connection in both cases
+double connection_shadowing (struct connection_class *connection,
+			     struct scenario_class *scenario, double sigma);
+
+// apply the fixed_deltaQ record of a connection that corresponds
+// to 'current_time', if any
+void connection_apply_fixed_deltaQ (struct connection_class *connection,
+				    double current_time);
+
+// update the state of a connection (e.g., relative distance, Pr)
+// after the state of the system changed;
+// return SUCCESS on succes, ERROR on error
+int connection_update (struct connection_class *connection,
+		       struct scenario_class *scenario);
+
 // update the state and calculate all deltaQ parameters 
 // for the current connection;
 // deltaQ parameters are returned in the corresponding fields of
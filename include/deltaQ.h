@@ -39,6 +39,7 @@
 #include "scenario.h"
 #include "xml_scenario.h"
 #include "io.h"
+#include "io_text.h"
 
 
 ///////////////////////////////////////////////////////////
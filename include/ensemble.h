@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: ensemble.h
+ * Function: Header file of ensemble.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __ENSEMBLE_H
+#define __ENSEMBLE_H
+
+#include <stdio.h>
+
+#include "deltaQ.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// maximum number of replicas of an ensemble
+#define MAX_ENSEMBLE_REPLICAS           1000
+
+// quantile of the normal distribution used for the confidence
+// intervals of ensemble output (95% confidence)
+#define ENSEMBLE_CONFIDENCE_Z           1.96
+
+
+//////////////////////////////////
+// Ensemble structures
+//////////////////////////////////
+
+// Monte Carlo ensemble of a scenario: all replicas share the node
+// motion and the deterministic part of connection state (distance
+// and path loss), and each replica draws its own shadowing and keeps
+// its own connection state (e.g., operating rate); replica 0 uses
+// the shared random stream, like a single run, and the other replicas use their own
+// random state
+struct ensemble_class
+{
+  int replica_number;
+
+  // connections of each replica
+  struct connection_class **connections;
+
+  // random state of each replica (not used for replica 0)
+  unsigned int *rand_states;
+};
+
+
+////////////////////////////////////////////////
+// Ensemble functions
+////////////////////////////////////////////////
+
+// init an ensemble of 'replica_number' replicas that start from
+// the current connection state of 'scenario';
+// return SUCCESS on succes, ERROR on error
+int ensemble_init (struct ensemble_class *ensemble,
+		   struct scenario_class *scenario, int replica_number);
+
+// compute deltaQ parameters for all replicas at 'current_time';
+// the connections of 'scenario' are set to those of replica 0;
+// return SUCCESS on succes, ERROR on error
+int ensemble_deltaQ (struct ensemble_class *ensemble,
+		     struct scenario_class *scenario, double current_time);
+
+// write the header of ensemble output to 'file'
+void ensemble_write_header (struct ensemble_class *ensemble, FILE * file,
+			    char *qomet_name);
+
+// write to 'file' the mean and confidence interval of the deltaQ
+// parameters of all replicas for each connection (except those
+// starting from noise sources); return SUCCESS on succes,
+// ERROR on error
+int ensemble_write_step (struct ensemble_class *ensemble,
+			 struct scenario_class *scenario, double time,
+			 FILE * file);
+
+// release the resources of an ensemble
+void ensemble_free (struct ensemble_class *ensemble);
+
+#endif
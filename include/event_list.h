@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: event_list.h
+ * Function: Header file of event_list.c
+ *
+ ***********************************************************************/
+
+#ifndef __EVENT_LIST_H
+#define __EVENT_LIST_H
+
+#include <stdint.h>
+
+// signature and version of event list files
+#define EVENT_LIST_SIGNATURE            "QEVL"
+#define EVENT_LIST_VERSION              1
+
+// header of an event list file; the host parameters are those
+// of the meteor instance the list was compiled for
+struct event_list_header {
+    char signature[4];
+    uint32_t version;
+    int32_t direction;
+    int32_t assign_id;
+    int32_t division;
+    int32_t node_count;
+    double quantum;             // [s]
+    uint32_t event_count;
+    uint32_t pipe_count;
+};
+
+// change of the configuration of a pipe; the events of a list are
+// sorted by time, and the events of a pipe are all different
+struct event_rec {
+    double time;                // [s]
+    uint32_t pipe;
+    float bandwidth;            // [bit/s]
+    float delay;                // [ms]
+    float loss_rate;
+    float jitter;               // [ms]
+};
+
+// state of a pipe while a list is compiled
+struct event_pipe {
+    uint32_t pipe;
+    int used;
+    int32_t last_event;         // index of the last event of the pipe
+    struct event_rec current;   // configuration after the last event
+};
+
+struct event_list {
+    struct event_list_header header;
+    struct event_rec *events;
+    uint32_t event_size;
+
+    // next event to be returned by event_list_next()
+    uint32_t next;
+
+    // last configuration of each pipe before the time of event_list_seek()
+    struct event_rec *seek_events;
+
+    // compilation state: events closer than 'quantum' to the first
+    // event of the current group are merged into that group
+    struct event_pipe *pipes;
+    uint32_t pipe_size;
+    double group_time;
+    int group_open;
+};
+
+// start compiling an event list with at most 'pipe_count' pipes;
+// return SUCCESS or ERROR
+int event_list_init(struct event_list *el, int32_t direction, int32_t assign_id, int32_t division,
+                    int32_t node_count, double quantum, uint32_t pipe_count);
+
+// add the configuration of 'pipe' at time 'time', which must not be
+// earlier than that of the previous call; configurations equal to the
+// current one of the pipe are dropped; return SUCCESS or ERROR
+int event_list_add(struct event_list *el, double time, uint32_t pipe, float bandwidth,
+                   float delay, float loss_rate, float jitter);
+
+int event_list_write(struct event_list *el, const char *file_name);
+int event_list_read(struct event_list *el, const char *file_name);
+
+// return the number of events with the earliest deadline that were
+// not returned yet (0 at the end of the list), and set 'deadline'
+// and 'events' accordingly
+int event_list_next(struct event_list *el, double *deadline, const struct event_rec **events);
+
+// make the first event at or after 'time' the next one, and return
+// the number of pipes changed before it (-1 on error); 'events' is set
+// to their configuration at 'time'
+int event_list_seek(struct event_list *el, double time, const struct event_rec **events);
+
+void event_list_rewind(struct event_list *el);
+void event_list_free(struct event_list *el);
+
+#endif
@@ -24,6 +24,7 @@
 #define __GENERIC_H
 
 #include <stdint.h>
+#include <stdlib.h>
 
 #include "deltaQ.h"
 
@@ -31,6 +32,34 @@
 #define SPEED_LIGHT                     2.9979e8
 #define ANTENNA_MAX_ATTENUATION         100.0
 
+// size of the state of random streams (same as that of rand())
+#define GENERIC_RAND_STREAM_STATE_SIZE  128
+
+
+/////////////////////////////////////////////
+// Random stream structure
+/////////////////////////////////////////////
+
+// random stream of the random functions below; once seeded, it
+// generates the same values as rand() seeded with the same value;
+// a shared stream is used by default, and a thread can use a stream
+// of its own, so that threads computing separate scenarios produce
+// the same results as separate processes
+struct generic_rand_stream_class
+{
+  struct random_data data;
+  char state[GENERIC_RAND_STREAM_STATE_SIZE];
+};
+
+// state of a random stream that can be saved to a file: the state
+// array, and the positions in it of the front and rear pointers
+struct generic_rand_saved_class
+{
+  char state[GENERIC_RAND_STREAM_STATE_SIZE];
+  int32_t front_i;
+  int32_t rear_i;
+};
+
 
 /////////////////////////////////////////////
 // Generic functions
@@ -48,6 +77,40 @@ double double_value (const char *string);
 // return the value on success, LONG_MIN on error
 long int long_int_value (const char *string);
 
+// make the random functions below use 'rand_state' in the current
+// thread, so that threads do not share the random stream;
+// use NULL to return to the random stream; return the previous
+// random state
+unsigned int *generic_set_rand_state (unsigned int *rand_state);
+
+// init a random stream seeded with 'seed'
+void generic_rand_stream_init (struct generic_rand_stream_class *stream,
+			       unsigned int seed);
+
+// make the current thread use 'stream' instead of the shared random
+// stream (use NULL to return to the shared stream); random states set
+// by generic_set_rand_state still take precedence;
+// return the previous random stream
+struct generic_rand_stream_class *generic_set_rand_stream (struct
+							   generic_rand_stream_class
+							   *stream);
+
+// seed the random stream of the current thread
+// (by default the shared one)
+void generic_rand_seed (unsigned int seed);
+
+// save to 'saved' the state of the random stream of the current
+// thread (by default the shared one)
+void generic_rand_save (struct generic_rand_saved_class *saved);
+
+// restore the state of the random stream of the current thread
+// (by default the shared one) from 'saved';
+// return SUCCESS on succes, ERROR if 'saved' is not valid
+int generic_rand_restore (struct generic_rand_saved_class *saved);
+
+// generate a random integer in the interval [0,RAND_MAX]
+int generic_rand ();
+
 // generate a random number in the interval [0,1)
 double rand_0_1 ();
 
@@ -35,6 +35,13 @@
 
 #define DEFAULT_NS2_SPEED       1e6
 
+// minimum buffer size for 'io_format_fixed' and 'io_format_int'
+#define IO_FORMAT_SIZE          32
+
+// buffer size for one line of text output; large enough even if
+// all fields need the printf fallback of 'io_format_fixed'
+#define IO_LINE_SIZE            8192
+
 
 //////////////////////////////////
 // Binary I/O file structures
@@ -87,6 +94,20 @@ struct io_connection_state_class
 };
 
 
+////////////////////////////////////////////////
+// File mapping functions
+////////////////////////////////////////////////
+
+// make the whole content of a file available in memory, by mapping
+// it if possible and by reading it otherwise; 'mapped' is set to
+// TRUE in the first case; return SUCCESS on succes, ERROR on error
+int io_map_file (const char *filename, char **data, size_t * size,
+		 int *mapped);
+
+// release the memory obtained with 'io_map_file'
+void io_unmap_file (char *data, size_t size, int mapped);
+
+
 ////////////////////////////////////////////////
 // Text I/O functions
 ////////////////////////////////////////////////
@@ -94,6 +115,20 @@ struct io_connection_state_class
 // write the header of the file in which connection description will be stored
 void io_write_header_to_file (FILE * file_global, char *qomet_name);
 
+// write 'value' to 'buffer' exactly as printf ("%.*f", precision, value);
+// return the number of characters written
+int io_format_fixed (char *buffer, size_t size, double value, int precision);
+
+// write an integer in decimal form; return the number of characters
+int io_format_int (char *buffer, int value);
+
+// format connection description as one line of text output into
+// 'line', which must be at least IO_LINE_SIZE bytes long;
+// return the length of the line
+int io_format_connection (struct connection_class *connection,
+			  struct scenario_class *scenario, double time,
+			  int cartesian_coord_syst, char *line);
+
 // write connection description to file
 void io_write_to_file (struct connection_class *connection,
 		       struct scenario_class *scenario, double time,
@@ -155,18 +190,18 @@ int io_read_settings_file_mac (char *settings_filename,
 ////////////////////////////////////////////////
 
 // print binary header
-void io_binary_print_header (struct bin_hdr_cls *bin_hdr);
+void io_binary_print_header (const struct bin_hdr_cls *bin_hdr);
 
 // print binary time record
-void io_binary_print_time_record (struct bin_time_rec_cls
+void io_binary_print_time_record (const struct bin_time_rec_cls
 				  *binary_time_record);
 
 // print binary record
-void io_binary_print_record (struct bin_rec_cls *binary_record);
-void io_bin_rec2gnuplot(struct bin_rec_cls *bin_rec, double time);
+void io_binary_print_record (const struct bin_rec_cls *binary_record);
+void io_bin_rec2gnuplot(const struct bin_rec_cls *bin_rec, double time);
 
 // copy binary record
-void io_bin_cp_rec(struct bin_rec_cls *binary_record_dst, struct bin_rec_cls *binary_record_src);
+void io_bin_cp_rec(struct bin_rec_cls *binary_record_dst, const struct bin_rec_cls *binary_record_src);
 
 // build binary record
 void io_binary_build_record (struct bin_rec_cls *binary_record,
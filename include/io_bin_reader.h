@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_bin_reader.h
+ * Function: Header file of io_bin_reader.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_BIN_READER_H
+#define __IO_BIN_READER_H
+
+#include <stddef.h>
+
+#include "global.h"
+#include "io.h"
+
+
+//////////////////////////////////
+// Binary reader structures
+//////////////////////////////////
+
+// entry of the per-link index: a record and its time record
+struct io_bin_link_entry_cls
+{
+  long int time_rec_i;
+  size_t offset;
+};
+
+// random-access reader for QOMET binary output; the file is mapped
+// in memory, and the records are accessed in place
+struct io_bin_reader_cls
+{
+  char filename[MAX_STRING];
+
+  // file contents and size
+  char *data;
+  size_t size;
+  int mapped;
+
+  // file header (points into 'data')
+  const struct bin_hdr_cls *header;
+
+  // number of complete time records, and the offset of each of them
+  long int time_rec_num;
+  size_t *time_rec_offsets;
+
+  // index of the time record returned by the next call
+  // of 'io_bin_reader_next_batch'
+  long int position;
+
+  // per-link index, built on first use: the records of the link
+  // 'from_id * if_num + to_id' are the entries between
+  // 'link_starts[link]' and 'link_starts[link + 1]'
+  long int *link_starts;
+  struct io_bin_link_entry_cls *link_entries;
+};
+
+// iterator over the records of one link
+struct io_bin_link_iter_cls
+{
+  struct io_bin_reader_cls *reader;
+  long int current;
+  long int end;
+};
+
+
+////////////////////////////////////////////////
+// Binary reader functions
+////////////////////////////////////////////////
+
+// open a QOMET binary output file and index its time records;
+// return SUCCESS on succes, ERROR on error
+int io_bin_reader_open (struct io_bin_reader_cls *reader,
+			const char *filename);
+
+// release the resources used by a reader
+void io_bin_reader_close (struct io_bin_reader_cls *reader);
+
+// restart reading from the first time record
+void io_bin_reader_rewind (struct io_bin_reader_cls *reader);
+
+// position the reader on the first time record whose time is not
+// earlier than 'time'; return the index of that time record (equal
+// to 'time_rec_num' if all records are earlier)
+long int io_bin_reader_seek (struct io_bin_reader_cls *reader, double time);
+
+// get the next time record and its records without copying them;
+// return TRUE if a time record was available, FALSE at end of file
+int io_bin_reader_next_batch (struct io_bin_reader_cls *reader,
+			      const struct bin_time_rec_cls **time_record,
+			      const struct bin_rec_cls **records);
+
+// init an iterator over the records of the link 'from_id' -> 'to_id';
+// return SUCCESS on succes, ERROR on error
+int io_bin_reader_link_iter (struct io_bin_reader_cls *reader,
+			     int from_id, int to_id,
+			     struct io_bin_link_iter_cls *iter);
+
+// get the next record of a link and the time at which it applies;
+// return TRUE if a record was available, FALSE otherwise
+int io_bin_link_iter_next (struct io_bin_link_iter_cls *iter, float *time,
+			   const struct bin_rec_cls **record);
+
+// get the record in effect for the link 'from_id' -> 'to_id' at 'time',
+// that is, the last record of the link whose time is not later than
+// 'time'; return NULL if there is no such record
+const struct bin_rec_cls *io_bin_reader_link_state (struct io_bin_reader_cls
+						    *reader, int from_id,
+						    int to_id, double time);
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_checkpoint.h
+ * Function: Header file of io_checkpoint.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_CHECKPOINT_H
+#define __IO_CHECKPOINT_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "deltaQ.h"
+#include "generic.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// signature and version of checkpoint files
+#define IO_CHECKPOINT_SIGNATURE         "QCK"
+#define IO_CHECKPOINT_VERSION           2
+
+
+//////////////////////////////////
+// Checkpoint structures
+//////////////////////////////////
+
+// state of a deltaQ run that is not part of the scenario; offsets
+// are set to -1 for disabled outputs
+struct io_checkpoint_class
+{
+  // first step of the run, and next step to be computed
+  long int first_step_i;
+  long int step_i;
+
+  // number of time records in binary output
+  long int time_rec_num;
+
+  // state of the shared random stream
+  struct generic_rand_saved_class rand_state;
+
+  // size of output files after the last computed step
+  long int text_offset;
+  long int binary_offset;
+  long int motion_offset;
+};
+
+// header of checkpoint files; structure sizes and element
+// numbers are used to detect checkpoints that belong to another
+// scenario or were written by an incompatible version
+struct io_checkpoint_header_class
+{
+  char signature[4];
+  int32_t version;
+
+  int32_t node_size;
+  int32_t environment_size;
+  int32_t motion_state_size;
+  int32_t connection_size;
+  int32_t binary_record_size;
+
+  int32_t node_number;
+  int32_t environment_number;
+  int32_t motion_number;
+  int32_t connection_number;
+  int32_t if_num;
+
+  int64_t first_step_i;
+  int64_t step_i;
+  int64_t time_rec_num;
+  struct generic_rand_saved_class rand_state;
+
+  int64_t text_offset;
+  int64_t binary_offset;
+  int64_t motion_offset;
+};
+
+
+////////////////////////////////////////////////
+// Checkpoint functions
+////////////////////////////////////////////////
+
+// write to file 'filename' a checkpoint with the state of 'scenario',
+// the binary output state 'io_connection_state' and the run state
+// 'checkpoint'; the previous checkpoint is only replaced once the
+// new one was completely written; return SUCCESS on succes,
+// ERROR on error
+int io_checkpoint_write (char *filename,
+			 struct io_checkpoint_class *checkpoint,
+			 struct scenario_class *scenario,
+			 struct io_connection_state_class
+			 *io_connection_state);
+
+// read from file 'filename' a checkpoint written for the same
+// initialized scenario, and restore the state of 'scenario' and
+// 'io_connection_state'; the run state is stored in 'checkpoint';
+// return SUCCESS on succes, ERROR on error
+int io_checkpoint_read (char *filename,
+			struct io_checkpoint_class *checkpoint,
+			struct scenario_class *scenario,
+			struct io_connection_state_class
+			*io_connection_state);
+
+// discard the content of output file 'file' after 'offset', and
+// continue writing from there; return SUCCESS on succes,
+// ERROR on error
+int io_checkpoint_truncate_file (FILE * file, long int offset);
+
+#endif
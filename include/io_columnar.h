@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_columnar.h
+ * Function: Header file of io_columnar.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_COLUMNAR_H
+#define __IO_COLUMNAR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "deltaQ.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// columns stored for each link, in the order of 'bin_rec_cls'
+#define IO_COLUMN_FRAME_ERROR_RATE      0
+#define IO_COLUMN_NUM_RETRANSMISSIONS   1
+#define IO_COLUMN_STANDARD              2
+#define IO_COLUMN_OPERATING_RATE        3
+#define IO_COLUMN_BANDWIDTH             4
+#define IO_COLUMN_LOSS_RATE             5
+#define IO_COLUMN_DELAY                 6
+#define IO_COLUMNS                      7
+
+// maximum number of steps in a chunk
+#define IO_COLUMNAR_CHUNK_STEPS         4096
+
+// memory shared by the append buffers of all links, and the
+// limits of the buffer size of each column
+#define IO_COLUMNAR_MEMORY              (16 * 1024 * 1024)
+#define IO_COLUMNAR_MIN_COLUMN_SIZE     64
+#define IO_COLUMNAR_MAX_COLUMN_SIZE     (16 * 1024)
+
+
+//////////////////////////////////
+// Columnar file structures
+//////////////////////////////////
+
+// The columnar output ('.col' file) is link-major: the values of
+// each metric of a link are stored contiguously, in chunks of
+// consecutive steps. A value is stored as the XOR between its bits
+// and those of the previous value of the same column in the chunk
+// (0 for the first one), encoded as a variable-length integer, so
+// unchanged values take one byte. The file layout is:
+//   header | chunks | link table | chunk table
+// where each chunk is a chunk header followed by its columns, and
+// the two tables start at 'index_offset'. The time of step 'i' is
+// 'start_time + i * step'.
+
+// columnar file header
+struct io_columnar_hdr_cls
+{
+  char signature[4];
+  int32_t major_version;
+  int32_t minor_version;
+  int32_t subminor_version;
+  int32_t svn_revision;
+  int32_t if_num;
+  int32_t link_num;
+  int32_t step_num;
+  int32_t chunk_num;
+  int32_t column_num;
+  double start_time;
+  double step;
+  uint64_t index_offset;
+};
+
+// chunk header, followed by the data of each column
+struct io_columnar_chunk_hdr_cls
+{
+  int32_t link_i;
+  int32_t first_step;
+  int32_t step_num;
+  uint32_t column_sizes[IO_COLUMNS];
+};
+
+// link table entry; the chunks of the link are the entries
+// between 'first_chunk' and 'first_chunk + chunk_num' of the
+// chunk table, in step order
+struct io_columnar_link_cls
+{
+  int32_t from_id;
+  int32_t to_id;
+  int32_t first_chunk;
+  int32_t chunk_num;
+};
+
+// chunk table entry
+struct io_columnar_chunk_cls
+{
+  uint64_t offset;
+  int32_t first_step;
+  int32_t step_num;
+};
+
+
+//////////////////////////////////
+// Writer structures
+//////////////////////////////////
+
+// append buffer of one link, holding its current chunk
+struct io_columnar_link_buffer_cls
+{
+  int connection_i;
+  int32_t from_id;
+  int32_t to_id;
+
+  int32_t first_step;
+  int32_t step_num;
+
+  unsigned char *columns[IO_COLUMNS];
+  uint32_t used[IO_COLUMNS];
+  uint32_t previous[IO_COLUMNS];
+};
+
+// chunk table entry kept in memory until the end of the run
+struct io_columnar_chunk_entry_cls
+{
+  int32_t link_i;
+  struct io_columnar_chunk_cls chunk;
+};
+
+// writer of columnar output; only the current chunk of each link
+// and the chunk table are kept in memory
+struct io_columnar_writer_cls
+{
+  FILE *file;
+  struct io_columnar_hdr_cls header;
+
+  struct io_columnar_link_buffer_cls *links;
+  unsigned char *column_memory;
+  size_t column_size;
+
+  struct io_columnar_chunk_entry_cls *chunks;
+  long int chunk_max_num;
+
+  uint64_t offset;
+
+  // TRUE if writing to file failed
+  int write_error;
+};
+
+
+//////////////////////////////////
+// Reader structures
+//////////////////////////////////
+
+// reader of columnar output; the file is mapped in memory
+struct io_columnar_reader_cls
+{
+  char filename[MAX_STRING];
+
+  char *data;
+  size_t size;
+  int mapped;
+
+  // file header and tables (point into 'data')
+  const struct io_columnar_hdr_cls *header;
+  const struct io_columnar_link_cls *links;
+  const struct io_columnar_chunk_cls *chunks;
+};
+
+
+////////////////////////////////////////////////
+// Writer functions
+////////////////////////////////////////////////
+
+// init a writer of columnar output for the connections of 'scenario'
+// (except those starting from noise sources), and write a provisional
+// header to 'file'; return SUCCESS on succes, ERROR on error
+int io_columnar_init (struct io_columnar_writer_cls *writer, FILE * file,
+		      struct scenario_class *scenario, double start_time,
+		      double step, int major_version, int minor_version,
+		      int subminor_version, int svn_revision);
+
+// append the current state of all links as a new step;
+// return SUCCESS on succes, ERROR on error
+int io_columnar_write_step (struct io_columnar_writer_cls *writer,
+			    struct scenario_class *scenario);
+
+// write the pending chunks, the link and chunk tables, and the final
+// header, and release the resources of the writer (the file itself is
+// not closed); return SUCCESS on succes, ERROR if any write failed
+int io_columnar_finalize (struct io_columnar_writer_cls *writer);
+
+
+////////////////////////////////////////////////
+// Reader functions
+////////////////////////////////////////////////
+
+// open a columnar output file and check its tables;
+// return SUCCESS on succes, ERROR on error
+int io_columnar_open (struct io_columnar_reader_cls *reader,
+		      const char *filename);
+
+// release the resources used by a reader
+void io_columnar_close (struct io_columnar_reader_cls *reader);
+
+// find the link 'from_id' -> 'to_id';
+// return its index, or ERROR if it is not in the file
+int io_columnar_find_link (struct io_columnar_reader_cls *reader,
+			   int from_id, int to_id);
+
+// decode one column of a link into 'values', which must hold
+// 'step_num' values; steps not covered by any chunk are set to 0;
+// return SUCCESS on succes, ERROR on error
+int io_columnar_read_column (struct io_columnar_reader_cls *reader,
+			     int link_i, int column_i, float *values);
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_slice.h
+ * Function: Header file of io_slice.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_SLICE_H
+#define __IO_SLICE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "deltaQ.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// size of the stdio buffer of each slice file
+#define IO_SLICE_FILE_BUFFER_SIZE       (64 * 1024)
+
+// initial number of records buffered for each slice during a step
+#define IO_SLICE_INITIAL_RECORDS        64
+
+
+//////////////////////////////////
+// Slice structures
+//////////////////////////////////
+
+// one slice: the binary output for a group of consecutive node ids
+struct io_slice_cls
+{
+  char filename[MAX_STRING];
+  FILE *file;
+  char *file_buffer;
+
+  // records of the current step
+  struct bin_rec_cls *records;
+  int record_number;
+  int record_max_number;
+};
+
+// writer of per-host binary output: slice 'i' holds the records
+// whose source or destination id is in the range
+// [i * group_size, (i + 1) * group_size), with the same time
+// records as the global binary output, so that each meteor
+// instance only needs to read the slice of its own node
+struct io_slice_writer_cls
+{
+  int if_num;
+  int group_size;
+  int slice_num;
+  struct io_slice_cls *slices;
+
+  long int time_rec_num;
+
+  // records whose ids are out of range
+  long int ignored_record_number;
+
+  // header fields
+  int major_version;
+  int minor_version;
+  int subminor_version;
+  int svn_revision;
+};
+
+
+////////////////////////////////////////////////
+// Slice functions
+////////////////////////////////////////////////
+
+// create the slice files '<filename_base>.<slice>.bin' for 'if_num'
+// ids grouped by 'group_size', and write their provisional headers;
+// return SUCCESS on succes, ERROR on error
+int io_slice_init (struct io_slice_writer_cls *writer, char *filename_base,
+		   int if_num, int group_size, int major_version,
+		   int minor_version, int subminor_version,
+		   int svn_revision);
+
+// add a record of the current step to the slices of its source
+// and destination
+void io_slice_add_record (struct io_slice_writer_cls *writer,
+			  struct bin_rec_cls *record);
+
+// write a time record with the records added since the previous
+// step to every slice; return SUCCESS on succes, ERROR on error
+int io_slice_end_step (struct io_slice_writer_cls *writer, float time);
+
+// rewrite the headers of all slices, close them and release the
+// resources of the writer; return SUCCESS on succes, ERROR on error
+int io_slice_finalize (struct io_slice_writer_cls *writer);
+
+#endif
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_summary.h
+ * Function: Header file of io_summary.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_SUMMARY_H
+#define __IO_SUMMARY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "deltaQ.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// metrics summarized for each link
+#define IO_SUMMARY_LOSS_RATE            0
+#define IO_SUMMARY_DELAY                1
+#define IO_SUMMARY_BANDWIDTH            2
+#define IO_SUMMARY_METRICS              3
+
+// number of histogram bins per power of 2; quantiles are
+// estimated within about 6% of the actual value
+#define IO_SUMMARY_BINS_PER_OCTAVE      8
+
+// a link is considered in outage while its loss rate is
+// at least this value
+#define IO_SUMMARY_OUTAGE_LOSS_RATE     0.5
+
+
+//////////////////////////////////
+// Summary structures
+//////////////////////////////////
+
+// streaming statistics of one metric of a link: mean and variance
+// (Welford's method), extremes, and a histogram with logarithmic
+// bins for quantiles; bin 0 holds values below the histogram range
+// (including 0), and the last bin those above it
+struct io_summary_metric_cls
+{
+  double mean;
+  double m2;
+  double min;
+  double max;
+  uint32_t *bins;
+};
+
+// statistics of one link
+struct io_summary_link_cls
+{
+  int connection_i;
+  int32_t from_id;
+  int32_t to_id;
+
+  int64_t step_num;
+  struct io_summary_metric_cls metrics[IO_SUMMARY_METRICS];
+
+  // outages (runs of steps with high loss rate)
+  int64_t outage_num;
+  int64_t outage_steps;
+  int64_t current_outage_steps;
+  int64_t longest_outage_steps;
+};
+
+// accumulator of per-link statistics over a whole run; all the
+// memory is allocated at init, and each step costs O(1) per link
+struct io_summary_class
+{
+  double step;
+
+  int link_num;
+  struct io_summary_link_cls *links;
+  uint32_t *bin_memory;
+};
+
+
+////////////////////////////////////////////////
+// Summary functions
+////////////////////////////////////////////////
+
+// init per-link statistics for the connections of 'scenario' (except
+// those starting from noise sources); 'step' is the duration of a
+// step; return SUCCESS on succes, ERROR on error
+int io_summary_init (struct io_summary_class *summary,
+		     struct scenario_class *scenario, double step);
+
+// add the current state of all links to the statistics
+void io_summary_update (struct io_summary_class *summary,
+			struct scenario_class *scenario);
+
+// write the statistics of all links to 'file' as text, one line
+// per link; return SUCCESS on succes, ERROR on error
+int io_summary_write (struct io_summary_class *summary, FILE * file,
+		      char *qomet_name);
+
+// release the resources of the statistics
+void io_summary_free (struct io_summary_class *summary);
+
+#endif
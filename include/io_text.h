@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_text.h
+ * Function: Header file of io_text.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_TEXT_H
+#define __IO_TEXT_H
+
+#include <stddef.h>
+
+#include "global.h"
+
+struct bin_rec_cls;
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// number of fields in a line of QOMET text output
+#define IO_TEXT_FIELDS          19
+
+
+//////////////////////////////////
+// Text I/O structures
+//////////////////////////////////
+
+// one line of QOMET text output (see 'io_write_to_file')
+struct io_text_rec_cls
+{
+  double time;
+
+  int from_id;
+  double from_x, from_y, from_z;
+
+  int to_id;
+  double to_x, to_y, to_z;
+
+  double distance;
+  double Pr;
+  double SNR;
+  double frame_error_rate;
+  double num_retransmissions;
+  double operating_rate;
+  double bandwidth;
+  double loss_rate;
+  double delay;
+  double jitter;
+};
+
+// reader for QOMET text output; the file is mapped in memory
+// and parsed in place, without any per-line allocation
+struct io_text_reader_cls
+{
+  char filename[MAX_STRING];
+
+  // file contents and size
+  char *data;
+  size_t size;
+
+  // TRUE if 'data' is mapped, FALSE if it was read into memory
+  int mapped;
+
+  // offset of the next line to be parsed
+  size_t position;
+
+  // number of the last line that was parsed (starting from 1)
+  long int line_nr;
+
+  // position of the last parse error (starting from 1),
+  // and its description
+  int error_column;
+  const char *error;
+};
+
+
+////////////////////////////////////////////////
+// Text input functions
+////////////////////////////////////////////////
+
+// open a QOMET text output file for reading;
+// return SUCCESS on succes, ERROR on error
+int io_text_open (struct io_text_reader_cls *reader, const char *filename);
+
+// release the resources used by a reader
+void io_text_close (struct io_text_reader_cls *reader);
+
+// restart reading from the beginning of the file
+void io_text_rewind (struct io_text_reader_cls *reader);
+
+// read the next record, skipping empty lines and comments;
+// return TRUE if a record was read, FALSE at end of file, and
+// ERROR if the line is invalid ('line_nr', 'error_column' and 'error'
+// describe the problem, and the next call continues with the next line)
+int io_text_read_record (struct io_text_reader_cls *reader,
+			 struct io_text_rec_cls *text_record);
+
+// parse one line of QOMET text output of given length;
+// return TRUE if a record was parsed, FALSE if the line is empty
+// or a comment, and ERROR on error (in which case 'error_column'
+// and 'error' are set, if not NULL)
+int io_text_parse_line (const char *line, size_t length,
+			struct io_text_rec_cls *text_record,
+			int *error_column, const char **error);
+
+// fill a binary record with the fields of a text record
+void io_text_to_binary_record (struct io_text_rec_cls *text_record,
+			       struct bin_rec_cls *binary_record);
+
+// print a parse error of a reader in the usual form
+// "file:line:column: description"
+void io_text_print_error (struct io_text_reader_cls *reader);
+
+#endif
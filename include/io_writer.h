@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: io_writer.h
+ * Function: Header file of io_writer.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __IO_WRITER_H
+#define __IO_WRITER_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "deltaQ.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// number of buffers used by the writer
+#define IO_WRITER_BUFFERS       4
+
+// size of each writer buffer
+#define IO_WRITER_BUFFER_SIZE   (1024 * 1024)
+
+// amount of data after which a completed step is handed to the
+// writer thread; smaller steps are accumulated in the same buffer
+#define IO_WRITER_STEP_SIZE     (64 * 1024)
+
+
+//////////////////////////////////
+// Writer structures
+//////////////////////////////////
+
+struct io_writer_buffer_class
+{
+  char *data;
+  size_t used;
+};
+
+// asynchronous writer of text output: lines are formatted into
+// the current buffer, and full buffers are written to file by a
+// separate thread, so that computation overlaps with output
+struct io_writer_class
+{
+  FILE *file;
+
+  struct io_writer_buffer_class buffers[IO_WRITER_BUFFERS];
+
+  // index of the buffer being filled
+  int current;
+
+  // index of the oldest buffer waiting to be written, and
+  // number of buffers waiting to be written
+  int head;
+  int count;
+
+  // TRUE if the writer thread should exit when the queue is empty
+  int finished;
+
+  // TRUE if writing to file failed
+  int write_error;
+
+  // TRUE if the writer thread is running; if it could not be
+  // started, buffers are written synchronously
+  int threaded;
+
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t queue_changed;
+};
+
+
+////////////////////////////////////////////////
+// Writer functions
+////////////////////////////////////////////////
+
+// init a writer for 'file' and start its thread;
+// return SUCCESS on succes, ERROR on error
+int io_writer_init (struct io_writer_class *writer, FILE * file);
+
+// format connection description as text output and add it to
+// the current buffer; return SUCCESS on succes, ERROR on error
+int io_writer_write_connection (struct io_writer_class *writer,
+				struct connection_class *connection,
+				struct scenario_class *scenario,
+				double time, int cartesian_coord_syst);
+
+// mark the end of a time step; the current buffer is handed to the
+// writer thread if it holds enough data;
+// return SUCCESS on succes, ERROR on error
+int io_writer_end_step (struct io_writer_class *writer);
+
+// write all pending data to file, so that the file holds all the
+// steps ended so far; return SUCCESS on succes, ERROR on error
+int io_writer_flush (struct io_writer_class *writer);
+
+// write all pending data, stop the writer thread and release
+// its resources (the file itself is not closed);
+// return SUCCESS on succes, ERROR if any write failed
+int io_writer_finalize (struct io_writer_class *writer);
+
+#endif
@@ -8,7 +8,7 @@ typedef struct if_list {
 };
 */
 
-extern struct rtnl_handle rth;
+extern __thread struct rtnl_handle rth;
 extern int print_linkinfo(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg);
 extern int print_addrinfo(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg);
 extern int print_neigh(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg);
@@ -24,5 +24,6 @@ extern void ipntable_reset_filter(void);
 extern int print_route(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg);
 extern int print_prefix(const struct sockaddr_nl *who, struct nlmsghdr *n, void *arg);
 extern int set_ifb(char* devname, int cmd); 
+extern int add_ifb(char* devname);
 extern int get_iface_list(struct ifconf *ifc);
 extern int change_ifqueuelen(char *dev, uint32_t qlen);
@@ -5,6 +5,16 @@
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 
+struct rtnl_batch;
+struct rtnl_handle;
+
+/*
+ * Called by rtnl_talk() for each request that only needs an ACK,
+ * before it is sent; returns 0 to send the request, 1 if the request
+ * was handled and must not be sent, -1 on error.
+ */
+typedef int (*rtnl_intercept_t)(struct rtnl_handle *rth, struct nlmsghdr *n, void *arg);
+
 struct rtnl_handle
 {
 	int			fd;
@@ -12,6 +22,40 @@ struct rtnl_handle
 	struct sockaddr_nl	peer;
 	__u32			seq;
 	__u32			dump;
+	struct rtnl_batch	*batch;
+	rtnl_intercept_t	intercept;
+	void			*intercept_arg;
+};
+
+/*
+ * While a batch is active on a handle, rtnl_talk() requests that only
+ * need an ACK are queued and sent many per sendmsg(), with at most
+ * 'window' requests waiting for their ACK; requests that need an
+ * answer first wait for all queued requests to be acknowledged.
+ * Failed requests are passed to 'error' with the request header
+ * echoed by the kernel and the (negative) error code.
+ *
+ * While a batch is held, requests are only queued, however many they
+ * are, and rtnl_batch_release() sends them; requests that need an
+ * answer only wait for the requests already sent.
+ */
+typedef void (*rtnl_batch_error_t)(struct nlmsghdr *request, int error, void *arg);
+
+struct rtnl_batch
+{
+	char			*buf;
+	int			len;
+	int			size;		/* maximum length of one sendmsg() */
+	int			alloc;		/* allocated length of buf */
+	int			held;
+	int			queued;		/* requests in buf */
+	int			outstanding;	/* requests sent, not ACKed */
+	int			window;
+	int			sent;
+	int			acked;
+	int			failed;
+	rtnl_batch_error_t	error;
+	void			*arg;
 };
 
 extern int rtnl_open(struct rtnl_handle *rth, unsigned subscriptions);
@@ -32,6 +76,13 @@ extern int rtnl_talk(struct rtnl_handle *rtnl, struct nlmsghdr *n, pid_t peer,
 		     void *jarg);
 extern int rtnl_send(struct rtnl_handle *rth, const char *buf, int);
 
+extern int rtnl_batch_begin(struct rtnl_handle *rth, struct rtnl_batch *batch,
+			    int window, rtnl_batch_error_t error, void *arg);
+extern int rtnl_batch_flush(struct rtnl_handle *rth);
+extern void rtnl_batch_hold(struct rtnl_handle *rth);
+extern int rtnl_batch_release(struct rtnl_handle *rth);
+extern int rtnl_batch_end(struct rtnl_handle *rth);
+
 
 extern int addattr32(struct nlmsghdr *n, int maxlen, int type, __u32 data);
 extern int addattr_l(struct nlmsghdr *n, int maxlen, int type, const void *data, int alen);
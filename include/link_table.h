@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: link_table.h
+ * Function: Header file of link_table.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __LINK_TABLE_H
+#define __LINK_TABLE_H
+
+#include "global.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// maximum number of tables, and number of key parameters
+// and of tabulated values of each table
+#define LINK_TABLE_MAX_TABLES           256
+#define LINK_TABLE_KEY_SIZE             6
+#define LINK_TABLE_MAX_VALUES           4
+
+// number of grid points of a table when it is first built, and the
+// maximum number of points it can be refined to
+#define LINK_TABLE_INITIAL_POINTS       1024
+#define LINK_TABLE_MAX_POINTS           65536
+
+// maximum error of interpolated values with respect to the
+// analytic functions; the error is relative, except for values
+// smaller than LINK_TABLE_ERROR_FLOOR, for which it is relative
+// to LINK_TABLE_ERROR_FLOOR
+#define LINK_TABLE_MAX_ERROR            1e-4
+#define LINK_TABLE_ERROR_FLOOR          1e-6
+
+// smallest error rate covered by error rate tables; smaller
+// error rates are computed analytically
+#define LINK_TABLE_MIN_ERROR_RATE       1e-12
+
+// number of tables cached by each thread
+#define LINK_TABLE_CACHE_SIZE           8
+
+// kinds of tables
+#define LINK_TABLE_WLAN_FER             0
+#define LINK_TABLE_WLAN_MAC             1
+#define LINK_TABLE_ZIGBEE_FER           2
+#define LINK_TABLE_ZIGBEE_MAC           3
+#define LINK_TABLE_ACTIVE_TAG_FER       4
+
+
+//////////////////////////////////
+// Link table structures
+//////////////////////////////////
+
+// analytic function tabulated by a table: compute the values
+// corresponding to 'x' for the parameters in 'context';
+// return SUCCESS on succes, ERROR on error
+typedef int (*link_table_function) (double x, void *context, double *values);
+
+// table of the values of an analytic function over a uniform grid,
+// identified by its kind and key; a table is only valid if linear
+// interpolation between grid points meets the error bound
+struct link_table_class
+{
+  int kind;
+  double key[LINK_TABLE_KEY_SIZE];
+
+  // TRUE if the table meets the error bound
+  int valid;
+
+  // grid of the table
+  double x_min;
+  double x_max;
+  double inverse_step;
+  int point_number;
+
+  // values at each grid point
+  int value_number;
+  double *values;
+
+  // maximum error measured when the table was validated
+  double error;
+};
+
+
+//////////////////////////////////
+// Link table variables
+//////////////////////////////////
+
+// TRUE if deltaQ parameters are computed using link tables
+extern int link_table_enabled;
+
+
+////////////////////////////////////////////////
+// Link table functions
+////////////////////////////////////////////////
+
+// find the table of kind 'kind' with key 'key' (LINK_TABLE_KEY_SIZE
+// elements, unused ones being 0); return the table (which may be
+// invalid) on success, NULL if it was not built yet
+struct link_table_class *link_table_find (int kind, double *key);
+
+// build the table of kind 'kind' with key 'key' by tabulating
+// 'value_number' values of 'function' between 'x_min' and 'x_max';
+// the grid is refined until the error, measured at the middle of each
+// grid interval, meets the error bound; the grid and function must
+// only depend on 'kind' and 'key'; return the table (which may be
+// invalid) on success, NULL on error
+struct link_table_class *link_table_build (int kind, double *key,
+					   double x_min, double x_max,
+					   int value_number,
+					   link_table_function function,
+					   void *context);
+
+// interpolate the values of a table for 'x'; return TRUE if the
+// table is valid and 'x' is inside its grid, FALSE otherwise
+int link_table_lookup (struct link_table_class *table, double x,
+		       double *values);
+
+// release all the tables; no other thread may use tables meanwhile
+void link_table_free_all (void);
+
+#endif
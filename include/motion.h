@@ -87,6 +87,10 @@ extern char *motion_types[];
 
 #define MAX_MOBILITY_RECORDS            2000
 
+// seed of the random state of stateful motions (random-walk and
+// behavioral), combined with the motion id
+#define MOTION_RANDOM_SEED              1
+
 
 /////////////////////////////////////////
 // Motion structure definition
@@ -166,6 +170,45 @@ struct motion_class
   struct trace_record_class trace_records[MAX_MOBILITY_RECORDS];
   int trace_record_number;
   int trace_record_crt;
+
+  // random state of random-walk and behavioral motions, used instead
+  // of the shared random state if 'own_rand_state' is TRUE, so that
+  // their trajectory only depends on the motion itself and can be
+  // replayed (see scenario_use_motion_rand_states)
+  int own_rand_state;
+  unsigned int rand_state;
+};
+
+// the fields of a motion that change while it is applied
+struct motion_state_class
+{
+  struct coordinate_class speed;
+  double velocity;
+  double current_walk_time;
+  double angle;
+  double time_since_destination_reached;
+  int speed_from_destination;
+  int motion_sense;
+  int trace_record_crt;
+  unsigned int rand_state;
+};
+
+// time grid on which motions are applied: sub-step 'divider_i' of
+// step 'step_i' takes place at time
+//   step_times[step_i] + divider_i * motion_step
+// for all times up to 'stop_time'; step times are obtained by adding
+// 'step' repeatedly to 'start_time', as in a complete run, so that
+// rounding errors are the same wherever the computation starts
+struct motion_grid_class
+{
+  double start_time;
+  double stop_time;
+  double step;
+  double motion_step;
+  int divider_number;
+
+  double *step_times;
+  long step_number;
 };
 
 
@@ -266,4 +309,60 @@ double motion_relative_velocity (struct scenario_class *scenario,
 				 struct node_class *node1,
 				 struct node_class *node2);
 
+// save in 'state' the fields of a motion that change while it is applied
+void motion_save_state (struct motion_class *motion,
+			struct motion_state_class *state);
+
+// restore the fields of a motion saved by motion_save_state
+void motion_restore_state (struct motion_class *motion,
+			   struct motion_state_class *state);
+
+
+/////////////////////////////////////////
+// Motion time grid functions
+/////////////////////////////////////////
+
+// init the time grid of a scenario that starts at 'start_time',
+// lasts 'duration' and is computed with 'step' split into
+// 'motion_step_divider' motion sub-steps;
+// return SUCCESS on succes, ERROR on error
+int motion_grid_init (struct motion_grid_class *grid, double start_time,
+		      double duration, double step,
+		      double motion_step_divider);
+
+// free the memory used by a time grid
+void motion_grid_free (struct motion_grid_class *grid);
+
+// return the time of step 'step_i'
+double motion_grid_step_time (struct motion_grid_class *grid, long step_i);
+
+// return the index of the first step whose time is not earlier
+// than 'time'
+long motion_grid_step_index (struct motion_grid_class *grid, double time);
+
+// return the number of motion sub-steps whose time is in the
+// interval [time1, time2)
+long motion_grid_count (struct motion_grid_class *grid, double time1,
+			double time2);
+
+
+/////////////////////////////////////////
+// Closed-form motion functions
+/////////////////////////////////////////
+
+// return TRUE if the motion can be evaluated in closed form (that is,
+// without applying all its previous steps), FALSE otherwise
+int motion_has_closed_form (struct motion_class *motion);
+
+// return TRUE if the motion changes the node position, FALSE otherwise
+int motion_changes_position (struct motion_class *motion);
+
+// apply in one go all the sub-steps of 'grid' earlier than 'time'
+// during which the motion is active, starting from the node state
+// before its first sub-step; only for motions that have a closed form;
+// return SUCCESS on succes, ERROR on error
+int motion_apply_closed_form (struct motion_class *motion,
+			      struct scenario_class *scenario,
+			      struct motion_grid_class *grid, double time);
+
 #endif
@@ -0,0 +1,28 @@
+#ifndef __ROUTE_CACHE_H__
+#define __ROUTE_CACHE_H__ 1
+
+/*
+ * Cache of the IPv4 main and local routing tables, used to find the
+ * output device of a destination without a netlink request per
+ * lookup. The tables are dumped when the cache is opened, and dumped
+ * again at the first lookup after a route, rule or link notification
+ * was received. Destinations are not resolved while policy rules
+ * other than the default ones exist. Only wireconf in egress mode
+ * resolves devices from routes; in ingress mode, the default, all
+ * rules are installed on the ifb devices.
+ */
+
+// open the cache; return 0 on success, -1 on error
+extern int route_cache_open(void);
+
+// return the name of the output device for IPv4 address 'addr'
+// (an optional '/len' suffix is ignored), or NULL if the cache
+// is not open or cannot resolve 'addr' (no route, a local
+// destination, a route without a single output device, or
+// policy routing in use); lookups must be made from one thread
+extern const char *route_cache_get_dev(const char *addr);
+
+// close the cache and release its routes
+extern void route_cache_close(void);
+
+#endif /* __ROUTE_CACHE_H__ */
@@ -63,6 +63,15 @@
 #define BEHAVIORAL_MOTION               4
 #define QUALNET_MOTION                  5
 
+// maximum number of threads used to compute connections in parallel
+#define MAX_SCENARIO_THREADS            64
+
+// number of steps between the motion checkpoints saved while
+// motions without closed form are replayed, and maximum number
+// of such checkpoints
+#define MOTION_CHECKPOINT_STEPS         1000
+#define MAX_MOTION_CHECKPOINTS          64
+
 
 ////////////////////////////////////////////////
 // Scenario structure definition
@@ -95,6 +104,52 @@ struct scenario_class
 
   // current execution time of the scenario
   double current_time;
+
+  // number of threads used to compute connections (1 for serial)
+  int thread_number;
+
+  // while connections are computed in parallel, copy of their state
+  // from which interference is computed, so that threads never read
+  // a connection that another thread is updating; while an ensemble
+  // replica is computed, the connections of that replica;
+  // NULL otherwise
+  struct connection_class *interfering_connections;
+
+  // TRUE while the shadowing of connections is drawn separately
+  // from their update (see connection_shadowing)
+  int shadowing_deferred;
+
+  // saved states of node positions and motions, used to move the
+  // scenario to a given time (see scenario_motion_seek)
+  struct scenario_checkpoint_class *motion_checkpoints;
+  int motion_checkpoint_number;
+};
+
+// state of all nodes and motions before step 'step_i' of the
+// motion time grid
+struct scenario_checkpoint_class
+{
+  long step_i;
+
+  // node positions, and orientations of all node interfaces
+  // (azimuth and elevation, in node and interface order)
+  struct coordinate_class *positions;
+  double *orientations;
+
+  struct motion_state_class *motion_states;
+};
+
+// private state of a thread that computes connections in parallel:
+// its own interference flags, used instead of the shared ones in the
+// node interfaces, and the random state of the connection it
+// currently computes, derived from the connection index so that
+// results do not depend on how connections are assigned to threads
+struct scenario_worker_class
+{
+  // interference flags indexed by 'node_i * MAX_INTERFACES + interf_j'
+  char *interference_accounted;
+
+  unsigned int rand_state;
 };
 
 
@@ -156,6 +211,36 @@ int scenario_init_state (struct scenario_class *scenario,
 			 int jpgis_filename_provided, char *jpgis_filename,
 			 int cartesian_coord_syst, int deltaQ_disabled);
 
+// compute the state of all connections until their deltaQ parameters
+// do not change anymore (done by scenario_init_state, unless deltaQ
+// computation is disabled); return SUCCESS on succes, ERROR on error
+int scenario_precompute_state (struct scenario_class *scenario);
+
+// apply all the motions that are active during the sub-steps of
+// step 'step_i' of 'grid' that are earlier than 'time_limit';
+// return SUCCESS on succes, ERROR on error
+int scenario_apply_motions (struct scenario_class *scenario,
+			    struct motion_grid_class *grid, long step_i,
+			    double time_limit);
+
+// move nodes to the state they have at 'time', as if all the motion
+// sub-steps of 'grid' earlier than 'time' were applied from the
+// initial state; motions with closed form are evaluated directly,
+// and the others are replayed from the latest saved checkpoint;
+// the first call must be made while nodes are in their initial state;
+// return SUCCESS on succes, ERROR on error
+int scenario_motion_seek (struct scenario_class *scenario,
+			  struct motion_grid_class *grid, double time);
+
+// release the motion checkpoints of a scenario
+void scenario_free_motion_checkpoints (struct scenario_class *scenario);
+
+// make random-walk and behavioral motions draw from random states
+// of their own instead of the shared random state, so that they can
+// be replayed by scenario_motion_seek; their trajectories then differ
+// from those of a run that uses the shared random state
+void scenario_use_motion_rand_states (struct scenario_class *scenario);
+
 // compute the deltaQ for all connections of the given scenario;
 // deltaQ parameters are returned in the corresponding fields of
 // the connection objects;
@@ -165,6 +250,42 @@ int scenario_deltaQ (struct scenario_class *scenario, double current_time);
 // reset the interference_accounted flag for all nodes
 void scenario_reset_node_interference_flag (struct scenario_class *scenario);
 
+// check whether the interference of an interface was already accounted;
+// return TRUE if it was, FALSE otherwise
+int scenario_interference_accounted (struct scenario_class *scenario,
+				     int node_i, int interf_j);
+
+// mark the interference of an interface as accounted
+void scenario_set_interference_accounted (struct scenario_class *scenario,
+					  int node_i, int interf_j);
+
+// return the connection with index 'connection_i' as it should be
+// seen when computing the interference it causes to other connections
+struct connection_class *scenario_interfering_connection (struct
+							  scenario_class
+							  *scenario,
+							  int connection_i);
+
+
+/////////////////////////////////////////////////////
+// parallel computation workers
+
+// init the private state of a thread;
+// return SUCCESS on succes, ERROR on error
+int scenario_worker_init (struct scenario_worker_class *worker);
+
+// make the current thread use the private state of 'worker' (or the
+// shared state if 'worker' is NULL)
+void scenario_worker_attach (struct scenario_worker_class *worker);
+
+// prepare the private state of a thread for computing the connection
+// with index 'connection_i'
+void scenario_worker_seed (struct scenario_worker_class *worker,
+			   int connection_i);
+
+// release the private state of a thread
+void scenario_worker_free (struct scenario_worker_class *worker);
+
 
 // try to merge an object specified by index 'object_i' to other
 // objects in scenario; 
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2006-2013 The StarBED Project  All rights reserved.
+ *
+ * See the file 'LICENSE' for licensing information.
+ *
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: sweep.h
+ * Function: Header file of sweep.c
+ *
+ * Author: Razvan Beuran
+ *
+ ***********************************************************************/
+
+#ifndef __SWEEP_H
+#define __SWEEP_H
+
+#include "deltaQ.h"
+
+
+//////////////////////////////////
+// Constants
+//////////////////////////////////
+
+// maximum number of variants of a sweep, and maximum
+// number of parameter overrides of a variant
+#define MAX_SWEEP_VARIANTS              1000
+#define MAX_SWEEP_OVERRIDES             64
+
+// wildcard that matches any name in override paths
+#define SWEEP_WILDCARD_STRING           "*"
+
+
+//////////////////////////////////
+// Sweep structures
+//////////////////////////////////
+
+// override of one scenario parameter, given as a name path
+// (e.g., 'interface.ap1.eth0.Pt') and a value
+struct sweep_override_class
+{
+  char path[MAX_STRING];
+  char value[MAX_STRING];
+};
+
+// variant of a scenario, identified by a name that is used
+// in the names of its output files
+struct sweep_variant_class
+{
+  char name[MAX_STRING];
+
+  struct sweep_override_class overrides[MAX_SWEEP_OVERRIDES];
+  int override_number;
+};
+
+// parameter sweep: the variants of an initialized base scenario;
+// nodes, environments, motions and connections of the base are
+// saved before any variant is computed, so that each variant starts
+// from the same state, while objects are never modified
+struct sweep_class
+{
+  struct sweep_variant_class *variants;
+  int variant_number;
+
+  // base scenario, and its elements saved before computation
+  struct scenario_class *base;
+  struct node_class *nodes;
+  struct environment_class *environments;
+  struct motion_class *motions;
+  struct connection_class *connections;
+};
+
+
+////////////////////////////////////////////////
+// Sweep functions
+////////////////////////////////////////////////
+
+// read the variants of a sweep from file 'filename'; each line
+// contains a variant name followed by 'path=value' overrides
+// separated by blanks; empty lines and lines starting with '#'
+// are ignored; return SUCCESS on succes, ERROR on error
+int sweep_read (struct sweep_class *sweep, char *filename);
+
+// save the state of the initialized scenario 'base', from which all
+// variants start; return SUCCESS on succes, ERROR on error
+int sweep_set_base (struct sweep_class *sweep, struct scenario_class *base);
+
+// copy the objects of the base scenario to 'scenario', so that
+// variants can also be computed in a scenario other than the base
+void sweep_copy_objects (struct sweep_class *sweep,
+			 struct scenario_class *scenario);
+
+// restore in 'scenario' the saved state of the base scenario, and
+// apply the overrides of variant 'variant_i'; the objects of
+// 'scenario' must be those of the base;
+// return SUCCESS on succes, ERROR on error
+int sweep_prepare_variant (struct sweep_class *sweep, int variant_i,
+			   struct scenario_class *scenario);
+
+// release the resources of a sweep
+void sweep_free (struct sweep_class *sweep);
+
+#endif
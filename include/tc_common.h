@@ -1,7 +1,7 @@
 
 #define TCA_BUF_MAX	(64*1024)
 
-extern struct rtnl_handle rth;
+extern __thread struct rtnl_handle rth;
 extern int do_qdisc(int argc, char **argv);
 extern int do_class(int argc, char **argv);
 extern int do_filter(int argc, char **argv);
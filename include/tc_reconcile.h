@@ -0,0 +1,42 @@
+#ifndef __TC_RECONCILE_H__
+#define __TC_RECONCILE_H__ 1
+
+/*
+ * Reconciliation of the tc state of a set of devices with the objects
+ * requested by a new configuration. The qdiscs, classes and filters
+ * of the devices are dumped when reconciliation begins; then, until
+ * it ends, requests to create objects that already exist with the
+ * same parameters are not sent, qdiscs and classes of the same kind
+ * with other parameters (netem delay, loss and rate, htb rates) are
+ * changed in place, other objects that exist with other contents are
+ * replaced, and requests to delete the root or ingress qdisc of a
+ * device are only sent if reconciliation cannot be used for it.
+ * Objects that were not requested are removed when reconciliation
+ * ends, hence tc_reconcile_end() must be called once all objects
+ * were requested, whether they were sent in a batch or one by one.
+ *
+ * Reconciliation is only used for devices whose root qdisc is
+ * an htb qdisc with handle 1:, as installed by wireconf.
+ */
+
+struct tc_reconcile_stats
+{
+	int existing;	/* objects found on the devices */
+	int reused;	/* requested objects that already existed */
+	int changed;	/* requested objects that existed with other parameters */
+	int replaced;	/* requested objects that existed with other contents */
+	int created;	/* requested objects that did not exist */
+	int removed;	/* objects that were not requested */
+};
+
+// dump the tc state of devices 'devs' and start intercepting
+// requests on 'rth'; return 0 on success, -1 on error
+extern int tc_reconcile_begin(char **devs, int dev_count);
+
+// stop intercepting requests and remove the objects that were
+// not requested; return 0 on success, -1 on error
+extern int tc_reconcile_end(void);
+
+extern struct tc_reconcile_stats *tc_reconcile_get_stats(void);
+
+#endif /* __TC_RECONCILE_H__ */
@@ -29,7 +29,10 @@
 #define Gigabit  1000000000
 
 static const double max_percent_value = 0xffffffff;
-struct rtnl_handle rth;
+
+// netlink handle used by the tc functions; it is private to each
+// thread, so threads that call them must open their own handle
+extern __thread struct rtnl_handle rth;
 
 struct qdisc_params
 {
@@ -43,6 +46,9 @@ struct qdisc_params
 	float reorder_corr;
 	uint32_t rate;
 	uint32_t buffer;
+	int rate_native;	/* netem limits the rate itself, at 'netem_rate' */
+	uint64_t netem_rate;	/* [bytes/s], 0 for no limit */
+	int delay_dist;		/* send the normal delay distribution table */
 };
 
 struct filter_match {
@@ -122,6 +128,8 @@ extern int delete_netem_qdisc(char* device, int ingress);
 extern int add_htb_qdisc(char* device, uint32_t id[4]);
 extern int add_htb_class(char* device, uint32_t id[4], uint32_t bnadwidth);
 extern int change_htb_class(char* device, uint32_t id[4], uint32_t bnadwidth);
+extern int netem_opt(struct qdisc_params* qp, struct nlmsghdr *n);
+extern int htb_class_opt(struct nlmsghdr *n, uint32_t bandwidth);
 extern int add_tbf_qdisc(char* device, uint32_t id[4], struct qdisc_params qp);
 extern int change_tbf_qdisc(char* device, uint32_t id[4], struct qdisc_params qp);
 
@@ -132,5 +140,9 @@ extern int add_tc_filter(char* dev, uint32_t id[4], char* proto_id, char* type,
 extern int u32_filter_parse(uint32_t handle, struct u32_params up, struct nlmsghdr *n, char* dev);
 extern int add_ingress_qdisc(char *dev);
 extern int add_ingress_filter(char *dev, char *ifb_dev);
+extern int add_ingress_shard_filter(char *dev, char *ifb_dev, int dst, uint32_t key, uint32_t mask);
+extern int add_fq_qdisc(char *dev, uint32_t limit, uint32_t horizon);
+extern int modify_clsact_qdisc(int cmd, char *dev);
+extern int add_bpf_filter(char *dev, int fd, char *name);
 
 #endif
@@ -86,4 +86,34 @@ int timer_wait(struct timer_handle *handle, float time_in_s);
 // should not be called too often so as not to interfere with timing
 double timer_elapsed_time (struct timer_handle *handle);
 
+
+/////////////////////////////////////////////
+// TSC-based timer functions (implemented by meteor)
+/////////////////////////////////////////////
+
+// get the TSC frequency in Hz
+uint32_t get_cpu_frequency (void);
+
+// allocate a timer whose origin is the current time;
+// return NULL on error
+struct timer_handle *timer_init_rdtsc (void);
+
+// set the timer origin to the current time
+void timer_reset_rdtsc (struct timer_handle *handle);
+
+// move the timer origin back by 'time_in_us'
+void timer_shift_rdtsc (struct timer_handle *handle, uint64_t time_in_us);
+
+// wait until 'time_in_us' after the timer origin; return SUCCESS
+// on success, ERROR if that time already passed, and 2 if the
+// scenario was restarted
+int timer_wait_rdtsc (struct timer_handle *handle, uint64_t time_in_us);
+
+// return TRUE if 'time_in_us' after the timer origin already
+// passed, FALSE otherwise
+int timer_missed_rdtsc (struct timer_handle *handle, uint64_t time_in_us);
+
+// release a timer
+void timer_free (struct timer_handle *handle);
+
 #endif
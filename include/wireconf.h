@@ -53,6 +53,7 @@
 
 #include <sys/types.h>
 
+#include <stdio.h>
 #include <net/if.h>
 #include <netinet/in.h>
 
@@ -88,7 +89,133 @@ int get_rule_linux(void);
 int32_t init_rule(char *dst, int protocol);
 int32_t add_rule(int s, uint32_t rulenum, int pipe_nr, int32_t protocol, char *src, char *dst, int direction);
 int32_t configure_rule(int s, char* dst, int handle, int bandwidth, double delay, double lossrate);
+// same as configure_rule(), with the jitter of the delay [ms]
+int32_t configure_rule_jitter(int s, char* dst, int handle, int bandwidth, double delay, double jitter, double lossrate);
 int32_t delete_rule(uint s, char *dst, u_int32_t rule_number);
+int32_t flush_rules(int s);
+
+// emulation backend used by the functions above, selected by name;
+// each backend is described at its initializer
+struct wireconf_backend {
+    const char *name;
+    int (*open)(void);
+    void (*close)(int s);
+    int32_t (*init)(char *dst, int protocol);
+    int32_t (*add_rule)(int s, uint32_t rulenum, int pipe_nr, int32_t protocol, char *src, char *dst, int direction);
+    int32_t (*configure)(int s, char *dst, int pipe_nr, int bandwidth, double delay, double jitter, double lossrate);
+    int32_t (*delete)(int s, char *dst, uint32_t rule_number);
+    int32_t (*flush)(int s);
+    void (*stats)(FILE *f);
+    int32_t (*begin_bulk)(int s);
+    int32_t (*end_bulk)(int s);
+    int32_t (*begin_record)(int s);
+    int32_t (*end_record)(int s);
+
+    // TRUE if the default backend is used instead when this one
+    // cannot be opened or initialized
+    int fallback;
+};
+
+// counters maintained for all backends by the dispatch functions
+struct wireconf_stats {
+    uint64_t init_count;
+    uint64_t add_count;
+    uint64_t configure_count;
+    uint64_t delete_count;
+    uint64_t flush_count;
+    uint64_t error_count;
+    double add_time;        // cumulative time spent in add_rule [s]
+    double configure_time;  // cumulative time spent in configure_rule [s]
+    double bulk_time;       // cumulative time spent in bulk installation [s]
+    uint64_t record_count;
+    double record_time;     // cumulative time spent applying prepared records [s]
+    double record_time_max;
+};
+
+extern struct wireconf_backend wireconf_memory_backend;
+extern struct wireconf_backend wireconf_bpf_backend;
+
+// select the backend by name ("netlink"/"ipfw", "netem", "bpf" or "memory");
+// must be called before get_socket(); return SUCCESS or ERROR
+int wireconf_set_backend(char *name);
+struct wireconf_backend *wireconf_get_backend(void);
+struct wireconf_stats *wireconf_get_stats(void);
+void wireconf_print_stats(FILE *f);
+
+// install rules in bulk: between these calls add_rule() may only
+// queue the objects of a rule, and installation errors are reported
+// by wireconf_end_bulk(); backends without bulk support install
+// rules immediately; return SUCCESS or ERROR
+int32_t wireconf_begin_bulk(int s);
+int32_t wireconf_end_bulk(int s);
+
+// apply the link configurations of a time record: between these calls
+// configure_rule() may only prepare a change, and wireconf_end_record()
+// applies the prepared changes, reports errors and returns when all of
+// them were applied, so that a record can be prepared before its
+// deadline; a record that is still open when a new one begins is
+// ended first; return SUCCESS or ERROR
+int32_t wireconf_begin_record(int s);
+int32_t wireconf_end_record(int s);
+
+// set the number of threads that apply link configurations in
+// parallel, each with its own netlink socket (0 to apply them in the
+// calling thread); must be called before get_socket()
+int wireconf_set_workers(int count);
+
+// in ingress mode, spread the traffic over 'count' ifb devices (a power
+// of 2) by the low bits of its source or destination address, each with
+// the pipes of its links; must be called before init_rule()
+#define WIRECONF_SHARD_SRC              0
+#define WIRECONF_SHARD_DST              1
+int wireconf_set_ingress_shards(int count, int key);
+
+#ifdef __linux
+// number of u32 filters installed per link (forward, reverse, broadcast)
+// and number of address strings they refer to
+#define WIRECONF_LINK_FILTERS           3
+#define WIRECONF_LINK_ADDRS             5
+#define WIRECONF_ADDR_LEN               20
+
+struct u32_params;
+struct qdisc_params;
+
+// fill in the filters of a link, as installed by add_rule();
+// 'ufp' must have WIRECONF_LINK_FILTERS elements and 'addrs' 
+// WIRECONF_LINK_ADDRS elements (referenced by the filters)
+void wireconf_build_link_filters(struct u32_params *ufp, char addrs[][WIRECONF_ADDR_LEN], int handle_nr, int32_t protocol, char *src, char *dst);
+
+// device on which the links are emulated: in ingress mode, the ifb
+// device to which the traffic received on the emulation interfaces is
+// redirected by this call, and otherwise the route device of 'dst'
+char *wireconf_link_device(char *dst);
+
+// fill in the netem parameters of a link, as set by configure_rule()
+void wireconf_build_qdisc_params(struct qdisc_params *qp, int32_t bandwidth, double delay, double jitter, double lossrate);
+
+// set the correlation of the delay and of the loss of all links [%];
+// return SUCCESS or ERROR
+int wireconf_set_netem_correlation(double delay_corr, double loss_corr);
+
+// function used by the workers to configure the link of pipe 'pipe_nr'
+// on device 'devname'; return SUCCESS or ERROR
+typedef int32_t (*wireconf_worker_apply_t)(char *devname, int32_t pipe_nr, int32_t bandwidth, double delay, double jitter, double lossrate);
+
+struct wireconf_worker_stats {
+    uint64_t record_count;  // records with link configurations for the worker
+    uint64_t job_count;
+    uint64_t error_count;
+    double latency_sum;     // cumulative apply latency of the records [s]
+    double latency_max;
+};
+
+int wireconf_workers_start(int count, wireconf_worker_apply_t apply);
+int wireconf_workers_count(void);
+int wireconf_workers_dispatch(char *devname, int32_t pipe_nr, int32_t bandwidth, double delay, double jitter, double lossrate);
+int wireconf_workers_wait(void);
+void wireconf_workers_stop(void);
+void wireconf_workers_print_stats(FILE *f);
+#endif
 
 // print a rule structure
 #ifdef __FreeBSD__
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: wireconf_bpf.h
+ * Function: Definitions shared by the BPF backend of the wireconf
+ *           library and the BPF program it loads
+ *
+ ***********************************************************************/
+
+#ifndef __WIRECONF_BPF_H
+#define __WIRECONF_BPF_H
+
+#include <linux/types.h>
+
+// number of pipes (the minor part of a tc handle), and of links;
+// each pipe has a forward, a reverse and a broadcast link
+#define BPF_MAX_PIPES           0x10000
+#define BPF_MAX_LINKS           (3 * BPF_MAX_PIPES)
+
+// object file of the program, installed next to meteor, the section
+// of the program in it, and the names of its maps
+#define BPF_OBJ_NAME            "wireconf_bpf_prog.o"
+#define BPF_PROG_SECTION        "classifier"
+#define BPF_LINK_MAP            "links"
+#define BPF_PIPE_MAP            "pipes"
+#define BPF_STATE_MAP           "state"
+
+// key of the map of links; an address of 0 matches any address
+struct bpf_link_key {
+    __u32 src;
+    __u32 dst;
+};
+
+// parameters of a pipe, written by the backend
+struct bpf_pipe {
+    __u64 rate;                 // [bytes/s], 0 for no limit
+    __u64 delay;                // [ns]
+    __u64 jitter;               // [ns]
+    __u32 loss;                 // drop probability, scaled to 2^32 - 1
+    __u32 pad;
+};
+
+// definition of a map in the object file; the maps are created by
+// the backend, and only their names are used to load the program
+struct bpf_map_def {
+    __u32 type;
+    __u32 key_size;
+    __u32 value_size;
+    __u32 max_entries;
+};
+
+#endif
@@ -0,0 +1,338 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: event_list.c
+ * Function: Lists of pipe configuration changes, compiled offline from
+ *           QOMET output for one meteor instance, so that at run time
+ *           meteor only handles the links that actually change
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "global.h"
+#include "message.h"
+#include "event_list.h"
+
+#define EVENT_LIST_INITIAL_EVENTS 1024
+
+// find the compilation state of 'pipe' in the hash table of pipes,
+// or the free entry where it should be added
+static struct event_pipe*
+event_pipe_find(el, pipe)
+struct event_list *el;
+uint32_t pipe;
+{
+    uint32_t i;
+
+    i = (pipe * 0x9E3779B1U) & (el->pipe_size - 1);
+    while(el->pipes[i].used == TRUE && el->pipes[i].pipe != pipe) {
+        i = (i + 1) & (el->pipe_size - 1);
+    }
+
+    return &el->pipes[i];
+}
+
+static int
+event_equal(a, b)
+struct event_rec *a;
+struct event_rec *b;
+{
+    return (a->bandwidth == b->bandwidth && a->delay == b->delay &&
+            a->loss_rate == b->loss_rate && a->jitter == b->jitter);
+}
+
+int
+event_list_init(el, direction, assign_id, division, node_count, quantum, pipe_count)
+struct event_list *el;
+int32_t direction;
+int32_t assign_id;
+int32_t division;
+int32_t node_count;
+double quantum;
+uint32_t pipe_count;
+{
+    memset(el, 0, sizeof(struct event_list));
+    memcpy(el->header.signature, EVENT_LIST_SIGNATURE, sizeof(el->header.signature));
+    el->header.version = EVENT_LIST_VERSION;
+    el->header.direction = direction;
+    el->header.assign_id = assign_id;
+    el->header.division = division;
+    el->header.node_count = node_count;
+    el->header.quantum = quantum;
+
+    // the hash table is kept at most half full
+    for(el->pipe_size = 16; el->pipe_size < 2 * pipe_count; el->pipe_size *= 2);
+    if((el->pipes = calloc(el->pipe_size, sizeof(struct event_pipe))) == NULL) {
+        WARNING("Cannot allocate memory for event list pipes");
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+int
+event_list_add(el, time, pipe, bandwidth, delay, loss_rate, jitter)
+struct event_list *el;
+double time;
+uint32_t pipe;
+float bandwidth;
+float delay;
+float loss_rate;
+float jitter;
+{
+    struct event_pipe *ep;
+    struct event_rec event;
+    struct event_rec *events;
+
+    // near-simultaneous changes are applied together
+    if(el->group_open == TRUE && time < el->group_time + el->header.quantum) {
+        time = el->group_time;
+    }
+    else {
+        el->group_time = time;
+        el->group_open = TRUE;
+    }
+
+    event.time = time;
+    event.pipe = pipe;
+    event.bandwidth = bandwidth;
+    event.delay = delay;
+    event.loss_rate = loss_rate;
+    event.jitter = jitter;
+
+    ep = event_pipe_find(el, pipe);
+    if(ep->used == TRUE) {
+        if(event_equal(&ep->current, &event)) {
+            return SUCCESS;
+        }
+
+        // a later change of the pipe in the same group replaces
+        // the previous one
+        if(el->events[ep->last_event].time == time) {
+            el->events[ep->last_event] = event;
+            ep->current = event;
+            return SUCCESS;
+        }
+    }
+    else {
+        if(el->header.pipe_count * 2 >= el->pipe_size) {
+            WARNING("Maximum number of event list pipes exceeded (%u)", el->pipe_size / 2);
+            return ERROR;
+        }
+        ep->used = TRUE;
+        ep->pipe = pipe;
+        el->header.pipe_count++;
+    }
+
+    if(el->header.event_count == el->event_size) {
+        el->event_size = (el->event_size == 0) ? EVENT_LIST_INITIAL_EVENTS : 2 * el->event_size;
+        if((events = realloc(el->events, el->event_size * sizeof(struct event_rec))) == NULL) {
+            WARNING("Cannot allocate memory for event list");
+            return ERROR;
+        }
+        el->events = events;
+    }
+
+    ep->last_event = el->header.event_count;
+    ep->current = event;
+    el->events[el->header.event_count++] = event;
+
+    return SUCCESS;
+}
+
+int
+event_list_write(el, file_name)
+struct event_list *el;
+const char *file_name;
+{
+    FILE *f;
+    int ret = SUCCESS;
+
+    if((f = fopen(file_name, "wb")) == NULL) {
+        WARNING("Cannot open event list file '%s'", file_name);
+        return ERROR;
+    }
+
+    if(fwrite(&el->header, sizeof(struct event_list_header), 1, f) != 1 ||
+       fwrite(el->events, sizeof(struct event_rec), el->header.event_count, f) != el->header.event_count) {
+        WARNING("Cannot write event list file '%s'", file_name);
+        ret = ERROR;
+    }
+    if(fclose(f) != 0) {
+        WARNING("Cannot write event list file '%s'", file_name);
+        ret = ERROR;
+    }
+
+    return ret;
+}
+
+int
+event_list_read(el, file_name)
+struct event_list *el;
+const char *file_name;
+{
+    FILE *f;
+
+    memset(el, 0, sizeof(struct event_list));
+
+    if((f = fopen(file_name, "rb")) == NULL) {
+        WARNING("Cannot open event list file '%s'", file_name);
+        return ERROR;
+    }
+
+    if(fread(&el->header, sizeof(struct event_list_header), 1, f) != 1 ||
+       memcmp(el->header.signature, EVENT_LIST_SIGNATURE, sizeof(el->header.signature)) != 0) {
+        WARNING("File '%s' is not an event list", file_name);
+        fclose(f);
+        return ERROR;
+    }
+    if(el->header.version != EVENT_LIST_VERSION) {
+        WARNING("Unsupported event list version (%u)", el->header.version);
+        fclose(f);
+        return ERROR;
+    }
+
+    el->event_size = el->header.event_count;
+    if(el->event_size > 0 && (el->events = malloc(el->event_size * sizeof(struct event_rec))) == NULL) {
+        WARNING("Cannot allocate memory for event list");
+        fclose(f);
+        return ERROR;
+    }
+    if(fread(el->events, sizeof(struct event_rec), el->event_size, f) != el->event_size) {
+        WARNING("Event list file '%s' is truncated", file_name);
+        event_list_free(el);
+        fclose(f);
+        return ERROR;
+    }
+    fclose(f);
+
+    return SUCCESS;
+}
+
+int
+event_list_next(el, deadline, events)
+struct event_list *el;
+double *deadline;
+const struct event_rec **events;
+{
+    uint32_t first = el->next;
+
+    if(first >= el->header.event_count) {
+        return 0;
+    }
+
+    // the list is sorted, so the events with the earliest deadline
+    // are the next ones
+    while(el->next < el->header.event_count && el->events[el->next].time == el->events[first].time) {
+        el->next++;
+    }
+
+    *deadline = el->events[first].time;
+    *events = &el->events[first];
+
+    return el->next - first;
+}
+
+int
+event_list_seek(el, time, events)
+struct event_list *el;
+double time;
+const struct event_rec **events;
+{
+    struct event_pipe *ep;
+    uint32_t i;
+    int count = 0;
+
+    // the changes of a pipe before 'time' are replaced by the last one
+    if(el->pipes == NULL) {
+        for(el->pipe_size = 16; el->pipe_size < 2 * el->header.pipe_count; el->pipe_size *= 2);
+        el->pipes = calloc(el->pipe_size, sizeof(struct event_pipe));
+        el->seek_events = malloc((el->header.pipe_count + 1) * sizeof(struct event_rec));
+        if(el->pipes == NULL || el->seek_events == NULL) {
+            WARNING("Cannot allocate memory for event list pipes");
+            return -1;
+        }
+    }
+    else {
+        memset(el->pipes, 0, el->pipe_size * sizeof(struct event_pipe));
+    }
+
+    for(el->next = 0; el->next < el->header.event_count && el->events[el->next].time < time; el->next++) {
+        ep = event_pipe_find(el, el->events[el->next].pipe);
+        if(ep->used == FALSE) {
+            if(count == el->header.pipe_count) {
+                WARNING("Event list has more pipes than its header (%u)", el->header.pipe_count);
+                return -1;
+            }
+            ep->used = TRUE;
+            ep->pipe = el->events[el->next].pipe;
+            count++;
+        }
+        ep->current = el->events[el->next];
+    }
+
+    count = 0;
+    for(i = 0; i < el->pipe_size; i++) {
+        if(el->pipes[i].used == TRUE) {
+            el->seek_events[count++] = el->pipes[i].current;
+        }
+    }
+    *events = el->seek_events;
+
+    return count;
+}
+
+void
+event_list_rewind(el)
+struct event_list *el;
+{
+    el->next = 0;
+}
+
+void
+event_list_free(el)
+struct event_list *el;
+{
+    free(el->events);
+    free(el->pipes);
+    free(el->seek_events);
+    el->events = NULL;
+    el->pipes = NULL;
+    el->seek_events = NULL;
+    el->event_size = 0;
+    el->pipe_size = 0;
+    el->header.event_count = 0;
+}
@@ -44,6 +44,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <time.h>
 #include <string.h>
 #include <math.h>
 #include <assert.h>
@@ -54,6 +55,9 @@
 #include "message.h"
 #include "routing_info.h"
 #include "statistics.h"
+#include "io_text.h"
+#include "io_bin_reader.h"
+#include "event_list.h"
 #include "timer.h"
 
 #ifdef __linux
@@ -63,9 +67,8 @@
 
 #define BIN_SC 1
 #define TXT_SC 2
+#define EVT_SC 3
 
-#define PARAMETERS_TOTAL        19
-#define PARAMETERS_UNUSED       13
 
 #define MIN_PIPE_ID_HV          10
 #define MIN_PIPE_ID_BR          10
@@ -149,6 +152,32 @@ usage()
             "\t\t\t-i <current_id> \t-s <settings_file>\n"
             "\t\t\t-m <time_period> \t[-b <baddr>] [-I Interface Name]\n"
             "\t\t\t[-a assign_id] [-d division] [-l] [-d {in|out|bridge}]\n");
+    fprintf(stderr, "Common options:\n"
+            "\t\t\t[-B {netlink|netem|bpf|memory}] select the emulation backend; 'netem'\n"
+            "\t\t\t\talso limits the rate with netem instead of HTB, 'bpf' shapes the\n"
+            "\t\t\t\tlinks with a BPF program and an fq qdisc (netlink is used if it\n"
+            "\t\t\t\tcannot be loaded), and 'memory' only records the configuration\n"
+            "\t\t\t\tand does not require root privileges\n"
+            "\t\t\t[-J <delay_corr>[,<loss_corr>]] correlation of the delay and of\n"
+            "\t\t\t\tthe loss of the links, in percent (default 0)\n"
+            "\t\t\t[-x] benchmark mode: do not wait for the record times, and print\n"
+            "\t\t\t\tthe achieved records/s and links/s at the end\n"
+            "\t\t\t[-S <start_time>] start the binary scenario at <start_time> s;\n"
+            "\t\t\t\tearlier records only set the initial link state\n"
+            "\t\t\t[-k] keep the emulation configuration at exit, so that the\n"
+            "\t\t\t\tnext run only changes the objects that differ\n"
+            "\t\t\t[-w <workers>] configure the links of each record with\n"
+            "\t\t\t\t<workers> threads, each with its own netlink socket\n"
+            "\t\t\t[-K <shards>[,{src|dst}]] spread the ingress traffic over\n"
+            "\t\t\t\t<shards> ifb devices (a power of 2) by the low bits of its\n"
+            "\t\t\t\tsource (default) or destination address\n");
+    fprintf(stderr, "Event lists (usage (2), hypervisor and bridge directions):\n"
+            "\t\t\t[-C <event_list_file>] compile the binary QOMET output into\n"
+            "\t\t\t\tthe list of link changes of this node, and exit\n"
+            "\t\t\t[-G <quantum>] merge changes less than <quantum> s apart\n"
+            "\t\t\t\twhen compiling (default 0)\n"
+            "\t\t\t[-E <event_list_file>] drive the emulation from a compiled\n"
+            "\t\t\t\tevent list instead of QOMET output\n");
     fprintf(stderr, "NOTE: If option '-s' is used, usage (2) is inferred, otherwise usage (1) is assumed.\n");
 }
 
@@ -173,6 +202,18 @@ restart_scenario()
     re_flag = TRUE;
 }
 
+// convert 'time_in_us' to TSC ticks; whole seconds and the remainder
+// are converted separately, since the product of the frequency and
+// the time would overflow after about 6000 s at 3 GHz
+static uint64_t
+timer_us_to_ticks(handle, time_in_us)
+struct timer_handle *handle;
+uint64_t time_in_us;
+{
+    return (time_in_us / 1000000) * handle->cpu_frequency +
+        ((time_in_us % 1000000) * handle->cpu_frequency) / 1000000;
+}
+
 int
 timer_wait_rdtsc(handle, time_in_us)
 struct timer_handle* handle;
@@ -180,7 +221,7 @@ uint64_t time_in_us;
 {
     uint64_t crt_time;
 
-    handle->next_event = handle->zero + (handle->cpu_frequency * time_in_us) / 1000000;
+    handle->next_event = handle->zero + timer_us_to_ticks(handle, time_in_us);
     rdtsc(crt_time);
 
     if(handle->next_event < crt_time) {
@@ -198,6 +239,18 @@ uint64_t time_in_us;
     return SUCCESS;
 }
 
+int
+timer_missed_rdtsc(handle, time_in_us)
+struct timer_handle* handle;
+uint64_t time_in_us;
+{
+    uint64_t crt_time;
+
+    rdtsc(crt_time);
+
+    return (handle->zero + timer_us_to_ticks(handle, time_in_us) < crt_time) ? TRUE : FALSE;
+}
+
 uint32_t
 get_cpu_frequency(void)
 {
@@ -240,6 +293,16 @@ struct timer_handle *handle;
     free(handle);
 }
 
+// move the timer origin back by 'time_in_us', so that the scenario
+// time 'time_in_us' corresponds to the current timer origin
+void
+timer_shift_rdtsc(handle, time_in_us)
+struct timer_handle *handle;
+uint64_t time_in_us;
+{
+    handle->zero -= timer_us_to_ticks(handle, time_in_us);
+}
+
 void
 timer_reset_rdtsc(handle)
 struct timer_handle *handle;
@@ -273,9 +336,9 @@ in_addr_t *p;
 int *prefix;
 int p_size;
 {
-    char node_name[20];
-    char interface[20];
-    char node_ip[IP_ADDR_SIZE];
+    char node_name[MAX_STRING];
+    char interface[MAX_STRING];
+    char node_ip[IP_ADDR_SIZE + 4];
     char *slash;
     char *ptr;
     static char buf[BUFSIZ];
@@ -300,7 +363,7 @@ int p_size;
         }
         else {
             int scaned_items;
-            scaned_items = sscanf(buf, "%s %s %d %16s",node_name, interface,  &node_id, node_ip);
+            scaned_items = sscanf(buf, "%255s %255s %d %19s", node_name, interface, &node_id, node_ip);
             if(scaned_items < 2) {
                 WARNING("Skipped invalid line #%d in settings file '%s'", line_nr, path);
                 continue;
@@ -395,6 +458,136 @@ int32_t dst_id;
     return conn_list;
 }
 
+// compile the binary QOMET output of 'reader' into the list of link
+// changes of this meteor instance, and write it to 'file_name'; the
+// links and their pipes are those configured by the binary scenario
+// loop of main(), and as there the first time record only sets the
+// initial state; return SUCCESS or ERROR
+int
+compile_event_list(reader, file_name, direction, all_node_cnt, conn_list_head, quantum)
+struct io_bin_reader_cls *reader;
+char *file_name;
+int32_t direction;
+int32_t all_node_cnt;
+struct connection_list *conn_list_head;
+double quantum;
+{
+    struct event_list el;
+    struct connection_list *conn_list;
+    const struct bin_time_rec_cls *bin_time_rec_ptr;
+    const struct bin_rec_cls *bin_recs;
+    struct bin_rec_cls *link_recs;
+    uint32_t *link_pipes;
+    int32_t *changed;
+    int32_t *changed_links;
+    int32_t changed_cnt = 0;
+    uint32_t pipe_cnt = 0;
+    int32_t src_id, dst_id;
+    int32_t link_i;
+    int32_t rec_i;
+    int64_t time_i;
+    int ret = ERROR;
+
+    if(direction != DIRECTION_HV && direction != DIRECTION_BR) {
+        WARNING("Event lists can only be compiled for the hypervisor and bridge directions");
+        return ERROR;
+    }
+
+    io_bin_reader_rewind(reader);
+    if(all_node_cnt != reader->header->if_num) {
+        WARNING("Number of nodes according to the settings file (%d) and number of nodes according to QOMET scenario (%d) differ", all_node_cnt, reader->header->if_num);
+        return ERROR;
+    }
+
+    // links are indexed by src_id * all_node_cnt + dst_id; links
+    // that are not configured by this instance have pipe 0
+    link_recs = (struct bin_rec_cls *)calloc(all_node_cnt * all_node_cnt, sizeof(struct bin_rec_cls));
+    link_pipes = (uint32_t *)calloc(all_node_cnt * all_node_cnt, sizeof(uint32_t));
+    changed = (int32_t *)calloc(all_node_cnt * all_node_cnt, sizeof(int32_t));
+    changed_links = (int32_t *)calloc(all_node_cnt * all_node_cnt, sizeof(int32_t));
+    if(link_recs == NULL || link_pipes == NULL || changed == NULL || changed_links == NULL) {
+        WARNING("Cannot allocate memory for event list compilation");
+        goto compile_end;
+    }
+
+    if(direction == DIRECTION_BR) {
+        for(conn_list = conn_list_head; conn_list != NULL; conn_list = conn_list->next_ptr) {
+            link_pipes[conn_list->src_id * all_node_cnt + conn_list->dst_id] = conn_list->rec_i + MIN_PIPE_ID_BR;
+            pipe_cnt++;
+        }
+    }
+    else {
+        for(src_id = assign_id; src_id < all_node_cnt; src_id += division) {
+            for(dst_id = 0; dst_id < src_id; dst_id++) {
+                link_pipes[src_id * all_node_cnt + dst_id] = (src_id - assign_id) * all_node_cnt + dst_id + MIN_PIPE_ID_OUT;
+                pipe_cnt++;
+            }
+        }
+    }
+
+    if(event_list_init(&el, direction, assign_id, division, all_node_cnt, quantum, pipe_cnt) == ERROR) {
+        goto compile_end;
+    }
+
+    for(time_i = 0; time_i < reader->time_rec_num; time_i++) {
+        if(io_bin_reader_next_batch(reader, &bin_time_rec_ptr, &bin_recs) == FALSE) {
+            WARNING("Aborting on input error (time record)");
+            goto compile_free;
+        }
+
+        for(rec_i = 0; rec_i < bin_time_rec_ptr->record_number; rec_i++) {
+            src_id = bin_recs[rec_i].from_id;
+            dst_id = bin_recs[rec_i].to_id;
+            if(src_id < FIRST_NODE_ID || src_id >= all_node_cnt || dst_id < FIRST_NODE_ID || dst_id >= all_node_cnt) {
+                WARNING("Record from %d to %d is out of the valid range [%d, %d]", src_id, dst_id,
+                        FIRST_NODE_ID, all_node_cnt - 1);
+                goto compile_free;
+            }
+
+            link_i = src_id * all_node_cnt + dst_id;
+            if(link_pipes[link_i] == 0) {
+                continue;
+            }
+            link_recs[link_i] = bin_recs[rec_i];
+            if(changed[link_i] == FALSE) {
+                changed[link_i] = TRUE;
+                changed_links[changed_cnt++] = link_i;
+            }
+        }
+
+        if(time_i == 0) {
+            continue;
+        }
+
+        // QOMET output has no jitter yet
+        for(rec_i = 0; rec_i < changed_cnt; rec_i++) {
+            link_i = changed_links[rec_i];
+            changed[link_i] = FALSE;
+            if(event_list_add(&el, bin_time_rec_ptr->time, link_pipes[link_i], link_recs[link_i].bandwidth,
+                              link_recs[link_i].delay, link_recs[link_i].loss_rate, 0.0) == ERROR) {
+                goto compile_free;
+            }
+        }
+        changed_cnt = 0;
+    }
+
+    if(event_list_write(&el, file_name) == SUCCESS) {
+        fprintf(stdout, "Compiled %ld time records into %u changes of %u links (quantum %.6f s)\n",
+                reader->time_rec_num, el.header.event_count, el.header.pipe_count, quantum);
+        ret = SUCCESS;
+    }
+
+compile_free:
+    event_list_free(&el);
+compile_end:
+    free(link_recs);
+    free(link_pipes);
+    free(changed);
+    free(changed_links);
+
+    return ret;
+}
+
 int
 main(argc, argv)
 int argc;
@@ -403,7 +596,6 @@ char **argv;
     char ch;
     char *p;
     char *saddr, *daddr;
-    char buf[BUFSIZ];
     char settings_file_name[BUFSIZ];
     int32_t ret;
     int32_t loop = FALSE;
@@ -421,8 +613,23 @@ char **argv;
 
     float crt_record_time = 0.0;
     struct bin_time_rec_cls bin_time_rec;
-    struct bin_rec_cls *bin_recs = NULL;
+    const struct bin_time_rec_cls *bin_time_rec_ptr;
+    const struct bin_rec_cls *bin_recs = NULL;
     int32_t bin_recs_max_cnt;
+    struct io_bin_reader_cls bin_reader;
+
+    char *event_list_file_name = NULL;
+    double event_quantum = 0.0;
+    double delay_corr;
+    double loss_corr = 0.0;
+    int shards;
+    int workers;
+    int shard_key = WIRECONF_SHARD_SRC;
+    struct event_list event_list;
+    const struct event_rec *events;
+    double event_time;
+    int32_t event_cnt;
+    int32_t event_i;
 
     int32_t *next_hop_ids = NULL;
     int32_t node_i;
@@ -454,8 +661,10 @@ char **argv;
     uint32_t sc_type;
     uint32_t usage_type;
 
-    double time, dummy[PARAMETERS_UNUSED], bandwidth, delay, lossrate;
-    FILE *qomet_fd;
+    double time, bandwidth, delay, lossrate;
+    struct io_text_reader_cls text_reader;
+    struct io_text_rec_cls text_rec;
+    int32_t text_result;
     FILE *conn_fd;
     struct timer_handle *timer;
     int32_t loop_cnt = 0;
@@ -467,6 +676,7 @@ char **argv;
 #endif
 
     struct timeval tp_begin, tp_end;
+    struct timespec origin_ts;
 
     int32_t i, j;
     int32_t my_id;
@@ -484,6 +694,12 @@ char **argv;
     qomet_param param_over_read;
     char baddr[IP_ADDR_SIZE];
 
+    int benchmark = FALSE;
+    int keep_config = FALSE;
+    uint64_t record_cnt = 0;
+    double start_time = 0.0;
+    long int start_time_i = 0;
+
     struct sigaction sa;
     struct connection_list *conn_list = NULL;
     struct connection_list *conn_list_head = NULL;
@@ -510,7 +726,8 @@ char **argv;
     next_hop_id = 0;
     rule_num = -1;
 
-    qomet_fd = NULL;
+    conn_fd = NULL;
+    sc_type = 0;
 
     saddr = daddr = NULL;
     fid = tid = pipe_nr = -1;
@@ -527,7 +744,7 @@ char **argv;
     }
 
     i = 0;
-    while((ch = getopt(argc, argv, "a:b:c:d:D:f:F:hi:I:lm:MNp:q:Q:r:Rs:t:T:p:")) != -1) {
+    while((ch = getopt(argc, argv, "a:b:B:c:C:d:D:E:f:F:G:hi:I:J:kK:lm:MNp:q:Q:r:Rs:S:t:T:p:w:x")) != -1) {
         switch(ch) {
             case 'a':
                 assign_id = strtol(optarg, &p, 10);
@@ -535,9 +752,17 @@ char **argv;
             case 'b':
                 strncpy(baddr, optarg, IP_ADDR_SIZE);
                 break;
+            case 'B':
+                if(wireconf_set_backend(optarg) == ERROR) {
+                    exit(1);
+                }
+                break;
             case 'c':
                 conn_fd = fopen(optarg, "r");
                 break;
+            case 'C':
+                event_list_file_name = optarg;
+                break;
             case 'd':
                 if(strcmp(optarg, "in") == 0) {
                     direction = DIRECTION_IN;
@@ -569,6 +794,17 @@ char **argv;
             case 'D':
                 division = strtol(optarg, &p, 10);
                 break;
+            case 'E':
+                if(sc_type != 0) {
+                    WARNING("Already read scenario data.");
+                    exit(1);
+                }
+                sc_type = EVT_SC;
+                if(event_list_read(&event_list, optarg) == ERROR) {
+                    WARNING("Could not open event list file '%s'", optarg);
+                    exit(1);
+                }
+                break;
             case 'f':
                 fid = strtol(optarg, &p, 10);
                 if((*optarg == '\0') || (*p != '\0')) {
@@ -580,6 +816,13 @@ char **argv;
             case 'F':
                 saddr = optarg;
                 break;
+            case 'G':
+                event_quantum = strtod(optarg, &p);
+                if((*optarg == '\0') || (*p != '\0') || event_quantum < 0) {
+                    WARNING("Invalid quantum '%s'", optarg);
+                    exit(1);
+                }
+                break;
             case 'h':
                 usage();
                 exit(0);
@@ -591,6 +834,43 @@ char **argv;
                 strcpy(device_list[if_num].dev_name, optarg);
                 if_num++;
 
+#elif __FreeBSD
+                fprintf(stderr, "support only linux\n");
+#endif
+                break;
+            case 'J':
+                delay_corr = strtod(optarg, &p);
+                if(*p == ',') {
+                    loss_corr = strtod(p + 1, &p);
+                }
+                if((*optarg == '\0') || (*p != '\0')) {
+                    WARNING("Invalid correlation '%s'", optarg);
+                    exit(1);
+                }
+#ifdef __linux
+                if(wireconf_set_netem_correlation(delay_corr, loss_corr) == ERROR) {
+                    exit(1);
+                }
+#elif __FreeBSD
+                fprintf(stderr, "support only linux\n");
+#endif
+                break;
+            case 'k':
+                keep_config = TRUE;
+                break;
+            case 'K':
+                shards = strtol(optarg, &p, 10);
+                if(strcmp(p, ",dst") == 0) {
+                    shard_key = WIRECONF_SHARD_DST;
+                }
+                else if(*p != '\0' && strcmp(p, ",src") != 0) {
+                    WARNING("Invalid ingress shards '%s'", optarg);
+                    exit(1);
+                }
+#ifdef __linux
+                if(wireconf_set_ingress_shards(shards, shard_key) == ERROR) {
+                    exit(1);
+                }
 #elif __FreeBSD
                 fprintf(stderr, "support only linux\n");
 #endif
@@ -619,23 +899,23 @@ char **argv;
                 }
                 break;
             case 'q':
-                if(sc_type == BIN_SC) {
+                if(sc_type == BIN_SC || sc_type == EVT_SC) {
                     WARNING("Already read scenario data.");
                     exit(1);
                 }
                 sc_type = TXT_SC;
-                if((qomet_fd = fopen(optarg, "r")) == NULL) {
+                if(io_text_open(&text_reader, optarg) == ERROR) {
                     WARNING("Could not open QOMET output file '%s'", optarg);
                     exit(1);
                 }
                 break;
             case 'Q':
-                if(sc_type == TXT_SC) {
+                if(sc_type == TXT_SC || sc_type == EVT_SC) {
                     WARNING("Already read scenario data.");
                     exit(1);
                 }
                 sc_type = BIN_SC;
-                if((qomet_fd = fopen(optarg, "rb")) == NULL) {
+                if(io_bin_reader_open(&bin_reader, optarg) == ERROR) {
                     WARNING("Could not open QOMET output file '%s'", optarg);
                     exit(1);
                 }
@@ -667,6 +947,13 @@ char **argv;
                             *(((uint8_t *)&ipaddrs[i]) + 3));
                 }
                 break;
+            case 'S':
+                start_time = strtod(optarg, &p);
+                if((*optarg == '\0') || (*p != '\0') || start_time < 0) {
+                    WARNING("Invalid start_time '%s'", optarg);
+                    exit(1);
+                }
+                break;
             case 't':
                 tid = strtol(optarg, &p, 10);
                 if((*optarg == '\0') || (*p != '\0')) {
@@ -677,6 +964,19 @@ char **argv;
             case 'T':
                 daddr = optarg;
                 break;
+            case 'w':
+                workers = strtol(optarg, &p, 10);
+                if((*optarg == '\0') || (*p != '\0')) {
+                    WARNING("Invalid number of workers '%s'", optarg);
+                    exit(1);
+                }
+                if(wireconf_set_workers(workers) == ERROR) {
+                    exit(1);
+                }
+                break;
+            case 'x':
+                benchmark = TRUE;
+                break;
             default:
                 usage();
                 exit(1);
@@ -695,11 +995,28 @@ char **argv;
         daddr = (char*)calloc(1, IP_ADDR_SIZE);
     }
 
-    if(qomet_fd == NULL) {
+    if(sc_type != BIN_SC && sc_type != TXT_SC && sc_type != EVT_SC) {
         WARNING("No QOMET data file was provided");
         usage();
         exit(1);
     }
+    if(event_list_file_name != NULL && (sc_type != BIN_SC || usage_type != 2)) {
+        WARNING("Event lists can only be compiled from binary QOMET output with a settings file");
+        exit(1);
+    }
+    if(sc_type == EVT_SC) {
+        if(usage_type != 2) {
+            WARNING("Event lists require a settings file");
+            exit(1);
+        }
+        if(event_list.header.direction != direction || event_list.header.assign_id != assign_id ||
+           event_list.header.division != division || event_list.header.node_count != all_node_cnt) {
+            WARNING("The event list was compiled for another node (direction=%d assign_id=%d division=%d nodes=%d)",
+                    event_list.header.direction, event_list.header.assign_id,
+                    event_list.header.division, event_list.header.node_count);
+            exit(1);
+        }
+    }
 
     if(conn_fd != NULL && direction == DIRECTION_BR) {
         char buf[BUFSIZ];
@@ -740,7 +1057,7 @@ char **argv;
 
     unsigned char mac_addresses[MAX_NODES][ETH_SIZE];
     char mac_char_addresses[MAX_NODES][MAC_ADDR_SIZE];
-    if(sc_type == BIN_SC) {
+    if(sc_type == BIN_SC || sc_type == EVT_SC) {
         if(use_mac_addr == TRUE) {
             if((node_cnt = io_read_settings_file_mac(settings_file_name,
                     ipaddrs, ipaddrs_c, mac_addresses, mac_char_addresses, MAX_NODES)) < 1) {
@@ -764,17 +1081,44 @@ char **argv;
         node_cnt = all_node_cnt / division;
     }
 
+    // compiling an event list does not touch the emulation
+    if(event_list_file_name != NULL) {
+        ret = compile_event_list(&bin_reader, event_list_file_name, direction, all_node_cnt,
+                                 conn_list_head, event_quantum);
+        io_bin_reader_close(&bin_reader);
+        exit(ret == SUCCESS ? 0 : 1);
+    }
+
     DEBUG("Initialize timer...");
     if((timer = timer_init_rdtsc()) == NULL) {
         WARNING("Could not initialize timer");
         exit(1);
     }
+    // scenario times are relative to the timer initialization; print
+    // this origin so that external measurements can be aligned with it
+    clock_gettime(CLOCK_MONOTONIC, &origin_ts);
+    if(start_time > 0) {
+        // with '-S', scenario time 'start_time' corresponds to now
+        double origin = origin_ts.tv_sec + origin_ts.tv_nsec / 1.0e9 - start_time;
+        fprintf(stdout, "Scenario time origin: %.9f s (CLOCK_MONOTONIC)\n", origin);
+    }
+    else {
+        fprintf(stdout, "Scenario time origin: %ld.%09ld s (CLOCK_MONOTONIC)\n",
+                (long)origin_ts.tv_sec, origin_ts.tv_nsec);
+    }
+    fflush(stdout);
     DEBUG("Open control socket...");
     if((dsock = get_socket()) < 0) {
         WARNING("Could not open control socket (requires root priviledges)\n");
         exit(1);
     }
 
+    // the initial configuration is installed in bulk; if bulk
+    // installation cannot be started rules are added one by one
+    if(wireconf_begin_bulk(dsock) != SUCCESS) {
+        WARNING("Could not start bulk rule installation");
+    }
+
     init_rule(daddr, protocol);
 
     if(usage_type == 1) {
@@ -789,6 +1133,7 @@ char **argv;
         int32_t ret;
         uint32_t src_id;
         uint32_t dst_id;
+
 //        for(src_id = assign_id; src_id < node_cnt + assign_id; src_id++) {}
         if(direction == DIRECTION_BR) {
             if(protocol == ETH) {
@@ -921,6 +1266,10 @@ char **argv;
             }
         }
     }
+    if(wireconf_end_bulk(dsock) != SUCCESS) {
+        WARNING("Could not add all rules");
+        exit(1);
+    }
     gettimeofday(&tp_begin, NULL);
 
     if(usage_type == 1) {
@@ -932,11 +1281,20 @@ char **argv;
 
     emulation_start:
     if(sc_type == BIN_SC) {
-        if(io_binary_read_header_from_file(&bin_hdr, qomet_fd) == ERROR) {
-            WARNING("Aborting on input error (binary header)");
-            exit(1);
-        }
+        // the file is indexed when opened; only complete time records are used
+        io_bin_reader_rewind(&bin_reader);
+        bin_hdr = *(bin_reader.header);
+        bin_hdr.time_rec_num = bin_reader.time_rec_num;
         io_binary_print_header(&bin_hdr);
+
+        // records before the start time only set the initial state
+        if(start_time > 0) {
+            start_time_i = io_bin_reader_seek(&bin_reader, start_time);
+            io_bin_reader_rewind(&bin_reader);
+            timer_shift_rdtsc(timer, (uint64_t)(start_time * 1000000));
+            INFO("Starting at time %.2f s (time record %ld of %d)", start_time,
+                start_time_i, bin_hdr.time_rec_num);
+        }
         if(direction == DIRECTION_BR) {
             fprintf(stdout, "Direction Mode: Bridge\n");
         }
@@ -957,14 +1315,6 @@ char **argv;
 
         bin_recs_max_cnt = bin_hdr.if_num * (bin_hdr.if_num - 1);
 
-        if(bin_recs == NULL) {
-            bin_recs = (struct bin_rec_cls *)calloc(bin_recs_max_cnt, sizeof(struct bin_rec_cls));
-        }
-        if(bin_recs == NULL) {
-            WARNING("Cannot allocate memory for binary records");
-            exit(1);
-        }
-
         if(next_hop_ids == NULL) {
             next_hop_ids = (int32_t *)calloc(bin_hdr.if_num, sizeof(int));
         }
@@ -1068,23 +1418,21 @@ char **argv;
             int rec_i;
             DEBUG("Reading QOMET data from file... Time : %ld/%d\n", time_i, bin_hdr.time_rec_num);
 
-            if(io_binary_read_time_record_from_file(&bin_time_rec, qomet_fd) == ERROR) {
+            // records are used in place, without being copied
+            if(io_bin_reader_next_batch(&bin_reader, &bin_time_rec_ptr, &bin_recs) == FALSE) {
                 WARNING("Aborting on input error (time record)");
                 exit (1);
             }
+            bin_time_rec = *bin_time_rec_ptr;
             io_binary_print_time_record(&bin_time_rec);
             crt_record_time = bin_time_rec.time;
+            record_cnt += bin_time_rec.record_number;
 
             if(bin_time_rec.record_number > bin_recs_max_cnt) {
                 WARNING("The number of records to be read exceeds allocated size (%d)", bin_recs_max_cnt);
                 exit (1);
             }
 
-            if(io_binary_read_records_from_file(bin_recs, bin_time_rec.record_number, qomet_fd) == ERROR) {
-                WARNING("Aborting on input error (records)");
-                exit (1);
-            }
-
             //for(rec_i = assign_id * all_node_cnt; rec_i < bin_time_rec.record_number; rec_i++) {}
             for(rec_i = 0; rec_i < bin_time_rec.record_number; rec_i++) {
                 if(bin_recs[rec_i].from_id < FIRST_NODE_ID) {
@@ -1215,42 +1563,32 @@ char **argv;
                 }
             }
 
-            if (time_i == 0) {
+            if (time_i == 0 || time_i < start_time_i) {
                 timer_reset(timer, crt_record_time);
             }
             else {
-                if(SCALING_FACTOR == 10.0) {
-                    INFO("Waiting to reach time %.2f s...", crt_record_time);
-                }
-                else {
-                    INFO("Waiting to reach real time %.2f s (scenario time %.2f)...\n", 
-                        crt_record_time * SCALING_FACTOR, crt_record_time);
-
-                    if((ret = timer_wait_rdtsc(timer, crt_record_time * 1000000)) < 0) {
-                        WARNING("Timer deadline missed at time=%.6f s", crt_record_time);
-                        WARNING("This rule is skip.\n");
-                        continue;
-                    }
-                    if(ret == 2) {
-                        fseek(qomet_fd, 0L, SEEK_SET);
-                        if((timer = timer_init_rdtsc()) == NULL) {
-                            WARNING("Could not initialize timer");
-                            exit(1);
-                        }
-                        re_flag = FALSE;
-                        goto emulation_start;
-                    }
-/*
-                    if(timer_wait(timer, crt_record_time * SCALING_FACTOR) != 0) {
-                        fprintf(stderr, "Timer deadline missed at time=%.2f s\n", crt_record_time);
-                    }
-*/
-                }
-
                 int32_t src_id, dst_id;
                 int32_t conf_rule_num;
                 int32_t ret;
+
+                // as when the changes were configured after waiting, a record
+                // whose deadline already passed is skipped; its changes are
+                // still marked as such, so they are applied with the next one
+                if(SCALING_FACTOR != 10.0 && benchmark == FALSE &&
+                        timer_missed_rdtsc(timer, (uint64_t)(crt_record_time * 1000000)) == TRUE) {
+                    WARNING("Timer deadline missed at time=%.6f s", crt_record_time);
+                    WARNING("This rule is skip.\n");
+                    continue;
+                }
+
 //                TCHK_START(time);
+                // the changes of the record are prepared before its deadline,
+                // so that only applying them remains once it is reached; the
+                // record is applied once wireconf_end_record() returns
+                if(wireconf_begin_record(dsock) != SUCCESS) {
+                    WARNING("Could not start applying the record at time=%.6f s", crt_record_time);
+                    exit(1);
+                }
                 if(direction == DIRECTION_BR) {
                     conn_list = conn_list_head;
                     while(conn_list != NULL) {
@@ -1283,7 +1621,7 @@ char **argv;
                         }
                         my_recs_ucast_changed[next_hop_id] = FALSE;
                         if(re_flag == TRUE) {
-                            fseek(qomet_fd, 0L, SEEK_SET);
+                            io_bin_reader_rewind(&bin_reader);
                             if((timer = timer_init_rdtsc()) == NULL) {
                                 WARNING("Could not initialize timer");
                                 exit(1);
@@ -1318,7 +1656,7 @@ char **argv;
                             }
                             my_recs_ucast_changed[next_hop_id] = FALSE;
                             if(re_flag == TRUE) {
-                                fseek(qomet_fd, 0L, SEEK_SET);
+                                io_bin_reader_rewind(&bin_reader);
                                 if((timer = timer_init_rdtsc()) == NULL) {
                                     WARNING("Could not initialize timer");
                                     exit(1);
@@ -1410,14 +1748,50 @@ char **argv;
                                 ipaddrs_c + (node_i - assign_id) * IP_ADDR_SIZE, 
                                 crt_record_time, bandwidth, lossrate, delay);
                         }
-                    }
     
-                    if(configure_rule(dsock, daddr, MIN_PIPE_ID_IN_BCAST + node_i,
-                        bandwidth, delay, lossrate) == ERROR) {
-                        WARNING("Error configuring BCAST pipe %d.", MIN_PIPE_ID_IN_BCAST + node_i);
-                        exit (1);
+                        if(configure_rule(dsock, daddr, MIN_PIPE_ID_IN_BCAST + node_i,
+                            bandwidth, delay, lossrate) == ERROR) {
+                            WARNING("Error configuring BCAST pipe %d.", MIN_PIPE_ID_IN_BCAST + node_i);
+                            exit (1);
+                        }
                     }
                 }
+
+                if(SCALING_FACTOR == 10.0) {
+                    INFO("Waiting to reach time %.2f s...", crt_record_time);
+                }
+                else {
+                    INFO("Waiting to reach real time %.2f s (scenario time %.2f)...\n", 
+                        crt_record_time * SCALING_FACTOR, crt_record_time);
+
+                    if(benchmark == TRUE) {
+                        ret = SUCCESS;
+                    }
+                    else if((ret = timer_wait_rdtsc(timer, (uint64_t)(crt_record_time * 1000000))) < 0) {
+                        // the deadline passed while the changes were prepared,
+                        // which can no longer be skipped, so they are applied late
+                        WARNING("Timer deadline missed at time=%.6f s", crt_record_time);
+                    }
+                    if(ret == 2) {
+                        io_bin_reader_rewind(&bin_reader);
+                        if((timer = timer_init_rdtsc()) == NULL) {
+                            WARNING("Could not initialize timer");
+                            exit(1);
+                        }
+                        re_flag = FALSE;
+                        goto emulation_start;
+                    }
+/*
+                    if(timer_wait(timer, crt_record_time * SCALING_FACTOR) != 0) {
+                        fprintf(stderr, "Timer deadline missed at time=%.2f s\n", crt_record_time);
+                    }
+*/
+                }
+
+                if(wireconf_end_record(dsock) != SUCCESS) {
+                    WARNING("Could not apply the record at time=%.6f s", crt_record_time);
+                    exit(1);
+                }
             }
 
 #ifdef __FreeBSD
@@ -1505,7 +1879,100 @@ char **argv;
 
         if(loop == TRUE) {
             re_flag = FALSE;
-            fseek(qomet_fd, 0L, SEEK_SET);
+            io_bin_reader_rewind(&bin_reader);
+            if((timer = timer_init_rdtsc()) == NULL) {
+                WARNING("Could not initialize timer");
+                exit(1);
+            }
+            goto emulation_start;
+        }
+    }
+    else if(sc_type == EVT_SC) {
+        event_list_rewind(&event_list);
+        gettimeofday(&tp_begin, NULL);
+
+        // changes before the start time only set the initial state,
+        // so only the last one of each link is applied
+        if(start_time > 0) {
+            if((event_cnt = event_list_seek(&event_list, start_time, &events)) < 0) {
+                exit(1);
+            }
+            if(wireconf_begin_record(dsock) != SUCCESS) {
+                WARNING("Could not start applying the initial state");
+                exit(1);
+            }
+            for(event_i = 0; event_i < event_cnt; event_i++) {
+                if(configure_rule_jitter(dsock, daddr, events[event_i].pipe, events[event_i].bandwidth,
+                                         events[event_i].delay, events[event_i].jitter,
+                                         events[event_i].loss_rate) != SUCCESS) {
+                    WARNING("Error configuring pipe %u.", events[event_i].pipe);
+                    exit(1);
+                }
+            }
+            if(wireconf_end_record(dsock) != SUCCESS) {
+                WARNING("Could not apply the initial state");
+                exit(1);
+            }
+            record_cnt += event_list.next;
+            timer_shift_rdtsc(timer, (uint64_t)(start_time * 1000000));
+            INFO("Starting at time %.2f s (event %u of %u)", start_time,
+                 event_list.next, event_list.header.event_count);
+        }
+
+        // the list is sorted by time, so the changes with the earliest
+        // deadline are always the next ones
+        while((event_cnt = event_list_next(&event_list, &event_time, &events)) > 0) {
+            record_cnt += event_cnt;
+
+            // the changes are prepared before their deadline
+            if(wireconf_begin_record(dsock) != SUCCESS) {
+                WARNING("Could not start applying the changes at time=%.6f s", event_time);
+                exit(1);
+            }
+            for(event_i = 0; event_i < event_cnt; event_i++) {
+                if(configure_rule_jitter(dsock, daddr, events[event_i].pipe, events[event_i].bandwidth,
+                                         events[event_i].delay, events[event_i].jitter,
+                                         events[event_i].loss_rate) != SUCCESS) {
+                    WARNING("Error configuring pipe %u.", events[event_i].pipe);
+                    exit(1);
+                }
+            }
+
+            if(benchmark == FALSE && event_time > start_time) {
+                INFO("Waiting to reach time %.6f s...", event_time);
+                if((ret = timer_wait_rdtsc(timer, (uint64_t)(event_time * 1000000))) < 0) {
+                    // the list only has the changes of the links, so
+                    // late changes are applied rather than skipped
+                    WARNING("Timer deadline missed at time=%.6f s", event_time);
+                }
+                if(ret == 2) {
+                    if((timer = timer_init_rdtsc()) == NULL) {
+                        WARNING("Could not initialize timer");
+                        exit(1);
+                    }
+                    re_flag = FALSE;
+                    goto emulation_start;
+                }
+            }
+
+            if(wireconf_end_record(dsock) != SUCCESS) {
+                WARNING("Could not apply the changes at time=%.6f s", event_time);
+                exit(1);
+            }
+            loop_cnt++;
+
+            if(re_flag == TRUE) {
+                if((timer = timer_init_rdtsc()) == NULL) {
+                    WARNING("Could not initialize timer");
+                    exit(1);
+                }
+                re_flag = FALSE;
+                goto emulation_start;
+            }
+        }
+
+        if(loop == TRUE) {
+            re_flag = FALSE;
             if((timer = timer_init_rdtsc()) == NULL) {
                 WARNING("Could not initialize timer");
                 exit(1);
@@ -1514,16 +1981,19 @@ char **argv;
         }
     }
     else if(sc_type == TXT_SC) {
-        while(fgets(buf, BUFSIZ, qomet_fd) != NULL) {
-            if(sscanf(buf, "%f %d %f %f %f %d %f %f %f %f %f %f " "%f %f %f %f %f %f %f", \
-                &time, &from, &dummy[0],
-                &dummy[1], &dummy[2], &to, &dummy[3], &dummy[4],
-                &dummy[5],  &dummy[6], &dummy[7], &dummy[8],
-                &dummy[9], &dummy[10], &dummy[11], &bandwidth, 
-                &lossrate, &delay, &dummy[12]) != PARAMETERS_TOTAL) {
+        while((text_result = io_text_read_record(&text_reader, &text_rec)) != FALSE) {
+            if(text_result == ERROR) {
+                io_text_print_error(&text_reader);
                 INFO("Skipped non-parametric line");
                 continue;
             }
+            time = text_rec.time;
+            from = text_rec.from_id;
+            to = text_rec.to_id;
+            bandwidth = text_rec.bandwidth;
+            lossrate = text_rec.loss_rate;
+            delay = text_rec.delay;
+            record_cnt++;
             if(usage_type == 1) {
                 if((from == fid) && (to == next_hop_id)) {
                     INFO("* Wireconf configuration (time=%.2f s): bandwidth=%.2fbit/s lossrate=%.4f delay=%.4f ms", \
@@ -1534,7 +2004,7 @@ char **argv;
                     }
                     else {
                         uint64_t time_usec = time * 1000000;
-                        if(timer_wait_rdtsc(timer, time_usec) < 0) {
+                        if(benchmark == FALSE && timer_wait_rdtsc(timer, time_usec) < 0) {
                             fprintf(stderr, "Timer deadline missed at time=%.2f s\n", time);
                         }
                     }
@@ -1543,7 +2013,7 @@ char **argv;
                     delay = (int)round(delay);
                     lossrate = (int)rint(lossrate * 0x7fffffff);
     
-                    configure_rule(dsock, daddr, pipe_nr, bandwidth, delay, lossrate);
+                    configure_rule_jitter(dsock, daddr, pipe_nr, bandwidth, delay, text_rec.jitter, lossrate);
                     loop_cnt++;
                 }
             }
@@ -1576,11 +2046,12 @@ char **argv;
                         timer_reset(timer, crt_record_time);
                     }
                     else {
-                        if(timer_wait_rdtsc(timer, time * 1000000) < 0) {
+                        if(benchmark == FALSE && timer_wait_rdtsc(timer, (uint64_t)(time * 1000000)) < 0) {
                             WARNING("Timer deadline missed at time=%.2f s", time);
                         }
                     }
     
+                    wireconf_begin_record(dsock);
                     for(i = assign_id; i < (node_cnt + assign_id); i++) {
                         if(i == my_id || direction != DIRECTION_HV) {
                             continue;
@@ -1657,6 +2128,7 @@ char **argv;
                         configure_rule(dsock, daddr, MIN_PIPE_ID_IN_BCAST + offset_num, bandwidth, delay, lossrate);
                         loop_cnt++;
                     }
+                    wireconf_end_record(dsock);
     
                     memset(param_table, 0, sizeof(qomet_param) * MAX_RULE_NUM);
                     rule_cnt = 0;
@@ -1678,7 +2150,7 @@ char **argv;
         } 
     }
     if(loop == TRUE) {
-        fseek(qomet_fd, 0L, SEEK_SET);
+        io_text_rewind(&text_reader);
         goto emulation_start;
     }
 
@@ -1692,15 +2164,40 @@ char **argv;
     }
 //    timer_free(timer);
 
-    delete_rule(dsock, daddr, rule_num);
-
     gettimeofday(&tp_end, NULL);
+    if(benchmark == TRUE) {
+        double elapsed;
+        uint64_t link_cnt;
+
+        elapsed = (tp_end.tv_sec + tp_end.tv_usec / 1.0e6) - (tp_begin.tv_sec + tp_begin.tv_usec / 1.0e6);
+        link_cnt = wireconf_get_stats()->configure_count;
+        fprintf(stdout, "Processed %llu records and %llu link configurations in %.6f s "
+                "(%.0f records/s, %.0f links/s)\n", (unsigned long long)record_cnt,
+                (unsigned long long)link_cnt, elapsed, 
+                elapsed > 0 ? record_cnt / elapsed : 0.0,
+                elapsed > 0 ? link_cnt / elapsed : 0.0);
+        wireconf_print_stats(stdout);
+    }
+
+    if(keep_config == FALSE) {
+        delete_rule(dsock, daddr, rule_num);
+    }
+
     INFO("Experiment execution time=%.4f s", 
         (tp_end.tv_sec+tp_end.tv_usec / 1.0e6) - (tp_begin.tv_sec + tp_begin.tv_usec / 1.0e6));
     DEBUG("Closing socket...");
 
     close_socket(dsock);
 //    fclose(qomet_fd);
+    if(sc_type == TXT_SC) {
+        io_text_close(&text_reader);
+    }
+    else if(sc_type == EVT_SC) {
+        event_list_free(&event_list);
+    }
+    else {
+        io_bin_reader_close(&bin_reader);
+    }
 
     return 0;
 }
@@ -39,6 +39,7 @@
  ***********************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
@@ -64,6 +65,67 @@
 //#define PKT_SIZE_IN_SLOT       60     // 1024 bytes packet including headers
 //#define PKT_SIZE_IN_SLOT       37     // 512 bytes packet including headers
 
+// size of the table of frame timings (must be a power of 2)
+#define FRAME_TIMING_CACHE_SIZE   64
+
+// PPDU duration and slot time of a frame, which only depend on its
+// size, standard and operating rate
+struct frame_timing_class
+{
+  int valid;
+  int frame_size;
+  int standard;
+  float operating_rate;
+
+  // ERROR if the operating rate is not a WLAN one
+  int status;
+  double ppdu_duration;
+  int slot_time;
+};
+
+// adjusted record of a link, together with the inputs it was
+// computed from
+struct adjust_link_cache
+{
+  int valid;
+  struct bin_rec_cls record;
+  int frame_size;
+  float coll_prob;
+  float channel_utilization_others;
+
+  // ERROR if the operating rate is unknown
+  int status;
+  struct bin_rec_cls adjusted;
+};
+
+// state of adjust_deltaQ for one sender that is kept between calls
+struct adjust_cache_class
+{
+  // TRUE if node i cannot be sensed by the sender
+  char *hidden;
+
+  // TRUE if hidden node i is counted in the collision sum of
+  // receiver r (element i * node_count + r)
+  char *sensed;
+
+  // channel utilizations included in the collision sums
+  float *utilizations;
+
+  // number of hidden nodes and sum of their channel utilizations,
+  // for each receiver
+  int *collision_counts;
+  double *collision_sums;
+
+  // adjusted records of the links to each receiver
+  struct adjust_link_cache *links;
+};
+
+static struct frame_timing_class frame_timings[FRAME_TIMING_CACHE_SIZE];
+
+// state of adjust_deltaQ for each sender
+static struct adjust_cache_class *adjust_caches = NULL;
+static int adjust_cache_count = 0;
+
 // statistics communication thread that sends traffic statistics
 // to other wireconf instances
 void *
@@ -385,6 +447,60 @@ stats_listen_thread (void *arg)
   return NULL;
 }
 
+// compute the PPDU duration and slot time of frames of 'frame_size'
+// bytes sent on the link of 'binary_record'; the values are kept in
+// a table, since the same few frame sizes and rates occur at every
+// step; return SUCCESS on success, ERROR if the operating rate is
+// not a WLAN one
+static int
+get_frame_timing (struct bin_rec_cls *binary_record, int frame_size,
+                  double *ppdu_duration, int *slot_time)
+{
+  struct frame_timing_class *timing;
+  struct connection_class connection;
+  unsigned int index;
+
+  index = ((unsigned int) frame_size * 2654435761U
+           ^ (unsigned int) binary_record->operating_rate
+           ^ (unsigned int) binary_record->standard)
+    & (FRAME_TIMING_CACHE_SIZE - 1);
+  timing = &frame_timings[index];
+
+  if (timing->valid == FALSE || timing->frame_size != frame_size
+      || timing->standard != binary_record->standard
+      || timing->operating_rate != binary_record->operating_rate)
+    {
+      connection_init (&connection, "UNKNOWN", "UNKNOWN", "UNKNOWN",
+                       frame_size, binary_record->standard,
+                       1, 2347, FALSE);
+
+      //DEBUG ("Standard: %d  Operating rate: %f", binary_record->standard, binary_record->operating_rate);
+
+      connection.operating_rate =
+        wlan_operating_rate_index
+        (&connection, binary_record->operating_rate);
+
+      if (connection.operating_rate == -1)
+        timing->status = ERROR;
+      else
+        {
+          timing->status = SUCCESS;
+          wlan_ppdu_duration (&connection, &(timing->ppdu_duration),
+                              &(timing->slot_time));
+        }
+
+      timing->frame_size = frame_size;
+      timing->standard = binary_record->standard;
+      timing->operating_rate = binary_record->operating_rate;
+      timing->valid = TRUE;
+    }
+
+  *ppdu_duration = timing->ppdu_duration;
+  *slot_time = timing->slot_time;
+
+  return timing->status;
+}
+
 float
 compute_channel_utilization (struct bin_rec_cls *binary_record,
                  long long unsigned int delta_pkt_counter,
@@ -397,7 +513,6 @@ compute_channel_utilization (struct bin_rec_cls *binary_record,
 
   float float_delta_pkt_counter, float_delta_byte_counter;
 
-  struct connection_class connection;
   double ppdu_duration, frame_duration;
   int slot_time;
 
@@ -413,25 +528,14 @@ compute_channel_utilization (struct bin_rec_cls *binary_record,
     {
       avg_frame_size = float_delta_byte_counter / float_delta_pkt_counter;
 
-      connection_init (&connection, "UNKNOWN", "UNKNOWN", "UNKNOWN",
-               (int) avg_frame_size, binary_record->standard,
-               1, 2347, FALSE);
-
-      //DEBUG ("Standard: %d  Operating rate: %f", binary_record->standard, binary_record->operating_rate);
-
-      connection.operating_rate =
-    wlan_operating_rate_index
-    (&connection, binary_record->operating_rate);
-
-      if (connection.operating_rate == -1)
+      if (get_frame_timing (binary_record, (int) avg_frame_size,
+                            &ppdu_duration, &slot_time) == ERROR)
     {
       //DEBUG ("Unknown operating rate for WLAN: %f, assuming non-WLAN standard and returning 0.0 channel utilization.", binary_record->operating_rate);
 
       return 0.0;
     }
 
-      wlan_ppdu_duration (&connection, &ppdu_duration, &slot_time);
-
 #ifdef ZERO
       frame_duration = 192 /*PHY_Overhead */  +
     ceil ((224 /*MAC_Overhead */  + avg_frame_size * 8 /*Frame_Body */ ) *
@@ -492,7 +596,6 @@ compute_tx_prob(struct bin_rec_cls *binary_record,
   float float_delta_pkt_counter, float_delta_byte_counter;
   float adjusted_float_delta_pkt_counter;
 
-  struct connection_class connection;
   double ppdu_duration;
   int slot_time;
 
@@ -510,25 +613,14 @@ compute_tx_prob(struct bin_rec_cls *binary_record,
     {
       avg_frame_size = float_delta_byte_counter / float_delta_pkt_counter;
 
-      connection_init (&connection, "UNKNOWN", "UNKNOWN", "UNKNOWN",
-               (int) avg_frame_size, binary_record->standard,
-               1, 2347, FALSE);
-
-      //DEBUG ("Standard: %d  Operating rate: %f", binary_record->standard, binary_record->operating_rate);
-
-      connection.operating_rate =
-    wlan_operating_rate_index
-    (&connection, binary_record->operating_rate);
-
-      if (connection.operating_rate == -1)
+      if (get_frame_timing (binary_record, (int) avg_frame_size,
+                            &ppdu_duration, &slot_time) == ERROR)
     {
       //DEBUG ("Unknown operating rate for WLAN: %f, assuming non-WLAN standard and returning 0.0 channel utilization.", binary_record->operating_rate);
 
       return 0.0;
     }
 
-      wlan_ppdu_duration (&connection, &ppdu_duration, &slot_time);
-
       //DEBUG ("float_delta_byte_counter=%f avg_frame_size=%f slot_time=%d", float_delta_byte_counter, avg_frame_size, slot_time);
 
       // special adjust delta_byte_counter because of bandwidth limitation
@@ -565,6 +657,239 @@ compute_tx_prob(struct bin_rec_cls *binary_record,
 
 
 
+// compare the fields of two records
+static int
+bin_rec_equal (const struct bin_rec_cls *a, const struct bin_rec_cls *b)
+{
+  return (a->from_id == b->from_id && a->to_id == b->to_id
+          && a->frame_error_rate == b->frame_error_rate
+          && a->num_retransmissions == b->num_retransmissions
+          && a->standard == b->standard
+          && a->operating_rate == b->operating_rate
+          && a->bandwidth == b->bandwidth
+          && a->loss_rate == b->loss_rate && a->delay == b->delay);
+}
+
+// get the cached state of the current sender, allocating it on first
+// use; return NULL if memory cannot be allocated
+static struct adjust_cache_class *
+get_adjust_cache (struct wireconf_class *wireconf)
+{
+  struct adjust_cache_class *cache;
+  int n = wireconf->node_count;
+  int i;
+
+  // the state is only valid for the same set of nodes
+  if (adjust_cache_count != n)
+    {
+      for (i = 0; i < adjust_cache_count; i++)
+        {
+          free (adjust_caches[i].hidden);
+          free (adjust_caches[i].sensed);
+          free (adjust_caches[i].utilizations);
+          free (adjust_caches[i].collision_counts);
+          free (adjust_caches[i].collision_sums);
+          free (adjust_caches[i].links);
+        }
+      free (adjust_caches);
+      adjust_cache_count = 0;
+
+      adjust_caches = calloc (n, sizeof (struct adjust_cache_class));
+      if (adjust_caches == NULL)
+        return NULL;
+      adjust_cache_count = n;
+    }
+
+  cache = &adjust_caches[wireconf->my_id];
+  if (cache->links == NULL)
+    {
+      cache->hidden = calloc (n, sizeof (char));
+      cache->sensed = calloc ((size_t) n * n, sizeof (char));
+      cache->utilizations = calloc (n, sizeof (float));
+      cache->collision_counts = calloc (n, sizeof (int));
+      cache->collision_sums = calloc (n, sizeof (double));
+      cache->links = calloc (n, sizeof (struct adjust_link_cache));
+
+      if (cache->hidden == NULL || cache->sensed == NULL
+          || cache->utilizations == NULL || cache->collision_counts == NULL
+          || cache->collision_sums == NULL || cache->links == NULL)
+        {
+          free (cache->hidden);
+          free (cache->sensed);
+          free (cache->utilizations);
+          free (cache->collision_counts);
+          free (cache->collision_sums);
+          free (cache->links);
+          memset (cache, 0, sizeof (struct adjust_cache_class));
+          return NULL;
+        }
+    }
+
+  return cache;
+}
+
+// bring the collision sums of the current sender up to date; the
+// sums of the receivers sensing a hidden node only change when its
+// utilization or its records change, so that a node that cannot
+// sense the sender and whose state stays the same costs nothing
+// (the sums are those of compute_collision_probability)
+static void
+update_collision_sums (struct wireconf_class *wireconf,
+                       struct adjust_cache_class *cache,
+                       struct bin_rec_cls **binary_records_ucast)
+{
+  int n = wireconf->node_count;
+  int i, r;
+  int hidden, sensed;
+  float utilization;
+  char *row;
+
+  for (i = 0; i < n; i++)
+    {
+      if (i == wireconf->my_id)
+        continue;
+
+      row = cache->sensed + (size_t) i *n;
+
+      // apply the change of the utilization received from node i
+      utilization = wireconf->total_channel_utilizations[i];
+      if (cache->hidden[i] == TRUE && utilization != cache->utilizations[i])
+        for (r = 0; r < n; r++)
+          if (row[r] == TRUE)
+            cache->collision_sums[r] += utilization - cache->utilizations[i];
+      cache->utilizations[i] = utilization;
+
+      // check whether node i can be sensed by the sender; if not, it
+      // is counted for the receivers that can sense it
+      hidden = (binary_records_ucast[i][wireconf->my_id].loss_rate >= 1.0);
+      if (hidden == FALSE && cache->hidden[i] == FALSE)
+        continue;
+
+      for (r = 0; r < n; r++)
+        {
+          sensed = (hidden == TRUE && r != i && r != wireconf->my_id
+                    && binary_records_ucast[i][r].loss_rate < 1.0);
+          if (sensed == row[r])
+            continue;
+
+          row[r] = sensed;
+          if (sensed == TRUE)
+            {
+              cache->collision_counts[r]++;
+              cache->collision_sums[r] += utilization;
+            }
+          else if (--cache->collision_counts[r] == 0)
+            // avoid accumulating rounding errors
+            cache->collision_sums[r] = 0.0;
+          else
+            cache->collision_sums[r] -= utilization;
+        }
+      cache->hidden[i] = hidden;
+    }
+}
+
+// adjust the record of a link for collision probability 'coll_prob'
+// and channel utilization of others 'total_channel_utilization_others';
+// the result is stored in 'adjusted_record'; return SUCCESS on success,
+// ERROR if the operating rate is unknown
+static int
+adjust_link (struct bin_rec_cls *binary_record, int avg_frame_size,
+             float coll_prob, float total_channel_utilization_others,
+             struct bin_rec_cls *adjusted_record)
+{
+  struct connection_class connection;
+
+  double loss_rate;
+  double delay, jitter;
+  double bandwidth;
+  double adaptive_learning_rate;
+  double num_retransmissions;
+
+  double fixed_delay = 0.0;
+
+  //copy first all fields of the record
+  io_bin_cp_rec (adjusted_record, binary_record);
+
+  // initialize connection
+  connection_init (&connection, "UNKNOWN", "UNKNOWN", "UNKNOWN",
+                   avg_frame_size, binary_record->standard, 1, 2347, FALSE);
+
+  /*
+     if ( number_active_nodes > 1)
+     adaptive_learning_rate = LEARNING_RATE / (number_active_nodes - 1);
+     else
+     adaptive_learning_rate = LEARNING_RATE;
+   */
+
+  adaptive_learning_rate = LEARNING_RATE;
+
+  //DEBUG ("Standard: %d  Operating rate: %f", binary_record->standard, binary_record->operating_rate);
+
+  connection.operating_rate =
+    wlan_operating_rate_index (&connection, binary_record->operating_rate);
+
+  if (connection.operating_rate == -1)
+    {
+      //DEBUG ("Unknown operating rate for WLAN: %f, assuming non-WLAN standard and returning 0.0 channel utilization.", binary_record->operating_rate);
+
+      return ERROR;
+    }
+
+  // compute first the fixed delay by subtracting from the 
+  // static parameters the value computed for 0 channel utilization
+  // of others
+  //      wlan_do_compute_delay_jitter (&connection, &delay, &jitter, 0.0);
+  //fixed_delay = binary_record->delay - delay;
+  //DEBUG ("fixed_delay=%f", fixed_delay);
+
+  // compute frame error rate
+  connection.frame_error_rate
+    = binary_record->frame_error_rate
+    + coll_prob - (binary_record->frame_error_rate * coll_prob);
+  // limit error rate for numerical reasons
+  if (connection.frame_error_rate > MAXIMUM_ERROR_RATE)
+    connection.frame_error_rate = MAXIMUM_ERROR_RATE;
+  adjusted_record->frame_error_rate = connection.frame_error_rate;
+
+  // compute number of retransmissions
+  wlan_retransmissions (&connection, NULL /*scenario */ ,
+                        &num_retransmissions);
+  connection.num_retransmissions = num_retransmissions;
+  adjusted_record->num_retransmissions = connection.num_retransmissions;
+
+  // compute loss rate & adjust by learning
+  wlan_do_compute_loss_rate (&connection, &loss_rate);
+  connection.loss_rate = loss_rate;
+  adjusted_record->loss_rate
+    += ((connection.loss_rate - adjusted_record->loss_rate)
+        * adaptive_learning_rate);
+
+  //DEBUG ("connection.loss_rate=%f adjusted_record->loss_rate=%f", connection.loss_rate, adjusted_record->loss_rate);
+
+  // compute delay & adjust by learning
+  wlan_do_compute_delay_jitter (&connection, &delay, &jitter,
+                                total_channel_utilization_others);
+  connection.variable_delay = delay;
+
+  connection.variable_delay = adjusted_record->delay
+    + ((connection.variable_delay - adjusted_record->delay)
+       * adaptive_learning_rate);
+  // add fixed delay !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+  connection.delay = fixed_delay + connection.variable_delay;
+  adjusted_record->delay = connection.delay;
+
+  //DEBUG ("adjusted_record->delay=%f", adjusted_record->delay);
+
+  // compute bandwidth (using adjusted variable delay from above)
+  wlan_do_compute_bandwidth (&connection, &bandwidth);
+  connection.bandwidth = bandwidth;
+  adjusted_record->bandwidth = connection.bandwidth;
+
+  //DEBUG ("op_rate=%.4f; static FER=%.4f dynamic FER=%.4f; static num_retr=%.4f dynamic num_retr=%.4f; static bandwidth=%.4f dynamic bandwidth=%.4f; static loss_rate=%.4f dynamic loss_rate=%.4f; static delay=%.4f  dynamic delay=%.4f", binary_record->operating_rate, binary_record->frame_error_rate, adjusted_record->frame_error_rate, binary_record->num_retransmissions, adjusted_record->num_retransmissions, binary_record->bandwidth, adjusted_record->bandwidth, binary_record->loss_rate, adjusted_record->loss_rate, binary_record->delay, adjusted_record->delay);
+
+  return SUCCESS;
+}
+
 int
 adjust_deltaQ (struct wireconf_class *wireconf,
            struct bin_rec_cls **binary_records_ucast,
@@ -578,8 +903,6 @@ adjust_deltaQ (struct wireconf_class *wireconf,
   float total_channel_utilization_others = 0.0;
   float total_transmission_probability_others = 0.0;
 
-  struct connection_class connection;
-
   float number_slots_per_packet;
   float number_packets_by_others;
 
@@ -591,7 +914,10 @@ adjust_deltaQ (struct wireconf_class *wireconf,
 
   float ACTIVE_THRESH = 0.02;
 
-  double fixed_delay = 0.0;
+  struct adjust_cache_class *cache;
+  struct adjust_link_cache *link;
+  struct bin_rec_cls *binary_record;
+  float coll_prob;
 
   // need default value !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
   //avg_frame_size = 1024; //1500; //1024;
@@ -733,165 +1059,79 @@ adjust_deltaQ (struct wireconf_class *wireconf,
     {
       //INFO ("Adjusting deltaQ parameters because of interference from others");
 
-      for (i = 0; i < wireconf->node_count; i++)
-    // do not consider the node itself
-    if (i != wireconf->my_id)
-      {
-        double loss_rate;
-        double delay, jitter;
-        double bandwidth;
-        double adaptive_learning_rate;
-        float coll_prob;
-        double num_retransmissions;
-
-        // initialize connection
-        connection_init (&connection, "UNKNOWN", "UNKNOWN", "UNKNOWN",
-                 (int) avg_frame_sizes[i],
-                 binary_records_ucast[wireconf->my_id][i].
-                 standard, 1, 2347, FALSE);
-
-
-        coll_prob = compute_collision_probability (wireconf, i,
-                               binary_records_ucast);
-        //DEBUG ("NEW: avg_frame_size=%f coll_prob = %f", avg_frame_sizes[i], coll_prob);
-
-        /*
-           if ( number_active_nodes > 1)
-           adaptive_learning_rate = LEARNING_RATE / (number_active_nodes - 1);
-           else
-           adaptive_learning_rate = LEARNING_RATE;
-         */
-
-        adaptive_learning_rate = LEARNING_RATE;
-
-        //float new_bandwidth;
-        //DEBUG ("Standard: %d  Operating rate: %f", binary_records_ucast[wireconf->my_id][i].standard, binary_records_ucast[wireconf->my_id][i].operating_rate);
-
-        connection.operating_rate =
-          wlan_operating_rate_index
-          (&connection,
-           binary_records_ucast[wireconf->my_id][i].operating_rate);
-        //      adjusted_binary_records_ucast[i].operating_rate 
-        //  = connection.operating_rate;
-
-        if (connection.operating_rate == -1)
+      // share channel fairly!!!!!!!!!!!!!!!!!!
+      if (number_active_nodes > 1)
+        if ((total_self_channel_utilization < (1.0 / number_active_nodes))
+            && (total_channel_utilization_others >
+                (1.0 - 1.0 / number_active_nodes)))
           {
-        //DEBUG ("Unknown operating rate for WLAN: %f, assuming non-WLAN standard and returning 0.0 channel utilization.", binary_records_ucast[wireconf->my_id][i].operating_rate);
-
-        return ERROR;
+            total_channel_utilization_others =
+              (1.0 - 1.0 / number_active_nodes);
+            //DEBUG ("corrected total_channel_utilization_others=%f", total_channel_utilization_others);
           }
 
-        // compute first the fixed delay by subtracting from the 
-        // static parameters the value computed for 0 channel utilization
-        // of others
-        //      wlan_do_compute_delay_jitter (&connection, &delay, &jitter, 0.0);
-        //fixed_delay = binary_records_ucast[wireconf->my_id][i].delay - delay;
-        //DEBUG ("fixed_delay=%f", fixed_delay);
-
-        // compute frame error rate
-        connection.frame_error_rate
-          = binary_records_ucast[wireconf->my_id][i].frame_error_rate
-          + coll_prob
-          - (binary_records_ucast[wireconf->my_id][i].frame_error_rate
-         * coll_prob);
-        // limit error rate for numerical reasons
-        if (connection.frame_error_rate > MAXIMUM_ERROR_RATE)
-          connection.frame_error_rate = MAXIMUM_ERROR_RATE;
-        adjusted_binary_records_ucast[i].frame_error_rate
-          = connection.frame_error_rate;
-
-        // compute number of retransmissions
-        wlan_retransmissions (&connection, NULL /*scenario */ ,
-                  &num_retransmissions);
-        connection.num_retransmissions = num_retransmissions;
-        adjusted_binary_records_ucast[i].num_retransmissions
-          = connection.num_retransmissions;
-
-        // compute loss rate & adjust by learning
-        wlan_do_compute_loss_rate (&connection, &loss_rate);
-        connection.loss_rate = loss_rate;
-        adjusted_binary_records_ucast[i].loss_rate
-          += ((connection.loss_rate
-           - adjusted_binary_records_ucast[i].loss_rate)
-          * adaptive_learning_rate);
-
-        //DEBUG ("connection.loss_rate=%f adjusted_binary_records_ucast[i].loss_rate=%f", connection.loss_rate, adjusted_binary_records_ucast[i].loss_rate);
-
-        /*
-           // share channel fairly!!!!!!!!!!!!!!!!!!
-           if (number_active_nodes > 1)
-           if (total_self_channel_utilization < (1.0/number_active_nodes))
-           {
-           total_channel_utilization_others = (1 - 1.0/number_active_nodes);
-           DEBUG ("corrected total_channel_utilization_others=%f", 
-           total_channel_utilization_others);
-           }
-         */
-
-        /*
-           // share channel fairly!!!!!!!!!!!!!!!!!!
-           if (number_active_nodes > 1)
-           if (total_channel_utilization_others > (1 - 1.0/number_active_nodes))
-           {
-           total_channel_utilization_others = (1 - 1.0/number_active_nodes);
-           DEBUG ("corrected total_channel_utilization_others=%f", 
-           total_channel_utilization_others);
-           }
-         */
-
-        // share channel fairly!!!!!!!!!!!!!!!!!!
-        if (number_active_nodes > 1)
-          if ((total_self_channel_utilization <
-           (1.0 / number_active_nodes))
-          && (total_channel_utilization_others >
-              (1.0 - 1.0 / number_active_nodes)))
-        {
-          total_channel_utilization_others =
-            (1.0 - 1.0 / number_active_nodes);
-          //DEBUG ("corrected total_channel_utilization_others=%f", total_channel_utilization_others);
-        }
-
-        // compute delay & adjust by learning
-        wlan_do_compute_delay_jitter (&connection, &delay, &jitter,
-                      total_channel_utilization_others);
-        connection.variable_delay = delay;
-
-        connection.variable_delay = adjusted_binary_records_ucast[i].delay
-          + ((connection.variable_delay
-          - adjusted_binary_records_ucast[i].delay)
-         * adaptive_learning_rate);
-        // add fixed delay !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-        connection.delay = fixed_delay + connection.variable_delay;
-        adjusted_binary_records_ucast[i].delay = connection.delay;
-
-        //DEBUG ("adjusted_binary_records_ucast[i].delay=%f", adjusted_binary_records_ucast[i].delay);
-
-        // compute bandwidth (using adjusted variable delay from above)
-        wlan_do_compute_bandwidth (&connection, &bandwidth);
-        connection.bandwidth = bandwidth;
-        adjusted_binary_records_ucast[i].bandwidth = connection.bandwidth;
-
-        //DEBUG ("op_rate=%.4f; static FER=%.4f dynamic FER=%.4f; static num_retr=%.4f dynamic num_retr=%.4f; static bandwidth=%.4f dynamic bandwidth=%.4f; static loss_rate=%.4f dynamic loss_rate=%.4f; static delay=%.4f  dynamic delay=%.4f", binary_records_ucast[wireconf->my_id][i].operating_rate, binary_records_ucast[wireconf->my_id][i].frame_error_rate, adjusted_binary_records_ucast[i].frame_error_rate, binary_records_ucast[wireconf->my_id][i].num_retransmissions, adjusted_binary_records_ucast[i].num_retransmissions, binary_records_ucast[wireconf->my_id][i].bandwidth, adjusted_binary_records_ucast[i].bandwidth, binary_records_ucast[wireconf->my_id][i].loss_rate, adjusted_binary_records_ucast[i].loss_rate, binary_records_ucast[wireconf->my_id][i].delay, adjusted_binary_records_ucast[i].delay);
-
-        /*
-           adjusted_binary_records_ucast[i].delay 
-           += ((connection.delay 
-           - adjusted_binary_records_ucast[i].delay)
-           * LEARNING_ALPHA);
-
-           new_bandwidth = adjusted_binary_records_ucast[i].bandwidth
-           + ((connection.bandwidth 
-           - adjusted_binary_records_ucast[i].bandwidth)
-           * LEARNING_ALPHA);
+      // the adjusted record of a link only depends on its record,
+      // frame size, collision probability and on the channel
+      // utilization of others, so it is kept between calls and only
+      // recomputed when one of them changed; without memory for the
+      // cached state everything is recomputed
+      cache = get_adjust_cache (wireconf);
+      if (cache != NULL)
+        update_collision_sums (wireconf, cache, binary_records_ucast);
 
-           DEBUG ("old_bw=%f  new_bw=%f",
-           adjusted_binary_records_ucast[i].bandwidth, new_bandwidth);
+      for (i = 0; i < wireconf->node_count; i++)
+        // do not consider the node itself
+        if (i != wireconf->my_id)
+          {
+            binary_record = &(binary_records_ucast[wireconf->my_id][i]);
 
-           adjusted_binary_records_ucast[i].bandwidth = new_bandwidth;
-         */
+            if (cache == NULL)
+              {
+                coll_prob = compute_collision_probability
+                  (wireconf, i, binary_records_ucast);
+                //DEBUG ("NEW: avg_frame_size=%f coll_prob = %f", avg_frame_sizes[i], coll_prob);
+
+                if (adjust_link (binary_record, (int) avg_frame_sizes[i],
+                                 coll_prob, total_channel_utilization_others,
+                                 &(adjusted_binary_records_ucast[i]))
+                    == ERROR)
+                  return ERROR;
+              }
+            else
+              {
+                // limit maximum value to 1
+                coll_prob = cache->collision_sums[i];
+                if (coll_prob >= 1.0)
+                  coll_prob = 1.0;
+
+                link = &(cache->links[i]);
+                if (link->valid == FALSE
+                    || bin_rec_equal (&(link->record), binary_record) == FALSE
+                    || link->frame_size != (int) avg_frame_sizes[i]
+                    || link->coll_prob != coll_prob
+                    || link->channel_utilization_others
+                    != total_channel_utilization_others)
+                  {
+                    io_bin_cp_rec (&(link->record), binary_record);
+                    link->frame_size = (int) avg_frame_sizes[i];
+                    link->coll_prob = coll_prob;
+                    link->channel_utilization_others
+                      = total_channel_utilization_others;
+                    link->status = adjust_link (binary_record,
+                                                link->frame_size, coll_prob,
+                                                total_channel_utilization_others,
+                                                &(link->adjusted));
+                    link->valid = TRUE;
+                  }
+
+                if (link->status == ERROR)
+                  return ERROR;
+                io_bin_cp_rec (&(adjusted_binary_records_ucast[i]),
+                               &(link->adjusted));
+              }
 
-        binary_records_ucast_changed[i] = TRUE;
-      }
+            binary_records_ucast_changed[i] = TRUE;
+          }
     }
 
   return SUCCESS;
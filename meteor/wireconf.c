@@ -43,14 +43,17 @@
 #include <sys/socket.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <ctype.h>
 #include <string.h>
 #include <unistd.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "global.h"
 #include "wireconf.h"
+#include "message.h"
 
 #ifdef __FreeBSD__
 #include <netinet/ip_fw.h>
@@ -62,6 +65,8 @@
 #include "ip_common.h"
 #include "tc_common.h"
 #include "tc_util.h"
+#include "route_cache.h"
+#include "tc_reconcile.h"
 #endif
 
 #define FRAME_LENGTH 1522
@@ -100,6 +105,17 @@ else if(name ##_current.tv_sec != name##_prev.tv_sec) {
 }                                                                                  \
 printf("%s: sec:%lu usec:%06ld\n", #name, name##_sec, name##_usec);
 
+// u32 hash table used to classify packets by the low byte of
+// their source address; link filters are spread over its
+// 256 buckets so that the kernel does not need to walk
+// a linear chain of keys for each packet
+#define U32_HASH_HTID      2
+#define U32_HASH_HANDLE    (U32_HASH_HTID << 20)
+#define U32_HASH_DIVISOR   "256"
+#define U32_HASH_KEY_SRC   "mask 0x000000ff at 12"
+#define U32_ROOT_HT        "800::"
+#define U32_HASH_LINK_NODE 0xffe
+
 #ifdef INGRESS
 char ifb_devname[DEV_NAME] = "ifb0";
 #endif 
@@ -160,8 +176,8 @@ uint16_t *port;
 }
 #endif
 
-int
-get_socket(void)
+static int
+open_kernel_socket(void)
 {
 #ifdef __FreeBSD__
     uint32_t socket_id;
@@ -179,17 +195,60 @@ get_socket(void)
 #endif
 }
 
-void
-close_socket(socket_id)
+static void
+close_kernel_socket(socket_id)
 int socket_id;
 {
 #ifdef __FreeBSD__
     close(socket_id);
 #elif __linux
+    wireconf_workers_stop();
+    route_cache_close();
+    // a record still held is sent before the socket is closed
+    rtnl_batch_end(&rth);
     rtnl_close(&rth);
 #endif
 }
 
+#ifdef __linux
+// TRUE if netem also limits the rate of the links ("netem" backend);
+// the HTB classes then only classify the traffic, and a link change
+// is a single netem change
+static int netem_native = FALSE;
+
+// correlation of the delay and of the loss of all links [%]
+static double netem_delay_corr = 0;
+static double netem_loss_corr = 0;
+
+static int
+open_netem_socket(void)
+{
+    netem_native = TRUE;
+    return open_kernel_socket();
+}
+
+// in ingress mode the traffic may be spread over several ifb devices
+// (shards) by the low bits of its source or destination address, so
+// that all packets don't contend for the root qdisc lock of a single
+// device; shard 0 is 'ifb_devname' and also gets the non-IP traffic
+#define MAX_SHARDS 32
+#define SHARD_ALL(count) ((count) == 32 ? 0xffffffffU : (1U << (count)) - 1)
+static int shard_count = 1;
+static int shard_key = WIRECONF_SHARD_SRC;
+static char shard_devname[MAX_SHARDS][IFNAMSIZ];
+
+// shards on which each pipe is installed, as a bit mask indexed
+// by the pipe handle (the minor number of its HTB class)
+static uint32_t pipe_shards[TC_H_MIN_MASK + 1];
+
+static char*
+shard_dev(i)
+int i;
+{
+    return (i == 0) ? ifb_devname : shard_devname[i];
+}
+#endif
+
 #ifdef __FreeBSD__
 static int
 apply_socket_options(s, option_id, option, socklen_t, option_length)
@@ -388,71 +447,226 @@ int direction;
 }
 #endif
 
-int32_t
-init_rule(dst, protocol)
-char *dst;
-int32_t protocol;
+#ifdef __linux
+// create the u32 hash table used for link filters, and the filter
+// in the root table that hashes packets into it by source address;
+// return 0 on success, non-zero on error
+static int
+add_u32_hash_table(devname)
+char *devname;
+{
+    int ret;
+    uint32_t filter_id[4];
+    char anyaddr[20];
+    char link[20];
+    struct u32_params ufp;
+
+    // hash table (handle 2:, 256 buckets)
+    memset(&ufp, 0, sizeof(struct u32_params));
+    filter_id[0] = 1;
+    filter_id[1] = 0;
+    filter_id[2] = U32_HASH_HANDLE >> 16;
+    filter_id[3] = U32_HASH_HANDLE & 0xFFFF;
+    ufp.divisor = U32_HASH_DIVISOR;
+
+    if((ret = add_tc_filter(devname, filter_id, "ip", "u32", &ufp)) != 0) {
+        fprintf(stderr, "Cannot add u32 hash table on %s\n", devname);
+        return ret;
+    }
+
+    // root table entry that matches all IP packets and links 
+    // them to the bucket given by the low byte of the source address;
+    // its node id is placed just before the catch-all filter
+    memset(&ufp, 0, sizeof(struct u32_params));
+    filter_id[2] = 0x8000;
+    filter_id[3] = U32_HASH_LINK_NODE;
+
+    strcpy(anyaddr, "0.0.0.0/0");
+    ufp.match[IP_SRC].proto = "ip";
+    ufp.match[IP_SRC].filter = "src";
+    ufp.match[IP_SRC].type = "u32";
+    ufp.match[IP_SRC].arg = anyaddr;
+
+    snprintf(link, sizeof(link), "%x:", U32_HASH_HTID);
+    ufp.ht = U32_ROOT_HT;
+    ufp.link = link;
+    ufp.hashkey = U32_HASH_KEY_SRC;
+
+    if((ret = add_tc_filter(devname, filter_id, "ip", "u32", &ufp)) != 0) {
+        fprintf(stderr, "Cannot add u32 hash link filter on %s\n", devname);
+        return ret;
+    }
+
+    return 0;
+}
+
+// compute the hash table bucket ("2:XX:") in which a filter 
+// matching source address 'addr' must be placed; return NULL 
+// if the address is not a single host (e.g., "any" or a prefix
+// shorter than /32), in which case the filter stays in the root table
+static char *
+get_u32_bucket(addr, ht)
+char *addr;
+char *ht;
 {
+    char host[20];
+    char *slash;
+    struct in_addr in;
+
+    if(addr == NULL || strcmp(addr, "any") == 0) {
+        return NULL;
+    }
+
+    strncpy(host, addr, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+    if((slash = strchr(host, '/')) != NULL) {
+        if(atoi(slash + 1) != 32) {
+            return NULL;
+        }
+        *slash = '\0';
+    }
+
+    if(inet_pton(AF_INET, host, &in) != 1) {
+        return NULL;
+    }
+
+    sprintf(ht, "%x:%x:", U32_HASH_HTID, ntohl(in.s_addr) & 0xFF);
+
+    return ht;
+}
+#endif
+
 #ifdef __linux
-    int32_t i;
-    char *devname;
-    uint32_t htb_qdisc_id[4];
+// destination used at initialization time, needed to find 
+// the device to flush when not in ingress mode
+static char init_dst[DEV_NAME] = "";
+
+// TRUE while rules are installed in bulk, even if the netlink
+// batch could not be started and objects are sent one by one
+static int kernel_bulk_open = FALSE;
+
+// find the output device for 'dst' in the route cache, so that
+// installing a rule needs no netlink route lookup; destinations
+// the cache cannot resolve are looked up in the kernel
+static char*
+get_route_dev(dst)
+char *dst;
+{
+    const char *devname;
 
-    ll_init_map(&rth);
+    if((devname = route_cache_get_dev(dst)) != NULL) {
+        return (char*)devname;
+    }
 
-    if(!INGRESS) {
-        devname =  get_route_info("dev", dst);
+    return (char*)get_route_info("dev", dst);
+}
+
+// create the ifb devices of the first 'count' shards if they don't
+// exist, and bring them up; return the number of shards available
+static int
+shards_up(count)
+int count;
+{
+    int i;
+
+    for(i = 0; i < count; i++) {
+        if(if_nametoindex(shard_dev(i)) == 0 && add_ifb(shard_dev(i)) < 0 && i > 0) {
+            WARNING("Cannot create ifb device %s; ingress traffic is spread over %d devices", shard_dev(i), i);
+            return i;
+        }
+        set_ifb(shard_dev(i), IF_UP);
+        change_ifqueuelen(shard_dev(i), QLEN);
     }
-    if(INGRESS) {
-        set_ifb(ifb_devname, IF_UP);
-        change_ifqueuelen(ifb_devname, QLEN);
 
-        for(i = 0; i < if_num; i++) {
-            if(!device_list[i].dev_name) {
-                break;
-            }
-            delete_netem_qdisc(device_list[i].dev_name, 1);
-            add_ingress_qdisc(device_list[i].dev_name);
-            if(add_ingress_filter(device_list[i].dev_name, ifb_devname) != 0) {
-                printf("Cannot add ingress filter from %s to %s\n", device_list[i].dev_name, ifb_devname);
+    return count;
+}
+
+// redirect the traffic received on the emulation interfaces to the
+// ifb devices of 'count' shards; return the name of the first one
+static char*
+redirect_ingress(count)
+int count;
+{
+    int32_t i;
+    int k;
+
+    for(i = 0; i < if_num; i++) {
+        if(!device_list[i].dev_name) {
+            break;
+        }
+        delete_netem_qdisc(device_list[i].dev_name, 1);
+        add_ingress_qdisc(device_list[i].dev_name);
+
+        // the IPv4 packets of shard 0 and the other packets are
+        // redirected by the filter that matches all packets
+        for(k = 1; k < count; k++) {
+            if(add_ingress_shard_filter(device_list[i].dev_name, shard_dev(k),
+                                        shard_key == WIRECONF_SHARD_DST, k, count - 1) != 0) {
+                printf("Cannot add ingress filter from %s to %s\n", device_list[i].dev_name, shard_dev(k));
             }
         }
+        if(add_ingress_filter(device_list[i].dev_name, ifb_devname) != 0) {
+            printf("Cannot add ingress filter from %s to %s\n", device_list[i].dev_name, ifb_devname);
+        }
+    }
 
 /* debug now...
-        int i;
-        int nifaces;
-        struct ifconf ifconf;
-        static struct ifreq ifreqs[MAX_DEV];
+    int i;
+    int nifaces;
+    struct ifconf ifconf;
+    static struct ifreq ifreqs[MAX_DEV];
 
-        memset(&ifconf, 0, sizeof(ifconf));
-        ifconf.ifc_buf = (char*) (ifreqs);
-        ifconf.ifc_len = sizeof(ifreqs);
+    memset(&ifconf, 0, sizeof(ifconf));
+    ifconf.ifc_buf = (char*) (ifreqs);
+    ifconf.ifc_len = sizeof(ifreqs);
 
-        if(get_iface_list(&ifconf) < 0) {
-            return -1;
-        }
-        nifaces =  ifconf.ifc_len / sizeof(struct ifreq);
-        dprintf(("Interfaces (count = %d)\n", nifaces));
-        for(i = 0; i < nifaces; i++) {
-            devname = ifreqs[i].ifr_name;
-            dprintf(("[init_rule] add ingress device %s\n", devname));
+    if(get_iface_list(&ifconf) < 0) {
+        return -1;
+    }
+    nifaces =  ifconf.ifc_len / sizeof(struct ifreq);
+    dprintf(("Interfaces (count = %d)\n", nifaces));
+    for(i = 0; i < nifaces; i++) {
+        devname = ifreqs[i].ifr_name;
+        dprintf(("[init_rule] add ingress device %s\n", devname));
 
-            delete_netem_qdisc(devname, 0);
-            add_ingress_qdisc(devname);
-            add_ingress_filter(devname, ifb_devname);
-        }
+        delete_netem_qdisc(devname, 0);
+        add_ingress_qdisc(devname);
+        add_ingress_filter(devname, ifb_devname);
+    }
 */
-        devname = ifb_devname;
+    return ifb_devname;
+}
+
+char*
+wireconf_link_device(dst)
+char *dst;
+{
+    // the links are not sharded, as they are not emulated by qdiscs
+    if(INGRESS) {
+        if(shard_count > 1) {
+            INFO("Ingress traffic is not spread over several devices with the '%s' backend",
+                 wireconf_get_backend()->name);
+        }
+        shards_up(1);
+        return redirect_ingress(1);
     }
- 
-    delete_netem_qdisc(devname, 0);
 
-    htb_qdisc_id[0] = TC_H_ROOT;
-    htb_qdisc_id[1] = 0;
-    htb_qdisc_id[2] = 1;
-    htb_qdisc_id[3] = 0;
-    add_htb_qdisc(devname, htb_qdisc_id);
+    if(route_cache_open() < 0) {
+        WARNING("Cannot open route cache; routes will be looked up for each rule");
+    }
+    return get_route_dev(dst);
+}
+#endif
 
+#ifdef __linux
+// install on 'devname' the root HTB qdisc, the default class and
+// netem qdisc, and the tables of the link filters
+static int32_t
+init_link_tree(devname, protocol)
+char *devname;
+int32_t protocol;
+{
+    uint32_t htb_qdisc_id[4];
     char srcaddr[20];
     char dstaddr[20];
     uint32_t htb_class_id[4];
@@ -461,6 +675,14 @@ int32_t protocol;
     struct qdisc_params qp;
     struct u32_params ufp;
 
+    delete_netem_qdisc(devname, 0);
+
+    htb_qdisc_id[0] = TC_H_ROOT;
+    htb_qdisc_id[1] = 0;
+    htb_qdisc_id[2] = 1;
+    htb_qdisc_id[3] = 0;
+    add_htb_qdisc(devname, htb_qdisc_id);
+
     memset(&ufp, 0, sizeof(struct u32_params));
 
     htb_class_id[0] = 1;
@@ -473,8 +695,10 @@ int32_t protocol;
     netem_qdisc_id[1] = 65535;
     netem_qdisc_id[2] = 65535;
     netem_qdisc_id[3] = 0;
+    memset(&qp, 0, sizeof(struct qdisc_params));
     qp.loss = ~0;
     qp.limit = 100000;
+    qp.rate_native = netem_native;
     add_netem_qdisc(devname, netem_qdisc_id, qp);
 
     filter_id[0] = 1;
@@ -498,62 +722,156 @@ int32_t protocol;
     ufp.classid[1] = filter_id[3];
 
     add_tc_filter(devname, filter_id, "ip", "u32", &ufp);
+
+    // link filters are hashed on the IPv4 source address;
+    // Ethernet matches remain in the linear root table
+    if(protocol == IP) {
+        if(add_u32_hash_table(devname) != 0) {
+            return ERROR;
+        }
+    }
+
+    return SUCCESS;
+}
+#endif
+
+static int32_t
+init_kernel(dst, protocol)
+char *dst;
+int32_t protocol;
+{
+#ifdef __linux
+    int32_t i;
+    char *devname;
+    char *reconcile_devs[MAX_IFS + MAX_SHARDS];
+    int reconcile_dev_count = 0;
+    int k;
+
+    // the devices are created before the map of device names is read
+    if(INGRESS) {
+        if((shard_count = shards_up(shard_count)) > 1) {
+            INFO("Ingress traffic is spread over %d ifb devices by %s address", shard_count,
+                 (shard_key == WIRECONF_SHARD_DST) ? "destination" : "source");
+        }
+    }
+
+    ll_init_map(&rth);
+
+    if(dst != NULL) {
+        strncpy(init_dst, dst, sizeof(init_dst) - 1);
+    }
+
+    if(!INGRESS) {
+        if(route_cache_open() < 0) {
+            WARNING("Cannot open route cache; routes will be looked up for each rule");
+        }
+        devname = get_route_dev(dst);
+    }
+
+    // when rules are installed in bulk, the configuration left on the
+    // devices by a previous run is reconciled with the new one, so that
+    // only the objects that differ are changed instead of all of them;
+    // this also holds when the batch could not be started and objects
+    // are sent one by one, but rules installed outside of bulk mode are
+    // not reconciled, as the unused objects are removed at its end
+    if(kernel_bulk_open == TRUE) {
+        if(INGRESS) {
+            for(k = 0; k < shard_count; k++) {
+                reconcile_devs[reconcile_dev_count++] = shard_dev(k);
+            }
+            for(i = 0; i < if_num; i++) {
+                if(device_list[i].dev_name[0] != '\0') {
+                    reconcile_devs[reconcile_dev_count++] = device_list[i].dev_name;
+                }
+            }
+        }
+        else if(devname != NULL) {
+            reconcile_devs[reconcile_dev_count++] = devname;
+        }
+        if(tc_reconcile_begin(reconcile_devs, reconcile_dev_count) < 0) {
+            WARNING("Cannot read the tc state; the configuration will be rebuilt");
+        }
+    }
+
+    if(INGRESS) {
+        redirect_ingress(shard_count);
+        for(k = 0; k < shard_count; k++) {
+            if(init_link_tree(shard_dev(k), protocol) != SUCCESS) {
+                return ERROR;
+            }
+        }
+        return 0;
+    }
+
+    if(init_link_tree(devname, protocol) != SUCCESS) {
+        return ERROR;
+    }
 #endif
     return 0;
 }
 
 #ifdef __linux
-int32_t
-add_rule_netem(rulenum, handle_nr, protocol, src, dst, direction)
-uint16_t rulenum;
-int handle_nr;
+// set the address matches and target class of a link filter;
+// IPv4 filters matching a single source host are placed in 
+// the corresponding bucket of the u32 hash table
+static void
+set_link_filter(up, protocol, handle_nr, src_type, src_arg, dst_type, dst_arg, ht)
+struct u32_params *up;
 int32_t protocol;
-char *src;
-char *dst;
-int direction;
+int handle_nr;
+char *src_type;
+char *src_arg;
+char *dst_type;
+char *dst_arg;
+char *ht;
 {
-    char *devname;
-    uint32_t htb_class_id[4];
-    uint32_t netem_qdisc_id[4];
-    uint32_t filter_id[4];
-    struct qdisc_params qp;
-    struct u32_params ufp;
+    char *proto = NULL;
 
-    if(!INGRESS) {
-        devname = (char* )malloc(DEV_NAME);
-        devname =  (char* )get_route_info("dev", dst);
+    if(protocol == ETH) {
+        proto = "ether";
     }
-    else if(INGRESS) {
-        devname = ifb_devname;
+    else if(protocol == IP) {
+        proto = "ip";
     }
 
-    memset(&qp, 0, sizeof(struct qdisc_params));
-    memset(&ufp, 0, sizeof(struct u32_params));
+    up->match[IP_SRC].type = src_type;
+    up->match[IP_SRC].proto = proto;
+    up->match[IP_SRC].filter = "src";
+    up->match[IP_SRC].arg = src_arg;
 
-    dprintf(("[add_rule] rulenum = %d\n", handle_nr));
-    qp.limit = 100000;
-    qp.delay = 0.001;
-    qp.rate = Gigabit;
-    qp.buffer = Gigabit / 1000;
+    up->match[IP_DST].type = dst_type;
+    up->match[IP_DST].proto = proto;
+    up->match[IP_DST].offmask = 0;
+    up->match[IP_DST].filter = "dst";
+    up->match[IP_DST].arg = dst_arg;
 
-    char srcaddr[20];
-    char dstaddr[20];
-    char bcastaddr[20];
+    up->classid[0] = 1;
+    up->classid[1] = handle_nr;
 
-    htb_class_id[0] = 1;
-    htb_class_id[1] = 0;
-    htb_class_id[2] = 1;
-    htb_class_id[3] = handle_nr;
+    // filters without a source match must stay in the root table
+    if(protocol == IP && src_type != NULL) {
+        up->ht = get_u32_bucket(src_arg, ht);
+    }
+}
 
-    netem_qdisc_id[0] = 1;
-    netem_qdisc_id[1] = handle_nr;
-    netem_qdisc_id[2] = handle_nr;
-    netem_qdisc_id[3] = 0;
+void
+wireconf_build_link_filters(ufp, addrs, handle_nr, protocol, src, dst)
+struct u32_params *ufp;
+char addrs[][WIRECONF_ADDR_LEN];
+int handle_nr;
+int32_t protocol;
+char *src;
+char *dst;
+{
+    char *srcaddr = addrs[0];
+    char *dstaddr = addrs[1];
+    char *bcastaddr = addrs[2];
+    char *src_ht = addrs[3];
+    char *dst_ht = addrs[4];
+    char *src_type;
+    char *dst_type;
 
-    filter_id[0] = 1;
-    filter_id[1] = 0;
-    filter_id[2] = 1;
-    filter_id[3] = handle_nr;
+    memset(ufp, 0, WIRECONF_LINK_FILTERS * sizeof(struct u32_params));
 
     if(protocol == ETH) {
         sprintf(bcastaddr, "%s", "ff:ff:ff:ff:ff:ff");
@@ -563,103 +881,227 @@ int direction;
     }
 
     if(src != NULL) {
-        if(protocol == ETH) {
-            sprintf(srcaddr, "%s", src);
-        }
-        else if(protocol == IP) {
-            sprintf(srcaddr, "%s", src);
-        }
+        snprintf(srcaddr, WIRECONF_ADDR_LEN, "%s", src);
         dprintf(("[add_rule] filter source address : %s\n", srcaddr));
     }
     else {
         dprintf(("[add_rule] source address is NULL\n"));
     }
     if(dst != NULL) {
-        if(protocol == ETH) {
-            sprintf(dstaddr, "%s", dst);
-        }
-        else if(protocol == IP) {
-            sprintf(dstaddr, "%s", dst);
-        }
+        snprintf(dstaddr, WIRECONF_ADDR_LEN, "%s", dst);
         dprintf(("[add_rule] filter dstination address : %s\n", dstaddr));
     }
     else {
         dprintf(("[add_rule] destination address is NULL\n"));
     }
 
-    if(INGRESS) {
-        devname = ifb_devname;
-    }
-
     if(strcmp(src, "any") == 0) {
         strcpy(srcaddr, "0.0.0.0/0");
-        ufp.match[IP_SRC].type = NULL;
+        src_type = NULL;
     }
     else {
-        ufp.match[IP_SRC].type = "u32";
-    }
-
-    if(protocol == ETH) {
-        ufp.match[IP_SRC].proto = "ether";
-    }
-    else if(protocol == IP) {
-        ufp.match[IP_SRC].proto = "ip";
+        src_type = "u32";
     }
-    ufp.match[IP_SRC].filter = "src";
-    ufp.match[IP_SRC].arg = srcaddr;
 
     if(strcmp(dst, "any") == 0) {
         strcpy(dstaddr, "0.0.0.0/0");
-        ufp.match[IP_DST].type = NULL;
+        dst_type = NULL;
     }
     else {
-        ufp.match[IP_DST].type = "u32";
+        dst_type = "u32";
     }
 
-    if(protocol == ETH) {
-        ufp.match[IP_DST].proto = "ether";
-        ufp.match[IP_DST].offmask = 0;
-    }
-    else if(protocol == IP) {
-        ufp.match[IP_DST].proto = "ip";
-        ufp.match[IP_DST].offmask = 0;
-    }
-    ufp.match[IP_DST].filter = "dst";
-    ufp.match[IP_DST].arg = dstaddr;
-    ufp.classid[0] = filter_id[2];
-    ufp.classid[1] = filter_id[3];
+    // forward direction (src -> dst)
+    set_link_filter(&ufp[0], protocol, handle_nr, src_type, srcaddr, dst_type, dstaddr, src_ht);
 
-    add_htb_class(devname, htb_class_id, 1000000000);
-    add_netem_qdisc(devname, netem_qdisc_id, qp);
-    add_tc_filter(devname, filter_id, "ip", "u32", &ufp);
+    // reverse direction (dst -> src)
+    set_link_filter(&ufp[1], protocol, handle_nr, dst_type, dstaddr, src_type, srcaddr, dst_ht);
 
-    if(strcmp(dst, "any") == 0) {
-        ufp.match[IP_SRC].type = NULL;
+    // broadcast traffic sent by src; the match types are 
+    // the same as for the reverse direction
+    set_link_filter(&ufp[2], protocol, handle_nr, dst_type, srcaddr, src_type, bcastaddr, src_ht);
+}
+
+// return the shards of the packets matched by a link filter
+static uint32_t
+link_filter_shards(up, protocol)
+struct u32_params *up;
+int32_t protocol;
+{
+    struct filter_match *m;
+    char addr[WIRECONF_ADDR_LEN];
+    char *p;
+    struct in_addr in;
+    int prefix = 32;
+    uint32_t host_bits;
+
+    if(!INGRESS || shard_count == 1) {
+        return 1;
     }
-    else {
-        ufp.match[IP_SRC].type = "u32";
+
+    // filters on Ethernet addresses or without an address on the
+    // side of the shard key may match the packets of any shard
+    m = &up->match[(shard_key == WIRECONF_SHARD_DST) ? IP_DST : IP_SRC];
+    if(protocol != IP || m->type == NULL) {
+        return SHARD_ALL(shard_count);
     }
-    ufp.match[IP_SRC].arg = dstaddr;
-    if(strcmp(src, "any") == 0) {
-        ufp.match[IP_DST].type = NULL;
+
+    strncpy(addr, m->arg, sizeof(addr) - 1);
+    addr[sizeof(addr) - 1] = '\0';
+    if((p = strchr(addr, '/')) != NULL) {
+        *p = '\0';
+        prefix = strtol(p + 1, NULL, 10);
     }
-    else {
-        ufp.match[IP_DST].type = "u32";
+    if(inet_aton(addr, &in) == 0) {
+        return SHARD_ALL(shard_count);
     }
-    ufp.match[IP_DST].arg = srcaddr;
-    add_tc_filter(devname, filter_id, "ip", "u32", &ufp);
-
-    ufp.match[IP_SRC].arg = srcaddr;
-    ufp.match[IP_DST].arg = bcastaddr;
 
-    add_tc_filter(devname, filter_id, "ip", "u32", &ufp);
+    // so do prefixes whose host part covers the bits of the shard
+    host_bits = (prefix <= 0) ? 0xffffffffU : (prefix >= 32) ? 0 : 0xffffffffU >> prefix;
+    if(host_bits & (shard_count - 1)) {
+        return SHARD_ALL(shard_count);
+    }
 
-    return 0;
+    return 1U << (ntohl(in.s_addr) & (shard_count - 1));
 }
-#endif
 
-int32_t 
-add_rule(s, rulenum, pipe_nr, protocol, src, dst, direction)
+int32_t
+add_rule_netem(rulenum, handle_nr, protocol, src, dst, direction)
+uint16_t rulenum;
+int handle_nr;
+int32_t protocol;
+char *src;
+char *dst;
+int direction;
+{
+    int i;
+    int k;
+    char *devname;
+    uint32_t shards;
+    uint32_t filter_shards[WIRECONF_LINK_FILTERS];
+    uint32_t htb_class_id[4];
+    uint32_t netem_qdisc_id[4];
+    uint32_t filter_id[4];
+    struct qdisc_params qp;
+    struct u32_params ufp[WIRECONF_LINK_FILTERS];
+    char addrs[WIRECONF_LINK_ADDRS][WIRECONF_ADDR_LEN];
+
+    memset(&qp, 0, sizeof(struct qdisc_params));
+
+    dprintf(("[add_rule] rulenum = %d\n", handle_nr));
+    qp.limit = 100000;
+    qp.delay = 0.001;
+    qp.rate = Gigabit;
+    qp.buffer = Gigabit / 1000;
+
+    // the distribution of the jitter is only sent when the qdisc
+    // is added, as the kernel keeps it afterwards
+    qp.rate_native = netem_native;
+    qp.delay_dist = netem_native;
+
+    htb_class_id[0] = 1;
+    htb_class_id[1] = 0;
+    htb_class_id[2] = 1;
+    htb_class_id[3] = handle_nr;
+
+    netem_qdisc_id[0] = 1;
+    netem_qdisc_id[1] = handle_nr;
+    netem_qdisc_id[2] = handle_nr;
+    netem_qdisc_id[3] = 0;
+
+    filter_id[0] = 1;
+    filter_id[1] = 0;
+    filter_id[2] = 1;
+    filter_id[3] = handle_nr;
+
+    wireconf_build_link_filters(ufp, addrs, handle_nr, protocol, src, dst);
+
+    // each filter is installed on the shards of the packets it
+    // matches, and the class and qdisc of the pipe on all of them
+    shards = 0;
+    for(i = 0; i < WIRECONF_LINK_FILTERS; i++) {
+        filter_shards[i] = link_filter_shards(&ufp[i], protocol);
+        shards |= filter_shards[i];
+    }
+    if(INGRESS) {
+        pipe_shards[TC_H_MIN(handle_nr)] = shards;
+    }
+
+    for(k = 0; k < shard_count; k++) {
+        if(!(shards & (1U << k))) {
+            continue;
+        }
+        devname = INGRESS ? shard_dev(k) : get_route_dev(dst);
+
+        add_htb_class(devname, htb_class_id, 1000000000);
+        add_netem_qdisc(devname, netem_qdisc_id, qp);
+        for(i = 0; i < WIRECONF_LINK_FILTERS; i++) {
+            if(filter_shards[i] & (1U << k)) {
+                add_tc_filter(devname, filter_id, "ip", "u32", &ufp[i]);
+            }
+        }
+    }
+
+    return 0;
+}
+#endif
+
+#ifdef __linux
+// number of rules between progress messages of bulk installation
+#define BULK_PROGRESS_RULES 1000
+
+// action of a request refused during bulk installation
+#define BULK_ACTION(type) (((type) == RTM_DELQDISC || (type) == RTM_DELTCLASS || \
+                            (type) == RTM_DELTFILTER) ? "remove" : "install")
+
+// netlink batch used while rules are installed in bulk, 
+// and number of rules queued in it
+static struct rtnl_batch bulk_batch;
+static int bulk_rule_count = 0;
+
+// report an object that the kernel refused to install or remove
+// during bulk installation or when a record was applied
+static void
+batch_report_error(request, error, arg)
+struct nlmsghdr *request;
+int error;
+void *arg;
+{
+    struct tcmsg *t = NLMSG_DATA(request);
+    const char *object;
+
+    switch(request->nlmsg_type) {
+        case RTM_NEWTCLASS:
+        case RTM_DELTCLASS:
+            object = "class";
+            break;
+        case RTM_NEWQDISC:
+        case RTM_DELQDISC:
+            object = "qdisc";
+            break;
+        case RTM_NEWTFILTER:
+        case RTM_DELTFILTER:
+            object = "filter";
+            break;
+        default:
+            object = "object";
+            break;
+    }
+
+    if(request->nlmsg_len < NLMSG_LENGTH(sizeof(struct tcmsg))) {
+        fprintf(stderr, "Could not %s %s: %s\n", BULK_ACTION(request->nlmsg_type), object, strerror(-error));
+        return;
+    }
+
+    fprintf(stderr, "Could not %s %s %x:%x (parent %x:%x) on %s: %s\n", BULK_ACTION(request->nlmsg_type), object,
+            TC_H_MAJ(t->tcm_handle) >> 16, TC_H_MIN(t->tcm_handle),
+            TC_H_MAJ(t->tcm_parent) >> 16, TC_H_MIN(t->tcm_parent),
+            ll_index_to_name(t->tcm_ifindex), strerror(-error));
+}
+#endif
+
+static int32_t 
+kernel_add_rule(s, rulenum, pipe_nr, protocol, src, dst, direction)
 int s;
 uint32_t rulenum;
 int pipe_nr;
@@ -671,8 +1113,74 @@ int direction;
 #ifdef __FreeBSD
     return add_rule_ipfw(s, rulenum, pipe_nr, protocol, src, dst, direction);
 #elif __linux
-    return add_rule_netem(rulenum, pipe_nr, protocol, src, dst, direction);
+    int32_t ret;
+
+    ret = add_rule_netem(rulenum, pipe_nr, protocol, src, dst, direction);
+
+    if(rth.batch != NULL && ++bulk_rule_count % BULK_PROGRESS_RULES == 0) {
+        fprintf(stderr, "Bulk install: %d rules queued, %d objects installed, %d errors\n",
+                bulk_rule_count, bulk_batch.acked, bulk_batch.failed);
+    }
+
+    return ret;
+#endif
+}
+
+// the class, qdisc and filters of all rules added in bulk are sent
+// in large netlink batches, with a bounded number of requests 
+// waiting for their ACK, instead of one round trip per object
+static int32_t
+kernel_begin_bulk(s)
+int s;
+{
+#ifdef __linux
+    kernel_bulk_open = TRUE;
+    if(rtnl_batch_begin(&rth, &bulk_batch, 0, batch_report_error, NULL) < 0) {
+        WARNING("Cannot start bulk rule installation");
+        return ERROR;
+    }
+    bulk_rule_count = 0;
+#endif
+
+    return SUCCESS;
+}
+
+static int32_t
+kernel_end_bulk(s)
+int s;
+{
+#ifdef __linux
+    struct tc_reconcile_stats *rs = tc_reconcile_get_stats();
+    int batched = (rth.batch != NULL);
+    int failed;
+
+    kernel_bulk_open = FALSE;
+
+    // objects of the previous configuration that were not requested
+    // again are removed in the same batch
+    if(tc_reconcile_end() < 0) {
+        WARNING("Cannot remove the unused objects of the previous configuration");
+    }
+    if(rs->existing > 0) {
+        INFO("Reconciled tc state: %d objects found, %d reused, %d changed, %d replaced, %d created, %d removed",
+             rs->existing, rs->reused, rs->changed, rs->replaced, rs->created, rs->removed);
+    }
+
+    if((failed = rtnl_batch_end(&rth)) < 0) {
+        fprintf(stderr, "Bulk rule installation aborted after %d of %d objects\n",
+                bulk_batch.acked + bulk_batch.failed, bulk_batch.sent);
+        return ERROR;
+    }
+
+    // as for rules added one by one, objects refused by the kernel
+    // are only reported, and don't stop the installation
+    if(batched) {
+        fprintf(stderr, "Bulk install: %d rules, %d objects installed, %d errors\n",
+                bulk_rule_count, bulk_batch.acked, failed);
+    }
 #endif
+
+    return SUCCESS;
 }
 
 #ifdef __FreeBSD
@@ -701,10 +1209,9 @@ uint32_t rule_number;
     struct qdisc_params qp; 
 
     memset(&qp, 0, sizeof(qp));
-    devname = malloc(DEV_NAME);
 
     if(!INGRESS) {
-        devname = (char*)get_route_info("dev", dst);
+        devname = get_route_dev(dst);
         delete_netem_qdisc(devname, 0);
     }
     if(INGRESS) {
@@ -715,16 +1222,18 @@ uint32_t rule_number;
             delete_netem_qdisc(device_list[i].dev_name, INGRESS);
             
         }
-        delete_netem_qdisc(ifb_devname, 0);
+        for(i = 0; i < shard_count; i++) {
+            delete_netem_qdisc(shard_dev(i), 0);
+        }
     }
 
     return SUCCESS;
 }
 #endif
 
-int
-delete_rule(s, dst, rule_number)
-uint32_t s;
+static int32_t
+kernel_delete(s, dst, rule_number)
+int s;
 char* dst;
 uint32_t rule_number;
 {
@@ -735,6 +1244,22 @@ uint32_t rule_number;
 #endif
 }
 
+static int32_t
+kernel_flush(s)
+int s;
+{
+#ifdef __FreeBSD
+    if(apply_socket_options(s, IP_FW_FLUSH, NULL, 0) < 0 ||
+       apply_socket_options(s, IP_DUMMYNET_FLUSH, NULL, 0) < 0) {
+        WARNING("Flush operation failed");
+        return ERROR;
+    }
+    return SUCCESS;
+#elif __linux
+    return delete_netem(s, init_dst, 0);
+#endif
+}
+
 #ifdef __FreeBSD
 void
 print_rule(rule)
@@ -792,23 +1317,82 @@ int lossrate;
 }
 
 #elif __linux
+void
+wireconf_build_qdisc_params(qp, bandwidth, delay, jitter, lossrate)
+struct qdisc_params *qp;
+int32_t bandwidth;
+double delay;
+double jitter;
+double lossrate;
+{
+    memset(qp, 0, sizeof(struct qdisc_params));
+
+    qp->delay = delay;
+    qp->jitter = jitter;
+    qp->delay_corr = netem_delay_corr / 100 * max_percent_value;
+    qp->loss_corr = netem_loss_corr / 100 * max_percent_value;
+    qp->limit = 100000;
+    if(lossrate == 1) {
+        qp->loss = ~0;
+    }
+    else if(lossrate < 1 || lossrate > 0) {
+        qp->loss = lossrate * max_percent_value;
+    }
+    else {
+        qp->loss = 0;
+    }
+
+    qp->rate = bandwidth;
+    if((bandwidth / 1024) < FRAME_LENGTH) {
+        qp->buffer = FRAME_LENGTH;
+    }
+    else {
+        qp->buffer = FRAME_LENGTH / 1024;
+    }
+
+    // netem rates are in bytes/s
+    if(netem_native == TRUE) {
+        qp->rate_native = TRUE;
+        qp->netem_rate = (bandwidth > 0) ? (uint64_t)bandwidth / 8 : 0;
+    }
+}
+
+// set the correlation of the delay and of the loss of the links [%];
+// return SUCCESS or ERROR
 int
-configure_qdisc(dst, handle, bandwidth, delay, lossrate)
-char* dst;
+wireconf_set_netem_correlation(delay_corr, loss_corr)
+double delay_corr;
+double loss_corr;
+{
+    if(delay_corr < 0 || delay_corr > 100 || loss_corr < 0 || loss_corr > 100) {
+        WARNING("Invalid netem correlation (delay %.2f%%, loss %.2f%%)", delay_corr, loss_corr);
+        return ERROR;
+    }
+
+    netem_delay_corr = delay_corr;
+    netem_loss_corr = loss_corr;
+
+    return SUCCESS;
+}
+
+// configure the netem qdisc and HTB class of pipe 'handle' on device
+// 'devname' (only the netem qdisc if netem limits the rate); only uses
+// the netlink handle of the calling thread, so it is also called by
+// the workers
+static int32_t
+configure_qdisc_dev(devname, handle, bandwidth, delay, jitter, lossrate)
+char *devname;
 int32_t handle;
 int32_t bandwidth;
-float delay;
+double delay;
+double jitter;
 double lossrate;
 {
-    char *devname;
     int32_t ret;
     uint32_t htb_class_id[4];
     uint32_t netem_qdisc_id[4];
     struct qdisc_params qp;
 
-    memset(&qp, 0, sizeof(qp));
-    devname = malloc(DEV_NAME);
-
     htb_class_id[0] = 1;
     htb_class_id[1] = 0;
     htb_class_id[2] = 1;
@@ -819,34 +1403,16 @@ double lossrate;
     netem_qdisc_id[2] = handle;
     netem_qdisc_id[3] = 0;
 
-    if(INGRESS) {
-        devname = ifb_devname;
-    }
-
-    qp.delay = delay;
-    qp.limit = 100000;
-    if(lossrate == 1) {
-        qp.loss = ~0;
-    }
-    else if(lossrate < 1 || lossrate > 0) {
-        qp.loss = lossrate * max_percent_value;
-    }
-    else {
-        qp.loss = 0;
-    }
+    wireconf_build_qdisc_params(&qp, bandwidth, delay, jitter, lossrate);
     ret = change_netem_qdisc(devname, netem_qdisc_id, qp);
     if(ret != 0) {
         fprintf(stderr, "Cannot change netem disc\n");
         return ret;
     }
-
-    qp.rate = bandwidth;
-    if((bandwidth / 1024) < FRAME_LENGTH) {
-        qp.buffer = FRAME_LENGTH;
-    }
-    else {
-        qp.buffer = FRAME_LENGTH / 1024;
+    if(qp.rate_native == TRUE) {
+        return SUCCESS;
     }
+
     ret = change_htb_class(devname, htb_class_id, qp.rate);
     if(ret != 0) {
         fprintf(stderr, "Cannot change HTB class\n");
@@ -855,20 +1421,610 @@ double lossrate;
 
     return SUCCESS;
 }
+
+// find the devices on which pipe 'handle' is emulated; return
+// their number, or 0 if there are none
+static int
+configure_devnames(dst, handle, devnames)
+char *dst;
+int32_t handle;
+char **devnames;
+{
+    uint32_t shards;
+    int count = 0;
+    int k;
+
+    if(!INGRESS) {
+        devnames[0] = get_route_dev(dst);
+        return (devnames[0] != NULL) ? 1 : 0;
+    }
+
+    // pipes that were not added by this process are left to the
+    // kernel to report, as without shards
+    if(shard_count == 1 || (shards = pipe_shards[TC_H_MIN(handle)]) == 0) {
+        devnames[0] = ifb_devname;
+        return 1;
+    }
+
+    for(k = 0; k < shard_count; k++) {
+        if(shards & (1U << k)) {
+            devnames[count++] = shard_dev(k);
+        }
+    }
+
+    return count;
+}
+
+int
+configure_qdisc(dst, handle, bandwidth, delay, jitter, lossrate)
+char* dst;
+int32_t handle;
+int32_t bandwidth;
+float delay;
+double jitter;
+double lossrate;
+{
+    char *devnames[MAX_SHARDS];
+    int count;
+    int k;
+    int32_t ret = SUCCESS;
+
+    if((count = configure_devnames(dst, handle, devnames)) == 0) {
+        fprintf(stderr, "Cannot find device for %s\n", dst);
+        return ERROR;
+    }
+
+    for(k = 0; k < count; k++) {
+        if(configure_qdisc_dev(devnames[k], handle, bandwidth, delay, jitter, lossrate) != SUCCESS) {
+            ret = ERROR;
+        }
+    }
+
+    return ret;
+}
+
+// number of workers requested, and TRUE while the changes
+// of a record are dispatched to them
+static int worker_number = 0;
+static int record_open = FALSE;
+
+// netlink batch holding the changes of a record that are applied
+// by the main thread, and TRUE while it is used
+static struct rtnl_batch record_batch;
+static int record_held = FALSE;
 #endif
 
-int32_t
-configure_rule(dsock, dst, pipe_nr, bandwidth, delay, lossrate)
+static int32_t
+kernel_configure(dsock, dst, pipe_nr, bandwidth, delay, jitter, lossrate)
 int dsock;
 char* dst;
 int32_t pipe_nr;
 int32_t bandwidth;
 double delay;
+double jitter;
 double lossrate;
 {
 #ifdef __FreeBSD
     return configure_pipe(dsock, pipe_nr, bandwidth, delay, lossrate);
 #elif __linux
-    return configure_qdisc(dst, pipe_nr, bandwidth, delay, lossrate);
+    char *devnames[MAX_SHARDS];
+    int count;
+    int k;
+
+    if(record_open == FALSE) {
+        return configure_qdisc(dst, pipe_nr, bandwidth, delay, jitter, lossrate);
+    }
+
+    // the devices are resolved here, as the route cache
+    // may only be used by the main thread
+    if((count = configure_devnames(dst, pipe_nr, devnames)) == 0) {
+        fprintf(stderr, "Cannot find device for %s\n", dst);
+        return ERROR;
+    }
+
+    for(k = 0; k < count; k++) {
+        if(wireconf_workers_dispatch(devnames[k], pipe_nr, bandwidth, delay, jitter, lossrate) != SUCCESS) {
+            return ERROR;
+        }
+    }
+
+    return SUCCESS;
 #endif
 }
+
+// the changes of a record are applied by the workers, if any;
+// they are started with the first record, once the rules exist;
+// otherwise the netlink messages of the changes are built in a held
+// batch, so that applying the record only needs to send them
+static int32_t
+kernel_begin_record(s)
+int s;
+{
+#ifdef __linux
+    if(worker_number > 0 && wireconf_workers_count() == 0) {
+        if(wireconf_workers_start(worker_number, configure_qdisc_dev) != SUCCESS) {
+            WARNING("Cannot start netlink workers; links will be configured by the main thread");
+            worker_number = 0;
+        }
+    }
+    record_open = (wireconf_workers_count() > 0);
+
+    if(record_open == FALSE && rth.batch == NULL) {
+        if(rtnl_batch_begin(&rth, &record_batch, 0, batch_report_error, NULL) < 0) {
+            WARNING("Cannot prepare the record; links will be configured immediately");
+            return SUCCESS;
+        }
+        rtnl_batch_hold(&rth);
+        record_held = TRUE;
+    }
+#endif
+
+    return SUCCESS;
+}
+
+static int32_t
+kernel_end_record(s)
+int s;
+{
+#ifdef __linux
+    int failed;
+
+    if(record_held == TRUE) {
+        record_held = FALSE;
+        if((failed = rtnl_batch_end(&rth)) < 0) {
+            WARNING("Record aborted after %d of %d link objects",
+                    record_batch.acked + record_batch.failed, record_batch.sent);
+            return ERROR;
+        }
+        // as for links configured one by one, objects refused by the
+        // kernel were reported, and don't stop the emulation
+        if(failed > 0) {
+            fprintf(stderr, "%d link objects of the record could not be changed\n", failed);
+        }
+        return SUCCESS;
+    }
+
+    if(record_open == FALSE) {
+        return SUCCESS;
+    }
+    record_open = FALSE;
+
+    if((failed = wireconf_workers_wait()) > 0) {
+        fprintf(stderr, "%d link configurations of the record could not be applied\n", failed);
+    }
+#endif
+
+    return SUCCESS;
+}
+
+static void
+kernel_stats(f)
+FILE *f;
+{
+#ifdef __linux
+    wireconf_workers_print_stats(f);
+#endif
+}
+
+/////////////////////////////////////////////
+// Backend dispatch
+/////////////////////////////////////////////
+
+// default backend; configures the kernel with netlink on Linux,
+// and with ipfw/dummynet on FreeBSD
+static struct wireconf_backend kernel_backend = {
+#ifdef __FreeBSD__
+    "ipfw",
+#else
+    "netlink",
+#endif
+    open_kernel_socket,
+    close_kernel_socket,
+    init_kernel,
+    kernel_add_rule,
+    kernel_configure,
+    kernel_delete,
+    kernel_flush,
+    kernel_stats,
+    kernel_begin_bulk,
+    kernel_end_bulk,
+    kernel_begin_record,
+    kernel_end_record
+};
+
+#ifdef __linux
+// same as the kernel backend, except that netem also limits the
+// rate; a link change is a single netem change instead of a netem
+// and an HTB change
+static struct wireconf_backend netem_backend = {
+    "netem",
+    open_netem_socket,
+    close_kernel_socket,
+    init_kernel,
+    kernel_add_rule,
+    kernel_configure,
+    kernel_delete,
+    kernel_flush,
+    kernel_stats,
+    kernel_begin_bulk,
+    kernel_end_bulk,
+    kernel_begin_record,
+    kernel_end_record
+};
+#endif
+
+static struct wireconf_backend *backends[] = {
+    &kernel_backend,
+#ifdef __linux
+    &netem_backend,
+    &wireconf_bpf_backend,
+    &wireconf_memory_backend,
+#endif
+    NULL
+};
+
+static struct wireconf_backend *backend = &kernel_backend;
+static struct wireconf_stats backend_stats;
+static double bulk_start_time;
+static int bulk_open = FALSE;
+static int record_pending = FALSE;
+
+// return the current value of the monotonic clock in seconds
+static double
+get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+wireconf_set_backend(name)
+char *name;
+{
+    int i;
+
+    for(i = 0; backends[i] != NULL; i++) {
+        if(strcmp(backends[i]->name, name) == 0) {
+            backend = backends[i];
+            return SUCCESS;
+        }
+    }
+
+    WARNING("Unknown wireconf backend '%s'", name);
+    return ERROR;
+}
+
+struct wireconf_backend *
+wireconf_get_backend(void)
+{
+    return backend;
+}
+
+struct wireconf_stats *
+wireconf_get_stats(void)
+{
+    return &backend_stats;
+}
+
+void
+wireconf_print_stats(f)
+FILE *f;
+{
+    fprintf(f, "wireconf backend '%s': init=%llu add=%llu configure=%llu "
+            "delete=%llu flush=%llu errors=%llu\n", backend->name, 
+            (unsigned long long)backend_stats.init_count,
+            (unsigned long long)backend_stats.add_count,
+            (unsigned long long)backend_stats.configure_count,
+            (unsigned long long)backend_stats.delete_count,
+            (unsigned long long)backend_stats.flush_count,
+            (unsigned long long)backend_stats.error_count);
+    if(backend_stats.add_count > 0) {
+        fprintf(f, "  add_rule: %.6f s total, %.3f us/rule\n", 
+                backend_stats.add_time, 
+                backend_stats.add_time * 1e6 / backend_stats.add_count);
+    }
+    if(backend_stats.configure_count > 0) {
+        fprintf(f, "  configure_rule: %.6f s total, %.3f us/rule\n", 
+                backend_stats.configure_time, 
+                backend_stats.configure_time * 1e6 / backend_stats.configure_count);
+    }
+    if(backend_stats.bulk_time > 0) {
+        fprintf(f, "  bulk install: %.6f s total\n", backend_stats.bulk_time);
+    }
+    if(backend_stats.record_count > 0) {
+        fprintf(f, "  records: %llu applied, %.6f s applying, %.3f us/record (max %.3f us)\n",
+                (unsigned long long)backend_stats.record_count, backend_stats.record_time,
+                backend_stats.record_time * 1e6 / backend_stats.record_count,
+                backend_stats.record_time_max * 1e6);
+    }
+    if(backend->stats != NULL) {
+        backend->stats(f);
+    }
+}
+
+int32_t
+wireconf_begin_bulk(s)
+int s;
+{
+    int32_t ret;
+
+    bulk_open = TRUE;
+    if(backend->begin_bulk == NULL) {
+        return SUCCESS;
+    }
+
+    bulk_start_time = get_time();
+    if((ret = backend->begin_bulk(s)) != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    return ret;
+}
+
+int32_t
+wireconf_end_bulk(s)
+int s;
+{
+    int32_t ret;
+
+    bulk_open = FALSE;
+    if(backend->end_bulk == NULL) {
+        return SUCCESS;
+    }
+
+    if((ret = backend->end_bulk(s)) != SUCCESS) {
+        backend_stats.error_count++;
+    }
+    backend_stats.bulk_time += get_time() - bulk_start_time;
+
+    return ret;
+}
+
+int32_t
+wireconf_begin_record(s)
+int s;
+{
+    int32_t ret;
+
+    if(backend->begin_record == NULL) {
+        return SUCCESS;
+    }
+
+    // the previous record was not ended (e.g., on scenario restart)
+    if(record_pending == TRUE && wireconf_end_record(s) != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    if((ret = backend->begin_record(s)) != SUCCESS) {
+        backend_stats.error_count++;
+        return ret;
+    }
+    record_pending = TRUE;
+
+    return SUCCESS;
+}
+
+int32_t
+wireconf_end_record(s)
+int s;
+{
+    int32_t ret;
+    double start;
+
+    if(backend->end_record == NULL || record_pending == FALSE) {
+        return SUCCESS;
+    }
+
+    start = get_time();
+    record_pending = FALSE;
+    if((ret = backend->end_record(s)) != SUCCESS) {
+        backend_stats.error_count++;
+    }
+    start = get_time() - start;
+    backend_stats.record_time += start;
+    if(start > backend_stats.record_time_max) {
+        backend_stats.record_time_max = start;
+    }
+    backend_stats.record_count++;
+
+    return ret;
+}
+
+int
+wireconf_set_workers(count)
+int count;
+{
+#ifdef __linux
+    if(count < 0) {
+        WARNING("Invalid number of workers (%d)", count);
+        return ERROR;
+    }
+    worker_number = count;
+
+    return SUCCESS;
+#else
+    WARNING("Netlink workers are only supported on Linux");
+    return ERROR;
+#endif
+}
+
+int
+wireconf_set_ingress_shards(count, key)
+int count;
+int key;
+{
+#ifdef __linux
+    int k;
+
+    if(count < 1 || count > MAX_SHARDS || (count & (count - 1)) != 0) {
+        WARNING("Invalid number of ingress shards (%d); it must be a power of 2 up to %d", count, MAX_SHARDS);
+        return ERROR;
+    }
+    if(key != WIRECONF_SHARD_SRC && key != WIRECONF_SHARD_DST) {
+        WARNING("Invalid ingress shard key (%d)", key);
+        return ERROR;
+    }
+
+    shard_count = count;
+    shard_key = key;
+    for(k = 1; k < count; k++) {
+        snprintf(shard_devname[k], IFNAMSIZ, "ifb%d", k);
+    }
+
+    return SUCCESS;
+#else
+    WARNING("Ingress shards are only supported on Linux");
+    return ERROR;
+#endif
+}
+
+// a backend that needs kernel features that are missing falls
+// back to the default backend when it is opened or initialized
+static void
+fallback_backend(void)
+{
+    WARNING("The '%s' backend is not available; using the '%s' backend", 
+            backend->name, kernel_backend.name);
+    backend = &kernel_backend;
+}
+
+int
+get_socket(void)
+{
+    int s;
+
+    if((s = backend->open()) < 0 && backend->fallback == TRUE) {
+        fallback_backend();
+        s = backend->open();
+    }
+
+    return s;
+}
+
+void
+close_socket(socket_id)
+int socket_id;
+{
+    backend->close(socket_id);
+}
+
+int32_t
+init_rule(dst, protocol)
+char *dst;
+int32_t protocol;
+{
+    int32_t ret;
+
+    backend_stats.init_count++;
+    if((ret = backend->init(dst, protocol)) != SUCCESS && backend->fallback == TRUE) {
+        backend->close(0);
+        fallback_backend();
+        if(backend->open() < 0) {
+            ret = ERROR;
+        }
+        else {
+            // rules were to be installed in bulk
+            if(bulk_open == TRUE) {
+                wireconf_begin_bulk(0);
+            }
+            ret = backend->init(dst, protocol);
+        }
+    }
+    if(ret != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    return ret;
+}
+
+int32_t 
+add_rule(s, rulenum, pipe_nr, protocol, src, dst, direction)
+int s;
+uint32_t rulenum;
+int pipe_nr;
+int32_t protocol;
+char *src;
+char *dst;
+int direction;
+{
+    int32_t ret;
+    double start = get_time();
+
+    ret = backend->add_rule(s, rulenum, pipe_nr, protocol, src, dst, direction);
+
+    backend_stats.add_time += get_time() - start;
+    backend_stats.add_count++;
+    if(ret != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    return ret;
+}
+
+int32_t
+configure_rule(dsock, dst, pipe_nr, bandwidth, delay, lossrate)
+int dsock;
+char* dst;
+int32_t pipe_nr;
+int32_t bandwidth;
+double delay;
+double lossrate;
+{
+    return configure_rule_jitter(dsock, dst, pipe_nr, bandwidth, delay, 0, lossrate);
+}
+
+int32_t
+configure_rule_jitter(dsock, dst, pipe_nr, bandwidth, delay, jitter, lossrate)
+int dsock;
+char* dst;
+int32_t pipe_nr;
+int32_t bandwidth;
+double delay;
+double jitter;
+double lossrate;
+{
+    int32_t ret;
+    double start = get_time();
+
+    ret = backend->configure(dsock, dst, pipe_nr, bandwidth, delay, jitter, lossrate);
+
+    backend_stats.configure_time += get_time() - start;
+    backend_stats.configure_count++;
+    if(ret != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    return ret;
+}
+
+int
+delete_rule(s, dst, rule_number)
+uint32_t s;
+char* dst;
+uint32_t rule_number;
+{
+    int32_t ret;
+
+    backend_stats.delete_count++;
+    if((ret = backend->delete(s, dst, rule_number)) != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    return ret;
+}
+
+int32_t
+flush_rules(s)
+int s;
+{
+    int32_t ret;
+
+    backend_stats.flush_count++;
+    if((ret = backend->flush(s)) != SUCCESS) {
+        backend_stats.error_count++;
+    }
+
+    return ret;
+}
@@ -0,0 +1,807 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: wireconf_bpf.c
+ * Function: BPF backend of the wireconf library; a BPF program attached
+ *           to the egress of the emulation device looks up the link of
+ *           each IPv4 packet by its addresses, drops it according to the
+ *           loss rate of the link, and sets its departure time according
+ *           to the rate and delay of the link; the root fq qdisc of the
+ *           device sends the packets at that time, so that configuring
+ *           a link only means updating the BPF map of its parameters;
+ *           the program (wireconf_bpf_prog.c) is compiled by the build
+ *           and loaded from its object file
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "global.h"
+#include "message.h"
+#include "wireconf.h"
+
+#ifdef __linux
+#include <sys/syscall.h>
+#include <arpa/inet.h>
+#include <elf.h>
+#include <linux/bpf.h>
+
+#include "utils.h"
+#include "tc_common.h"
+#include "tc_util.h"
+#include "route_cache.h"
+#include "wireconf_bpf.h"
+
+#ifndef EM_BPF
+#define EM_BPF                  247
+#endif
+
+// returned by BPF commands that a map type does not support
+#ifndef ENOTSUPP
+#define ENOTSUPP                524
+#endif
+
+// maximum number of packets queued in the fq qdisc, and maximum
+// time before their departure [us]
+#define BPF_FQ_LIMIT            100000
+#define BPF_FQ_HORIZON          10000000
+
+#define BPF_PIN_DIR             "/sys/fs/bpf"
+#define BPF_PROG_NAME           "meteor_links"
+#define BPF_LOG_SIZE            65536
+
+// map of links (to their pipe), map of pipe parameters, and map of
+// the departure time of the next packet of each pipe, only written
+// by the program
+static int link_map_fd = -1;
+static int pipe_map_fd = -1;
+static int state_map_fd = -1;
+static int prog_fd = -1;
+
+static char bpf_devname[IFNAME_LEN];
+static uint32_t bpf_link_count = 0;
+
+// pipe changes of the current record, written at its end
+static int record_open = FALSE;
+static uint32_t *record_keys = NULL;
+static struct bpf_pipe *record_values = NULL;
+static uint32_t record_count = 0;
+static uint32_t record_size = 0;
+static int batch_supported = TRUE;
+
+static uint64_t update_count = 0;
+static uint64_t syscall_count = 0;
+
+static int
+bpf_call(cmd, attr)
+int cmd;
+union bpf_attr *attr;
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(union bpf_attr));
+}
+
+static int
+bpf_map_create(type, key_size, value_size, max_entries)
+int type;
+uint32_t key_size;
+uint32_t value_size;
+uint32_t max_entries;
+{
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = type;
+    attr.key_size = key_size;
+    attr.value_size = value_size;
+    attr.max_entries = max_entries;
+
+    return bpf_call(BPF_MAP_CREATE, &attr);
+}
+
+static int
+bpf_map_update(fd, key, value)
+int fd;
+const void *key;
+const void *value;
+{
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = fd;
+    attr.key = (uint64_t)(unsigned long)key;
+    attr.value = (uint64_t)(unsigned long)value;
+    attr.flags = BPF_ANY;
+
+    syscall_count++;
+    return bpf_call(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+// update 'count' elements of a map with a single system call;
+// return the number of elements updated, or -1 on error
+static int
+bpf_map_update_batch(fd, keys, values, count)
+int fd;
+const void *keys;
+const void *values;
+uint32_t count;
+{
+    union bpf_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.batch.map_fd = fd;
+    attr.batch.keys = (uint64_t)(unsigned long)keys;
+    attr.batch.values = (uint64_t)(unsigned long)values;
+    attr.batch.count = count;
+    attr.batch.elem_flags = BPF_ANY;
+
+    syscall_count++;
+    if(bpf_call(BPF_MAP_UPDATE_BATCH, &attr) < 0) {
+        return -1;
+    }
+
+    return attr.batch.count;
+}
+
+// get the path of the object file of the program, which is installed
+// in the directory of the executable
+static int
+bpf_obj_path(path, size)
+char *path;
+size_t size;
+{
+    char exe[PATH_MAX];
+    ssize_t len;
+    char *p;
+
+    if((len = readlink("/proc/self/exe", exe, sizeof(exe) - 1)) < 0) {
+        return ERROR;
+    }
+    exe[len] = '\0';
+    if((p = strrchr(exe, '/')) != NULL) {
+        *p = '\0';
+    }
+    snprintf(path, size, "%s/%s", exe, BPF_OBJ_NAME);
+
+    return SUCCESS;
+}
+
+// get the file descriptor of the map named 'name' in the program
+static int
+bpf_map_fd(name)
+const char *name;
+{
+    if(strcmp(name, BPF_LINK_MAP) == 0) {
+        return link_map_fd;
+    }
+    if(strcmp(name, BPF_PIPE_MAP) == 0) {
+        return pipe_map_fd;
+    }
+    if(strcmp(name, BPF_STATE_MAP) == 0) {
+        return state_map_fd;
+    }
+
+    return -1;
+}
+
+// check that the section 'sh' is within the object file
+static int
+bpf_section_ok(sh, size)
+Elf64_Shdr *sh;
+size_t size;
+{
+    return (sh->sh_type == SHT_NOBITS ||
+            (sh->sh_offset <= size && sh->sh_size <= size - sh->sh_offset));
+}
+
+// get the instructions of the program from the object file 'data',
+// and point its map references to the maps of the backend; return
+// the instructions, to be freed by the caller, or NULL on error
+static struct bpf_insn*
+bpf_obj_prog(data, size, insn_count)
+char *data;
+size_t size;
+uint32_t *insn_count;
+{
+    Elf64_Ehdr *eh = (Elf64_Ehdr*)data;
+    Elf64_Shdr *shdrs;
+    Elf64_Shdr *sh;
+    Elf64_Shdr *symtab;
+    Elf64_Rel *rels;
+    Elf64_Sym *sym;
+    struct bpf_insn *insns;
+    const char *shstrtab;
+    const char *strtab;
+    const char *name;
+    int prog_index = -1;
+    uint64_t count;
+    uint64_t j;
+    uint64_t n;
+    int fd;
+    int i;
+
+    if(size < sizeof(Elf64_Ehdr) || memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 ||
+       eh->e_ident[EI_CLASS] != ELFCLASS64 || eh->e_machine != EM_BPF ||
+       eh->e_shentsize != sizeof(Elf64_Shdr) || eh->e_shoff > size ||
+       eh->e_shnum > (size - eh->e_shoff) / sizeof(Elf64_Shdr) ||
+       eh->e_shstrndx >= eh->e_shnum) {
+        WARNING("Not a BPF object file");
+        return NULL;
+    }
+    shdrs = (Elf64_Shdr*)(data + eh->e_shoff);
+    for(i = 0; i < eh->e_shnum; i++) {
+        if(bpf_section_ok(&shdrs[i], size) == FALSE) {
+            WARNING("Truncated BPF object file");
+            return NULL;
+        }
+    }
+    shstrtab = data + shdrs[eh->e_shstrndx].sh_offset;
+
+    for(i = 0; i < eh->e_shnum; i++) {
+        if(shdrs[i].sh_type == SHT_PROGBITS && shdrs[i].sh_name < shdrs[eh->e_shstrndx].sh_size &&
+           strcmp(shstrtab + shdrs[i].sh_name, BPF_PROG_SECTION) == 0) {
+            prog_index = i;
+        }
+    }
+    if(prog_index < 0 || shdrs[prog_index].sh_size == 0) {
+        WARNING("No '%s' section in the BPF object file", BPF_PROG_SECTION);
+        return NULL;
+    }
+
+    count = shdrs[prog_index].sh_size / sizeof(struct bpf_insn);
+    if((insns = malloc(count * sizeof(struct bpf_insn))) == NULL) {
+        WARNING("Cannot allocate memory for the BPF program");
+        return NULL;
+    }
+    memcpy(insns, data + shdrs[prog_index].sh_offset, count * sizeof(struct bpf_insn));
+
+    // the maps are referred to by 64-bit immediate loads, relocated
+    // with the symbol of the map
+    for(i = 0; i < eh->e_shnum; i++) {
+        sh = &shdrs[i];
+        if((sh->sh_type != SHT_REL && sh->sh_type != SHT_RELA) || sh->sh_info != prog_index) {
+            continue;
+        }
+        if(sh->sh_type == SHT_RELA || sh->sh_link >= eh->e_shnum ||
+           shdrs[sh->sh_link].sh_link >= eh->e_shnum) {
+            WARNING("Unsupported relocations in the BPF object file");
+            free(insns);
+            return NULL;
+        }
+        symtab = &shdrs[sh->sh_link];
+        strtab = data + shdrs[symtab->sh_link].sh_offset;
+        rels = (Elf64_Rel*)(data + sh->sh_offset);
+        n = sh->sh_size / sizeof(Elf64_Rel);
+
+        for(j = 0; j < n; j++) {
+            if(ELF64_R_SYM(rels[j].r_info) >= symtab->sh_size / sizeof(Elf64_Sym) ||
+               rels[j].r_offset / sizeof(struct bpf_insn) >= count) {
+                WARNING("Invalid relocation in the BPF object file");
+                free(insns);
+                return NULL;
+            }
+            sym = (Elf64_Sym*)(data + symtab->sh_offset) + ELF64_R_SYM(rels[j].r_info);
+            name = (sym->st_name < shdrs[symtab->sh_link].sh_size) ? strtab + sym->st_name : "";
+            if((fd = bpf_map_fd(name)) < 0 ||
+               insns[rels[j].r_offset / sizeof(struct bpf_insn)].code != (BPF_LD | BPF_IMM | BPF_DW)) {
+                WARNING("Unknown reference to '%s' in the BPF program", name);
+                free(insns);
+                return NULL;
+            }
+            insns[rels[j].r_offset / sizeof(struct bpf_insn)].src_reg = BPF_PSEUDO_MAP_FD;
+            insns[rels[j].r_offset / sizeof(struct bpf_insn)].imm = fd;
+        }
+    }
+
+    *insn_count = count;
+
+    return insns;
+}
+
+// read the object file of the program
+static struct bpf_insn*
+bpf_read_prog(path, insn_count)
+const char *path;
+uint32_t *insn_count;
+{
+    struct bpf_insn *insns = NULL;
+    FILE *f;
+    char *data;
+    long size;
+
+    if((f = fopen(path, "rb")) == NULL) {
+        WARNING("Cannot open the BPF object file %s (%s)", path, strerror(errno));
+        return NULL;
+    }
+    if(fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        WARNING("Cannot read the BPF object file %s", path);
+        fclose(f);
+        return NULL;
+    }
+    if((data = malloc(size)) == NULL) {
+        WARNING("Cannot allocate memory for the BPF object file");
+        fclose(f);
+        return NULL;
+    }
+    if(fread(data, 1, size, f) != (size_t)size) {
+        WARNING("Cannot read the BPF object file %s", path);
+    }
+    else {
+        insns = bpf_obj_prog(data, size, insn_count);
+    }
+    free(data);
+    fclose(f);
+
+    return insns;
+}
+
+static int
+bpf_load_prog(void)
+{
+    struct bpf_insn *insns;
+    uint32_t insn_count;
+    union bpf_attr attr;
+    char path[PATH_MAX + sizeof(BPF_OBJ_NAME)];
+    char *log;
+    int fd;
+
+    if(bpf_obj_path(path, sizeof(path)) == ERROR ||
+       (insns = bpf_read_prog(path, &insn_count)) == NULL) {
+        return -1;
+    }
+
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_SCHED_CLS;
+    attr.insns = (uint64_t)(unsigned long)insns;
+    attr.insn_cnt = insn_count;
+    attr.license = (uint64_t)(unsigned long)"Dual BSD/GPL";
+    strncpy(attr.prog_name, BPF_PROG_NAME, sizeof(attr.prog_name) - 1);
+
+    if((fd = bpf_call(BPF_PROG_LOAD, &attr)) >= 0) {
+        free(insns);
+        return fd;
+    }
+
+    // the verifier log is only needed to report the error
+    if((log = malloc(BPF_LOG_SIZE)) != NULL) {
+        log[0] = '\0';
+        attr.log_buf = (uint64_t)(unsigned long)log;
+        attr.log_size = BPF_LOG_SIZE;
+        attr.log_level = 1;
+        if((fd = bpf_call(BPF_PROG_LOAD, &attr)) < 0) {
+            WARNING("Cannot load the BPF program (%s)", strerror(errno));
+            DEBUG("BPF verifier log:\n%s", log);
+        }
+        free(log);
+    }
+    free(insns);
+
+    return fd;
+}
+
+// pin the maps, so that the link parameters of the emulation
+// can be read or changed by other tools
+static void
+bpf_pin_maps(void)
+{
+    const char *names[2] = {"links", "pipes"};
+    int fds[2];
+    char path[256];
+    union bpf_attr attr;
+    int i;
+
+    fds[0] = link_map_fd;
+    fds[1] = pipe_map_fd;
+
+    for(i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), "%s/meteor_%s_%s", BPF_PIN_DIR, bpf_devname, names[i]);
+        unlink(path);
+
+        memset(&attr, 0, sizeof(attr));
+        attr.pathname = (uint64_t)(unsigned long)path;
+        attr.bpf_fd = fds[i];
+        if(bpf_call(BPF_OBJ_PIN, &attr) < 0) {
+            INFO("Cannot pin the BPF map of %s at %s (%s)", names[i], path, strerror(errno));
+            return;
+        }
+    }
+}
+
+static void
+bpf_unpin_maps(void)
+{
+    char path[256];
+
+    snprintf(path, sizeof(path), "%s/meteor_%s_links", BPF_PIN_DIR, bpf_devname);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/meteor_%s_pipes", BPF_PIN_DIR, bpf_devname);
+    unlink(path);
+}
+
+// convert an address such as "10.0.0.1", "10.0.0.1/32" or "any"
+// (converted to 0) to a network byte order IPv4 address
+static int
+bpf_parse_addr(str, addr)
+char *str;
+uint32_t *addr;
+{
+    char buf[WIRECONF_ADDR_LEN];
+    char *p;
+    struct in_addr in;
+
+    if(strcmp(str, "any") == 0) {
+        *addr = 0;
+        return SUCCESS;
+    }
+
+    // links are between hosts, so prefixes are ignored
+    strncpy(buf, str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    if((p = strchr(buf, '/')) != NULL) {
+        *p = '\0';
+    }
+    if(inet_pton(AF_INET, buf, &in) != 1) {
+        WARNING("Invalid IPv4 address '%s'", str);
+        return ERROR;
+    }
+    *addr = in.s_addr;
+
+    return SUCCESS;
+}
+
+static void
+bpf_close_fds(void)
+{
+    if(prog_fd >= 0) {
+        close(prog_fd);
+    }
+    if(link_map_fd >= 0) {
+        close(link_map_fd);
+    }
+    if(pipe_map_fd >= 0) {
+        close(pipe_map_fd);
+    }
+    if(state_map_fd >= 0) {
+        close(state_map_fd);
+    }
+    prog_fd = link_map_fd = pipe_map_fd = state_map_fd = -1;
+}
+
+// the maps and the program are created here, so that a kernel
+// without BPF support is detected before any rule is installed
+static int
+bpf_open(void)
+{
+    link_map_fd = bpf_map_create(BPF_MAP_TYPE_HASH, sizeof(struct bpf_link_key),
+                                 sizeof(uint32_t), BPF_MAX_LINKS);
+    pipe_map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t),
+                                 sizeof(struct bpf_pipe), BPF_MAX_PIPES);
+    state_map_fd = bpf_map_create(BPF_MAP_TYPE_ARRAY, sizeof(uint32_t),
+                                  sizeof(uint64_t), BPF_MAX_PIPES);
+    if(link_map_fd < 0 || pipe_map_fd < 0 || state_map_fd < 0) {
+        WARNING("Cannot create the BPF maps (%s)", strerror(errno));
+        bpf_close_fds();
+        return ERROR;
+    }
+
+    if((prog_fd = bpf_load_prog()) < 0) {
+        bpf_close_fds();
+        return ERROR;
+    }
+
+    if(rtnl_open(&rth, 0) < 0) {
+        bpf_close_fds();
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+// the program and maps stay in use while the filter is attached
+static void
+bpf_close(s)
+int s;
+{
+    bpf_close_fds();
+    route_cache_close();
+    rtnl_close(&rth);
+
+    free(record_keys);
+    free(record_values);
+    record_keys = NULL;
+    record_values = NULL;
+    record_size = 0;
+}
+
+static int32_t
+bpf_init(dst, protocol)
+char *dst;
+int32_t protocol;
+{
+    char *devname;
+
+    if(protocol != IP) {
+        WARNING("The BPF backend only supports IPv4 rules");
+        return ERROR;
+    }
+
+    ll_init_map(&rth);
+    if((devname = wireconf_link_device(dst)) == NULL) {
+        WARNING("Cannot find the emulation device of %s", dst);
+        return ERROR;
+    }
+    strncpy(bpf_devname, devname, sizeof(bpf_devname) - 1);
+
+    if(add_fq_qdisc(bpf_devname, BPF_FQ_LIMIT, BPF_FQ_HORIZON) != 0) {
+        WARNING("Cannot add the fq qdisc of %s", bpf_devname);
+        return ERROR;
+    }
+
+    modify_clsact_qdisc(RTM_DELQDISC, bpf_devname);
+    if(modify_clsact_qdisc(RTM_NEWQDISC, bpf_devname) != 0 ||
+       add_bpf_filter(bpf_devname, prog_fd, BPF_PROG_NAME) != 0) {
+        WARNING("Cannot attach the BPF program to %s", bpf_devname);
+        delete_netem_qdisc(bpf_devname, 0);
+        return ERROR;
+    }
+
+    bpf_pin_maps();
+    INFO("BPF program attached to %s", bpf_devname);
+
+    return SUCCESS;
+}
+
+static int32_t
+bpf_add_rule(s, rulenum, pipe_nr, protocol, src, dst, direction)
+int s;
+uint32_t rulenum;
+int pipe_nr;
+int32_t protocol;
+char *src;
+char *dst;
+int direction;
+{
+    struct bpf_link_key keys[3];
+    struct bpf_pipe pipe;
+    uint32_t key = pipe_nr;
+    int i;
+
+    if(pipe_nr <= 0 || pipe_nr >= BPF_MAX_PIPES) {
+        WARNING("Invalid pipe number %d", pipe_nr);
+        return ERROR;
+    }
+    if(protocol != IP) {
+        WARNING("The BPF backend only supports IPv4 rules");
+        return ERROR;
+    }
+
+    // same links as the filters of the netlink backend: forward,
+    // reverse and broadcast from the source
+    if(bpf_parse_addr(src, &keys[0].src) == ERROR ||
+       bpf_parse_addr(dst, &keys[0].dst) == ERROR) {
+        return ERROR;
+    }
+    keys[1].src = keys[0].dst;
+    keys[1].dst = keys[0].src;
+    keys[2].src = keys[0].src;
+    keys[2].dst = INADDR_BROADCAST;
+
+    // links are not shaped until they are configured
+    memset(&pipe, 0, sizeof(pipe));
+    if(bpf_map_update(pipe_map_fd, &key, &pipe) < 0) {
+        WARNING("Cannot reset pipe %d (%s)", pipe_nr, strerror(errno));
+        return ERROR;
+    }
+
+    for(i = 0; i < 3; i++) {
+        if(bpf_map_update(link_map_fd, &keys[i], &key) < 0) {
+            WARNING("Cannot add a link of pipe %d (%s)", pipe_nr, strerror(errno));
+            return ERROR;
+        }
+        bpf_link_count++;
+    }
+
+    return SUCCESS;
+}
+
+static int32_t
+bpf_configure(s, dst, pipe_nr, bandwidth, delay, jitter, lossrate)
+int s;
+char *dst;
+int pipe_nr;
+int bandwidth;
+double delay;
+double jitter;
+double lossrate;
+{
+    struct bpf_pipe pipe;
+    uint32_t key = pipe_nr;
+    uint32_t size;
+    void *p;
+
+    if(pipe_nr <= 0 || pipe_nr >= BPF_MAX_PIPES) {
+        WARNING("Invalid pipe number %d", pipe_nr);
+        return ERROR;
+    }
+
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.rate = (bandwidth > 0) ? (uint64_t)bandwidth / 8 : 0;
+    pipe.delay = (delay > 0) ? delay * 1000000 : 0;
+    pipe.jitter = (jitter > 0) ? jitter * 1000000 : 0;
+    if(lossrate >= 1) {
+        pipe.loss = ~0;
+    }
+    else if(lossrate > 0) {
+        pipe.loss = lossrate * max_percent_value;
+    }
+    update_count++;
+
+    if(record_open == FALSE) {
+        if(bpf_map_update(pipe_map_fd, &key, &pipe) < 0) {
+            WARNING("Cannot configure pipe %d (%s)", pipe_nr, strerror(errno));
+            return ERROR;
+        }
+        return SUCCESS;
+    }
+
+    if(record_count == record_size) {
+        size = (record_size == 0) ? 256 : 2 * record_size;
+        if((p = realloc(record_keys, size * sizeof(uint32_t))) == NULL) {
+            WARNING("Cannot allocate memory for the record");
+            return ERROR;
+        }
+        record_keys = p;
+        if((p = realloc(record_values, size * sizeof(struct bpf_pipe))) == NULL) {
+            WARNING("Cannot allocate memory for the record");
+            return ERROR;
+        }
+        record_values = p;
+        record_size = size;
+    }
+    record_keys[record_count] = key;
+    record_values[record_count++] = pipe;
+
+    return SUCCESS;
+}
+
+// the changes of a record are kept until its end, and then written
+// with a single system call if the kernel supports it
+static int32_t
+bpf_begin_record(s)
+int s;
+{
+    record_open = TRUE;
+    record_count = 0;
+
+    return SUCCESS;
+}
+
+static int32_t
+bpf_end_record(s)
+int s;
+{
+    uint32_t i = 0;
+    int ret;
+
+    record_open = FALSE;
+
+    if(batch_supported == TRUE && record_count > 0) {
+        if((ret = bpf_map_update_batch(pipe_map_fd, record_keys, record_values, record_count)) < 0) {
+            if(errno != EINVAL && errno != ENOTSUPP && errno != EOPNOTSUPP) {
+                WARNING("Cannot configure the pipes of the record (%s)", strerror(errno));
+                return ERROR;
+            }
+            INFO("BPF map batches are not supported; pipes will be configured one by one");
+            batch_supported = FALSE;
+        }
+        else {
+            i = ret;
+        }
+    }
+
+    // as for the netlink backend, pipes that cannot be configured
+    // are reported, and don't stop the emulation
+    for(; i < record_count; i++) {
+        if(bpf_map_update(pipe_map_fd, &record_keys[i], &record_values[i]) < 0) {
+            fprintf(stderr, "Cannot configure pipe %u (%s)\n", record_keys[i], strerror(errno));
+        }
+    }
+    record_count = 0;
+
+    return SUCCESS;
+}
+
+// as for the netlink backend, deleting a rule removes all the
+// emulation state
+static int32_t
+bpf_delete(s, dst, rule_number)
+int s;
+char *dst;
+uint32_t rule_number;
+{
+    int32_t i;
+
+    if(bpf_devname[0] == '\0') {
+        return SUCCESS;
+    }
+
+    modify_clsact_qdisc(RTM_DELQDISC, bpf_devname);
+    delete_netem_qdisc(bpf_devname, 0);
+    for(i = 0; i < if_num; i++) {
+        if(strcmp(device_list[i].dev_name, bpf_devname) != 0) {
+            delete_netem_qdisc(device_list[i].dev_name, 1);
+        }
+    }
+    bpf_unpin_maps();
+
+    return SUCCESS;
+}
+
+static int32_t
+bpf_flush(s)
+int s;
+{
+    return bpf_delete(s, NULL, 0);
+}
+
+static void
+bpf_stats(f)
+FILE *f;
+{
+    fprintf(f, "  bpf maps: links=%u pipe updates=%llu system calls=%llu\n", bpf_link_count,
+            (unsigned long long)update_count, (unsigned long long)syscall_count);
+}
+
+// classifies and shapes the packets with a BPF program and an fq
+// qdisc; a link change is a single BPF map update
+struct wireconf_backend wireconf_bpf_backend = {
+    "bpf",
+    bpf_open,
+    bpf_close,
+    bpf_init,
+    bpf_add_rule,
+    bpf_configure,
+    bpf_delete,
+    bpf_flush,
+    bpf_stats,
+    NULL,
+    NULL,
+    bpf_begin_record,
+    bpf_end_record,
+    TRUE
+};
+#endif
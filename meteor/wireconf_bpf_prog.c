@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: wireconf_bpf_prog.c
+ * Function: BPF program of the BPF backend of the wireconf library,
+ *           compiled with clang for the bpf target; it is attached to
+ *           the egress of the emulation device, looks up the link of
+ *           each IPv4 packet by its addresses, drops it according to
+ *           the loss rate of the link, and sets its departure time
+ *           according to the rate and delay of the link
+ *
+ ***********************************************************************/
+
+#include <stddef.h>
+#include <linux/types.h>
+#include <linux/bpf.h>
+#include <linux/if_ether.h>
+#include <linux/ip.h>
+#include <linux/pkt_cls.h>
+
+#include "wireconf_bpf.h"
+
+#define SEC(name) __attribute__((section(name), used))
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define bpf_htons(x) __builtin_bswap16(x)
+#else
+#define bpf_htons(x) (x)
+#endif
+
+static void *(*bpf_map_lookup_elem)(void *map, const void *key) =
+    (void *)BPF_FUNC_map_lookup_elem;
+static __u32 (*bpf_get_prandom_u32)(void) =
+    (void *)BPF_FUNC_get_prandom_u32;
+static __u64 (*bpf_ktime_get_ns)(void) =
+    (void *)BPF_FUNC_ktime_get_ns;
+
+// map of links (to their pipe), map of pipe parameters, and map of
+// the departure time of the next packet of each pipe, only written
+// by the program
+struct bpf_map_def links SEC("maps") = {
+    BPF_MAP_TYPE_HASH, sizeof(struct bpf_link_key), sizeof(__u32), BPF_MAX_LINKS
+};
+struct bpf_map_def pipes SEC("maps") = {
+    BPF_MAP_TYPE_ARRAY, sizeof(__u32), sizeof(struct bpf_pipe), BPF_MAX_PIPES
+};
+struct bpf_map_def state SEC("maps") = {
+    BPF_MAP_TYPE_ARRAY, sizeof(__u32), sizeof(__u64), BPF_MAX_PIPES
+};
+
+SEC("classifier")
+int
+meteor_links(struct __sk_buff *skb)
+{
+    void *data = (void *)(long)skb->data;
+    void *data_end = (void *)(long)skb->data_end;
+    struct iphdr *ip = data + ETH_HLEN;
+    struct bpf_link_key key;
+    struct bpf_pipe *pipe;
+    __u32 *pipe_nr;
+    __u64 *next;
+    __u64 now;
+    __u64 tstamp = 0;
+
+    // the time stamp of other packets may be a reception time,
+    // which fq must not take as their departure time
+    if(skb->protocol != bpf_htons(ETH_P_IP) || (void *)(ip + 1) > data_end) {
+        goto stamp;
+    }
+
+    // links are looked up by both addresses, and then with
+    // any source address and with any destination address
+    key.src = ip->saddr;
+    key.dst = ip->daddr;
+    if((pipe_nr = bpf_map_lookup_elem(&links, &key)) == NULL) {
+        key.src = 0;
+        if((pipe_nr = bpf_map_lookup_elem(&links, &key)) == NULL) {
+            key.src = ip->saddr;
+            key.dst = 0;
+            if((pipe_nr = bpf_map_lookup_elem(&links, &key)) == NULL) {
+                goto stamp;
+            }
+        }
+    }
+
+    if((pipe = bpf_map_lookup_elem(&pipes, pipe_nr)) == NULL ||
+       (next = bpf_map_lookup_elem(&state, pipe_nr)) == NULL) {
+        goto stamp;
+    }
+
+    // loss
+    if(pipe->loss != 0 && bpf_get_prandom_u32() < pipe->loss) {
+        return TC_ACT_SHOT;
+    }
+
+    // rate: the packet leaves when the previous ones of the pipe were
+    // sent, and delays the next ones by its transmission time; the
+    // state is not locked, so that concurrent packets of a pipe may
+    // only be sent slightly earlier
+    now = bpf_ktime_get_ns();
+    tstamp = now;
+    if(pipe->rate != 0) {
+        if(*next > now) {
+            tstamp = *next;
+        }
+        *next = tstamp + (__u64)skb->len * 1000000000 / pipe->rate;
+    }
+
+    // delay, and jitter uniformly distributed around it
+    tstamp += pipe->delay;
+    if(pipe->jitter != 0) {
+        tstamp += (__u64)bpf_get_prandom_u32() % (2 * pipe->jitter + 1);
+        tstamp -= pipe->jitter;
+    }
+
+stamp:
+    skb->tstamp = tstamp;
+
+    return TC_ACT_OK;
+}
+
+char _license[] SEC("license") = "Dual BSD/GPL";
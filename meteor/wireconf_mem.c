@@ -0,0 +1,440 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: wireconf_mem.c
+ * Function: In-memory backend of the wireconf library; the qdiscs,
+ *           classes and filters that would be installed are encoded
+ *           with the tc library, checked, and recorded in memory
+ *           instead of being sent to the kernel
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "message.h"
+#include "wireconf.h"
+
+#ifdef __linux
+#include "utils.h"
+#include "tc_common.h"
+#include "tc_util.h"
+
+// maximum handle of a link (the minor part of a tc handle)
+#define MEM_MAX_HANDLE          0xFFFF
+
+// state of an emulated link, as it would be found in the kernel
+struct mem_link {
+    int used;
+    int32_t protocol;
+    char src[WIRECONF_ADDR_LEN];
+    char dst[WIRECONF_ADDR_LEN];
+    uint32_t filter_count;
+
+    // netem qdisc parameters
+    uint32_t latency;
+    uint32_t loss;
+    uint32_t limit;
+
+    // htb class parameters
+    uint32_t rate;
+
+    uint32_t configure_count;
+};
+
+// netlink request, as built by the tc library
+struct mem_request {
+    struct nlmsghdr n;
+    struct tcmsg t;
+    char buf[TCA_BUF_MAX];
+};
+
+static struct mem_link *mem_links = NULL;
+static uint32_t mem_link_count = 0;
+static uint32_t mem_filter_count = 0;
+static uint32_t mem_base_objects = 0;
+static uint64_t mem_message_count = 0;
+static uint64_t mem_message_bytes = 0;
+static struct mem_request mem_req;
+
+// prepare a request of a given type for the object with
+// parent 'parent' and handle 'handle'
+static struct nlmsghdr *
+mem_request_init(type, parent, handle)
+int type;
+uint32_t parent;
+uint32_t handle;
+{
+    memset(&mem_req, 0, sizeof(struct nlmsghdr) + sizeof(struct tcmsg));
+
+    mem_req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+    mem_req.n.nlmsg_flags = NLM_F_REQUEST;
+    mem_req.n.nlmsg_type = type;
+    mem_req.t.tcm_family = AF_UNSPEC;
+    mem_req.t.tcm_parent = parent;
+    mem_req.t.tcm_handle = handle;
+
+    return &mem_req.n;
+}
+
+// check the generic part of an encoded request, and return
+// its options attribute; return NULL on error
+static struct rtattr *
+mem_request_check(n, kind)
+struct nlmsghdr *n;
+char *kind;
+{
+    struct rtattr *tb[TCA_MAX + 1];
+    struct tcmsg *t = NLMSG_DATA(n);
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(struct tcmsg));
+
+    if(len < 0 || n->nlmsg_len > sizeof(mem_req)) {
+        WARNING("Invalid %s request length (%u)", kind, n->nlmsg_len);
+        return NULL;
+    }
+
+    parse_rtattr(tb, TCA_MAX, TCA_RTA(t), len);
+    if(tb[TCA_KIND] == NULL || strcmp(RTA_DATA(tb[TCA_KIND]), kind) != 0) {
+        WARNING("Request kind is not '%s'", kind);
+        return NULL;
+    }
+    if(tb[TCA_OPTIONS] == NULL) {
+        WARNING("Missing options in %s request", kind);
+        return NULL;
+    }
+
+    mem_message_count++;
+    mem_message_bytes += n->nlmsg_len;
+
+    return tb[TCA_OPTIONS];
+}
+
+// encode the netem qdisc of a link and record its parameters
+static int
+mem_encode_netem(link, handle, qp)
+struct mem_link *link;
+int handle;
+struct qdisc_params *qp;
+{
+    struct nlmsghdr *n;
+    struct rtattr *opt;
+    struct tc_netem_qopt *qopt;
+
+    n = mem_request_init(RTM_NEWQDISC, TC_HANDLE(1, handle), TC_HANDLE(handle, 0));
+    addattr_l(n, sizeof(mem_req), TCA_KIND, "netem", strlen("netem") + 1);
+    if(netem_opt(qp, n) < 0) {
+        WARNING("Cannot encode netem qdisc %x:", handle);
+        return ERROR;
+    }
+
+    if((opt = mem_request_check(n, "netem")) == NULL) {
+        return ERROR;
+    }
+    if(RTA_PAYLOAD(opt) < sizeof(struct tc_netem_qopt)) {
+        WARNING("Truncated netem options for qdisc %x:", handle);
+        return ERROR;
+    }
+
+    qopt = RTA_DATA(opt);
+    link->latency = qopt->latency;
+    link->loss = qopt->loss;
+    link->limit = qopt->limit;
+
+    return SUCCESS;
+}
+
+// encode the htb class of a link and record its rate
+static int
+mem_encode_htb_class(link, handle, bandwidth)
+struct mem_link *link;
+int handle;
+uint32_t bandwidth;
+{
+    struct nlmsghdr *n;
+    struct rtattr *opt;
+    struct rtattr *tb[TCA_HTB_MAX + 1];
+    struct tc_htb_opt *hopt;
+
+    n = mem_request_init(RTM_NEWTCLASS, TC_HANDLE(1, 0), TC_HANDLE(1, handle));
+    addattr_l(n, sizeof(mem_req), TCA_KIND, "htb", strlen("htb") + 1);
+    if(htb_class_opt(n, bandwidth) < 0) {
+        WARNING("Cannot encode htb class 1:%x", handle);
+        return ERROR;
+    }
+
+    if((opt = mem_request_check(n, "htb")) == NULL) {
+        return ERROR;
+    }
+    parse_rtattr_nested(tb, TCA_HTB_MAX, opt);
+    if(tb[TCA_HTB_PARMS] == NULL || RTA_PAYLOAD(tb[TCA_HTB_PARMS]) < sizeof(struct tc_htb_opt)) {
+        WARNING("Missing htb parameters for class 1:%x", handle);
+        return ERROR;
+    }
+
+    hopt = RTA_DATA(tb[TCA_HTB_PARMS]);
+    link->rate = hopt->rate.rate;
+
+    return SUCCESS;
+}
+
+// encode a u32 filter of a link, and check that it
+// points to the class of the link
+static int
+mem_encode_filter(handle, up)
+int handle;
+struct u32_params *up;
+{
+    struct nlmsghdr *n;
+    struct rtattr *opt;
+    struct rtattr *tb[TCA_U32_MAX + 1];
+    uint32_t classid;
+
+    n = mem_request_init(RTM_NEWTFILTER, TC_HANDLE(1, 0), 0);
+    addattr_l(n, sizeof(mem_req), TCA_KIND, "u32", strlen("u32") + 1);
+    if(u32_filter_parse(TC_HANDLE(1, handle), *up, n, "mem") < 0) {
+        WARNING("Cannot encode u32 filter for class 1:%x", handle);
+        return ERROR;
+    }
+
+    if((opt = mem_request_check(n, "u32")) == NULL) {
+        return ERROR;
+    }
+    parse_rtattr_nested(tb, TCA_U32_MAX, opt);
+    if(tb[TCA_U32_CLASSID] == NULL) {
+        WARNING("Missing class id in u32 filter for class 1:%x", handle);
+        return ERROR;
+    }
+    classid = *(uint32_t *)RTA_DATA(tb[TCA_U32_CLASSID]);
+    if(classid != TC_HANDLE(1, handle)) {
+        WARNING("u32 filter points to class %x instead of 1:%x", classid, handle);
+        return ERROR;
+    }
+    if(up->ht != NULL && tb[TCA_U32_HASH] == NULL) {
+        WARNING("Missing hash table in u32 filter for class 1:%x", handle);
+        return ERROR;
+    }
+
+    return SUCCESS;
+}
+
+// remove all recorded state
+static void
+mem_reset(void)
+{
+    if(mem_links != NULL) {
+        memset(mem_links, 0, (MEM_MAX_HANDLE + 1) * sizeof(struct mem_link));
+    }
+    mem_link_count = 0;
+    mem_filter_count = 0;
+    mem_base_objects = 0;
+}
+
+static int
+mem_open(void)
+{
+    if(mem_links == NULL) {
+        mem_links = calloc(MEM_MAX_HANDLE + 1, sizeof(struct mem_link));
+        if(mem_links == NULL) {
+            WARNING("Cannot allocate memory backend state");
+            return ERROR;
+        }
+    }
+
+    if(tc_core_init() < 0) {
+        WARNING("Missing tc core init");
+        return ERROR;
+    }
+
+    return 0;
+}
+
+static void
+mem_close(s)
+int s;
+{
+    free(mem_links);
+    mem_links = NULL;
+}
+
+static int32_t
+mem_init(dst, protocol)
+char *dst;
+int32_t protocol;
+{
+    if(mem_links == NULL) {
+        WARNING("Memory backend used before get_socket()");
+        return ERROR;
+    }
+
+    mem_reset();
+
+    // root htb qdisc, default class and netem qdisc, catch-all filter,
+    // plus the u32 hash table and its link filter for IP
+    mem_base_objects = (protocol == IP) ? 6 : 4;
+
+    return SUCCESS;
+}
+
+static int32_t
+mem_add_rule(s, rulenum, pipe_nr, protocol, src, dst, direction)
+int s;
+uint32_t rulenum;
+int pipe_nr;
+int32_t protocol;
+char *src;
+char *dst;
+int direction;
+{
+    int i;
+    struct mem_link *link;
+    struct qdisc_params qp;
+    struct u32_params ufp[WIRECONF_LINK_FILTERS];
+    char addrs[WIRECONF_LINK_ADDRS][WIRECONF_ADDR_LEN];
+
+    if(pipe_nr <= 0 || pipe_nr > MEM_MAX_HANDLE) {
+        WARNING("Handle %d out of range", pipe_nr);
+        return ERROR;
+    }
+    link = &mem_links[pipe_nr];
+    if(link->used == TRUE) {
+        WARNING("Handle %d already in use", pipe_nr);
+        return ERROR;
+    }
+
+    // same initial configuration as the netlink backend
+    memset(&qp, 0, sizeof(struct qdisc_params));
+    qp.limit = 100000;
+    qp.delay = 0.001;
+
+    if(mem_encode_htb_class(link, pipe_nr, Gigabit) == ERROR ||
+       mem_encode_netem(link, pipe_nr, &qp) == ERROR) {
+        return ERROR;
+    }
+
+    wireconf_build_link_filters(ufp, addrs, pipe_nr, protocol, src, dst);
+    for(i = 0; i < WIRECONF_LINK_FILTERS; i++) {
+        if(mem_encode_filter(pipe_nr, &ufp[i]) == ERROR) {
+            return ERROR;
+        }
+    }
+
+    link->used = TRUE;
+    link->protocol = protocol;
+    strncpy(link->src, src, WIRECONF_ADDR_LEN - 1);
+    strncpy(link->dst, dst, WIRECONF_ADDR_LEN - 1);
+    link->filter_count = WIRECONF_LINK_FILTERS;
+    mem_link_count++;
+    mem_filter_count += WIRECONF_LINK_FILTERS;
+
+    return SUCCESS;
+}
+
+static int32_t
+mem_configure(s, dst, pipe_nr, bandwidth, delay, jitter, lossrate)
+int s;
+char *dst;
+int pipe_nr;
+int bandwidth;
+double delay;
+double jitter;
+double lossrate;
+{
+    struct mem_link *link;
+    struct qdisc_params qp;
+
+    if(pipe_nr <= 0 || pipe_nr > MEM_MAX_HANDLE || mem_links[pipe_nr].used == FALSE) {
+        WARNING("Cannot configure unknown handle %d", pipe_nr);
+        return ERROR;
+    }
+    link = &mem_links[pipe_nr];
+
+    wireconf_build_qdisc_params(&qp, bandwidth, delay, jitter, lossrate);
+    if(mem_encode_netem(link, pipe_nr, &qp) == ERROR ||
+       mem_encode_htb_class(link, pipe_nr, qp.rate) == ERROR) {
+        return ERROR;
+    }
+    link->configure_count++;
+
+    return SUCCESS;
+}
+
+// like the netlink backend, deleting a rule removes all the
+// emulation state
+static int32_t
+mem_delete(s, dst, rule_number)
+int s;
+char *dst;
+uint32_t rule_number;
+{
+    mem_reset();
+
+    return SUCCESS;
+}
+
+static int32_t
+mem_flush(s)
+int s;
+{
+    mem_reset();
+
+    return SUCCESS;
+}
+
+static void
+mem_stats(f)
+FILE *f;
+{
+    fprintf(f, "  memory state: links=%u qdiscs=%u classes=%u filters=%u\n",
+            mem_link_count, mem_link_count + (mem_base_objects > 0 ? 2 : 0),
+            mem_link_count + (mem_base_objects > 0 ? 1 : 0),
+            mem_filter_count + (mem_base_objects > 0 ? mem_base_objects - 3 : 0));
+    fprintf(f, "  encoded messages: %llu (%llu bytes)\n",
+            (unsigned long long)mem_message_count,
+            (unsigned long long)mem_message_bytes);
+}
+
+// only records the state that would have been installed, and can
+// run without root privileges
+struct wireconf_backend wireconf_memory_backend = {
+    "memory",
+    mem_open,
+    mem_close,
+    mem_init,
+    mem_add_rule,
+    mem_configure,
+    mem_delete,
+    mem_flush,
+    mem_stats
+};
+#endif
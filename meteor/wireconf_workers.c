@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2006-2009 The StarBED Project  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the project nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/************************************************************************
+ *
+ * QOMET Emulator Implementation
+ *
+ * File name: wireconf_workers.c
+ * Function: Pool of worker threads that apply link configurations
+ *           through their own netlink sockets; the links are divided
+ *           between the workers by pipe number, so that the changes
+ *           of a link are always applied in order by the same worker,
+ *           and the changes of a record are queued in advance and
+ *           applied once the record is released
+ *
+ ***********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "global.h"
+#include "message.h"
+#include "wireconf.h"
+
+#ifdef __linux
+#include "utils.h"
+#include "tc_common.h"
+#include "tc_util.h"
+
+#define WORKER_INITIAL_JOBS 256
+
+// link configuration waiting to be applied by a worker
+struct worker_job {
+    char devname[IFNAME_LEN];
+    int32_t pipe_nr;
+    int32_t bandwidth;
+    double delay;
+    double jitter;
+    double lossrate;
+};
+
+struct worker {
+    pthread_t thread;
+    int index;
+
+    // jobs of the current record, applied once 'barrier' is set;
+    // 'mutex' protects the queue and the flags, and 'cond' signals
+    // changes of them
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct worker_job *jobs;
+    int job_count;
+    int job_next;
+    int job_size;
+    int barrier;        // the record was released
+    int stop;
+
+    // only changed by the worker before it reaches the barrier,
+    // and read by the main thread after the barrier
+    int open_failed;
+    int failed;
+    double record_start;
+    struct wireconf_worker_stats stats;
+};
+
+static struct worker *workers = NULL;
+static int worker_count = 0;
+static wireconf_worker_apply_t worker_apply = NULL;
+static pthread_barrier_t worker_barrier;
+
+// number of workers that tried to open their netlink socket
+static pthread_mutex_t ready_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ready_cond = PTHREAD_COND_INITIALIZER;
+static int ready_count = 0;
+
+static double
+get_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void*
+worker_main(arg)
+void *arg;
+{
+    struct worker *w = (struct worker*)arg;
+    struct worker_job job;
+    double latency;
+
+    // 'rth' is private to each thread
+    if(rtnl_open(&rth, 0) < 0) {
+        w->open_failed = TRUE;
+    }
+    pthread_mutex_lock(&ready_mutex);
+    ready_count++;
+    pthread_cond_signal(&ready_cond);
+    pthread_mutex_unlock(&ready_mutex);
+    if(w->open_failed == TRUE) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&w->mutex);
+    while(1) {
+        while(w->barrier == FALSE && w->stop == FALSE) {
+            pthread_cond_wait(&w->cond, &w->mutex);
+        }
+
+        if(w->job_next < w->job_count) {
+            job = w->jobs[w->job_next++];
+            pthread_mutex_unlock(&w->mutex);
+
+            if(worker_apply(job.devname, job.pipe_nr, job.bandwidth, job.delay, job.jitter, job.lossrate) != SUCCESS) {
+                w->failed++;
+                w->stats.error_count++;
+            }
+            w->stats.job_count++;
+
+            pthread_mutex_lock(&w->mutex);
+            continue;
+        }
+
+        if(w->stop == TRUE) {
+            break;
+        }
+
+        // all the jobs of the record were applied
+        if(w->job_count > 0) {
+            latency = get_time() - w->record_start;
+            w->stats.record_count++;
+            w->stats.latency_sum += latency;
+            if(latency > w->stats.latency_max) {
+                w->stats.latency_max = latency;
+            }
+        }
+        w->job_count = 0;
+        w->job_next = 0;
+        w->barrier = FALSE;
+        pthread_mutex_unlock(&w->mutex);
+
+        pthread_barrier_wait(&worker_barrier);
+
+        pthread_mutex_lock(&w->mutex);
+    }
+    pthread_mutex_unlock(&w->mutex);
+
+    rtnl_close(&rth);
+
+    return NULL;
+}
+
+// start 'count' workers, that apply link configurations with 'apply';
+// return SUCCESS on success, ERROR on error (no worker is running)
+int
+wireconf_workers_start(count, apply)
+int count;
+wireconf_worker_apply_t apply;
+{
+    int i;
+    int started;
+    int ret = SUCCESS;
+
+    if(worker_count > 0) {
+        return SUCCESS;
+    }
+    if(count < 1) {
+        WARNING("Invalid number of workers (%d)", count);
+        return ERROR;
+    }
+
+    if((workers = calloc(count, sizeof(struct worker))) == NULL) {
+        WARNING("Cannot allocate memory for workers");
+        return ERROR;
+    }
+    worker_apply = apply;
+
+    ready_count = 0;
+    for(started = 0; started < count; started++) {
+        workers[started].index = started;
+        pthread_mutex_init(&workers[started].mutex, NULL);
+        pthread_cond_init(&workers[started].cond, NULL);
+        if(pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]) != 0) {
+            WARNING("Cannot create worker thread");
+            break;
+        }
+    }
+
+    // wait until the netlink sockets of the started workers are open
+    pthread_mutex_lock(&ready_mutex);
+    while(ready_count < started) {
+        pthread_cond_wait(&ready_cond, &ready_mutex);
+    }
+    pthread_mutex_unlock(&ready_mutex);
+
+    // the workers and the main thread meet at the barrier at the end
+    // of each record; the workers only reach it once a record is
+    // released, so it can be created after they started
+    pthread_barrier_init(&worker_barrier, NULL, started + 1);
+
+    worker_count = started;
+    if(started < count) {
+        ret = ERROR;
+    }
+    for(i = 0; i < started; i++) {
+        if(workers[i].open_failed == TRUE) {
+            WARNING("Worker %d cannot open a netlink socket", i);
+            ret = ERROR;
+        }
+    }
+
+    if(ret == ERROR) {
+        wireconf_workers_stop();
+        return ERROR;
+    }
+
+    INFO("Started %d netlink workers", worker_count);
+
+    return SUCCESS;
+}
+
+// return the number of running workers
+int
+wireconf_workers_count(void)
+{
+    return worker_count;
+}
+
+// queue a link configuration for the worker in charge of 'pipe_nr';
+// return SUCCESS on success, ERROR on error
+int
+wireconf_workers_dispatch(devname, pipe_nr, bandwidth, delay, jitter, lossrate)
+char *devname;
+int32_t pipe_nr;
+int32_t bandwidth;
+double delay;
+double jitter;
+double lossrate;
+{
+    struct worker *w;
+    struct worker_job *jobs;
+    struct worker_job *job;
+    int size;
+
+    if(worker_count == 0) {
+        return ERROR;
+    }
+
+    w = &workers[(uint32_t)pipe_nr % worker_count];
+
+    pthread_mutex_lock(&w->mutex);
+    if(w->job_count == w->job_size) {
+        size = (w->job_size == 0) ? WORKER_INITIAL_JOBS : 2 * w->job_size;
+        if((jobs = realloc(w->jobs, size * sizeof(struct worker_job))) == NULL) {
+            pthread_mutex_unlock(&w->mutex);
+            WARNING("Cannot allocate memory for worker jobs");
+            return ERROR;
+        }
+        w->jobs = jobs;
+        w->job_size = size;
+    }
+
+    job = &w->jobs[w->job_count++];
+    strncpy(job->devname, devname, sizeof(job->devname) - 1);
+    job->devname[sizeof(job->devname) - 1] = '\0';
+    job->pipe_nr = pipe_nr;
+    job->bandwidth = bandwidth;
+    job->delay = delay;
+    job->jitter = jitter;
+    job->lossrate = lossrate;
+
+    pthread_mutex_unlock(&w->mutex);
+
+    return SUCCESS;
+}
+
+// release the queued link configurations, and wait until the workers
+// applied them; return the number of configurations that could not
+// be applied
+int
+wireconf_workers_wait(void)
+{
+    int i;
+    int failed = 0;
+    double start;
+
+    if(worker_count == 0) {
+        return 0;
+    }
+
+    start = get_time();
+    for(i = 0; i < worker_count; i++) {
+        pthread_mutex_lock(&workers[i].mutex);
+        workers[i].record_start = start;
+        workers[i].barrier = TRUE;
+        pthread_cond_signal(&workers[i].cond);
+        pthread_mutex_unlock(&workers[i].mutex);
+    }
+
+    pthread_barrier_wait(&worker_barrier);
+
+    for(i = 0; i < worker_count; i++) {
+        failed += workers[i].failed;
+        workers[i].failed = 0;
+    }
+
+    return failed;
+}
+
+// stop the workers; queued link configurations are applied first
+void
+wireconf_workers_stop(void)
+{
+    int i;
+
+    if(workers == NULL) {
+        return;
+    }
+
+    for(i = 0; i < worker_count; i++) {
+        pthread_mutex_lock(&workers[i].mutex);
+        workers[i].stop = TRUE;
+        pthread_cond_signal(&workers[i].cond);
+        pthread_mutex_unlock(&workers[i].mutex);
+    }
+    for(i = 0; i < worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+        pthread_mutex_destroy(&workers[i].mutex);
+        pthread_cond_destroy(&workers[i].cond);
+        free(workers[i].jobs);
+    }
+    pthread_barrier_destroy(&worker_barrier);
+
+    free(workers);
+    workers = NULL;
+    worker_count = 0;
+}
+
+// print the apply latency of each worker, i.e., the time from the
+// release of a record to the last of its configurations applied
+void
+wireconf_workers_print_stats(f)
+FILE *f;
+{
+    struct wireconf_worker_stats *ws;
+    int i;
+
+    for(i = 0; i < worker_count; i++) {
+        ws = &workers[i].stats;
+        fprintf(f, "  worker %d: records=%llu links=%llu errors=%llu", i,
+                (unsigned long long)ws->record_count,
+                (unsigned long long)ws->job_count,
+                (unsigned long long)ws->error_count);
+        if(ws->record_count > 0) {
+            fprintf(f, " latency avg=%.3f us max=%.3f us",
+                    ws->latency_sum * 1e6 / ws->record_count, ws->latency_max * 1e6);
+        }
+        fprintf(f, "\n");
+    }
+}
+#endif
@@ -0,0 +1,102 @@
+#!/bin/sh
+# Run meteor end-to-end on a single Linux host: two network namespaces
+# joined by a veth pair, timestamped UDP probes sent across the link,
+# and a comparison of the measured delay/loss/rate with the scenario
+
+if [ "$(id -u)" -ne 0 ]
+then
+    echo "ERROR: This script must be run as root!"
+    echo "Command function: Measure meteor apply latency and accuracy using network namespaces"
+    echo "Usage: $(basename $0) [<number_of_updates> [<update_interval_s> [<probes_per_s>]]]"
+    exit 1
+fi
+
+# Define variables
+steps=${1:-6}
+interval=${2:-2}
+probe_rate=${3:-200}
+
+ns_a=qomet_a
+ns_b=qomet_b
+addr_a=10.199.0.1
+addr_b=10.199.0.2
+work_dir=$(mktemp -d /tmp/qomet_netns.XXXXXX)
+scenario=${work_dir}/testbed.bin
+settings=${work_dir}/testbed.settings
+samples=${work_dir}/samples.txt
+bin_dir=$(cd $(dirname $0) && pwd)/bin
+
+# probes run for the whole scenario plus margins for setup and drain
+duration=$(awk "BEGIN { print (${steps} + 2) * ${interval} + 2 }")
+
+cleanup()
+{
+    ip netns del ${ns_a} 2>/dev/null
+    ip netns del ${ns_b} 2>/dev/null
+}
+trap cleanup EXIT INT TERM
+
+##################
+# Set up testbed
+##################
+
+echo "* Creating namespaces ${ns_a} (${addr_a}) and ${ns_b} (${addr_b})..."
+cleanup
+ip netns add ${ns_a} || exit 1
+ip netns add ${ns_b} || exit 1
+ip link add veth_a netns ${ns_a} type veth peer name veth_b netns ${ns_b} || exit 1
+ip -n ${ns_a} addr add ${addr_a}/24 dev veth_a
+ip -n ${ns_b} addr add ${addr_b}/24 dev veth_b
+ip -n ${ns_a} link set lo up
+ip -n ${ns_b} link set lo up
+ip -n ${ns_a} link set veth_a up
+ip -n ${ns_b} link set veth_b up
+
+# meteor shapes the ingress traffic of veth_b through ifb0
+modprobe ifb numifbs=0 2>/dev/null
+ip -n ${ns_b} link add ifb0 type ifb || exit 1
+
+echo "node_a veth_a 0 ${addr_a}" > ${settings}
+echo "node_b veth_b 1 ${addr_b}" >> ${settings}
+
+${bin_dir}/link_probe -g ${scenario} -n ${steps} -i ${interval} || exit 1
+
+####################
+# Run the experiment
+####################
+
+echo "* Starting probe receiver and sender (${probe_rate} probes/s, ${duration} s)..."
+ip netns exec ${ns_b} ${bin_dir}/link_probe -l ${samples} -t ${duration} &
+receiver_pid=$!
+sleep 0.5
+ip netns exec ${ns_a} ${bin_dir}/link_probe -s ${addr_b} -r ${probe_rate} -t $(awk "BEGIN { print ${duration} - 1 }") &
+sender_pid=$!
+sleep 0.5
+
+echo "* Starting QOMET emulation..."
+ip netns exec ${ns_b} ${bin_dir}/meteor -Q ${scenario} -s ${settings} -i 0 -m ${interval} -I veth_b > ${work_dir}/meteor.log 2>&1
+origin=$(grep "Scenario time origin" ${work_dir}/meteor.log | awk '{print $4}')
+
+wait ${sender_pid} ${receiver_pid}
+
+if [ -z "${origin}" ]
+then
+    echo "ERROR: meteor did not report its time origin (see ${work_dir}/meteor.log)"
+    exit 1
+fi
+
+###############
+# Results
+###############
+
+echo
+echo "-- Applied vs. requested link conditions"
+${bin_dir}/link_probe -a ${samples} -b ${scenario} -T ${origin}
+
+echo
+echo "-- Configuration throughput (netlink, no real-time waits)"
+ip netns exec ${ns_b} ${bin_dir}/meteor -x -Q ${scenario} -s ${settings} -i 0 -m ${interval} -I veth_b \
+    | grep -A10 "records/s"
+
+echo
+echo "Output files are in ${work_dir}"
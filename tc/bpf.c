@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <linux/if_ether.h>
+
+#include "utils.h"
+#include "tc_util.h"
+#include "tc_common.h"
+
+#define DEFAULT_PRIO 10
+
+// add (or replace) the root fq qdisc of a device; packets are sent
+// at their skb->tstamp, and dropped if it is more than 'horizon' us
+// in the future
+int
+add_fq_qdisc(dev, limit, horizon)
+char *dev;
+uint32_t limit;
+uint32_t horizon;
+{
+    char qdisc_kind[16] = "fq";
+    uint8_t horizon_drop = 1;
+    struct rtattr *tail;
+    struct {
+        struct nlmsghdr n;
+        struct tcmsg    t;
+        char            buf[TCA_BUF_MAX];
+    } req;
+    memset(&req, 0, sizeof(req));
+
+    req.n.nlmsg_len   = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.n.nlmsg_flags = NLM_F_REQUEST|NLM_F_CREATE|NLM_F_REPLACE;
+    req.n.nlmsg_type  = RTM_NEWQDISC;
+    req.t.tcm_family  = AF_UNSPEC;
+    req.t.tcm_parent  = TC_H_ROOT;
+    req.t.tcm_handle  = TC_HANDLE(1, 0);
+
+    addattr_l(&req.n, sizeof(req), TCA_KIND, qdisc_kind, strlen(qdisc_kind) + 1);
+
+    // all the links may share a flow, since the packets redirected
+    // from ingress have no socket
+    tail = NLMSG_TAIL(&req.n);
+    addattr_l(&req.n, sizeof(req), TCA_OPTIONS, NULL, 0);
+    addattr32(&req.n, sizeof(req), TCA_FQ_PLIMIT, limit);
+    addattr32(&req.n, sizeof(req), TCA_FQ_FLOW_PLIMIT, limit);
+    addattr32(&req.n, sizeof(req), TCA_FQ_HORIZON, horizon);
+    addattr_l(&req.n, sizeof(req), TCA_FQ_HORIZON_DROP, &horizon_drop, sizeof(horizon_drop));
+    tail->rta_len = (void *)NLMSG_TAIL(&req.n) - (void *)tail;
+
+    if((req.t.tcm_ifindex = ll_name_to_index(dev)) == 0) {
+        fprintf(stderr, "Cannot find device \"%s\"\n", dev);
+        return 1;
+    }
+    dprintf(("[add_fq_qdisc] fq ifindex = %d\n", req.t.tcm_ifindex));
+
+    if(rtnl_talk(&rth, &req.n, 0, 0, NULL, NULL, NULL) < 0) {
+        return 2;
+    }
+
+    return 0;
+}
+
+// add or delete the clsact qdisc of a device, to which the BPF
+// filters are attached
+int
+modify_clsact_qdisc(cmd, dev)
+int cmd;
+char *dev;
+{
+    char qdisc_kind[16] = "clsact";
+    struct {
+        struct nlmsghdr n;
+        struct tcmsg    t;
+        char            buf[TCA_BUF_MAX];
+    } req;
+    memset(&req, 0, sizeof(req));
+
+    req.n.nlmsg_len   = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.n.nlmsg_flags = NLM_F_REQUEST;
+    if(cmd == RTM_NEWQDISC) {
+        req.n.nlmsg_flags |= NLM_F_EXCL|NLM_F_CREATE;
+    }
+    req.n.nlmsg_type  = cmd;
+    req.t.tcm_family  = AF_UNSPEC;
+    req.t.tcm_parent  = TC_H_CLSACT;
+    req.t.tcm_handle  = TC_H_MAKE(TC_H_CLSACT, 0);
+
+    addattr_l(&req.n, sizeof(req), TCA_KIND, qdisc_kind, strlen(qdisc_kind) + 1);
+
+    if((req.t.tcm_ifindex = ll_name_to_index(dev)) == 0) {
+        fprintf(stderr, "Cannot find device \"%s\"\n", dev);
+        return 1;
+    }
+    dprintf(("[modify_clsact_qdisc] clsact ifindex = %d\n", req.t.tcm_ifindex));
+
+    if(rtnl_talk(&rth, &req.n, 0, 0, NULL, NULL, NULL) < 0) {
+        return 2;
+    }
+
+    return 0;
+}
+
+// attach the BPF program 'fd' to the egress hook of the clsact qdisc
+// of a device; its return value is the action of the packet
+int
+add_bpf_filter(dev, fd, name)
+char *dev;
+int fd;
+char *name;
+{
+    char filter_kind[16] = "bpf";
+    struct rtattr *tail;
+    struct {
+        struct nlmsghdr n;
+        struct tcmsg    t;
+        char            buf[MAX_MSG];
+    } req;
+    memset(&req, 0, sizeof(req));
+
+    req.n.nlmsg_len   = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.n.nlmsg_flags = NLM_F_REQUEST|NLM_F_CREATE|NLM_F_EXCL;
+    req.n.nlmsg_type  = RTM_NEWTFILTER;
+    req.t.tcm_family  = AF_UNSPEC;
+    req.t.tcm_parent  = TC_H_MAKE(TC_H_CLSACT, TC_H_MIN_EGRESS);
+    req.t.tcm_info    = TC_H_MAKE(DEFAULT_PRIO << 16, htons(ETH_P_ALL));
+
+    addattr_l(&req.n, sizeof(req), TCA_KIND, filter_kind, strlen(filter_kind) + 1);
+
+    tail = NLMSG_TAIL(&req.n);
+    addattr_l(&req.n, sizeof(req), TCA_OPTIONS, NULL, 0);
+    addattr32(&req.n, sizeof(req), TCA_BPF_FD, fd);
+    addattr_l(&req.n, sizeof(req), TCA_BPF_NAME, name, strlen(name) + 1);
+    addattr32(&req.n, sizeof(req), TCA_BPF_FLAGS, TCA_BPF_FLAG_ACT_DIRECT);
+    tail->rta_len = (void *)NLMSG_TAIL(&req.n) - (void *)tail;
+
+    if((req.t.tcm_ifindex = ll_name_to_index(dev)) == 0) {
+        fprintf(stderr, "Cannot find device \"%s\"\n", dev);
+        return 1;
+    }
+    dprintf(("[add_bpf_filter] bpf ifindex = %d\n", req.t.tcm_ifindex));
+
+    if(rtnl_talk(&rth, &req.n, 0, 0, NULL, NULL, NULL) < 0) {
+        return 2;
+    }
+
+    return 0;
+}
@@ -42,7 +42,7 @@ else if(name ##_current.tv_sec != name##_prev.tv_sec) {
 }                                                                                  \
 printf("%s: sec:%lu usec:%06ld\n", #name, name##_sec, name##_usec);
 
-static int
+int
 htb_class_opt(n, bandwidth)
 struct nlmsghdr *n;
 uint32_t bandwidth;
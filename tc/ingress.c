@@ -17,6 +17,7 @@
 #include "tc_common.h"
 
 #define DEFAULT_PRIO 10
+#define SHARD_PRIO   (DEFAULT_PRIO - 1)
 
 int
 add_ingress_qdisc(dev)
@@ -163,13 +164,13 @@ char *ifb;
 }
 
 int
-u32_ingress_filter(n, ifb)
+u32_ingress_filter(n, ifb, key, mask, off)
 struct nlmsghdr *n;
 char* ifb;
+uint32_t key;
+uint32_t mask;
+int off;
 {
-    uint32_t key = 0;
-    uint32_t mask = 0;
-    int off = 0;
     int offmask = 0;
     unsigned handle;
     struct rtattr *tail;
@@ -182,7 +183,7 @@ char* ifb;
     tail = NLMSG_TAIL(n);
     addattr_l(n, MAX_MSG, TCA_OPTIONS, NULL, 0);
 
-    pack_key(sel, htonl(key), htonl(mask), off, offmask);
+    pack_key(&sel.sel, htonl(key), htonl(mask), off, offmask);
 
     handle = TC_HANDLE(1, 1);
     dprintf(("[u32_ingress_filter] handle id %d\n", handle));
@@ -197,17 +198,22 @@ char* ifb;
     return 0;
 }
 
-int
-add_ingress_filter(dev, ifb)
+// redirect to 'ifb' the packets of protocol 'proto' received on 'dev'
+// whose 32-bit word at 'off' matches 'key' under 'mask'
+static int
+ingress_filter_add(dev, ifb, prio, proto, key, mask, off)
 char *dev;
 char *ifb;
+uint32_t prio;
+char *proto;
+uint32_t key;
+uint32_t mask;
+int off;
 {
     char filter_kind[16] = "u32";
     int32_t ret;
     uint16_t protocol_id;
     uint32_t protocol;
-    uint32_t prio;
-    struct tc_estimator *est;
     struct {
         struct nlmsghdr n;
         struct tcmsg    t;
@@ -215,17 +221,13 @@ char *ifb;
     } req;
 
     memset(&req, 0, sizeof(req));
-    est = malloc(sizeof(struct tc_estimator));
-    memset(est, 0, sizeof(struct tc_estimator));
 
     req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
     req.n.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
     req.n.nlmsg_type = RTM_NEWTFILTER;
 
-    protocol = htons(ETH_P_ALL);
-    ll_proto_a2n(&protocol_id, "all");
+    ll_proto_a2n(&protocol_id, proto);
     protocol = protocol_id;
-    prio = DEFAULT_PRIO;
 
     req.t.tcm_family = AF_UNSPEC;
     req.t.tcm_parent = 0xffff0000;
@@ -233,7 +235,7 @@ char *ifb;
 
     addattr_l(&req.n, sizeof(req), TCA_KIND, filter_kind, strlen(filter_kind) + 1);
 
-    ret = u32_ingress_filter(&req.n, ifb);
+    ret = u32_ingress_filter(&req.n, ifb, key, mask, off);
     if(ret != 0) {
         return ret;
     }
@@ -248,3 +250,27 @@ char *ifb;
 
     return 0;
 }
+
+// redirect all the packets received on 'dev' to 'ifb'
+int
+add_ingress_filter(dev, ifb)
+char *dev;
+char *ifb;
+{
+    return ingress_filter_add(dev, ifb, DEFAULT_PRIO, "all", 0, 0, 0);
+}
+
+// redirect to 'ifb' the IPv4 packets received on 'dev' whose source
+// (or destination, if 'dst' is set) address matches 'key' under
+// 'mask'; these filters are evaluated before the one redirecting
+// all packets
+int
+add_ingress_shard_filter(dev, ifb, dst, key, mask)
+char *dev;
+char *ifb;
+int dst;
+uint32_t key;
+uint32_t mask;
+{
+    return ingress_filter_add(dev, ifb, SHARD_PRIO, "ip", key, mask, dst ? 16 : 12);
+}
@@ -8,6 +8,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <linux/if_link.h>
+#include "utils.h"
 #include "tc_util.h"
 #include "ip_common.h"
 
@@ -146,6 +148,42 @@ int cmd;
     return 0;
 }
 
+// create the ifb device 'dev' (down); return 0 on success, -1 on error
+int
+add_ifb(dev)
+char* dev;
+{
+    struct rtattr *linkinfo;
+    struct {
+        struct nlmsghdr  n;
+        struct ifinfomsg i;
+        char             buf[1024];
+    } req;
+    char answer[1024];
+
+    memset(&req, 0, sizeof(req));
+
+    // the request is sent immediately even while a batch is
+    // active, as the device must exist before it is configured
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct ifinfomsg));
+    req.n.nlmsg_flags = NLM_F_REQUEST|NLM_F_CREATE|NLM_F_EXCL|NLM_F_ACK;
+    req.n.nlmsg_type = RTM_NEWLINK;
+    req.i.ifi_family = AF_UNSPEC;
+
+    addattr_l(&req.n, sizeof(req), IFLA_IFNAME, dev, strlen(dev) + 1);
+    linkinfo = NLMSG_TAIL(&req.n);
+    addattr_l(&req.n, sizeof(req), IFLA_LINKINFO, NULL, 0);
+    addattr_l(&req.n, sizeof(req), IFLA_INFO_KIND, "ifb", strlen("ifb"));
+    linkinfo->rta_len = (void *)NLMSG_TAIL(&req.n) - (void *)linkinfo;
+
+    if(rtnl_talk(&rth, &req.n, 0, 0, (struct nlmsghdr*)answer, NULL, NULL) < 0) {
+        fprintf(stderr, "Cannot create ifb device %s\n", dev);
+        return -1;
+    }
+
+    return 0;
+}
+
 /* test code
 int
 main(argc, argv)
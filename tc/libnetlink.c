@@ -142,6 +142,10 @@ int type;
     } req;
     struct sockaddr_nl nladdr;
 
+    if(rtnl_batch_flush(rth) < 0) {
+        return -1;
+    }
+
     memset(&nladdr, 0, sizeof(nladdr));
     nladdr.nl_family = AF_NETLINK;
 
@@ -190,6 +194,10 @@ int len;
         .msg_iovlen = 2,
     };
 
+    if(rtnl_batch_flush(rth) < 0) {
+        return -1;
+    }
+
     memset(&nladdr, 0, sizeof(nladdr));
     nladdr.nl_family = AF_NETLINK;
 
@@ -287,6 +295,279 @@ skip_it:
     }
 }
 
+#define RTNL_BATCH_SIZE   65536     /* maximum size of one sendmsg() */
+#define RTNL_BATCH_WINDOW 256       /* default maximum of outstanding ACKs */
+#define RTNL_BATCH_SNDBUF 262144
+#define RTNL_BATCH_RCVBUF 1048576
+
+/* receive ACKs until at most 'limit' requests are outstanding */
+static int
+rtnl_batch_wait(rtnl, limit)
+struct rtnl_handle *rtnl;
+int limit;
+{
+    struct rtnl_batch *batch = rtnl->batch;
+    struct nlmsghdr *h;
+    struct nlmsgerr *err;
+    struct sockaddr_nl nladdr;
+    struct iovec iov;
+    struct msghdr msg = {
+        .msg_name = &nladdr,
+        .msg_namelen = sizeof(nladdr),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+    char buf[16384];
+    int status;
+    int echoed;
+
+    iov.iov_base = buf;
+    while(batch->outstanding > limit) {
+        iov.iov_len = sizeof(buf);
+        status = recvmsg(rtnl->fd, &msg, 0);
+
+        if(status < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == ENOBUFS) {
+                fprintf(stderr, "Netlink ACKs lost (receive buffer too small)\n");
+                return -1;
+            }
+            perror("Cannot receive netlink ACKs");
+            return -1;
+        }
+        if(status == 0) {
+            fprintf(stderr, "EOF on netlink\n");
+            return -1;
+        }
+
+        for(h = (struct nlmsghdr*)buf; NLMSG_OK(h, status); h = NLMSG_NEXT(h, status)) {
+            if(nladdr.nl_pid != 0 || h->nlmsg_pid != rtnl->local.nl_pid || h->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+
+            batch->outstanding--;
+            err = (struct nlmsgerr*)NLMSG_DATA(h);
+            if(h->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
+                fprintf(stderr, "ERROR truncated\n");
+                batch->failed++;
+                continue;
+            }
+            if(err->error == 0) {
+                batch->acked++;
+                continue;
+            }
+
+            batch->failed++;
+            if(batch->error != NULL) {
+                /* only the part of the request echoed by the kernel is passed on */
+                echoed = h->nlmsg_len - NLMSG_LENGTH(sizeof(struct nlmsgerr)) + sizeof(struct nlmsghdr);
+                if(err->msg.nlmsg_len > echoed) {
+                    err->msg.nlmsg_len = echoed;
+                }
+                batch->error(&err->msg, err->error, batch->arg);
+            }
+        }
+        if(msg.msg_flags & MSG_TRUNC) {
+            fprintf(stderr, "Message truncated\n");
+        }
+    }
+
+    return 0;
+}
+
+/* send the queued requests, after waiting for enough ACKs to keep
+   the number of outstanding requests within the window; the requests
+   queued while the batch was held may need several sendmsg() */
+static int
+rtnl_batch_send(rtnl)
+struct rtnl_handle *rtnl;
+{
+    struct rtnl_batch *batch = rtnl->batch;
+    struct nlmsghdr *h;
+    int offset = 0;
+    int len;
+    int count;
+
+    while(batch->queued > 0) {
+        len = 0;
+        for(count = 0; count < batch->queued && count < batch->window; count++) {
+            h = (struct nlmsghdr*)(batch->buf + offset + len);
+            if(len + NLMSG_ALIGN(h->nlmsg_len) > batch->size) {
+                break;
+            }
+            len += NLMSG_ALIGN(h->nlmsg_len);
+        }
+
+        if(rtnl_batch_wait(rtnl, batch->window - count) < 0) {
+            return -1;
+        }
+        if(rtnl_send(rtnl, batch->buf + offset, len) < 0) {
+            perror("Cannot talk to rtnetlink");
+            return -1;
+        }
+
+        batch->outstanding += count;
+        batch->sent += count;
+        batch->queued -= count;
+        offset += len;
+    }
+    batch->len = 0;
+
+    return 0;
+}
+
+static int
+rtnl_batch_add(rtnl, n)
+struct rtnl_handle *rtnl;
+struct nlmsghdr *n;
+{
+    struct rtnl_batch *batch = rtnl->batch;
+    int len = NLMSG_ALIGN(n->nlmsg_len);
+    char *buf;
+
+    if(len > batch->size) {
+        fprintf(stderr, "Netlink request too large for batch (%d bytes)\n", len);
+        return -1;
+    }
+    if(batch->held) {
+        if(batch->len + len > batch->alloc) {
+            if((buf = realloc(batch->buf, 2 * batch->alloc)) == NULL) {
+                fprintf(stderr, "Cannot allocate netlink batch\n");
+                return -1;
+            }
+            batch->buf = buf;
+            batch->alloc *= 2;
+        }
+    }
+    else if(batch->len + len > batch->size || batch->queued == batch->window) {
+        if(rtnl_batch_send(rtnl) < 0) {
+            return -1;
+        }
+    }
+
+    n->nlmsg_seq = ++rtnl->seq;
+    n->nlmsg_flags |= NLM_F_ACK;
+    memset(batch->buf + batch->len, 0, len);
+    memcpy(batch->buf + batch->len, n, n->nlmsg_len);
+    batch->len += len;
+    batch->queued++;
+
+    return 0;
+}
+
+int
+rtnl_batch_begin(rtnl, batch, window, error, arg)
+struct rtnl_handle *rtnl;
+struct rtnl_batch *batch;
+int window;
+rtnl_batch_error_t error;
+void *arg;
+{
+    int sndbuf = RTNL_BATCH_SNDBUF;
+    int rcvbuf = RTNL_BATCH_RCVBUF;
+    socklen_t optlen = sizeof(sndbuf);
+
+    if(rtnl->batch != NULL) {
+        fprintf(stderr, "Netlink batch already active\n");
+        return -1;
+    }
+
+    memset(batch, 0, sizeof(struct rtnl_batch));
+    batch->window = (window > 0) ? window : RTNL_BATCH_WINDOW;
+    batch->error = error;
+    batch->arg = arg;
+
+    /* ACKs of a whole window must fit in the receive buffer, and
+       a batch in the send buffer; the *FORCE options need root */
+    if(setsockopt(rtnl->fd, SOL_SOCKET, SO_SNDBUFFORCE, &sndbuf, sizeof(sndbuf)) < 0) {
+        setsockopt(rtnl->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    }
+    if(setsockopt(rtnl->fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0) {
+        setsockopt(rtnl->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    if(getsockopt(rtnl->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &optlen) < 0) {
+        perror("SO_SNDBUF");
+        return -1;
+    }
+
+    batch->size = RTNL_BATCH_SIZE;
+    if(batch->size > sndbuf - 32) {
+        batch->size = sndbuf - 32;
+    }
+    batch->alloc = batch->size;
+    if((batch->buf = malloc(batch->alloc)) == NULL) {
+        fprintf(stderr, "Cannot allocate netlink batch\n");
+        return -1;
+    }
+
+    rtnl->batch = batch;
+
+    return 0;
+}
+
+/* send all queued requests and wait for all ACKs; the requests
+   of a held batch stay queued */
+int
+rtnl_batch_flush(rtnl)
+struct rtnl_handle *rtnl;
+{
+    if(rtnl->batch == NULL) {
+        return 0;
+    }
+    if(!rtnl->batch->held && rtnl_batch_send(rtnl) < 0) {
+        return -1;
+    }
+
+    return rtnl_batch_wait(rtnl, 0);
+}
+
+/* queue requests without sending them until rtnl_batch_release() */
+void
+rtnl_batch_hold(rtnl)
+struct rtnl_handle *rtnl;
+{
+    if(rtnl->batch != NULL) {
+        rtnl->batch->held = 1;
+    }
+}
+
+/* send the requests queued while the batch was held, and wait for
+   all ACKs */
+int
+rtnl_batch_release(rtnl)
+struct rtnl_handle *rtnl;
+{
+    if(rtnl->batch == NULL) {
+        return 0;
+    }
+    rtnl->batch->held = 0;
+
+    return rtnl_batch_flush(rtnl);
+}
+
+/* flush and end the batch; return the number of failed requests,
+   or -1 if the batch could not be completed */
+int
+rtnl_batch_end(rtnl)
+struct rtnl_handle *rtnl;
+{
+    struct rtnl_batch *batch = rtnl->batch;
+    int ret;
+
+    if(batch == NULL) {
+        return 0;
+    }
+
+    ret = rtnl_batch_release(rtnl);
+    rtnl->batch = NULL;
+    free(batch->buf);
+    batch->buf = NULL;
+
+    return (ret < 0) ? -1 : batch->failed;
+}
+
 int
 rtnl_talk(rtnl, n, peer, groups, answer, junk, jarg)
 struct rtnl_handle* rtnl;
@@ -312,6 +593,22 @@ void *jarg;
         .msg_iovlen = 1,
     };
     char buf[16384];
+    int ret;
+
+    if(rtnl->intercept != NULL && answer == NULL && peer == 0 && groups == 0) {
+        if((ret = rtnl->intercept(rtnl, n, rtnl->intercept_arg)) != 0) {
+            return (ret < 0) ? -1 : 0;
+        }
+    }
+
+    if(rtnl->batch != NULL) {
+        if(answer == NULL && peer == 0 && groups == 0) {
+            return rtnl_batch_add(rtnl, n);
+        }
+        if(rtnl_batch_flush(rtnl) < 0) {
+            return -1;
+        }
+    }
 
     dprintf_l255(("[rtnl_talk] msghdr size = %ld\n", sizeof(msg)));
     memset(&nladdr, 0, sizeof(nladdr));
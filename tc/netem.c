@@ -8,6 +8,7 @@
 #include <arpa/inet.h>
 #include <string.h>
 #include <errno.h>
+#include <math.h>
 
 #include "utils.h"
 #include "tc_util.h"
@@ -16,6 +17,9 @@
 #define MAXDIST 65536
 #define NETEM_LIMIT 10000
 
+// number of entries of the normal delay distribution table
+#define NORMAL_DIST_SIZE 4096
+
 #define NEXT_IS_NUMBER() (NEXT_ARG_OK() && isnumber(argv[1]))
 
 static int
@@ -43,16 +47,61 @@ const char* str;
     return 0;
 }
 
-static int
+// return the normal delay distribution table, in the format of the
+// tables of iproute2 (inverse of the standard normal distribution
+// function, scaled by NETEM_DIST_SCALE); computed on first use
+static __s16*
+normal_dist(void)
+{
+    static __s16 table[NORMAL_DIST_SIZE];
+    static int ready = 0;
+    double p, low, high, x;
+    int i, j;
+
+    if(ready) {
+        return table;
+    }
+
+    for(i = 0; i < NORMAL_DIST_SIZE; i++) {
+        p = (i + 0.5) / NORMAL_DIST_SIZE;
+        low = -8;
+        high = 8;
+        for(j = 0; j < 50; j++) {
+            x = (low + high) / 2;
+            if(0.5 * (1 + erf(x / M_SQRT2)) < p) {
+                low = x;
+            }
+            else {
+                high = x;
+            }
+        }
+        x = rint((low + high) / 2 * NETEM_DIST_SCALE);
+        if(x > 32767) {
+            x = 32767;
+        }
+        else if(x < -32767) {
+            x = -32767;
+        }
+        table[i] = x;
+    }
+    ready = 1;
+
+    return table;
+}
+
+int
 netem_opt(qp, n)
 struct qdisc_params* qp;
 struct nlmsghdr *n;
 {
     uint32_t latency;
+    uint32_t jitter;
+    uint64_t rate64;
     size_t dist_size = 0;
     struct rtattr* tail;
     struct tc_netem_qopt opt;
     struct tc_netem_corr cor;
+    struct tc_netem_rate rate;
     struct tc_netem_reorder reorder;
     struct tc_netem_corrupt corrupt;
     __s16* dist_data = NULL;
@@ -63,6 +112,7 @@ struct nlmsghdr *n;
     memset(&cor, 0, sizeof(cor));
     memset(&reorder, 0, sizeof(reorder));
     memset(&corrupt, 0, sizeof(corrupt));
+    memset(&rate, 0, sizeof(rate));
     memset(present, 0, sizeof(present));
 
     if(qp->limit) {
@@ -73,12 +123,12 @@ struct nlmsghdr *n;
         opt.latency = tc_core_time2tick(latency);
     }
     if(qp->jitter) {
-        qp->jitter = 0;
-/*
-        if(get_ticks(&opt.jitter, qp->jitter)) {
-            return -1;
-        }
-*/
+        jitter = qp->jitter * 1000;
+        opt.jitter = tc_core_time2tick(jitter);
+    }
+    if(qp->delay_dist) {
+        dist_data = normal_dist();
+        dist_size = NORMAL_DIST_SIZE;
     }
     if(qp->delay_corr) {
         ++present[TCA_NETEM_CORR];
@@ -113,14 +163,31 @@ struct nlmsghdr *n;
         fprintf(stderr, "gap specified without reorder probability\n");
         return -1;
     }
-    if(dist_data && (opt.latency == 0 || opt.jitter == 0)) {
-        fprintf(stderr, "distribution specified but no latency and jitter values\n");
-        return -1;
-    }
+    // the distribution table may be installed before any jitter is
+    // set, since the kernel keeps it when the qdisc is changed
     if(addattr_l(n, TCA_BUF_MAX, TCA_OPTIONS, &opt, sizeof(opt)) < 0) {
         return -1;
     }
-    if(cor.delay_corr || cor.loss_corr || cor.dup_corr) {
+
+    // netem keeps the rate and the correlations that are not sent,
+    // so they are always sent when netem limits the rate itself
+    if(qp->rate_native) {
+        ++present[TCA_NETEM_CORR];
+        if(addattr_l(n, TCA_BUF_MAX, TCA_NETEM_CORR, &cor, sizeof(cor)) < 0) {
+            return -1;
+        }
+        rate.rate = (qp->netem_rate >= ~0U) ? ~0U : qp->netem_rate;
+        if(addattr_l(n, TCA_BUF_MAX, TCA_NETEM_RATE, &rate, sizeof(rate)) < 0) {
+            return -1;
+        }
+        if(qp->netem_rate >= ~0U) {
+            rate64 = qp->netem_rate;
+            if(addattr_l(n, TCA_BUF_MAX, TCA_NETEM_RATE64, &rate64, sizeof(rate64)) < 0) {
+                return -1;
+            }
+        }
+    }
+    else if(cor.delay_corr || cor.loss_corr || cor.dup_corr) {
         if (present[TCA_NETEM_CORR] && addattr_l(n, TCA_BUF_MAX, TCA_NETEM_CORR, &cor, sizeof(cor)) < 0) {
             return -1;
         }
@@ -0,0 +1,506 @@
+/*
+ * route_cache.c Cache of the IPv4 main and local routing tables, used
+ *               to find the output device of a destination without a
+ *               netlink request per lookup.
+ *
+ *      The tables are dumped when the cache is opened, and again at the
+ *      first lookup after they changed: a thread waits with rtnl_listen()
+ *      for route, link and policy rule notifications, and marks the
+ *      cache as invalid when one is received. The routes are kept sorted
+ *      by table, prefix length and destination, so that a lookup is a
+ *      binary search for each prefix length.
+ *
+ *      Policy routing is not cached: if rules other than the default
+ *      ones (local, main and default tables, without selectors) exist,
+ *      all lookups are left to the kernel. Lookups must be made from a
+ *      single thread.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/fib_rules.h>
+#include <string.h>
+#include <errno.h>
+
+#include "libnetlink.h"
+#include "ll_map.h"
+#include "route_cache.h"
+
+#define ROUTE_CACHE_INITIAL_SIZE 64
+
+// number of prefix lengths of IPv4 routes (0 to 32)
+#define ROUTE_CACHE_PREFIX_LENS 33
+
+// priorities of the default IPv4 policy rules
+#define RULE_PRIORITY_LOCAL   0
+#define RULE_PRIORITY_MAIN    32766
+#define RULE_PRIORITY_DEFAULT 32767
+
+// route of the main or local table; 'oif' is 0 for routes that cannot
+// be resolved to a single device (e.g., unreachable or multipath
+// routes), for which lookups are left to the kernel, as well as for
+// destinations that match a route of the local table
+struct route_entry {
+    uint32_t dst;        // network byte order, masked
+    uint32_t mask;       // network byte order
+    int dst_len;
+    uint32_t priority;
+    int local;
+    int oif;
+};
+
+static struct rtnl_handle listen_rth;
+static pthread_t listen_thread;
+static int cache_open = 0;
+
+// set by the listening thread when the kernel tables changed
+static pthread_mutex_t stale_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int cache_stale = 0;
+
+static struct route_entry *routes = NULL;
+static int route_count = 0;
+static int route_size = 0;
+
+// index in 'routes' of the first route of each table (local first)
+// and prefix length (longest first); the routes of table 'local' with
+// prefix length 'len' are in [route_starts[local][32 - len],
+// route_starts[local][32 - len + 1])
+static int route_starts[2][ROUTE_CACHE_PREFIX_LENS + 1];
+
+// number of policy rules, and how many of them are default ones
+static int rule_count = 0;
+static int default_rule_count = 0;
+
+static uint32_t
+prefix_mask(len)
+int len;
+{
+    if(len <= 0) {
+        return 0;
+    }
+
+    return htonl(0xFFFFFFFFU << (32 - len));
+}
+
+// order routes by table (local first), prefix length (longest first),
+// destination and priority (lowest first)
+static int
+route_entry_compare(a, b)
+const void *a;
+const void *b;
+{
+    const struct route_entry *ra = a;
+    const struct route_entry *rb = b;
+
+    if(ra->local != rb->local) {
+        return rb->local - ra->local;
+    }
+    if(ra->dst_len != rb->dst_len) {
+        return rb->dst_len - ra->dst_len;
+    }
+    if(ra->dst != rb->dst) {
+        return (ntohl(ra->dst) < ntohl(rb->dst)) ? -1 : 1;
+    }
+    if(ra->priority != rb->priority) {
+        return (ra->priority < rb->priority) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+// sort the routes and find the start of each table and prefix length
+static void
+route_cache_index(void)
+{
+    int i, local, len_i;
+
+    qsort(routes, route_count, sizeof(struct route_entry), route_entry_compare);
+
+    i = 0;
+    for(local = 1; local >= 0; local--) {
+        for(len_i = 0; len_i < ROUTE_CACHE_PREFIX_LENS; len_i++) {
+            route_starts[local][len_i] = i;
+            while(i < route_count && routes[i].local == local &&
+                  routes[i].dst_len == 32 - len_i) {
+                i++;
+            }
+        }
+        route_starts[local][ROUTE_CACHE_PREFIX_LENS] = i;
+    }
+}
+
+// return the index of the route with the lowest priority for
+// destination 'dst' among the routes of table 'local' with prefix
+// length 'len', or -1
+static int
+route_cache_search(local, len, dst)
+int local;
+int len;
+uint32_t dst;
+{
+    int low = route_starts[local][32 - len];
+    int high = route_starts[local][32 - len + 1];
+    int middle;
+    uint32_t key = ntohl(dst & prefix_mask(len));
+
+    while(low < high) {
+        middle = (low + high) / 2;
+        if(ntohl(routes[middle].dst) < key) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+
+    if(low < route_starts[local][32 - len + 1] && ntohl(routes[low].dst) == key) {
+        return low;
+    }
+
+    return -1;
+}
+
+// the kernel flushes the IPv4 routes of a device that goes down or
+// is removed without sending a notification for each of them
+static int
+route_cache_update_link(who, n)
+const struct sockaddr_nl *who;
+struct nlmsghdr *n;
+{
+    struct ifinfomsg *ifi = NLMSG_DATA(n);
+    int i;
+
+    if(n->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi))) {
+        return -1;
+    }
+
+    // keep the device names used by ll_index_to_name() up to date
+    ll_remember_index(who, n, NULL);
+    if(ifi->ifi_flags & IFF_UP) {
+        return 0;
+    }
+
+    for(i = 0; i < route_count; ) {
+        if(routes[i].oif == ifi->ifi_index) {
+            routes[i] = routes[--route_count];
+        }
+        else {
+            i++;
+        }
+    }
+
+    return 0;
+}
+
+// count the policy rules, and those that are the default ones, which
+// look up the local, main and default tables for all packets
+static int
+route_cache_update_rule(n)
+struct nlmsghdr *n;
+{
+    struct fib_rule_hdr *frh = NLMSG_DATA(n);
+    struct rtattr *tb[FRA_MAX+1];
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*frh));
+    uint32_t table, priority = 0;
+
+    if(len < 0) {
+        return -1;
+    }
+    if(frh->family != AF_INET) {
+        return 0;
+    }
+
+    parse_rtattr(tb, FRA_MAX, (struct rtattr*)(((char*)frh) + NLMSG_ALIGN(sizeof(*frh))), len);
+
+    rule_count++;
+
+    table = frh->table;
+    if(tb[FRA_TABLE]) {
+        table = *(uint32_t*)RTA_DATA(tb[FRA_TABLE]);
+    }
+    if(tb[FRA_PRIORITY]) {
+        priority = *(uint32_t*)RTA_DATA(tb[FRA_PRIORITY]);
+    }
+
+    if(frh->action != FR_ACT_TO_TBL || frh->dst_len != 0 || frh->src_len != 0 ||
+       frh->tos != 0 || (frh->flags & FIB_RULE_INVERT) || tb[FRA_IIFNAME] ||
+       tb[FRA_OIFNAME] || tb[FRA_FWMARK]) {
+        return 0;
+    }
+
+    if((priority == RULE_PRIORITY_LOCAL && table == RT_TABLE_LOCAL) ||
+       (priority == RULE_PRIORITY_MAIN && table == RT_TABLE_MAIN) ||
+       (priority == RULE_PRIORITY_DEFAULT && table == RT_TABLE_DEFAULT)) {
+        default_rule_count++;
+    }
+
+    return 0;
+}
+
+static int
+route_cache_update(who, n, arg)
+const struct sockaddr_nl *who;
+struct nlmsghdr *n;
+void *arg;
+{
+    struct rtmsg *r = NLMSG_DATA(n);
+    struct rtattr *tb[RTA_MAX+1];
+    struct route_entry entry;
+    struct route_entry *new_routes;
+    int len = n->nlmsg_len;
+    uint32_t table;
+
+    if(n->nlmsg_type == RTM_NEWLINK) {
+        return route_cache_update_link(who, n);
+    }
+    if(n->nlmsg_type == RTM_NEWRULE) {
+        return route_cache_update_rule(n);
+    }
+    if(n->nlmsg_type != RTM_NEWROUTE) {
+        return 0;
+    }
+
+    len -= NLMSG_LENGTH(sizeof(*r));
+    if(len < 0) {
+        return -1;
+    }
+    if(r->rtm_family != AF_INET) {
+        return 0;
+    }
+
+    parse_rtattr(tb, RTA_MAX, RTM_RTA(r), len);
+
+    table = r->rtm_table;
+    if(tb[RTA_TABLE]) {
+        table = *(uint32_t*)RTA_DATA(tb[RTA_TABLE]);
+    }
+    if(table != RT_TABLE_MAIN && table != RT_TABLE_LOCAL) {
+        return 0;
+    }
+
+    memset(&entry, 0, sizeof(entry));
+    entry.local = (table == RT_TABLE_LOCAL);
+    entry.dst_len = r->rtm_dst_len;
+    entry.mask = prefix_mask(entry.dst_len);
+    if(tb[RTA_DST]) {
+        memcpy(&entry.dst, RTA_DATA(tb[RTA_DST]), sizeof(entry.dst));
+    }
+    entry.dst &= entry.mask;
+    if(tb[RTA_PRIORITY]) {
+        entry.priority = *(uint32_t*)RTA_DATA(tb[RTA_PRIORITY]);
+    }
+    if(!entry.local && r->rtm_type == RTN_UNICAST && tb[RTA_OIF]) {
+        entry.oif = *(int*)RTA_DATA(tb[RTA_OIF]);
+    }
+
+    if(route_count == route_size) {
+        route_size = (route_size == 0) ? ROUTE_CACHE_INITIAL_SIZE : 2 * route_size;
+        new_routes = realloc(routes, route_size * sizeof(struct route_entry));
+        if(new_routes == NULL) {
+            fprintf(stderr, "Cannot allocate memory for route cache\n");
+            return -1;
+        }
+        routes = new_routes;
+    }
+    routes[route_count++] = entry;
+
+    return 0;
+}
+
+// replace the cached routes, devices and rules by a dump of the kernel
+// tables; the device list is dumped after the routes, so that the
+// routes of devices that are down are dropped
+static int
+route_cache_dump(void)
+{
+    struct rtnl_handle dump_rth;
+    int ret = 0;
+
+    if(rtnl_open(&dump_rth, 0) < 0) {
+        return -1;
+    }
+
+    route_count = 0;
+    rule_count = 0;
+    default_rule_count = 0;
+
+    if(rtnl_wilddump_request(&dump_rth, AF_INET, RTM_GETROUTE) < 0 ||
+       rtnl_dump_filter(&dump_rth, route_cache_update, NULL, NULL, NULL) < 0 ||
+       rtnl_wilddump_request(&dump_rth, AF_UNSPEC, RTM_GETLINK) < 0 ||
+       rtnl_dump_filter(&dump_rth, route_cache_update, NULL, NULL, NULL) < 0 ||
+       rtnl_wilddump_request(&dump_rth, AF_INET, RTM_GETRULE) < 0 ||
+       rtnl_dump_filter(&dump_rth, route_cache_update, NULL, NULL, NULL) < 0) {
+        fprintf(stderr, "Cannot dump routing table\n");
+        ret = -1;
+    }
+
+    rtnl_close(&dump_rth);
+
+    route_cache_index();
+
+    return ret;
+}
+
+// called by rtnl_listen() for each notification; any change of the
+// IPv4 routes, rules or devices invalidates the cache
+static int
+route_cache_notify(who, n, arg)
+const struct sockaddr_nl *who;
+struct nlmsghdr *n;
+void *arg;
+{
+    switch(n->nlmsg_type) {
+    case RTM_NEWROUTE:
+    case RTM_DELROUTE:
+    case RTM_NEWRULE:
+    case RTM_DELRULE:
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+        pthread_mutex_lock(&stale_mutex);
+        cache_stale = 1;
+        pthread_mutex_unlock(&stale_mutex);
+        break;
+    }
+
+    return 0;
+}
+
+// wait for notifications until the thread is cancelled; when
+// notifications are lost because the socket buffer is full, those
+// already in the buffer are still received, so that the cache is
+// invalidated after the lost changes
+static void*
+route_cache_listen(arg)
+void *arg;
+{
+    rtnl_listen(&listen_rth, route_cache_notify, NULL);
+
+    // the socket was closed by the kernel, so that changes
+    // are no longer received
+    pthread_mutex_lock(&stale_mutex);
+    cache_stale = -1;
+    pthread_mutex_unlock(&stale_mutex);
+
+    return NULL;
+}
+
+int
+route_cache_open(void)
+{
+    if(cache_open) {
+        return 0;
+    }
+
+    // subscribe before dumping, so that changes made during
+    // the dump invalidate the cache
+    if(rtnl_open(&listen_rth, RTMGRP_IPV4_ROUTE | RTMGRP_IPV4_RULE | RTMGRP_LINK) < 0) {
+        return -1;
+    }
+
+    cache_stale = 0;
+    if(route_cache_dump() < 0) {
+        rtnl_close(&listen_rth);
+        return -1;
+    }
+
+    if(pthread_create(&listen_thread, NULL, route_cache_listen, NULL) != 0) {
+        fprintf(stderr, "Cannot start route notification thread\n");
+        rtnl_close(&listen_rth);
+        return -1;
+    }
+
+    cache_open = 1;
+
+    return 0;
+}
+
+const char*
+route_cache_get_dev(addr)
+const char *addr;
+{
+    char host[INET_ADDRSTRLEN];
+    struct in_addr in;
+    const char *slash;
+    size_t len;
+    int stale;
+    int dst_len;
+    int i;
+
+    if(!cache_open || addr == NULL) {
+        return NULL;
+    }
+
+    // the flag is cleared before dumping, so that changes
+    // made during the dump invalidate the cache again
+    pthread_mutex_lock(&stale_mutex);
+    stale = cache_stale;
+    if(stale > 0) {
+        cache_stale = 0;
+    }
+    pthread_mutex_unlock(&stale_mutex);
+
+    if(stale < 0 || (stale > 0 && route_cache_dump() < 0)) {
+        fprintf(stderr, "Route cache disabled\n");
+        route_cache_close();
+        return NULL;
+    }
+
+    // with policy routing the tables used depend on the rules
+    if(rule_count != default_rule_count || default_rule_count != 3) {
+        return NULL;
+    }
+
+    slash = strchr(addr, '/');
+    len = (slash != NULL) ? (size_t)(slash - addr) : strlen(addr);
+    if(len >= sizeof(host)) {
+        return NULL;
+    }
+    memcpy(host, addr, len);
+    host[len] = '\0';
+
+    if(inet_pton(AF_INET, host, &in) != 1) {
+        return NULL;
+    }
+
+    // the local table is used first by the kernel, then the longest
+    // prefix match of the main table, with the lowest metric
+    for(dst_len = 32; dst_len >= 0; dst_len--) {
+        if(route_cache_search(1, dst_len, in.s_addr) >= 0) {
+            return NULL;
+        }
+    }
+
+    for(dst_len = 32; dst_len >= 0; dst_len--) {
+        if((i = route_cache_search(0, dst_len, in.s_addr)) >= 0) {
+            if(routes[i].oif == 0) {
+                return NULL;
+            }
+            return ll_index_to_name(routes[i].oif);
+        }
+    }
+
+    return NULL;
+}
+
+void
+route_cache_close(void)
+{
+    if(cache_open) {
+        pthread_cancel(listen_thread);
+        pthread_join(listen_thread, NULL);
+        rtnl_close(&listen_rth);
+        cache_open = 0;
+    }
+
+    free(routes);
+    routes = NULL;
+    route_count = 0;
+    route_size = 0;
+}
@@ -35,7 +35,7 @@ int show_raw = 0;
 int resolve_hosts = 0;
 int use_iec = 0;
 int force = 0;
-struct rtnl_handle rth;
+__thread struct rtnl_handle rth;
 
 static void *BODY = NULL;	/* cached handle dlopen(NULL) */
 static struct qdisc_util * qdisc_list;
@@ -0,0 +1,774 @@
+/*
+ * tc_reconcile.c Reconciliation of the tc state of devices with the
+ *                objects requested by a new configuration, so that
+ *                a configuration that is already installed is reused
+ *                instead of being deleted and rebuilt.
+ *
+ *      The existing qdiscs, classes and filters are dumped once; the
+ *      requests made by the tc functions are then intercepted in
+ *      rtnl_talk() and compared with them, whether they are sent in
+ *      a batch or one by one.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "utils.h"
+#include "tc_util.h"
+#include "tc_common.h"
+#include "ll_map.h"
+#include "tc_reconcile.h"
+
+#define RECONCILE_MAX_DEVS  128
+#define RECONCILE_HASH_SIZE 65536
+
+#define TC_OBJ_QDISC  0
+#define TC_OBJ_CLASS  1
+#define TC_OBJ_FILTER 2
+
+// parameters of qdiscs and classes compared with the dumped ones
+#define TC_PARAM_LATENCY    0   // netem
+#define TC_PARAM_JITTER     1
+#define TC_PARAM_LIMIT      2
+#define TC_PARAM_LOSS       3
+#define TC_PARAM_GAP        4
+#define TC_PARAM_DUPLICATE  5
+#define TC_PARAM_DELAY_CORR 6
+#define TC_PARAM_LOSS_CORR  7
+#define TC_PARAM_DUP_CORR   8
+#define TC_PARAM_REORDER    9
+#define TC_PARAM_REORDER_CORR 10
+#define TC_PARAM_RATE       11  // netem and htb class
+#define TC_PARAM_CEIL       12  // htb class
+#define TC_PARAM_BUFFER     13
+#define TC_PARAM_CBUFFER    14
+#define TC_PARAM_DEFCLS     15  // htb qdisc
+#define TC_PARAM_R2Q        16
+#define TC_PARAM_MAX        17
+
+// handle of the root table of u32 filters; all wireconf filters
+// have the same priority, hence they use a single u32 instance
+// whose root table is 800:
+#define U32_ROOT_HANDLE 0x80000000
+
+#define IS_INGRESS(h) (TC_H_MAJ(h) == TC_H_MAJ(TC_H_INGRESS))
+
+// qdisc, class or filter; qdiscs and classes are identified by
+// their handle on the device, filters by their parent, priority,
+// protocol and handle
+struct tc_object {
+    int type;
+    int ifindex;
+    uint32_t parent;
+    uint32_t handle;
+    uint32_t info;
+    char kind[16];
+
+    // contents of u32 filters
+    uint32_t htid;
+    uint32_t classid;
+    uint32_t link;
+    uint32_t divisor;
+    int sel_len;
+    unsigned char *sel;
+
+    // parameters of qdiscs and classes; only the parameters set in
+    // 'param_mask' are known, and requests with parameters that are
+    // not dumped (such as a delay distribution) are always sent
+    uint64_t params[TC_PARAM_MAX];
+    uint32_t param_mask;
+    int param_unknown;
+
+    int used;
+    int ignored;
+    struct tc_object *next;          // in the bucket of the handle
+    struct tc_object *next_contents; // in the bucket of the contents
+    struct tc_object *next_all;
+};
+
+struct reconcile_dev {
+    int ifindex;
+    int root_ok;        // root qdisc is htb 1:
+    int ingress_ok;     // ingress qdisc exists
+};
+
+static struct reconcile_dev devs[RECONCILE_MAX_DEVS];
+static int dev_number = 0;
+
+// objects are indexed by handle, and filters also by contents,
+// for requests that let the kernel choose the node id
+static struct tc_object *objects[RECONCILE_HASH_SIZE];
+static struct tc_object *contents[RECONCILE_HASH_SIZE];
+static struct tc_object *object_list = NULL;
+static struct tc_reconcile_stats stats;
+static int active = 0;
+
+static struct reconcile_dev*
+find_dev(ifindex)
+int ifindex;
+{
+    int i;
+
+    for(i = 0; i < dev_number; i++) {
+        if(devs[i].ifindex == ifindex) {
+            return &devs[i];
+        }
+    }
+
+    return NULL;
+}
+
+static unsigned
+object_hash(obj)
+struct tc_object *obj;
+{
+    uint32_t h;
+
+    h = obj->type * 0x9E3779B1U ^ obj->ifindex;
+    h = h * 0x9E3779B1U ^ obj->handle;
+    if(obj->type == TC_OBJ_FILTER) {
+        h = h * 0x9E3779B1U ^ obj->parent;
+        h = h * 0x9E3779B1U ^ obj->info;
+    }
+    h ^= h >> 16;
+
+    return h & (RECONCILE_HASH_SIZE - 1);
+}
+
+static unsigned
+contents_hash(obj)
+struct tc_object *obj;
+{
+    uint32_t h;
+    int i;
+
+    h = obj->ifindex * 0x9E3779B1U ^ obj->parent;
+    h = h * 0x9E3779B1U ^ obj->info;
+    h = h * 0x9E3779B1U ^ obj->htid;
+    h = h * 0x9E3779B1U ^ obj->classid;
+    h = h * 0x9E3779B1U ^ obj->link;
+    h = h * 0x9E3779B1U ^ obj->divisor;
+    for(i = 0; i < obj->sel_len; i++) {
+        h = h * 31 + obj->sel[i];
+    }
+    h ^= h >> 16;
+
+    return h & (RECONCILE_HASH_SIZE - 1);
+}
+
+static int
+object_same_key(a, b)
+struct tc_object *a;
+struct tc_object *b;
+{
+    if(a->type != b->type || a->ifindex != b->ifindex || a->handle != b->handle) {
+        return 0;
+    }
+    if(a->type == TC_OBJ_FILTER && (a->parent != b->parent || a->info != b->info)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+// return 1 if the contents of two objects with the same key are equal;
+// for qdiscs and classes, this only compares their kind
+static int
+object_same_contents(a, b)
+struct tc_object *a;
+struct tc_object *b;
+{
+    if(strcmp(a->kind, b->kind) != 0) {
+        return 0;
+    }
+    if(a->type != TC_OBJ_FILTER) {
+        return 1;
+    }
+
+    return (a->htid == b->htid && a->classid == b->classid && a->link == b->link &&
+            a->divisor == b->divisor && a->sel_len == b->sel_len &&
+            (a->sel_len == 0 || memcmp(a->sel, b->sel, a->sel_len) == 0));
+}
+
+// return 1 if the parameters of request 'req' are those of the
+// existing object 'obj'; parameters not sent with the request are
+// kept by the kernel when the object is changed, and aren't compared
+static int
+object_same_params(obj, req)
+struct tc_object *obj;
+struct tc_object *req;
+{
+    int i;
+
+    if(req->param_unknown || (req->param_mask & ~obj->param_mask) != 0) {
+        return 0;
+    }
+    for(i = 0; i < TC_PARAM_MAX; i++) {
+        if((req->param_mask & (1U << i)) && req->params[i] != obj->params[i]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void
+object_set_param(obj, param, value)
+struct tc_object *obj;
+int param;
+uint64_t value;
+{
+    obj->params[param] = value;
+    obj->param_mask |= 1U << param;
+}
+
+// parse the options of netem and htb qdiscs and classes
+static void
+object_parse_params(obj, opt)
+struct tc_object *obj;
+struct rtattr *opt;
+{
+    struct rtattr *nb[TCA_NETEM_MAX+1];
+    struct rtattr *hb[TCA_HTB_MAX+1];
+    struct tc_netem_qopt *qopt;
+    struct tc_netem_corr *cor;
+    struct tc_netem_reorder *reorder;
+    struct tc_htb_opt *hopt;
+    struct tc_htb_glob *gopt;
+
+    if(strcmp(obj->kind, "netem") == 0) {
+        if(RTA_PAYLOAD(opt) < sizeof(struct tc_netem_qopt)) {
+            obj->param_unknown = 1;
+            return;
+        }
+        qopt = RTA_DATA(opt);
+        object_set_param(obj, TC_PARAM_LATENCY, qopt->latency);
+        object_set_param(obj, TC_PARAM_JITTER, qopt->jitter);
+        object_set_param(obj, TC_PARAM_LIMIT, qopt->limit);
+        object_set_param(obj, TC_PARAM_LOSS, qopt->loss);
+        object_set_param(obj, TC_PARAM_GAP, qopt->gap);
+        object_set_param(obj, TC_PARAM_DUPLICATE, qopt->duplicate);
+
+        // nested attributes follow the aligned qopt structure
+        memset(nb, 0, sizeof(nb));
+        parse_rtattr(nb, TCA_NETEM_MAX, RTA_DATA(opt) + RTA_ALIGN(sizeof(struct tc_netem_qopt)),
+                     RTA_PAYLOAD(opt) - RTA_ALIGN(sizeof(struct tc_netem_qopt)));
+        if(nb[TCA_NETEM_CORR] && RTA_PAYLOAD(nb[TCA_NETEM_CORR]) >= sizeof(struct tc_netem_corr)) {
+            cor = RTA_DATA(nb[TCA_NETEM_CORR]);
+            object_set_param(obj, TC_PARAM_DELAY_CORR, cor->delay_corr);
+            object_set_param(obj, TC_PARAM_LOSS_CORR, cor->loss_corr);
+            object_set_param(obj, TC_PARAM_DUP_CORR, cor->dup_corr);
+        }
+        if(nb[TCA_NETEM_REORDER] && RTA_PAYLOAD(nb[TCA_NETEM_REORDER]) >= sizeof(struct tc_netem_reorder)) {
+            reorder = RTA_DATA(nb[TCA_NETEM_REORDER]);
+            object_set_param(obj, TC_PARAM_REORDER, reorder->probability);
+            object_set_param(obj, TC_PARAM_REORDER_CORR, reorder->correlation);
+        }
+        if(nb[TCA_NETEM_RATE64] && RTA_PAYLOAD(nb[TCA_NETEM_RATE64]) >= sizeof(uint64_t)) {
+            object_set_param(obj, TC_PARAM_RATE, *(uint64_t*)RTA_DATA(nb[TCA_NETEM_RATE64]));
+        }
+        else if(nb[TCA_NETEM_RATE] && RTA_PAYLOAD(nb[TCA_NETEM_RATE]) >= sizeof(struct tc_netem_rate)) {
+            object_set_param(obj, TC_PARAM_RATE, ((struct tc_netem_rate*)RTA_DATA(nb[TCA_NETEM_RATE]))->rate);
+        }
+        // the distribution table is not dumped
+        if(nb[TCA_NETEM_DELAY_DIST]) {
+            obj->param_unknown = 1;
+        }
+    }
+    else if(strcmp(obj->kind, "htb") == 0) {
+        memset(hb, 0, sizeof(hb));
+        parse_rtattr_nested(hb, TCA_HTB_MAX, opt);
+        if(obj->type == TC_OBJ_CLASS && hb[TCA_HTB_PARMS] &&
+           RTA_PAYLOAD(hb[TCA_HTB_PARMS]) >= sizeof(struct tc_htb_opt)) {
+            hopt = RTA_DATA(hb[TCA_HTB_PARMS]);
+            object_set_param(obj, TC_PARAM_RATE, hopt->rate.rate);
+            object_set_param(obj, TC_PARAM_CEIL, hopt->ceil.rate);
+            object_set_param(obj, TC_PARAM_BUFFER, hopt->buffer);
+            object_set_param(obj, TC_PARAM_CBUFFER, hopt->cbuffer);
+            if(hb[TCA_HTB_RATE64] && RTA_PAYLOAD(hb[TCA_HTB_RATE64]) >= sizeof(uint64_t)) {
+                object_set_param(obj, TC_PARAM_RATE, *(uint64_t*)RTA_DATA(hb[TCA_HTB_RATE64]));
+            }
+            if(hb[TCA_HTB_CEIL64] && RTA_PAYLOAD(hb[TCA_HTB_CEIL64]) >= sizeof(uint64_t)) {
+                object_set_param(obj, TC_PARAM_CEIL, *(uint64_t*)RTA_DATA(hb[TCA_HTB_CEIL64]));
+            }
+        }
+        if(obj->type == TC_OBJ_QDISC && hb[TCA_HTB_INIT] &&
+           RTA_PAYLOAD(hb[TCA_HTB_INIT]) >= sizeof(struct tc_htb_glob)) {
+            gopt = RTA_DATA(hb[TCA_HTB_INIT]);
+            object_set_param(obj, TC_PARAM_DEFCLS, gopt->defcls);
+            object_set_param(obj, TC_PARAM_R2Q, gopt->rate2quantum);
+        }
+    }
+}
+
+// fill in 'obj' from a request or a dumped object; for requests, the
+// handle of u32 filters is set to the one the kernel will assign, or
+// to 0 if the kernel chooses the node id; 'sel' points into 'n'
+static int
+object_parse(n, obj, request)
+struct nlmsghdr *n;
+struct tc_object *obj;
+int request;
+{
+    struct tcmsg *t = NLMSG_DATA(n);
+    struct rtattr *tb[TCA_MAX+1];
+    struct rtattr *ub[TCA_U32_MAX+1];
+    int len = n->nlmsg_len - NLMSG_LENGTH(sizeof(*t));
+
+    if(len < 0) {
+        return -1;
+    }
+
+    memset(obj, 0, sizeof(struct tc_object));
+    switch(n->nlmsg_type) {
+        case RTM_NEWQDISC:
+        case RTM_DELQDISC:
+            obj->type = TC_OBJ_QDISC;
+            break;
+        case RTM_NEWTCLASS:
+        case RTM_DELTCLASS:
+            obj->type = TC_OBJ_CLASS;
+            break;
+        case RTM_NEWTFILTER:
+        case RTM_DELTFILTER:
+            obj->type = TC_OBJ_FILTER;
+            break;
+        default:
+            return -1;
+    }
+    obj->ifindex = t->tcm_ifindex;
+    obj->parent = t->tcm_parent;
+    obj->handle = t->tcm_handle;
+    obj->info = (obj->type == TC_OBJ_FILTER) ? t->tcm_info : 0;
+
+    memset(tb, 0, sizeof(tb));
+    parse_rtattr(tb, TCA_MAX, TCA_RTA(t), len);
+    if(tb[TCA_KIND]) {
+        strncpy(obj->kind, RTA_DATA(tb[TCA_KIND]), sizeof(obj->kind) - 1);
+    }
+
+    if(obj->type != TC_OBJ_FILTER && tb[TCA_OPTIONS] != NULL) {
+        object_parse_params(obj, tb[TCA_OPTIONS]);
+    }
+    if(obj->type != TC_OBJ_FILTER || strcmp(obj->kind, "u32") != 0 || tb[TCA_OPTIONS] == NULL) {
+        return 0;
+    }
+
+    memset(ub, 0, sizeof(ub));
+    parse_rtattr_nested(ub, TCA_U32_MAX, tb[TCA_OPTIONS]);
+    if(ub[TCA_U32_CLASSID]) {
+        obj->classid = *(uint32_t*)RTA_DATA(ub[TCA_U32_CLASSID]);
+    }
+    if(ub[TCA_U32_LINK]) {
+        obj->link = *(uint32_t*)RTA_DATA(ub[TCA_U32_LINK]);
+    }
+    if(ub[TCA_U32_DIVISOR]) {
+        obj->divisor = *(uint32_t*)RTA_DATA(ub[TCA_U32_DIVISOR]);
+    }
+    if(ub[TCA_U32_SEL]) {
+        obj->sel_len = RTA_PAYLOAD(ub[TCA_U32_SEL]);
+        obj->sel = RTA_DATA(ub[TCA_U32_SEL]);
+    }
+
+    // hash tables keep the requested handle
+    if(obj->divisor != 0) {
+        return 0;
+    }
+
+    if(request) {
+        // filters are placed in the table (and bucket) given by
+        // TCA_U32_HASH, or else in the root table
+        obj->htid = U32_ROOT_HANDLE;
+        if(ub[TCA_U32_HASH] && TC_U32_HTID(*(uint32_t*)RTA_DATA(ub[TCA_U32_HASH])) != TC_U32_ROOT) {
+            obj->htid = *(uint32_t*)RTA_DATA(ub[TCA_U32_HASH]) & 0xFFFFF000;
+        }
+        obj->handle = TC_U32_NODE(t->tcm_handle) ? (obj->htid | TC_U32_NODE(t->tcm_handle)) : 0;
+    }
+    else {
+        obj->htid = obj->handle & 0xFFFFF000;
+    }
+
+    return 0;
+}
+
+static struct tc_object*
+object_find(key)
+struct tc_object *key;
+{
+    struct tc_object *obj;
+
+    for(obj = objects[object_hash(key)]; obj != NULL; obj = obj->next) {
+        if(!obj->ignored && object_same_key(obj, key)) {
+            return obj;
+        }
+    }
+
+    return NULL;
+}
+
+// find an unused filter with the same contents as 'key', for
+// requests that let the kernel choose the node id
+static struct tc_object*
+object_find_contents(key)
+struct tc_object *key;
+{
+    struct tc_object *obj;
+
+    for(obj = contents[contents_hash(key)]; obj != NULL; obj = obj->next_contents) {
+        if(!obj->ignored && !obj->used && obj->type == key->type &&
+           obj->ifindex == key->ifindex && obj->parent == key->parent &&
+           obj->info == key->info && object_same_contents(obj, key)) {
+            return obj;
+        }
+    }
+
+    return NULL;
+}
+
+// delete an existing object; the request is not intercepted
+static int
+object_delete(obj)
+struct tc_object *obj;
+{
+    struct {
+        struct nlmsghdr n;
+        struct tcmsg t;
+        char buf[256];
+    } req;
+    rtnl_intercept_t intercept;
+    int ret;
+
+    memset(&req, 0, sizeof(req));
+    req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct tcmsg));
+    req.n.nlmsg_flags = NLM_F_REQUEST;
+    switch(obj->type) {
+        case TC_OBJ_QDISC:
+            req.n.nlmsg_type = RTM_DELQDISC;
+            break;
+        case TC_OBJ_CLASS:
+            req.n.nlmsg_type = RTM_DELTCLASS;
+            break;
+        default:
+            req.n.nlmsg_type = RTM_DELTFILTER;
+            break;
+    }
+    req.t.tcm_family = AF_UNSPEC;
+    req.t.tcm_ifindex = obj->ifindex;
+    req.t.tcm_parent = obj->parent;
+    req.t.tcm_handle = obj->handle;
+    req.t.tcm_info = obj->info;
+    if(obj->kind[0]) {
+        addattr_l(&req.n, sizeof(req), TCA_KIND, obj->kind, strlen(obj->kind) + 1);
+    }
+
+    intercept = rth.intercept;
+    rth.intercept = NULL;
+    ret = rtnl_talk(&rth, &req.n, 0, 0, NULL, NULL, NULL);
+    rth.intercept = intercept;
+
+    return ret;
+}
+
+static int
+reconcile_store(who, n, arg)
+const struct sockaddr_nl *who;
+struct nlmsghdr *n;
+void *arg;
+{
+    struct tc_object key;
+    struct tc_object *obj;
+    unsigned h;
+
+    if(object_parse(n, &key, 0) < 0 || find_dev(key.ifindex) == NULL) {
+        return 0;
+    }
+    // filter dumps also list the protocol/priority heads, without handle
+    if(key.type == TC_OBJ_FILTER && key.handle == 0) {
+        return 0;
+    }
+
+    if((obj = malloc(sizeof(struct tc_object))) == NULL) {
+        fprintf(stderr, "Cannot allocate memory for tc state\n");
+        return -1;
+    }
+    *obj = key;
+    if(key.sel_len > 0) {
+        if((obj->sel = malloc(key.sel_len)) == NULL) {
+            free(obj);
+            fprintf(stderr, "Cannot allocate memory for tc state\n");
+            return -1;
+        }
+        memcpy(obj->sel, key.sel, key.sel_len);
+    }
+
+    h = object_hash(obj);
+    obj->next = objects[h];
+    objects[h] = obj;
+    if(obj->type == TC_OBJ_FILTER) {
+        h = contents_hash(obj);
+        obj->next_contents = contents[h];
+        contents[h] = obj;
+    }
+    obj->next_all = object_list;
+    object_list = obj;
+
+    return 0;
+}
+
+static void
+reconcile_free(void)
+{
+    struct tc_object *obj;
+    struct tc_object *next;
+
+    for(obj = object_list; obj != NULL; obj = next) {
+        next = obj->next_all;
+        free(obj->sel);
+        free(obj);
+    }
+    object_list = NULL;
+    memset(objects, 0, sizeof(objects));
+    memset(contents, 0, sizeof(contents));
+    dev_number = 0;
+}
+
+static int
+reconcile_dump(type, ifindex, parent)
+int type;
+int ifindex;
+uint32_t parent;
+{
+    struct tcmsg t;
+
+    memset(&t, 0, sizeof(t));
+    t.tcm_family = AF_UNSPEC;
+    t.tcm_ifindex = ifindex;
+    t.tcm_parent = parent;
+
+    if(rtnl_dump_request(&rth, type, &t, sizeof(t)) < 0) {
+        perror("Cannot send dump request");
+        return -1;
+    }
+    if(rtnl_dump_filter(&rth, reconcile_store, NULL, NULL, NULL) < 0) {
+        fprintf(stderr, "Dump terminated\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+reconcile_intercept(rtnl, n, arg)
+struct rtnl_handle *rtnl;
+struct nlmsghdr *n;
+void *arg;
+{
+    struct tcmsg *t = NLMSG_DATA(n);
+    struct reconcile_dev *dev;
+    struct tc_object key;
+    struct tc_object *obj;
+
+    switch(n->nlmsg_type) {
+        case RTM_NEWQDISC:
+        case RTM_NEWTCLASS:
+        case RTM_NEWTFILTER:
+        case RTM_DELQDISC:
+            break;
+        default:
+            return 0;
+    }
+    if(n->nlmsg_len < NLMSG_LENGTH(sizeof(struct tcmsg))) {
+        return 0;
+    }
+    if((dev = find_dev(t->tcm_ifindex)) == NULL) {
+        return 0;
+    }
+
+    // the objects below the root and ingress qdiscs are
+    // reconciled instead of being deleted with them
+    if(n->nlmsg_type == RTM_DELQDISC) {
+        if((t->tcm_parent == TC_H_ROOT && dev->root_ok) ||
+           (IS_INGRESS(t->tcm_parent) && dev->ingress_ok)) {
+            return 1;
+        }
+        return 0;
+    }
+
+    // changes of existing objects are always sent
+    if(!(n->nlmsg_flags & NLM_F_CREATE) || object_parse(n, &key, 1) < 0) {
+        return 0;
+    }
+
+    if(key.type == TC_OBJ_FILTER && key.handle == 0) {
+        obj = object_find_contents(&key);
+    }
+    else {
+        obj = object_find(&key);
+    }
+
+    if(obj == NULL || obj->used) {
+        stats.created++;
+        return 0;
+    }
+
+    obj->used = 1;
+    if(object_same_contents(obj, &key)) {
+        if(object_same_params(obj, &key)) {
+            stats.reused++;
+            return 1;
+        }
+
+        // a qdisc or class of the same kind with other parameters is
+        // changed in place, so that the objects below it are kept
+        n->nlmsg_flags &= ~NLM_F_EXCL;
+        stats.changed++;
+        return 0;
+    }
+
+    // an object with the same handle but other contents is replaced
+    if(object_delete(obj) < 0) {
+        return -1;
+    }
+    stats.replaced++;
+
+    return 0;
+}
+
+int
+tc_reconcile_begin(names, name_count)
+char **names;
+int name_count;
+{
+    struct tc_object *obj;
+    struct reconcile_dev *dev;
+    int ifindex;
+    int i;
+
+    if(active) {
+        return 0;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    dev_number = 0;
+    for(i = 0; i < name_count && dev_number < RECONCILE_MAX_DEVS; i++) {
+        if((ifindex = ll_name_to_index(names[i])) == 0) {
+            fprintf(stderr, "Cannot find device \"%s\"\n", names[i]);
+            continue;
+        }
+        if(find_dev(ifindex) == NULL) {
+            memset(&devs[dev_number], 0, sizeof(struct reconcile_dev));
+            devs[dev_number++].ifindex = ifindex;
+        }
+    }
+
+    // qdiscs of all devices are dumped at once
+    if(reconcile_dump(RTM_GETQDISC, 0, 0) < 0) {
+        reconcile_free();
+        return -1;
+    }
+
+    for(obj = object_list; obj != NULL; obj = obj->next_all) {
+        dev = find_dev(obj->ifindex);
+        if(obj->parent == TC_H_ROOT && obj->handle == TC_HANDLE(1, 0) && strcmp(obj->kind, "htb") == 0) {
+            dev->root_ok = 1;
+        }
+        if(obj->handle == TC_H_MAJ(TC_H_INGRESS)) {
+            dev->ingress_ok = 1;
+        }
+    }
+
+    // other root hierarchies are deleted and rebuilt as before
+    for(obj = object_list; obj != NULL; obj = obj->next_all) {
+        if(!find_dev(obj->ifindex)->root_ok && obj->handle != TC_H_MAJ(TC_H_INGRESS)) {
+            obj->ignored = 1;
+        }
+    }
+
+    for(i = 0; i < dev_number; i++) {
+        if(devs[i].root_ok && (reconcile_dump(RTM_GETTCLASS, devs[i].ifindex, 0) < 0 ||
+                               reconcile_dump(RTM_GETTFILTER, devs[i].ifindex, 0) < 0)) {
+            reconcile_free();
+            return -1;
+        }
+        if(devs[i].ingress_ok && reconcile_dump(RTM_GETTFILTER, devs[i].ifindex, TC_H_MAJ(TC_H_INGRESS)) < 0) {
+            reconcile_free();
+            return -1;
+        }
+    }
+
+    for(obj = object_list; obj != NULL; obj = obj->next_all) {
+        if(!obj->ignored) {
+            stats.existing++;
+        }
+    }
+
+    rth.intercept = reconcile_intercept;
+    rth.intercept_arg = NULL;
+    active = 1;
+
+    return 0;
+}
+
+int
+tc_reconcile_end(void)
+{
+    struct tc_object *obj;
+    struct tc_object key;
+    struct tc_object *parent_class;
+    int type;
+    int ret = 0;
+
+    if(!active) {
+        return 0;
+    }
+
+    rth.intercept = NULL;
+    active = 0;
+
+    // filters are removed first, as classes cannot be deleted while
+    // filters refer to them; leaf qdiscs are deleted with their class,
+    // and the root and ingress qdiscs are kept
+    for(type = TC_OBJ_FILTER; type >= TC_OBJ_QDISC; type--) {
+        for(obj = object_list; obj != NULL; obj = obj->next_all) {
+            if(obj->type != type || obj->used || obj->ignored) {
+                continue;
+            }
+            if(type == TC_OBJ_FILTER && TC_U32_KEY(obj->handle) == 0) {
+                continue;
+            }
+            if(type == TC_OBJ_QDISC) {
+                if(obj->parent == TC_H_ROOT || obj->handle == TC_H_MAJ(TC_H_INGRESS)) {
+                    continue;
+                }
+                memset(&key, 0, sizeof(key));
+                key.type = TC_OBJ_CLASS;
+                key.ifindex = obj->ifindex;
+                key.handle = obj->parent;
+                parent_class = object_find(&key);
+                if(parent_class != NULL && !parent_class->used) {
+                    continue;
+                }
+            }
+
+            if(object_delete(obj) < 0) {
+                ret = -1;
+            }
+            stats.removed++;
+        }
+    }
+
+    reconcile_free();
+
+    return ret;
+}
+
+struct tc_reconcile_stats*
+tc_reconcile_get_stats(void)
+{
+    return &stats;
+}
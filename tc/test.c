@@ -22,7 +22,7 @@
 int preferred_family = AF_UNSPEC;
 int oneline = 0;
 char * _SL_ = NULL;
-struct rtnl_handle rth;
+__thread struct rtnl_handle rth;
 
 char* get_route_info(char *info, char *addr)
 {
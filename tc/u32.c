@@ -721,6 +721,39 @@ struct tc_u32_sel *sel;
 	return 0;
 }
 
+// parse a hashkey specification of the form "mask 0x000000ff at 12"
+// (the same syntax as the iproute2 'hashkey' option)
+static int
+parse_hashkey_string(str, sel)
+char *str;
+struct tc_u32_sel *sel;
+{
+	char buf[64];
+	char *name;
+	char *value;
+	char *save_ptr;
+	struct filter_match match;
+
+	memset(&match, 0, sizeof(match));
+	strncpy(buf, str, sizeof(buf) - 1);
+	buf[sizeof(buf) - 1] = '\0';
+
+	name = strtok_r(buf, " ", &save_ptr);
+	while(name != NULL) {
+		if((value = strtok_r(NULL, " ", &save_ptr)) == NULL) {
+			return -1;
+		}
+		match.filter = name;
+		match.arg = value;
+		if(parse_hashkey(match, sel)) {
+			return -1;
+		}
+		name = strtok_r(NULL, " ", &save_ptr);
+	}
+
+	return 0;
+}
+
 int
 u32_filter_parse(handle, up, n, dev)
 uint32_t handle;
@@ -760,7 +793,14 @@ char* dev;
     		sel_ok++;
     	}
     }
-	if(up.classid) {
+	if(up.hashkey) {
+		if(parse_hashkey_string(up.hashkey, &sel.sel)) {
+			fprintf(stderr, "Illegal \"hashkey\"\n");
+			return -1;
+		}
+		sel_ok++;
+	}
+	if(up.classid[0] || up.classid[1]) {
 		unsigned classid;
         classid = TC_HANDLE(up.classid[0], up.classid[1]);
 		addattr_l(n, MAX_MSG, TCA_U32_CLASSID, &classid, 4);